@@ -30,6 +30,7 @@ CLI* CLI::Instance()
 
 CLI::CLI()
 {
+  showIOStats = false;
   rm = RelationManager::instance();
   Attribute attr;
 
@@ -186,6 +187,12 @@ RC CLI::process(const string input)
   a[input.size()] = 0;
   memcpy(a,input.c_str(),input.size());
 
+  // snapshot the I/O statistics to show the I/O of the command
+  bool showStats = showIOStats;
+  map<string, IOStats> ioStatsBefore;
+  if (showStats)
+    PagedFileManager::instance()->getIOStats(ioStatsBefore);
+
   // tokenize input
   char * tokenizer = strtok(a, DELIMITERS);
   if (tokenizer != NULL)
@@ -291,6 +298,26 @@ RC CLI::process(const string input)
       code = history();
     }
 
+    ////////////////////////////////////////////
+    // stats
+    // stats on | off | reset
+    ////////////////////////////////////////////
+    else if (expect(tokenizer, "stats")) {
+      tokenizer = next();
+      if (tokenizer == NULL) {
+        code = printIOStats(map<string, IOStats>());
+      }
+      else if (expect(tokenizer, "on") || expect(tokenizer, "off")) {
+        showIOStats = expect(tokenizer, "on");
+      }
+      else if (expect(tokenizer, "reset")) {
+        PagedFileManager::instance()->resetIOStats();
+        showStats = false;
+      }
+      else
+        code = error ("I expect <on>, <off> or <reset>");
+    }
+
     ////////////////////////////////////////////
     // select...
     ////////////////////////////////////////////
@@ -310,6 +337,8 @@ RC CLI::process(const string input)
       code = error ("i have no idea about this command, sorry");
     }
   }
+  if (showStats && code != EXIT_CODE)
+    printIOStats(ioStatsBefore);
   delete[] a;
   return code;
 }
@@ -1390,10 +1419,11 @@ RC CLI::printTable(const string tableName)
   if (rc != 0)
     return error ("table: " + tableName + " does not exist");
 
-  // Set up the iterator
+  // Set up the iterator, the tuples are read a batch at a time
   RM_ScanIterator rmsi;
-  RID rid;
-  void *data_returned = malloc(4096);
+  vector<RID> rids;
+  unsigned count;
+  void *data_returned = malloc(MAX_PAGE_SIZE);
   
 
   // convert attributes to vector<string>
@@ -1411,15 +1441,19 @@ RC CLI::printTable(const string tableName)
     outputBuffer.push_back(it->name);
   }
 
-  while( (rc = rmsi.getNextTuple(rid, data_returned)) != RM_EOF) {
+  while( (rc = rmsi.getNextBatch(data_returned, MAX_PAGE_SIZE, rids, count)) != RM_EOF) {
     if ( rc != 0) {
       cout << "fata" << endl;
       exit(1);
     }
       
-    if (this->updateOutputBuffer(outputBuffer, data_returned, attributes) != 0) {
-      free(data_returned);
-      return error("problem in updateOutputBuffer");
+    char *tuple = (char *)data_returned;
+    for (unsigned i = 0; i < count; i++) {
+      if (this->updateOutputBuffer(outputBuffer, tuple, attributes) != 0) {
+        free(data_returned);
+        return error("problem in updateOutputBuffer");
+      }
+      tuple += RecordBasedFileManager::instance()->getRecordSize(tuple, attributes);
     }
   }
   rmsi.close();
@@ -1455,6 +1489,11 @@ RC CLI::help(const string input)
     cout << "\tload <tableName> \"fileName\"";
     cout << ": loads given filName to given table" << endl;
   }
+  else if (input.compare("stats") == 0) {
+    cout << "\tstats: print the I/O statistics of each file" << endl;
+    cout << "\tstats on | off: print the I/O of each command after it runs" << endl;
+    cout << "\tstats reset: reset the I/O statistics" << endl;
+  }
   else if (input.compare("help") == 0) {
     cout << "\thelp <commandName>: print help for given command" << endl;
     cout << "\thelp: show help for all commands" << endl;
@@ -1487,6 +1526,7 @@ RC CLI::help(const string input)
     help("print");
     help("insert");
     help("load");
+    help("stats");
     help("help");
     help("query");
     help("quit");
@@ -1498,6 +1538,30 @@ RC CLI::help(const string input)
   return 0;
 }
 
+// Print the I/O statistics of the files changed since before, and their total
+RC CLI::printIOStats(const map<string, IOStats> &before)
+{
+  map<string, IOStats> after;
+  PagedFileManager::instance()->getIOStats(after);
+  IOStats total, none;
+  for (map<string, IOStats>::iterator itr = after.begin(); itr != after.end(); ++itr) {
+    map<string, IOStats>::const_iterator itrBefore = before.find(itr->first);
+    IOStats stats = itr->second;
+    if (itrBefore != before.end())
+      stats = stats - itrBefore->second;
+    if (memcmp(&stats, &none, sizeof(IOStats)) == 0)
+      continue;
+    cout << "  " << itr->first << ": ";
+    stats.print(cout);
+    cout << endl;
+    total += stats;
+  }
+  cout << "  total: ";
+  total.print(cout);
+  cout << endl;
+  return 0;
+}
+
 RC CLI::getAttributesFromCatalog(const string tableName, vector<Attribute> &columns)
 {
   return rm->getAttributes(tableName, columns);
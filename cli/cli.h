@@ -56,6 +56,7 @@ private:
   RC printIndex();
   RC help(const string input);
   RC history();
+  RC printIOStats(const map<string, IOStats> &before);
 
   // query parsers
   // code [0,4]: operation number
@@ -104,6 +105,7 @@ private:
   RC getAttribute(const string name, const vector<Attribute> pool, Attribute &attr);
 
   RelationManager * rm;
+  bool showIOStats;        // print the I/O of each command
   static CLI * _cli;
 };
 
@@ -3,6 +3,7 @@
 
 IndexManager* IndexManager::_index_manager = 0;
 SpaceManager* SpaceManager::_space_manager = 0;
+thread_local unsigned IndexManager::pageSize = PAGE_SIZE;
 
 IndexManager* IndexManager::instance()
 {
@@ -20,11 +21,11 @@ IndexManager::~IndexManager()
 {
 }
 
-RC IndexManager::createFile(const string &fileName)
+RC IndexManager::createFile(const string &fileName, unsigned pageSize)
 {
 	RC rc;
 	PagedFileManager *pfm = PagedFileManager::instance();
-	rc = pfm->createFile(fileName.c_str());
+	rc = pfm->createFile(fileName.c_str(), pageSize);
 	if(rc != SUCC) {
 		cerr << "IndexManager::createFile: create index file error " << fileName << " "<< rc << endl;
 		return rc;
@@ -35,8 +36,9 @@ RC IndexManager::createFile(const string &fileName)
 		cerr << "IndexManager::createFile: open index file error " << rc << endl;
 		return rc;
 	}
+	setPageSize(fileHandle);
 
-	char page[PAGE_SIZE];
+	char page[MAX_PAGE_SIZE];
 	PageNum totalPageNum = 0;
 	totalPageNum = fileHandle.getNumberOfPages();
 	setPageEmpty(page);
@@ -113,21 +115,22 @@ RC IndexManager::closeFile(FileHandle &fileHandle)
 
 RC IndexManager::insertEntry(FileHandle &fileHandle, const Attribute &attribute, const void *key, const RID &rid)
 {
+	setPageSize(fileHandle);
 	if (!SpaceManager::instance()->isIndexLoaded(fileHandle.fileName)) {
 		return IX_INDEX_FILE_NOT_OPEN;
 	}
 	RC rc;
-	char rootPage[PAGE_SIZE];
-	char copiedUpKey[PAGE_SIZE];
+	char *rootPage;
+	char copiedUpKey[MAX_PAGE_SIZE];
 	bool copiedUp = false;
 	PageNum copiedUpNextPageNum;
 	rc = insertEntry(ROOT_PAGE, fileHandle,
 			attribute, key, rid,
 			copiedUpKey, copiedUp, copiedUpNextPageNum);
-	// read the root page
-	rc = fileHandle.readPage(ROOT_PAGE, rootPage);
+	// pin the root page
+	rc = fileHandle.pinPage(ROOT_PAGE, rootPage);
 	if (rc != SUCC) {
-		cerr << "IndexManager::insertEntry: readPage error " << rc << endl;
+		cerr << "IndexManager::insertEntry: pinPage error " << rc << endl;
 		return rc;
 	}
 	// get the type of root
@@ -146,24 +149,19 @@ RC IndexManager::insertEntry(FileHandle &fileHandle, const Attribute &attribute,
 					0, copiedUpNextPageNum);
 			if (rc != SUCC) {
 				cerr << "IndexManager::insertEntry: insertEntryAtPos error 1 " << rc << endl;
-				return rc;
-			}
-			spaceAvailable = getFreeSpaceSize(rootPage);
-			// write the root page back
-			rc = fileHandle.writePage(ROOT_PAGE, rootPage);
-			if (rc != SUCC) {
-				cerr << "IndexManager::insertEntry: writePage error (root page) " << rc << endl;
+				fileHandle.unpinPage(ROOT_PAGE);
 				return rc;
 			}
 		} else {
 			// need to split the root again
-			char leftPage[PAGE_SIZE];
-			char rightPage[PAGE_SIZE];
-			char movedUpKey[PAGE_SIZE];
+			char leftPage[MAX_PAGE_SIZE];
+			char rightPage[MAX_PAGE_SIZE];
+			char movedUpKey[MAX_PAGE_SIZE];
 			rc = splitPageNonLeaf(rootPage, leftPage, rightPage,
 					attribute, copiedUpKey, copiedUpNextPageNum, movedUpKey);
 			if (rc != SUCC) {
 				cerr << "IndexManager::insertEntry: splitPageNonLeaf error " << rc << endl;
+				fileHandle.unpinPage(ROOT_PAGE);
 				return rc;
 			}
 
@@ -173,6 +171,7 @@ RC IndexManager::insertEntry(FileHandle &fileHandle, const Attribute &attribute,
 			rc = sm->getEmptyPage(fileHandle, newLeftPageNum);
 			if (rc != SUCC) {
 				cerr << "IndexManager::insertEntry: getEmptyPage error at left page " << rc << endl;
+				fileHandle.unpinPage(ROOT_PAGE);
 				return rc;
 			}
 			// get a new page for right page
@@ -180,6 +179,7 @@ RC IndexManager::insertEntry(FileHandle &fileHandle, const Attribute &attribute,
 			rc = sm->getEmptyPage(fileHandle, newRightPageNum);
 			if (rc != SUCC) {
 				cerr << "IndexManager::insertEntry: getEmptyPage error at left page " << rc << endl;
+				fileHandle.unpinPage(ROOT_PAGE);
 				return rc;
 			}
 
@@ -190,6 +190,7 @@ RC IndexManager::insertEntry(FileHandle &fileHandle, const Attribute &attribute,
 			rc = fileHandle.writePage(newLeftPageNum, leftPage);
 			if (rc != SUCC) {
 				cerr << "IndexManager::insertEntry: writePage error " << rc << endl;
+				fileHandle.unpinPage(ROOT_PAGE);
 				return rc;
 			}
 
@@ -197,6 +198,7 @@ RC IndexManager::insertEntry(FileHandle &fileHandle, const Attribute &attribute,
 			rc = fileHandle.writePage(newRightPageNum, rightPage);
 			if (rc != SUCC) {
 				cerr << "IndexManager::insertEntry: writePage error " << rc << endl;
+				fileHandle.unpinPage(ROOT_PAGE);
 				return rc;
 			}
 
@@ -211,12 +213,7 @@ RC IndexManager::insertEntry(FileHandle &fileHandle, const Attribute &attribute,
 					newLeftPageNum, newRightPageNum);
 			if (rc != SUCC) {
 				cerr << "IndexManager::insertEntry: insertEntryAtPos error " << rc << endl;
-				return rc;
-			}
-			// write the root page back
-			rc = fileHandle.writePage(ROOT_PAGE, rootPage);
-			if (rc != SUCC) {
-				cerr << "IndexManager::insertEntry: writePage error (root page) " << rc << endl;
+				fileHandle.unpinPage(ROOT_PAGE);
 				return rc;
 			}
 		}
@@ -224,37 +221,41 @@ RC IndexManager::insertEntry(FileHandle &fileHandle, const Attribute &attribute,
 	else if (copiedUp && isLeaf == CONST_IS_LEAF) {
 		// get a new page for left page
 		SpaceManager *sm = SpaceManager::instance();
-		char leftPage[PAGE_SIZE];
-		char rightPage[PAGE_SIZE];
+		char leftPage[MAX_PAGE_SIZE];
+		char *rightPage;
 		PageNum newPageNum;
 		rc = sm->getEmptyPage(fileHandle, newPageNum);
 		if (rc != SUCC) {
 			cerr << "IndexManager::insertEntry: getEmptyPage error " << rc << endl;
+			fileHandle.unpinPage(ROOT_PAGE);
 			return rc;
 		}
 		// copy root page to the left page
-		memcpy(leftPage, rootPage, PAGE_SIZE);
-
-		rc = fileHandle.readPage(copiedUpNextPageNum, rightPage);
-		if (rc != SUCC) {
-			cerr << "IndexManager::insertEntry: readPage (right page) error " << rc << endl;
-			return rc;
-		}
+		memcpy(leftPage, rootPage, pageSize);
 
 		// set the next page number
-		setPrevPageNum(rightPage, newPageNum);
 		setNextPageNum(leftPage, copiedUpNextPageNum);
 
 		// write the new left page back
 		rc = fileHandle.writePage(newPageNum, leftPage);
 		if (rc != SUCC) {
 			cerr << "IndexManager::insertEntry: writePage (left page) error " << rc << endl;
+			fileHandle.unpinPage(ROOT_PAGE);
+			return rc;
+		}
+
+		rc = fileHandle.pinPage(copiedUpNextPageNum, rightPage);
+		if (rc != SUCC) {
+			cerr << "IndexManager::insertEntry: pinPage (right page) error " << rc << endl;
+			fileHandle.unpinPage(ROOT_PAGE);
 			return rc;
 		}
-		// write the new right page back
-		rc = fileHandle.writePage(copiedUpNextPageNum, rightPage);
+		setPrevPageNum(rightPage, newPageNum);
+		// write the right page back
+		rc = fileHandle.unpinPage(copiedUpNextPageNum, true);
 		if (rc != SUCC) {
-			cerr << "IndexManager::insertEntry: writePage (right page) error " << rc << endl;
+			cerr << "IndexManager::insertEntry: unpinPage (right page) error " << rc << endl;
+			fileHandle.unpinPage(ROOT_PAGE);
 			return rc;
 		}
 
@@ -269,31 +270,35 @@ RC IndexManager::insertEntry(FileHandle &fileHandle, const Attribute &attribute,
 				newPageNum, copiedUpNextPageNum);
 		if (rc != SUCC) {
 			cerr << "IndexManager::insertEntry: insertEntryAtPos error " << rc << endl;
-			return rc;
-		}
-		// write the root page back
-		isLeaf = isPageLeaf(rootPage);
-		rc = fileHandle.writePage(ROOT_PAGE, rootPage);
-		if (rc != SUCC) {
-			cerr << "IndexManager::insertEntry: writePage error (root page) " << rc << endl;
+			fileHandle.unpinPage(ROOT_PAGE);
 			return rc;
 		}
 	}
-	return rc;
+	// write the root page back, it is changed if a child split
+	rc = fileHandle.unpinPage(ROOT_PAGE, copiedUp);
+	if (rc != SUCC) {
+		cerr << "IndexManager::insertEntry: writePage error (root page) " << rc << endl;
+		return rc;
+	}
+	return PagedFileManager::instance()->commit();
 }
 
 RC IndexManager::deleteEntry(FileHandle &fileHandle, const Attribute &attribute, const void *key, const RID &rid)
 {
+	setPageSize(fileHandle);
 	if (!SpaceManager::instance()->isIndexLoaded(fileHandle.fileName)) {
 		return IX_INDEX_FILE_NOT_OPEN;
 	}
 	RC rc;
 	rc = deleteEntry(ROOT_PAGE, fileHandle, attribute, key, rid);
-	return rc;
+	if (rc != SUCC)
+		return rc;
+	return PagedFileManager::instance()->commit();
 }
 
 // delete all entries
 RC IndexManager::deleteEntries(FileHandle &fileHandle) {
+	setPageSize(fileHandle);
 	RC rc;
 	SpaceManager *sp = SpaceManager::instance();
 
@@ -306,7 +311,7 @@ RC IndexManager::deleteEntries(FileHandle &fileHandle) {
 			return rc;
 		}
 	}
-	return SUCC;
+	return PagedFileManager::instance()->commit();
 }
 
 // scan() returns an iterator to allow the caller to go through the results
@@ -324,6 +329,7 @@ RC IndexManager::scan(FileHandle &fileHandle,
     bool        	highKeyInclusive,
     IX_ScanIterator &ix_ScanIterator)
 {
+	setPageSize(fileHandle);
 	if (!SpaceManager::instance()->isIndexLoaded(fileHandle.fileName)) {
 		return IX_INDEX_FILE_NOT_OPEN;
 	}
@@ -352,18 +358,24 @@ RC IndexManager::scan(FileHandle &fileHandle,
 		return SUCC;
 	}
 
-	char page[PAGE_SIZE];
+	const char *leaf;
 	RC rc;
 
 	bool skipFirst = true;
 
 	while (true) {
-		// read the page
-		rc = fileHandle.readPage(rid.pageNum, page);
+		// keys are read from the leaf page in place
+		rc = fileHandle.readPage(rid.pageNum, leaf);
 		if (rc != SUCC) {
 			cerr << "scan: readPage error " << rc << endl;
 			return rc;
 		}
+		char *page = (char *)leaf;
+		// start reading the next leaf while this one is scanned, unless it is buffered
+		PageNum nextLeaf = getNextPageNum(page);
+		if (nextLeaf != ROOT_PAGE &&
+				!PagedFileManager::instance()->bufferManager.isPageBuffered(fileHandle.fileName, nextLeaf))
+			fileHandle.prefetchPages(nextLeaf, 1);
 		// get the total slot number
 		SlotNum totalSlotNum = getSlotNum(page);
 		for (SlotNum sn = rid.slotNum; sn <= totalSlotNum; ++sn) {
@@ -372,6 +384,7 @@ RC IndexManager::scan(FileHandle &fileHandle,
 			rc = getIndexDir(page, indexDir, sn);
 			if (rc != SUCC) {
 				cerr << "scan: getIndexDir error " << rc << endl;
+				fileHandle.releasePage(leaf);
 				return rc;
 			}
 			char *key = page + indexDir.slotOffset;
@@ -390,10 +403,11 @@ RC IndexManager::scan(FileHandle &fileHandle,
 			} else {
 				cmpResult = compareKey(attribute, key, highKey);
 			}
-			if (highKeyInclusive && cmpResult > 0)
-				return SUCC;
-			if (!highKeyInclusive && cmpResult >= 0)
+			if ((highKeyInclusive && cmpResult > 0) ||
+					(!highKeyInclusive && cmpResult >= 0)) {
+				fileHandle.releasePage(leaf);
 				return SUCC;
+			}
 
 			if (skipFirst && lowKeyInclusive == false) { // i.e. IX_SEARCH_HIT!
 				skipFirst = false;
@@ -418,6 +432,7 @@ RC IndexManager::scan(FileHandle &fileHandle,
 					}
 					if (rc != SUCC) {
 						cerr << "scan: getNextDupRecord error " << rc << endl;
+						fileHandle.releasePage(leaf);
 						return rc;
 					}
 					unsigned long ridKey = dataRID.slotNum * PAGE_SIZE
@@ -433,6 +448,7 @@ RC IndexManager::scan(FileHandle &fileHandle,
 		}
 		rid.pageNum = getNextPageNum(page);
 		rid.slotNum = 1;
+		fileHandle.releasePage(leaf);
 		if (rid.pageNum == ROOT_PAGE) {
 			return SUCC;
 		}
@@ -821,26 +837,26 @@ bool IndexManager::isPageEmpty(void *page) {
 
 // free space operation
 void* IndexManager::getFreeSpaceStartPoint(const void *page) {
-	char *data = (char *)page + PAGE_SIZE - sizeof(Offset);
+	char *data = (char *)page + pageSize - sizeof(Offset);
 	Offset freeSpaceStartLen = *((Offset *)data);
 	data = (char *)page + freeSpaceStartLen;
 	return (void *)data;
 }
 Offset IndexManager::getFreeSpaceOffset(const void *page) {
-	char *data = (char *)page + PAGE_SIZE - sizeof(Offset);
+	char *data = (char *)page + pageSize - sizeof(Offset);
 	return *((Offset *)data);
 }
 void IndexManager::setFreeSpaceStartPoint(void *page, const void *point) {
 	Address addr_len = (Address)point - (Address)page;
 	Offset freeSpaceStartLen = (Offset)addr_len;
-	char *data = (char *)page + PAGE_SIZE - sizeof(Offset);
+	char *data = (char *)page + pageSize - sizeof(Offset);
 	memcpy(data, &freeSpaceStartLen, sizeof(Offset));
 }
 int IndexManager::getFreeSpaceSize(const void *page) {
-	char *data = (char *)page + PAGE_SIZE - sizeof(Offset);
+	char *data = (char *)page + pageSize - sizeof(Offset);
 	Offset freeSpaceStartLen = *((Offset *)data);
 	SlotNum totalSlotNum = getSlotNum(page);
-	int restSpace = PAGE_SIZE - freeSpaceStartLen
+	int restSpace = pageSize - freeSpaceStartLen
 			- sizeof(Offset)
 			- sizeof(PageNum)*2 - sizeof(IsLeaf)
 			- sizeof(SlotNum) - totalSlotNum * sizeof(IndexDir);
@@ -849,7 +865,7 @@ int IndexManager::getFreeSpaceSize(const void *page) {
 
 // leaf flag operation
 IsLeaf IndexManager::isPageLeaf(const void *page) {
-	char *data = (char *)page + PAGE_SIZE
+	char *data = (char *)page + pageSize
 			- sizeof(Offset)
 			- sizeof(IsLeaf);
 	IsLeaf isLeaf(CONST_NOT_LEAF);
@@ -857,7 +873,7 @@ IsLeaf IndexManager::isPageLeaf(const void *page) {
 	return isLeaf;
 }
 void IndexManager::setPageLeaf(void *page, const IsLeaf &isLeaf) {
-	char *data = (char *)page + PAGE_SIZE
+	char *data = (char *)page + pageSize
 			- sizeof(Offset)
 			- sizeof(IsLeaf);
 	memcpy(data, &isLeaf, sizeof(IsLeaf));
@@ -866,7 +882,7 @@ void IndexManager::setPageLeaf(void *page, const IsLeaf &isLeaf) {
 
 // set/get prev/next page number
 PageNum IndexManager::getPrevPageNum(const void *page) {
-	char *data = (char *)page + PAGE_SIZE - sizeof(Offset)
+	char *data = (char *)page + pageSize - sizeof(Offset)
 			- sizeof(IsLeaf)
 			- sizeof(PageNum);
 	PageNum pageNum(EOF_PAGE_NUM);
@@ -874,7 +890,7 @@ PageNum IndexManager::getPrevPageNum(const void *page) {
 	return pageNum;
 }
 PageNum IndexManager::getNextPageNum(const void *page) {
-	char *data = (char *)page + PAGE_SIZE - sizeof(Offset)
+	char *data = (char *)page + pageSize - sizeof(Offset)
 			- sizeof(IsLeaf)
 			- sizeof(PageNum)*2;
 	PageNum pageNum(EOF_PAGE_NUM);
@@ -883,13 +899,13 @@ PageNum IndexManager::getNextPageNum(const void *page) {
 }
 void IndexManager::setPrevPageNum(void *page,
 		const PageNum &pageNum) {
-	char *data = (char *)page + PAGE_SIZE - sizeof(Offset)
+	char *data = (char *)page + pageSize - sizeof(Offset)
 			- sizeof(IsLeaf)
 			- sizeof(PageNum);
 	memcpy(data, &pageNum, sizeof(PageNum));
 }
 void IndexManager::setNextPageNum(void *page, const PageNum &pageNum) {
-	char *data = (char *)page + PAGE_SIZE - sizeof(Offset)
+	char *data = (char *)page + pageSize - sizeof(Offset)
 			- sizeof(IsLeaf)
 			- sizeof(PageNum)*2;
 	memcpy(data, &pageNum, sizeof(PageNum));
@@ -897,7 +913,7 @@ void IndexManager::setNextPageNum(void *page, const PageNum &pageNum) {
 
 
 SlotNum IndexManager::getSlotNum(const void *page) {
-	char *data = (char *)page + PAGE_SIZE
+	char *data = (char *)page + pageSize
 			- sizeof(Offset)
 			- sizeof(PageNum)*2 - sizeof(IsLeaf) - sizeof(SlotNum);
 	SlotNum slotNum(0);
@@ -905,7 +921,7 @@ SlotNum IndexManager::getSlotNum(const void *page) {
 	return slotNum;
 }
 void IndexManager::setSlotNum(void *page, const SlotNum &slotNum) {
-	char *data = (char *)page + PAGE_SIZE
+	char *data = (char *)page + pageSize
 			- sizeof(Offset)
 			- sizeof(PageNum)*2 - sizeof(IsLeaf) - sizeof(SlotNum);
 	memcpy(data, &slotNum, sizeof(SlotNum));
@@ -916,7 +932,7 @@ RC IndexManager::getIndexDir(const void *page,
 	SlotNum totalSlotNum = getSlotNum(page);
 	if (totalSlotNum < slotNum)
 		return IX_SLOT_DIR_OVERFLOW;
-	char *data = (char *)page + PAGE_SIZE
+	char *data = (char *)page + pageSize
 				- sizeof(Offset)
 				- sizeof(PageNum)*2 - sizeof(IsLeaf)
 				- sizeof(SlotNum) - slotNum * sizeof(IndexDir);
@@ -929,7 +945,7 @@ RC IndexManager::setIndexDir(void *page,
 	SlotNum totalSlotNum = getSlotNum(page);
 	if (totalSlotNum < slotNum)
 		return IX_SLOT_DIR_OVERFLOW;
-	char *data = (char *)page + PAGE_SIZE
+	char *data = (char *)page + pageSize
 				- sizeof(Offset)
 				- sizeof(PageNum)*2 - sizeof(IsLeaf)
 				- sizeof(SlotNum) - slotNum * sizeof(IndexDir);
@@ -966,15 +982,16 @@ RC IndexManager::insertEntry(const PageNum &pageNum,
 	copiedUp = false;
 	RC rc;
 	SpaceManager *sm = SpaceManager::instance();
-	char page[PAGE_SIZE];
+	char *page;
 
-	rc = fileHandle.readPage(pageNum, page);
+	rc = fileHandle.pinPage(pageNum, page);
 	if (rc != SUCC) {
-		cerr << "IndexManager::insertEntry: error read page " << rc << endl;
+		cerr << "IndexManager::insertEntry: error pin page " << rc << endl;
 		return rc;
 	}
 	IsLeaf pageType = isPageLeaf(page);
 	if (pageType == CONST_IS_DUP_PAGE) {
+		fileHandle.unpinPage(pageNum);
 		cerr << "IndexManager::insertEntry: read dup page " << IX_READ_DUP_PAGE << endl;
 		return IX_READ_DUP_PAGE;
 	}
@@ -1006,7 +1023,7 @@ RC IndexManager::insertEntry(const PageNum &pageNum,
 		setPageLeaf(page, CONST_IS_LEAF);
 
 		// write disk
-		rc = fileHandle.writePage(pageNum, page);
+		rc = fileHandle.unpinPage(pageNum, true);
 		if (rc != SUCC) {
 			cerr << "IndexManager::insertEntry: error write root page " << rc << endl;
 			return rc;
@@ -1026,6 +1043,7 @@ RC IndexManager::insertEntry(const PageNum &pageNum,
 				cerr << "request slot num " << slotNum << endl;
 				cerr << "while there are only " << getSlotNum(page) << endl;
 				cerr << "IndexManager::insertEntry: get index dir error " << rc << endl;
+				fileHandle.unpinPage(pageNum);
 				return rc;
 			}
 			char *data = page + indexDir.slotOffset;
@@ -1044,6 +1062,7 @@ RC IndexManager::insertEntry(const PageNum &pageNum,
 						dupHeadRID, rid, dupAssignedRID);
 				if (rc != SUCC) {
 					cerr << "IndexManager::insertEntry: insert dup record error 1 " << rc << endl;
+					fileHandle.unpinPage(pageNum);
 					return rc;
 				}
 				memcpy(data + indexDir.recordLength-sizeof(Dup)-sizeof(RID),
@@ -1059,12 +1078,9 @@ RC IndexManager::insertEntry(const PageNum &pageNum,
 				if (rid2Insert.pageNum == rid.pageNum &&
 						rid2Insert.slotNum == rid.slotNum) {
 					// this is a dup record with the same key and rid
+					fileHandle.unpinPage(pageNum);
 					return IX_INSERT_DUP_KEY_RID;
 				}
-				// set the record to be dup
-				isDup = true;
-				memcpy(data + indexDir.recordLength - sizeof(Dup),
-						&isDup, sizeof(Dup));
 				// set the first record
 				dupHeadRID.pageNum = DUP_PAGENUM_END;
 				dupHeadRID.slotNum = 0;
@@ -1072,6 +1088,7 @@ RC IndexManager::insertEntry(const PageNum &pageNum,
 						dupHeadRID, rid, dupAssignedRID);
 				if (rc != SUCC) {
 					// cerr << "IndexManager::insertEntry: insert dup record error 2 " << rc << endl;
+					fileHandle.unpinPage(pageNum);
 					return rc;
 				}
 				// set the second record
@@ -1085,14 +1102,20 @@ RC IndexManager::insertEntry(const PageNum &pageNum,
 						dupHeadRID, dataRID, dupAssignedRID);
 				if (rc != SUCC) {
 					cerr << "IndexManager::insertEntry: insert dup record error 3 " << rc << endl;
+					fileHandle.unpinPage(pageNum);
 					return rc;
 				}
+				// set the record to be dup, the frame is only changed once
+				// the chain is in place
+				isDup = true;
+				memcpy(data + indexDir.recordLength - sizeof(Dup),
+						&isDup, sizeof(Dup));
 				// set the rid of the record at the page
 				memcpy(data + indexDir.recordLength - sizeof(Dup) - sizeof(RID),
 						&dupAssignedRID, sizeof(RID));
 			}
 			// write to the page
-			rc = fileHandle.writePage(pageNum, page);
+			rc = fileHandle.unpinPage(pageNum, true);
 			if (rc != SUCC) {
 				cerr << "IndexManager::insertEntry: write page error 1 " << rc << endl;
 				return rc;
@@ -1112,10 +1135,11 @@ RC IndexManager::insertEntry(const PageNum &pageNum,
 						key, keyLen, rid, false, 0, 0);
 				if (rc != SUCC) {
 					cerr << "IndexManager::insertEntry: insert entry error 3 " << rc << endl;
+					fileHandle.unpinPage(pageNum);
 					return rc;
 				}
 				// write to the page
-				rc = fileHandle.writePage(pageNum, page);
+				rc = fileHandle.unpinPage(pageNum, true);
 				if (rc != SUCC) {
 					cerr << "IndexManager::insertEntry: write page error 2 " << rc << endl;
 					return rc;
@@ -1123,19 +1147,21 @@ RC IndexManager::insertEntry(const PageNum &pageNum,
 			} else {
 				// the leaf page does not fit
 				// must split
-				char leftPage[PAGE_SIZE];
-				char rightPage[PAGE_SIZE];
+				char leftPage[MAX_PAGE_SIZE];
+				char rightPage[MAX_PAGE_SIZE];
 				copiedUp = true;
 				rc = splitPageLeaf(page, leftPage, rightPage,
 						attribute, key, rid, copiedUpKey);
 				if (rc != SUCC) {
 					cerr << "IndexManager::insertEntry: splitPageLeaf error " << rc << endl;
+					fileHandle.unpinPage(pageNum);
 					return rc;
 				}
 				// get an empty page to hold the right page
 				rc = sm->getEmptyPage(fileHandle, copiedUpNextPageNum);
 				if (rc != SUCC) {
 					cerr << "IndexManager::insertEntry: getEmptyPage error " << rc << endl;
+					fileHandle.unpinPage(pageNum);
 					return rc;
 				}
 				PageNum origNextPageNum = getNextPageNum(page);
@@ -1146,13 +1172,15 @@ RC IndexManager::insertEntry(const PageNum &pageNum,
 				rc = fileHandle.writePage(copiedUpNextPageNum, rightPage);
 				if (rc != SUCC) {
 					cerr << "IndexManager::insertEntry: writePage error " << rc << endl;
+					fileHandle.unpinPage(pageNum);
 					return rc;
 				}
 
 				setNextPageNum(leftPage, copiedUpNextPageNum);
 				setPrevPageNum(leftPage, origPrevPageNum);
 				// write to the page
-				rc = fileHandle.writePage(pageNum, leftPage);
+				memcpy(page, leftPage, pageSize);
+				rc = fileHandle.unpinPage(pageNum, true);
 				if (rc != SUCC) {
 					cerr << "IndexManager::insertEntry: write page error 1 " << rc << endl;
 					return rc;
@@ -1160,16 +1188,17 @@ RC IndexManager::insertEntry(const PageNum &pageNum,
 
 				// load next page affected, reset its page pointer
 				if (origNextPageNum != ROOT_PAGE) {
-					rc = fileHandle.readPage(origNextPageNum, rightPage);
+					char *nextPage;
+					rc = fileHandle.pinPage(origNextPageNum, nextPage);
 					if (rc != SUCC) {
-						cerr << "IndexManager::insertEntry: readPage(origNextPageNum, leftPage) error " << rc << endl;
+						cerr << "IndexManager::insertEntry: pinPage(origNextPageNum) error " << rc << endl;
 						return rc;
 					}
-					setPrevPageNum(rightPage, copiedUpNextPageNum);
+					setPrevPageNum(nextPage, copiedUpNextPageNum);
 					// write changes
-					rc = fileHandle.writePage(origNextPageNum, rightPage);
+					rc = fileHandle.unpinPage(origNextPageNum, true);
 					if (rc != SUCC) {
-						cerr << "IndexManager::insertEntry: writePage(origNextPageNum, leftPage) error " << rc << endl;
+						cerr << "IndexManager::insertEntry: unpinPage(origNextPageNum) error " << rc << endl;
 						return rc;
 					}
 				}
@@ -1191,6 +1220,7 @@ RC IndexManager::insertEntry(const PageNum &pageNum,
 			cerr << "request slot num " << slotNumtoLookat << endl;
 			cerr << "while there are only " << getSlotNum(page) << endl;
 			cerr << "IndexManager::insertEntry: get index dir error " << rc << endl;
+			fileHandle.unpinPage(pageNum);
 			return rc;
 		}
 		char *data = page + indexDir.slotOffset;
@@ -1206,6 +1236,9 @@ RC IndexManager::insertEntry(const PageNum &pageNum,
 		}
 		PageNum nextPageNum;
 		memcpy(&nextPageNum, data, sizeof(PageNum));
+		// the page is not held during the descent, so the pool needs no frame
+		// per level; the insertion below never changes it, slotNum stays valid
+		fileHandle.unpinPage(pageNum);
 		rc = insertEntry(nextPageNum,
 				fileHandle,
 				attribute, key, rid,
@@ -1216,6 +1249,11 @@ RC IndexManager::insertEntry(const PageNum &pageNum,
 		}
 		if (copiedUp) {
 			// its child split
+			rc = fileHandle.pinPage(pageNum, page);
+			if (rc != SUCC) {
+				cerr << "IndexManager::insertEntry: error pin page " << rc << endl;
+				return rc;
+			}
 			// begin insert the copied key to the nonleaf page
 			// first check the available size
 			int keyLen = getKeySize(attribute, copiedUpKey);
@@ -1229,10 +1267,11 @@ RC IndexManager::insertEntry(const PageNum &pageNum,
 						copiedUpKey, keyLen, rid, false, 0, copiedUpNextPageNum);
 				if (rc != SUCC) {
 					cerr << "IndexManager::insertEntry: insert entry error 1 " << rc << endl;
+					fileHandle.unpinPage(pageNum);
 					return rc;
 				}
 				// write to the page
-				rc = fileHandle.writePage(pageNum, page);
+				rc = fileHandle.unpinPage(pageNum, true);
 				if (rc != SUCC) {
 					cerr << "IndexManager::insertEntry: write page error 2 " << rc << endl;
 					return rc;
@@ -1243,18 +1282,20 @@ RC IndexManager::insertEntry(const PageNum &pageNum,
 					// the overflow page is the root page, process it outside
 					// if the page is not the root page, the left page is not copied
 					// this is the difference and reason to process root separately
+					fileHandle.unpinPage(pageNum);
 					return SUCC;
 				}
 				// split nonleaf page
-				char leftPage[PAGE_SIZE];
-				char rightPage[PAGE_SIZE];
-				char keyMovedUp[PAGE_SIZE];
+				char leftPage[MAX_PAGE_SIZE];
+				char rightPage[MAX_PAGE_SIZE];
+				char keyMovedUp[MAX_PAGE_SIZE];
 				PageNum movedUpNextPageNum;
 
 				rc = splitPageNonLeaf(page, leftPage, rightPage,
 						attribute, copiedUpKey, copiedUpNextPageNum, keyMovedUp);
 				if (rc != SUCC) {
 					cerr << "IndexManager::insertEntry: splitPageLeaf error " << rc << endl;
+					fileHandle.unpinPage(pageNum);
 					return rc;
 				}
 				// get the prev and next page number
@@ -1265,6 +1306,7 @@ RC IndexManager::insertEntry(const PageNum &pageNum,
 				rc = sm->getEmptyPage(fileHandle, movedUpNextPageNum);
 				if (rc != SUCC) {
 					cerr << "IndexManager::insertEntry: getEmptyPage error " << rc << endl;
+					fileHandle.unpinPage(pageNum);
 					return rc;
 				}
 				setNextPageNum(rightPage, origNextPageNum);
@@ -1273,13 +1315,15 @@ RC IndexManager::insertEntry(const PageNum &pageNum,
 				rc = fileHandle.writePage(movedUpNextPageNum, rightPage);
 				if (rc != SUCC) {
 					cerr << "IndexManager::insertEntry: writePage error " << rc << endl;
+					fileHandle.unpinPage(pageNum);
 					return rc;
 				}
 
 				setNextPageNum(leftPage, movedUpNextPageNum);
 				setPrevPageNum(leftPage, origPrevPageNum);
 				// write to the left page
-				rc = fileHandle.writePage(pageNum, leftPage);
+				memcpy(page, leftPage, pageSize);
+				rc = fileHandle.unpinPage(pageNum, true);
 				if (rc != SUCC) {
 					cerr << "IndexManager::insertEntry: write page error 1 " << rc << endl;
 					return rc;
@@ -1291,16 +1335,17 @@ RC IndexManager::insertEntry(const PageNum &pageNum,
 
 				// load next page affected
 				if (origNextPageNum != ROOT_PAGE) {
-					rc = fileHandle.readPage(origNextPageNum, rightPage);
+					char *nextPage;
+					rc = fileHandle.pinPage(origNextPageNum, nextPage);
 					if (rc != SUCC) {
-						cerr << "IndexManager::insertEntry: readPage(origNextPageNum, leftPage) error " << rc << endl;
+						cerr << "IndexManager::insertEntry: pinPage(origNextPageNum) error " << rc << endl;
 						return rc;
 					}
-					setPrevPageNum(rightPage, movedUpNextPageNum);
+					setPrevPageNum(nextPage, movedUpNextPageNum);
 					// write changes
-					rc = fileHandle.writePage(origNextPageNum, rightPage);
+					rc = fileHandle.unpinPage(origNextPageNum, true);
 					if (rc != SUCC) {
-						cerr << "IndexManager::insertEntry: writePage(origNextPageNum, leftPage) error " << rc << endl;
+						cerr << "IndexManager::insertEntry: unpinPage(origNextPageNum) error " << rc << endl;
 						return rc;
 					}
 				}
@@ -1316,15 +1361,16 @@ RC IndexManager::deleteEntry(const PageNum &pageNum,
 		const Attribute &attribute,
 		const void *key, const RID &rid) {
 	RC rc;
-	char page[PAGE_SIZE];
+	char *page;
 
-	rc = fileHandle.readPage(pageNum, page);
+	rc = fileHandle.pinPage(pageNum, page);
 	if (rc != SUCC) {
-		cerr << "IndexManager::deleteEntry: error read page " << rc << endl;
+		cerr << "IndexManager::deleteEntry: error pin page " << rc << endl;
 		return rc;
 	}
 	IsLeaf pageType = isPageLeaf(page);
 	if (pageType == CONST_IS_DUP_PAGE) {
+		fileHandle.unpinPage(pageNum);
 		cerr << "IndexManager::deleteEntry: read dup page " << IX_READ_DUP_PAGE << endl;
 		return IX_READ_DUP_PAGE;
 	}
@@ -1341,6 +1387,7 @@ RC IndexManager::deleteEntry(const PageNum &pageNum,
 			rc = getIndexDir(page, indexDir, slotNum);
 			if (rc != SUCC) {
 				cerr << "IndexManager::deleteEntry: getIndexDir error " << rc << endl;
+				fileHandle.unpinPage(pageNum);
 				return rc;
 			}
 			char *data = page + indexDir.slotOffset
@@ -1351,9 +1398,10 @@ RC IndexManager::deleteEntry(const PageNum &pageNum,
 				// good it is not duplicate, just delete
 				rc = deleteEntryAtPos(page, slotNum);
 				if (rc != SUCC) {
+					fileHandle.unpinPage(pageNum);
 					return rc;
 				}
-				rc = fileHandle.writePage(pageNum, page);
+				rc = fileHandle.unpinPage(pageNum, true);
 				if (rc != SUCC) {
 					cerr << "IndexManager::deleteEntry: writePage error " << rc << endl;
 					return rc;
@@ -1370,6 +1418,7 @@ RC IndexManager::deleteEntry(const PageNum &pageNum,
 				rc = sm->deleteDupRecord(fileHandle, dupHeadRID, rid);
 				if (rc != SUCC) {
 					// the record does not exist
+					fileHandle.unpinPage(pageNum);
 					return rc;
 				}
 				if (dupHeadRID.pageNum != DUP_PAGENUM_END) {
@@ -1380,13 +1429,14 @@ RC IndexManager::deleteEntry(const PageNum &pageNum,
 					// there is only one word left
 					deleteEntryAtPos(page, slotNum);
 				}
-				rc = fileHandle.writePage(pageNum, page);
+				rc = fileHandle.unpinPage(pageNum, true);
 				if (rc != SUCC) {
 					cerr << "IndexManager::deleteEntry: writePage error " << rc << endl;
 					return rc;
 				}
 			}
 		} else {
+			fileHandle.unpinPage(pageNum);
 			return rc_search;
 		}
 	} else if (pageType == CONST_NOT_LEAF) {
@@ -1403,6 +1453,7 @@ RC IndexManager::deleteEntry(const PageNum &pageNum,
 			cerr << "request slot num " << slotNumtoLookat << endl;
 			cerr << "while there are only " << getSlotNum(page) << endl;
 			cerr << "IndexManager::deleteEntry: get index dir error " << rc << endl;
+			fileHandle.unpinPage(pageNum);
 			return rc;
 		}
 		char *data = page + indexDir.slotOffset;
@@ -1419,6 +1470,8 @@ RC IndexManager::deleteEntry(const PageNum &pageNum,
 
 		PageNum nextPageNum;
 		memcpy(&nextPageNum, data, sizeof(PageNum));
+		// a delete never changes the nonleaf pages, so none is held below
+		fileHandle.unpinPage(pageNum);
 		rc = deleteEntry(nextPageNum, fileHandle, attribute,
 				key, rid);
 		if (rc != SUCC) {
@@ -1428,6 +1481,7 @@ RC IndexManager::deleteEntry(const PageNum &pageNum,
 		return rc;
 	}
 
+	fileHandle.unpinPage(pageNum);
 	cerr << "likely reach a dup page" << endl;
 	return IX_DEL_FAILURE;
 }
@@ -1438,16 +1492,19 @@ RC IndexManager::searchEntry(const PageNum &pageNum,
 		const Attribute &attribute,
 		const void *key, RID &rid) {
 	RC rc;
-	char page[PAGE_SIZE];
+	const char *node;
 
-	rc = fileHandle.readPage(pageNum, page);
+	// the page is only read, so search it in place
+	rc = fileHandle.readPage(pageNum, node);
 	if (rc != SUCC) {
 		cerr << "IndexManager::searchEntry: error read page " << rc << endl;
 		return rc;
 	}
+	char *page = (char *)node;
 	IsLeaf pageType = isPageLeaf(page);
 	if (pageType == CONST_IS_DUP_PAGE) {
 		cerr << "IndexManager::searchEntry: read dup page " << IX_READ_DUP_PAGE << endl;
+		fileHandle.releasePage(node);
 		return IX_READ_DUP_PAGE;
 	}
 
@@ -1469,6 +1526,7 @@ RC IndexManager::searchEntry(const PageNum &pageNum,
 			// if hit, good just find and return
 			rid.pageNum = pageNum;
 			rid.slotNum = slotNum;
+			fileHandle.releasePage(node);
 			return rc_search;
 		} else if (rc_search == IX_SEARCH_UPPER_BOUND){
 			PageNum nextPageNum = getNextPageNum(page);
@@ -1482,6 +1540,7 @@ RC IndexManager::searchEntry(const PageNum &pageNum,
 				rid.slotNum = slotNum;
 				rc_search = IX_SEARCH_HIT_MED;
 			}
+			fileHandle.releasePage(node);
 			return rc_search;
 		}
 	} else if (pageType == CONST_NOT_LEAF) {
@@ -1498,6 +1557,7 @@ RC IndexManager::searchEntry(const PageNum &pageNum,
 			cerr << "request slot num " << slotNumtoLookat << endl;
 			cerr << "while there are only " << getSlotNum(page) << endl;
 			cerr << "IndexManager::searchEntry: get index dir error " << rc << endl;
+			fileHandle.releasePage(node);
 			return rc;
 		}
 		char *data = page + indexDir.slotOffset;
@@ -1514,9 +1574,11 @@ RC IndexManager::searchEntry(const PageNum &pageNum,
 
 		PageNum nextPageNum;
 		memcpy(&nextPageNum, data, sizeof(PageNum));
+		fileHandle.releasePage(node);
 		rc_search = searchEntry(nextPageNum, fileHandle, attribute, key, rid);
 		return rc_search;
 	}
+	fileHandle.releasePage(node);
 	return rc_search;
 }
 
@@ -2009,7 +2071,7 @@ void IndexManager::printLeafPage(const void *page, const Attribute &attr) {
 void IndexManager::printKey(const Attribute &attr,
 		const void *key) {
 	stringstream ss;
-	char entry[PAGE_SIZE];
+	char entry[MAX_PAGE_SIZE];
 	int len(0);
 	switch (attr.type) {
 	case TypeInt:
@@ -2048,6 +2110,7 @@ SpaceManager::~SpaceManager()
 
 RC SpaceManager::initIndexFile(FileHandle &fileHandle,
 		const string &indexFileName) {
+	IndexManager::instance()->setPageSize(fileHandle);
 	RC rc;
 	IndexManager	*ix = IndexManager::instance();
 
@@ -2073,11 +2136,13 @@ RC SpaceManager::initIndexFile(FileHandle &fileHandle,
 	PageNum totalPageNum(0);
 	totalPageNum = fileHandle.getNumberOfPages();
 	for (PageNum pn = 1; pn < totalPageNum; ++pn) {
-		rc = fileHandle.readPage(pn, page);
+		const char *node;
+		rc = fileHandle.readPage(pn, node);
 		if (rc != SUCC) {
 			cerr << "initIndexFile: read page error " << rc << endl;
 			return rc;
 		}
+		char *page = (char *)node;
 		IsLeaf isDupPage = ix->isPageLeaf(page);
 		if(isDupPage == CONST_IS_DUP_PAGE) {
 			int availSpace = ix->getFreeSpaceSize(page);
@@ -2087,6 +2152,7 @@ RC SpaceManager::initIndexFile(FileHandle &fileHandle,
 		} else if(ix->isPageEmpty(page)) {
 			itrEmpty->second.insert(pn);
 		}
+		fileHandle.releasePage(node);
 	}
 
 	return SUCC;
@@ -2123,6 +2189,7 @@ RC SpaceManager::insertDupRecord(FileHandle &fileHandle,
 		const RID &dupHeadRID,
 		const RID &dataRID,
 		RID &dupAssignedRID) {
+	IndexManager::instance()->setPageSize(fileHandle);
 	RC rc;
 	// first check if there has been already inserted a dup record that
 	// has the same rid
@@ -2159,6 +2226,7 @@ RC SpaceManager::insertDupRecord(FileHandle &fileHandle,
 	IndexManager *ix = IndexManager::instance();
 
 	PageNum pageNum;
+	char *page;
 	int spaceAvailable = 0;
 	int loop = 0;
 	do {
@@ -2167,17 +2235,20 @@ RC SpaceManager::insertDupRecord(FileHandle &fileHandle,
 			cerr << "insertDupRecord: get dup page error " << rc << endl;
 			return rc;
 		}
-		rc = fileHandle.readPage(pageNum, page);
+		rc = fileHandle.pinPage(pageNum, page);
 		if (rc != SUCC) {
-			cerr << "insertDupRecord: read page error " << rc << endl;
+			cerr << "insertDupRecord: pin page error " << rc << endl;
 			return rc;
 		}
 		// check the space availability
 		spaceAvailable = ix->getFreeSpaceSize(page);
-		if (loop > 10) {
-			cerr << "insertDupRecord: fail to allocate new dup page " <<
-					IX_FAILTO_ALLOCATE_PAGE << endl;
-			return IX_FAILTO_ALLOCATE_PAGE;
+		if (spaceAvailable < DUP_RECORD_SIZE) {
+			fileHandle.unpinPage(pageNum);
+			if (loop > 10) {
+				cerr << "insertDupRecord: fail to allocate new dup page " <<
+						IX_FAILTO_ALLOCATE_PAGE << endl;
+				return IX_FAILTO_ALLOCATE_PAGE;
+			}
 		}
 		++loop;
 	} while (spaceAvailable < DUP_RECORD_SIZE);
@@ -2192,6 +2263,7 @@ RC SpaceManager::insertDupRecord(FileHandle &fileHandle,
 		rc = ix->getIndexDir(page, indexDir, sn);
 		if (rc != SUCC) {
 			cerr << "insertDupRecord: get slot dir error " << rc << endl;
+			fileHandle.unpinPage(pageNum);
 			return rc;
 		}
 		if (indexDir.slotOffset == DUP_SLOT_DEL) {
@@ -2220,11 +2292,13 @@ RC SpaceManager::insertDupRecord(FileHandle &fileHandle,
 	rc = ix->setIndexDir(page, indexDir, slotNum2Insert);
 	if (rc != SUCC) {
 		cerr << "insertDupRecord: get slot dir error " << rc << endl;
+		fileHandle.unpinPage(pageNum);
 		return rc;
 	}
+	spaceAvailable = ix->getFreeSpaceSize(page);
 
 	// write page back
-	rc = fileHandle.writePage(pageNum, page);
+	rc = fileHandle.unpinPage(pageNum, true);
 	if (rc != SUCC) {
 		cerr << "insertDupRecord: write page error " << rc << endl;
 		return rc;
@@ -2235,7 +2309,6 @@ RC SpaceManager::insertDupRecord(FileHandle &fileHandle,
 	dupAssignedRID.slotNum = slotNum2Insert;
 
 	// push the page to the list
-	spaceAvailable = ix->getFreeSpaceSize(page);
 	if (spaceAvailable >= DUP_RECORD_SIZE) {
 		putDupPage(fileHandle, pageNum);
 	}
@@ -2245,17 +2318,19 @@ RC SpaceManager::insertDupRecord(FileHandle &fileHandle,
 RC SpaceManager::deleteDupRecord(FileHandle &fileHandle,
 		RID &dupHeadRID,
 		const RID &dataRID) {
+	IndexManager::instance()->setPageSize(fileHandle);
 	IndexManager *ix = IndexManager::instance();
 	RC rc;
 	PageNum curPageNum = dupHeadRID.pageNum;
 	SlotNum curSlotNum = dupHeadRID.slotNum;
 	PageNum prevPageNum = dupHeadRID.pageNum;
 	SlotNum prevSlotNum = dupHeadRID.slotNum;
+	char *page;
 
 	while (true) {
-		rc = fileHandle.readPage(curPageNum, page);
+		rc = fileHandle.pinPage(curPageNum, page);
 		if (rc != SUCC) {
-			cerr << "deleteDupRecord: try to read page " <<
+			cerr << "deleteDupRecord: try to pin page " <<
 					curPageNum <<
 					" warning code " << rc << endl;
 			return rc;
@@ -2265,6 +2340,7 @@ RC SpaceManager::deleteDupRecord(FileHandle &fileHandle,
 		SlotNum totalSlotNum = ix->getSlotNum(page);
 		if (curSlotNum > totalSlotNum) {
 			cerr << "try to delete a dup record with nonexistence in page number" << endl;
+			fileHandle.unpinPage(curPageNum);
 			return IX_DEL_FAILURE;
 		}
 
@@ -2282,10 +2358,12 @@ RC SpaceManager::deleteDupRecord(FileHandle &fileHandle,
 				// nothing hit
 				// return
 				cerr << "try to delete a dup record, but does not exit in the index" << endl;
+				fileHandle.unpinPage(curPageNum);
 				return IX_DEL_FAILURE;
 			}
 			// not the record to be deleted
 			// get the next dup record
+			fileHandle.unpinPage(curPageNum);
 			prevPageNum = curPageNum;
 			prevSlotNum = curSlotNum;
 			curPageNum = nextRid.pageNum;
@@ -2303,9 +2381,12 @@ RC SpaceManager::deleteDupRecord(FileHandle &fileHandle,
 		} else {
 			// 1.2 the last one/a middle one
 			// need to change the next rid of previous page
-			rc = fileHandle.readPage(prevPageNum, prevPage);
+			// it may be the current page, whose frame then takes the change too
+			char *prevPage;
+			rc = fileHandle.pinPage(prevPageNum, prevPage);
 			if (rc != SUCC) {
-				cerr << "deleteDupRecord: read previous page error " << rc << endl;
+				cerr << "deleteDupRecord: pin previous page error " << rc << endl;
+				fileHandle.unpinPage(curPageNum);
 				return rc;
 			}
 			RID prevRID;
@@ -2315,9 +2396,10 @@ RC SpaceManager::deleteDupRecord(FileHandle &fileHandle,
 			// set the next RID info of previous page
 			data = prevPage + DUP_RECORD_SIZE * (prevSlotNum-1);
 			memcpy(data, &prevRID, sizeof(RID));
-			rc = fileHandle.writePage(prevPageNum, prevPage);
+			rc = fileHandle.unpinPage(prevPageNum, true);
 			if (rc != SUCC) {
 				cerr << "deleteDupRecord: write previous page error " << rc << endl;
+				fileHandle.unpinPage(curPageNum);
 				return rc;
 			}
 			// debug info
@@ -2334,18 +2416,15 @@ RC SpaceManager::deleteDupRecord(FileHandle &fileHandle,
 					*/
 		}
 
-		// reread page in case it is covered by previous operation
-		rc = fileHandle.readPage(curPageNum, page);
-		if (rc != SUCC) {
-			cerr << "deleteDupRecord: read page error " << rc << endl;
-			return rc;
-		}
 		// 2. need to reset the index dir
+		// the page is released dirty from here on, its frame may hold the
+		// change of the previous record
 		// get the Slot Dir;
 		if (totalSlotNum < curSlotNum) {
 			// this is not an error
 			// output a warning and return success
 			cerr << "deleteDupRecord: total slot num is less than current slot number " << rc << endl;
+			fileHandle.unpinPage(curPageNum, true);
 			return IX_DEL_FAILURE;
 		}
 		if (totalSlotNum == curSlotNum) {
@@ -2373,12 +2452,14 @@ RC SpaceManager::deleteDupRecord(FileHandle &fileHandle,
 			rc = ix->getIndexDir(page, indexDir, curSlotNum);
 			if (rc != SUCC) {
 				cerr << "deleteDupRecord: read slot dir error " << rc << endl;
+				fileHandle.unpinPage(curPageNum, true);
 				return rc;
 			}
 			// if the index dir is already deleted
 			// then everything is done, just return
 			if (indexDir.slotOffset == DUP_SLOT_DEL) {
 				cerr << "The dup record has already been deleted" << endl;
+				fileHandle.unpinPage(curPageNum, true);
 				return IX_DEL_FAILURE;
 			}
 
@@ -2387,12 +2468,14 @@ RC SpaceManager::deleteDupRecord(FileHandle &fileHandle,
 			rc = ix->setIndexDir(page, indexDir, curSlotNum);
 			if (rc != SUCC) {
 				cerr << "deleteDupRecord: set slot dir error " << rc << endl;
+				fileHandle.unpinPage(curPageNum, true);
 				return rc;
 			}
 		}
+		int spaceAvailable = ix->getFreeSpaceSize(page);
 
 		// write page back
-		rc = fileHandle.writePage(curPageNum, page);
+		rc = fileHandle.unpinPage(curPageNum, true);
 		if (rc != SUCC) {
 			cerr << "deleteDupRecord: write page error " << rc << endl;
 			return rc;
@@ -2401,7 +2484,6 @@ RC SpaceManager::deleteDupRecord(FileHandle &fileHandle,
 		// push the page to the list
 		// if a page already exists, no need for it already fits
 		// if a page does not exist, then push
-		int spaceAvailable = ix->getFreeSpaceSize(page);
 		if (!dupPageExist(fileHandle, curPageNum) &&
 				spaceAvailable > DUP_RECORD_SIZE)
 			putDupPage(fileHandle, curPageNum);
@@ -2422,25 +2504,29 @@ RC SpaceManager::deleteDupRecord(FileHandle &fileHandle,
 RC SpaceManager::getNextDupRecord(FileHandle &fileHandle,
 		RID &dupHeadRID,
 		RID &dataRID) {
+	IndexManager::instance()->setPageSize(fileHandle);
 	IndexManager *ix = IndexManager::instance();
 	RC rc;
 
-	char page[PAGE_SIZE];
-	rc = fileHandle.readPage(dupHeadRID.pageNum, page);
+	const char *dupPage;
+	rc = fileHandle.readPage(dupHeadRID.pageNum, dupPage);
 	if (rc != SUCC) {
 		cerr << "try to read page num " << dupHeadRID.pageNum << endl;
 		cerr << "getNextDupRecord:readPage error " << rc << endl;
 		return rc;
 	}
 
+	char *page = (char *)dupPage;
 	IndexDir indexDir;
 	rc = ix->getIndexDir(page, indexDir, dupHeadRID.slotNum);
 	if (rc != SUCC) {
 		cerr << "getNextDupRecord:getIndexDir error " << rc << endl;
+		fileHandle.releasePage(dupPage);
 		return rc;
 	}
 
 	if (indexDir.slotOffset == DUP_SLOT_DEL) {
+		fileHandle.releasePage(dupPage);
 		return IX_SEARCH_NOT_HIT;
 	}
 
@@ -2448,6 +2534,7 @@ RC SpaceManager::getNextDupRecord(FileHandle &fileHandle,
 	memcpy(&dataRID, data + sizeof(RID), sizeof(RID));
 	memcpy(&dupHeadRID, data, sizeof(RID));
 
+	fileHandle.releasePage(dupPage);
 	return SUCC;
 }
 
@@ -2496,6 +2583,7 @@ bool SpaceManager::dupPageExist(FileHandle &fileHandle,
 // if no empty page exists, new one and return that
 RC SpaceManager::getEmptyPage(FileHandle &fileHandle,
 		PageNum &pageNum) {
+	IndexManager::instance()->setPageSize(fileHandle);
 	RC rc = SUCC;
 	auto itr = emptyPageList.find(fileHandle.fileName);
 	if (itr == emptyPageList.end() ||
@@ -2503,6 +2591,8 @@ RC SpaceManager::getEmptyPage(FileHandle &fileHandle,
 		IndexManager *ix = IndexManager::instance();
 		// no empty page, new one
 		PageNum totalPageNum = fileHandle.getNumberOfPages();
+		char page[MAX_PAGE_SIZE];
+		memset(page, 0, fileHandle.getPageSize());
 		ix->setPageEmpty(page);
 		rc = fileHandle.appendPage(page);
 		if (rc != SUCC) {
@@ -2520,13 +2610,20 @@ RC SpaceManager::getEmptyPage(FileHandle &fileHandle,
 }
 RC SpaceManager::putEmptyPage(FileHandle &fileHandle,
 		const PageNum &pageNum) {
+	IndexManager::instance()->setPageSize(fileHandle);
 	IndexManager *ix = IndexManager::instance();
 	RC rc;
+	char *page;
 
+	rc = fileHandle.pinPage(pageNum, page);
+	if(rc != SUCC) {
+		cerr << "putEmptyPage: pin page error " << rc << endl;
+		return rc;
+	}
 	ix->setPageEmpty(page);
 
 	// write page to disk
-	rc = fileHandle.writePage(pageNum, page);
+	rc = fileHandle.unpinPage(pageNum, true);
 	if(rc != SUCC) {
 		cerr << "putEmptyPage: get new page error " << rc << endl;
 		return rc;
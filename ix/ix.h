@@ -74,7 +74,7 @@ class IndexManager {
  public:
   static IndexManager* instance();
 
-  RC createFile(const string &fileName);
+  RC createFile(const string &fileName, unsigned pageSize = PAGE_SIZE);
 
   RC destroyFile(const string &fileName);
 
@@ -111,7 +111,11 @@ class IndexManager {
 
  private:
   static IndexManager *_index_manager;
+  // kept per thread, so that threads work on indexes of different page sizes at once
+  static thread_local unsigned pageSize;		// page size of the index being worked on
  public:
+  // use the page size of the index for the page layout below
+  void setPageSize(FileHandle &fileHandle) { pageSize = fileHandle.getPageSize(); }
   // api to handle an index page
   void setPageEmpty(void *page);
   bool isPageEmpty(void *page);
@@ -288,9 +292,6 @@ public:
 			PageNum &pageNum);
 	RC putEmptyPage(FileHandle &fileHandle,
 			const PageNum &pageNum);
-private:
-	char page[PAGE_SIZE];
-	char prevPage[PAGE_SIZE];
 };
 
 
@@ -1941,6 +1941,59 @@ void basic_test_scan_string() {
 	cout << "******************end scan test string" << endl;
 }
 
+void basic_test_page_size() {
+	cout << "******************begin page size test" << endl;
+	string indexFileName = "test_page_size";
+	Attribute attr;
+	attr.length = 4;
+	attr.name = "age";
+	attr.type = TypeInt;
+	const int numTuple = 5000;
+
+	// the same keys in 4 KB and 16 KB pages
+	PageNum totalPageNum[2];
+	unsigned pageSizes[2] = {PAGE_SIZE, PAGE_SIZE * 4};
+	for (int i = 0; i < 2; ++i) {
+		remove(indexFileName.c_str());
+		FileHandle fileHandle;
+		RC rc = ix->createFile(indexFileName, pageSizes[i]);
+		assert(rc == success);
+		rc = ix->openFile(indexFileName, fileHandle);
+		assert(rc == success);
+		assert(fileHandle.getPageSize() == pageSizes[i]);
+
+		RID rid;
+		for (int key = 0; key < numTuple; ++key) {
+			rid.pageNum = key;
+			rid.slotNum = key;
+			rc = ix->insertEntry(fileHandle, attr, &key, rid);
+			assert(rc == success);
+		}
+
+		IX_ScanIterator ix_ScanIterator;
+		rc = ix->scan(fileHandle, attr, NULL, NULL, true, true, ix_ScanIterator);
+		assert(rc == success);
+		int key, count = 0;
+		while (ix_ScanIterator.getNextEntry(rid, &key) == success) {
+			assert(key == count && rid.pageNum == unsigned(count));
+			++count;
+		}
+		assert(count == numTuple);
+		rc = ix_ScanIterator.close();
+		assert(rc == success);
+
+		totalPageNum[i] = fileHandle.getNumberOfPages();
+		rc = ix->closeFile(fileHandle);
+		assert(rc == success);
+		rc = ix->destroyFile(indexFileName);
+		assert(rc == success);
+	}
+	// the larger pages hold more keys each
+	assert(totalPageNum[1] < totalPageNum[0]);
+
+	cout << "******************end page size test" << endl;
+}
+
 int main()
 {
 	cout << "Begin tests" << endl;
@@ -1973,6 +2026,7 @@ int main()
 	basic_test_scan_float();
 	basic_test_scan_float();
 	basic_test_scan_string();
+	basic_test_page_size();
 
 
 	cout << "Finish all tests" << endl;
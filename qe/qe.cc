@@ -123,7 +123,7 @@ int getRecordSize(char *data, const vector<Attribute> &attrs) {
  * 				Filter
  *
  */
-Filter::Filter(Iterator* input, const Condition &condition) {
+Filter::Filter(Iterator* input, const Condition &condition) : batchIndex(0), inputEnd(false) {
 	// set the iterator
 	iter = input;
 
@@ -162,13 +162,66 @@ RC Filter::getNextTuple(void *data) {
 	}
 	RC rc;
 
-	do {
-		rc = iter->getNextTuple(data);
-		if (rc != SUCC) {
-			return QE_EOF;
+	// strings and a missing condition are compared a tuple at a time
+	if (type == TypeVarChar || compOp == NO_OP) {
+		do {
+			rc = iter->getNextTuple(data);
+			if (rc != SUCC) {
+				return QE_EOF;
+			}
+		} while (!compareValue(data));
+		return SUCC;
+	}
+
+	while (true) {
+		if (batchIndex + 1 >= batchOffsets.size()) {
+			rc = loadBatch();
+			if (rc != SUCC) {
+				return QE_EOF;
+			}
 		}
-	} while (!compareValue(data));
+		unsigned index = batchIndex++;
+		if (selection[index / 8] & (1 << (index % 8))) {
+			memcpy(data, &batch[batchOffsets[index]],
+					batchOffsets[index + 1] - batchOffsets[index]);
+			return SUCC;
+		}
+	}
+}
+// read the next batch of tuples and select them at once
+RC Filter::loadBatch() {
+	batchIndex = 0;
+	batchOffsets.assign(1, 0);
+	runValues.clear();
+	unsigned used = 0;
+	while (!inputEnd && runValues.size() < FILTER_BATCH_TUPLES) {
+		// room for the largest tuple, as for the batches of a table scan
+		if (batch.size() < used + MAX_PAGE_SIZE) {
+			batch.resize(used + MAX_PAGE_SIZE);
+		}
+		if (iter->getNextTuple(&batch[used]) != SUCC) {
+			inputEnd = true;
+			break;
+		}
+		// gather the condition value, 4 bytes for an int and a real alike
+		int lhs;
+		memcpy(&lhs, locateValue(&batch[used]), sizeof(int));
+		runValues.push_back(lhs);
+		used += getRecordSize(&batch[used], attributeNames);
+		batchOffsets.push_back(used);
+	}
+	if (runValues.empty()) {
+		return QE_EOF;
+	}
 
+	selection.resize(SELECTION_BYTES(runValues.size()));
+	if (type == TypeInt) {
+		selectValues(&runValues[0], runValues.size(), compOp,
+				*((int *)value), &selection[0]);
+	} else {
+		selectValues((const float *)&runValues[0], runValues.size(), compOp,
+				*((float *)value), &selection[0]);
+	}
 	return SUCC;
 }
 // For attribute in vector<Attribute>, name it as rel.attr
@@ -191,10 +244,9 @@ void Filter::copyValue(const Value &input) {
 	}
 }
 
-bool Filter::compareValue(void *input) {
-	char *lhs_value = (char *)input;
-	int len;
-
+// locate the condition value of a tuple
+char *Filter::locateValue(char *input) {
+	char *lhs_value = input;
 	for (Attribute attr : attributeNames) {
 		if (attr.name == lhsAttr) {
 			break;
@@ -202,6 +254,12 @@ bool Filter::compareValue(void *input) {
 		// move pointer
 		movePointer(lhs_value, attr.type);
 	}
+	return lhs_value;
+}
+
+bool Filter::compareValue(void *input) {
+	char *lhs_value = locateValue((char *)input);
+	int len;
 
 
 	int lhs_int, rhs_int;
@@ -606,6 +664,10 @@ Aggregate::Aggregate(Iterator *input,                              // Iterator o
 	initStatus = true;
 	// set iterator
 	iter = input;
+	// a table scan reads only the attribute aggregated
+	TableScan *tableScan = dynamic_cast<TableScan *>(input);
+	if (tableScan != NULL)
+		tableScan->setProjection(vector<string>(1, aggAttr.name));
 	// set the attributes of iterator
 	iter->getAttributes(attrs);
 	// set aggAttr;
@@ -628,6 +690,14 @@ Aggregate::Aggregate(Iterator *input,                              // Iterator o
 	initStatus = true;
 	// set iterator
 	iter = input;
+	// a table scan reads only the attributes aggregated and grouped by
+	TableScan *tableScan = dynamic_cast<TableScan *>(input);
+	if (tableScan != NULL) {
+		vector<string> names(1, aggAttr.name);
+		if (gAttr.name != aggAttr.name)
+			names.push_back(gAttr.name);
+		tableScan->setProjection(names);
+	}
 	// set the attributes of iterator
 	iter->getAttributes(attrs);
 	// set aggAttr;
@@ -19,6 +19,9 @@ using namespace std;
 #define QE_FAIL_TO_FIND_CONDITION_ATTRIBUTE 111
 #define QE_FAIL_TO_LOAD_INNER_DATA 112
 
+#define TABLE_SCAN_BATCH_SIZE MAX_PAGE_SIZE	// defines the bytes of tuples a table scan reads at a time
+#define FILTER_BATCH_TUPLES 256				// defines # of tuples a filter selects at a time
+
 // get the table and condition attribute name from table.attribute
 RC getTableAttributeName(const string &tableAttribute,
 		string &table, string &attribute);
@@ -122,14 +125,21 @@ class TableScan : public Iterator
         RelationManager &rm;
         RM_ScanIterator *iter;
         string tableName;
+        string relationName;        // the table scanned, tableName may be its alias
         vector<Attribute> attrs;
         vector<string> attrNames;
         RID rid;
+        // tuples read ahead with getNextBatch, handed out one at a time
+        vector<char> batch;
+        vector<RID> batchRids;
+        unsigned batchCount, batchIndex, batchOffset;
 
-        TableScan(RelationManager &rm, const string &tableName, const char *alias = NULL):rm(rm)
+        TableScan(RelationManager &rm, const string &tableName, const char *alias = NULL):rm(rm),
+                batch(TABLE_SCAN_BATCH_SIZE), batchCount(0), batchIndex(0), batchOffset(0)
         {
         	//Set members
         	this->tableName = tableName;
+        	relationName = tableName;
 
             // Get Attributes from RM
             rm.getAttributes(tableName, attrs);
@@ -156,12 +166,47 @@ class TableScan : public Iterator
             iter->close();
             delete iter;
             iter = new RM_ScanIterator();
-            rm.scan(tableName, "", NO_OP, NULL, attrNames, *iter);
+            rm.scan(relationName, "", NO_OP, NULL, attrNames, *iter);
+            batchCount = batchIndex = batchOffset = 0;
+        };
+
+        // Read only the attributes named as rel.attr, the scan starts again
+        // Nothing changes unless all of them are found
+        void setProjection(const vector<string> &names)
+        {
+            vector<Attribute> projected;
+            for (unsigned i = 0; i < attrs.size(); ++i) {
+                for (unsigned j = 0; j < names.size(); ++j) {
+                    if (names[j] == tableName + "." + attrs[i].name) {
+                        projected.push_back(attrs[i]);
+                        break;
+                    }
+                }
+            }
+            if (projected.size() != names.size())
+                return;
+            attrs = projected;
+            attrNames.clear();
+            for (unsigned i = 0; i < attrs.size(); ++i)
+                attrNames.push_back(attrs[i].name);
+            setIterator();
         };
 
         RC getNextTuple(void *data)
         {
-            return iter->getNextTuple(rid, data);
+            // read the next batch when the tuples of the last one are used up
+            if (batchIndex >= batchCount) {
+                RC rc = iter->getNextBatch(&batch[0], batch.size(), batchRids, batchCount);
+                if (rc != SUCC)
+                    return rc;
+                batchIndex = batchOffset = 0;
+            }
+            unsigned size = RecordBasedFileManager::instance()->getRecordSize(
+                    &batch[batchOffset], attrs);
+            memcpy(data, &batch[batchOffset], size);
+            rid = batchRids[batchIndex++];
+            batchOffset += size;
+            return SUCC;
         };
 
         void getAttributes(vector<Attribute> &attrs) const
@@ -284,9 +329,21 @@ class Filter : public Iterator {
         char value[PAGE_SIZE];
         char tempData[PAGE_SIZE];
     	bool initStatus;
+    	// tuples read ahead, their int or real condition values gathered into
+    	// a run and selected together by the predicate kernels
+    	vector<char> batch;
+    	vector<unsigned> batchOffsets;		// where each tuple starts, then the end
+    	vector<int> runValues;
+    	vector<unsigned char> selection;
+    	unsigned batchIndex;
+    	bool inputEnd;
 
     	void copyValue(const Value &input);
     	bool compareValue(void *input);
+    	// locate the condition value of a tuple
+    	char *locateValue(char *input);
+    	// read and select the next batch of tuples, QE_EOF if there are none left
+    	RC loadBatch();
 };
 
 
@@ -1,7 +1,188 @@
 #include "pfm.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <new>
+#include <limits.h>
+#include <sys/uio.h>
 
 PagedFileManager* PagedFileManager::_pf_manager = 0;
 
+// I/O statistics
+IOStats & IOStats::operator+=(const IOStats &stats) {
+	pagesRead += stats.pagesRead;
+	pagesWritten += stats.pagesWritten;
+	pagesAppended += stats.pagesAppended;
+	pagesPrefetched += stats.pagesPrefetched;
+	bytesRead += stats.bytesRead;
+	bytesWritten += stats.bytesWritten;
+	readCalls += stats.readCalls;
+	writeCalls += stats.writeCalls;
+	syncCalls += stats.syncCalls;
+	ioTime += stats.ioTime;
+	return *this;
+}
+
+IOStats IOStats::operator-(const IOStats &stats) const {
+	IOStats diff;
+	diff.pagesRead = pagesRead - stats.pagesRead;
+	diff.pagesWritten = pagesWritten - stats.pagesWritten;
+	diff.pagesAppended = pagesAppended - stats.pagesAppended;
+	diff.pagesPrefetched = pagesPrefetched - stats.pagesPrefetched;
+	diff.bytesRead = bytesRead - stats.bytesRead;
+	diff.bytesWritten = bytesWritten - stats.bytesWritten;
+	diff.readCalls = readCalls - stats.readCalls;
+	diff.writeCalls = writeCalls - stats.writeCalls;
+	diff.syncCalls = syncCalls - stats.syncCalls;
+	diff.ioTime = ioTime - stats.ioTime;
+	return diff;
+}
+
+void IOStats::print(ostream &out) const {
+	out << "pages read " << pagesRead << ", written " << pagesWritten
+			<< ", appended " << pagesAppended << ", prefetched " << pagesPrefetched
+			<< "; bytes read " << bytesRead
+			<< ", written " << bytesWritten << "; calls read " << readCalls
+			<< ", write " << writeCalls << ", sync " << syncCalls
+			<< "; io time " << ioTime / 1000 << " us";
+}
+
+void IOCounters::reset() {
+	pagesRead = 0;
+	pagesWritten = 0;
+	pagesAppended = 0;
+	pagesPrefetched = 0;
+	bytesRead = 0;
+	bytesWritten = 0;
+	readCalls = 0;
+	writeCalls = 0;
+	syncCalls = 0;
+	ioTime = 0;
+}
+
+// Add the counts, only the nonzero ones are touched
+void IOCounters::add(const IOStats &stats) {
+	if (stats.pagesRead != 0)
+		pagesRead += stats.pagesRead;
+	if (stats.pagesWritten != 0)
+		pagesWritten += stats.pagesWritten;
+	if (stats.pagesAppended != 0)
+		pagesAppended += stats.pagesAppended;
+	if (stats.pagesPrefetched != 0)
+		pagesPrefetched += stats.pagesPrefetched;
+	if (stats.bytesRead != 0)
+		bytesRead += stats.bytesRead;
+	if (stats.bytesWritten != 0)
+		bytesWritten += stats.bytesWritten;
+	if (stats.readCalls != 0)
+		readCalls += stats.readCalls;
+	if (stats.writeCalls != 0)
+		writeCalls += stats.writeCalls;
+	if (stats.syncCalls != 0)
+		syncCalls += stats.syncCalls;
+	if (stats.ioTime != 0)
+		ioTime += stats.ioTime;
+}
+
+IOStats IOCounters::load() const {
+	IOStats stats;
+	stats.pagesRead = pagesRead;
+	stats.pagesWritten = pagesWritten;
+	stats.pagesAppended = pagesAppended;
+	stats.pagesPrefetched = pagesPrefetched;
+	stats.bytesRead = bytesRead;
+	stats.bytesWritten = bytesWritten;
+	stats.readCalls = readCalls;
+	stats.writeCalls = writeCalls;
+	stats.syncCalls = syncCalls;
+	stats.ioTime = ioTime;
+	return stats;
+}
+
+// The I/O of a call made through a handle is counted into the call, and
+// charged to the handle when the call returns; the I/O of other threads
+// on the same file is not charged to it
+class HandleIOScope {
+public:
+	HandleIOScope(FileHandle &fileHandle);
+	~HandleIOScope();
+	// Count I/O of the file of the call
+	static void count(IOCounters *stats, const IOStats &io);
+private:
+	FileHandle &fileHandle;
+	IOCounters *stats;			// statistics of the file of the handle
+	IOStats io;					// I/O of the file during the call
+	HandleIOScope *outer;		// call of the thread this one is made in
+	static thread_local HandleIOScope *current;
+};
+thread_local HandleIOScope *HandleIOScope::current = NULL;
+
+HandleIOScope::HandleIOScope(FileHandle &fileHandle) : fileHandle(fileHandle),
+		stats(fileHandle.fileInfo == NULL ? NULL : fileHandle.fileInfo->stats), outer(current) {
+	current = this;
+}
+
+HandleIOScope::~HandleIOScope() {
+	current = outer;
+	fileHandle.ioStats.add(io);
+}
+
+void HandleIOScope::count(IOCounters *stats, const IOStats &io) {
+	if (stats == NULL)
+		return;
+	stats->add(io);
+	if (current != NULL && current->stats == stats)
+		current->io += io;
+}
+
+// Count pages of the file into the counter
+static void countPageIO(IOCounters *stats, unsigned long long IOStats::*counter,
+		unsigned long long numPages) {
+	IOStats io;
+	io.*counter = numPages;
+	HandleIOScope::count(stats, io);
+}
+// Start time of a system call, in nanoseconds
+static unsigned long long ioClock() {
+	return chrono::duration_cast<chrono::nanoseconds>(
+			chrono::steady_clock::now().time_since_epoch()).count();
+}
+// Count a system call started at start into the stats, if any
+static void countRead(IOCounters *stats, ssize_t size, unsigned long long start) {
+	if (stats == NULL)
+		return;
+	IOStats io;
+	io.readCalls = 1;
+	io.bytesRead = size > 0 ? size : 0;
+	io.ioTime = ioClock() - start;
+	HandleIOScope::count(stats, io);
+}
+static void countWrite(IOCounters *stats, ssize_t size, unsigned long long start) {
+	if (stats == NULL)
+		return;
+	IOStats io;
+	io.writeCalls = 1;
+	io.bytesWritten = size > 0 ? size : 0;
+	io.ioTime = ioClock() - start;
+	HandleIOScope::count(stats, io);
+}
+static void countSync(IOCounters *stats, unsigned long long start) {
+	if (stats == NULL)
+		return;
+	IOStats io;
+	io.syncCalls = 1;
+	io.ioTime = ioClock() - start;
+	HandleIOScope::count(stats, io);
+}
+// Sync a file to the disk
+static bool syncFile(int fd, IOCounters *stats) {
+	unsigned long long start = ioClock();
+	bool synced = fdatasync(fd) == 0;
+	countSync(stats, start);
+	return synced;
+}
+
 PagedFileManager* PagedFileManager::instance()
 {
     if(!_pf_manager)
@@ -11,7 +192,10 @@ PagedFileManager* PagedFileManager::instance()
 }
 
 
-PagedFileManager::PagedFileManager()
+PagedFileManager::PagedFileManager() : bufferManager(MAX_PAGE_IN_MEM),
+		writePolicy(WRITE_IMMEDIATE), directIO(false), mmapRead(false),
+		readAhead(READ_AHEAD_PAGES), extentSize(EXTENT_PAGES), logName(LOG_FILE_NAME),
+		checkpointSize(LOG_CHECKPOINT_SIZE)
 {
 }
 
@@ -20,6 +204,95 @@ PagedFileManager::~PagedFileManager()
 {
 }
 
+// The manager is never destroyed, write the deferred pages back at exit
+static void flushAtExit() {
+	PagedFileManager *pfm = PagedFileManager::instance();
+	pfm->bufferManager.stopFlusher();
+	pfm->flush();
+	pfm->logManager.close();
+}
+
+// Set when dirty pages are written to the disk
+// Leaving a deferred policy writes all the dirty pages back
+// Entering WRITE_LOGGED opens the log and replays what a crash left in it,
+// leaving it takes a checkpoint and closes the log
+RC PagedFileManager::setWritePolicy(WritePolicy policy, unsigned flushIntervalMs) {
+	static bool exitHandlerSet = false;
+	bufferManager.stopFlusher();
+	if (policy != WRITE_LOGGED && logManager.isOpen()) {
+		RC rc = checkpoint();
+		if (rc != SUCC)
+			return rc;
+		logManager.close();
+	}
+	writePolicy = policy;
+	if (policy != WRITE_IMMEDIATE && !exitHandlerSet)
+		exitHandlerSet = atexit(flushAtExit) == 0;
+	if (policy == WRITE_PERIODIC) {
+		bufferManager.startFlusher(flushIntervalMs);
+	} else if (policy == WRITE_LOGGED && !logManager.isOpen()) {
+		// the buffered pages are older than the replayed ones
+		RC rc = bufferManager.flushAll();
+		if (rc == SUCC)
+			rc = logManager.open(logName.c_str(), getStatsEntry(logName));
+		if (rc != SUCC) {
+			writePolicy = WRITE_IMMEDIATE;
+			return rc;
+		}
+		return reloadFiles();
+	} else if (policy == WRITE_IMMEDIATE) {
+		// a pinned page is written through when it is unpinned
+		RC rc = bufferManager.flushAll();
+		return rc == BUFFER_PAGE_PINNED ? SUCC : rc;
+	}
+	return SUCC;
+}
+
+// Write all the dirty pages of every file to the disk
+RC PagedFileManager::flush() {
+	if (logManager.isOpen())
+		return checkpoint();
+	return bufferManager.flushAll();
+}
+
+// Make the pages written so far durable, callers end their operations with it
+// A checkpoint is taken once the log outgrows the checkpoint size
+RC PagedFileManager::commit() {
+	if (!logManager.isOpen())
+		return SUCC;
+	RC rc = logManager.commit();
+	if (rc != SUCC || logManager.getSize() < checkpointSize)
+		return rc;
+	// the log is kept while a dirty page is pinned, the next commit tries again
+	rc = checkpoint();
+	return rc == BUFFER_PAGE_PINNED ? SUCC : rc;
+}
+
+// Write the dirty pages back in page order and empty the log
+RC PagedFileManager::checkpoint() {
+	RC rc = logManager.commit();
+	if (rc != SUCC)
+		return rc;
+	unsigned long long logSize = logManager.getSize();
+	rc = bufferManager.flushAll();
+	if (rc != SUCC && rc != BUFFER_PAGE_PINNED)
+		return rc;
+	// a pinned page is not written, so the records are kept for the next checkpoint
+	bool pinned = rc == BUFFER_PAGE_PINNED;
+	// the files must hold the pages before their records are dropped
+	for (unsigned i = 0; i < FILE_REGISTRY_SHARDS; ++i) {
+		lock_guard<mutex> guard(fileRegistry[i].latch);
+		unordered_map<string, FileInfo>::iterator itr;
+		for (itr = fileRegistry[i].refCounter.begin(); itr != fileRegistry[i].refCounter.end(); ++itr) {
+			if (!syncFile(itr->second.fd, itr->second.stats)) {
+				PrintFileStreamError("PagedFileManager::checkpoint");
+				return FILE_STREAM_FAILURE;
+			}
+		}
+	}
+	return pinned ? BUFFER_PAGE_PINNED : logManager.truncate(logSize);
+}
+
 // Check a file's existence
 bool PagedFileManager::fileExist(const char* fileName) {
 	struct stat fileInfo;
@@ -27,24 +300,48 @@ bool PagedFileManager::fileExist(const char* fileName) {
 }
 
 // This method creates a paged file called fileName. The file should not already exist.
-RC PagedFileManager::createFile(const char *fileName)
+// The page size is a power of 2 from PAGE_SIZE to MAX_PAGE_SIZE, and is
+// kept in the file header.
+RC PagedFileManager::createFile(const char *fileName, unsigned pageSize, unsigned flags)
 {
+	if (pageSize < PAGE_SIZE || pageSize > MAX_PAGE_SIZE ||
+			(pageSize & (pageSize - 1)) != 0) {
+		PrintError("Page size not supported in PagedFileManager::createFile");
+		return FILE_PAGE_SIZE_INVALID;
+	}
 	if (fileExist(fileName)) {
 		// Check if a file has already existed
 		PrintError("File exists in PagedFileManager::createFile");
 		return FILE_EXIST;
 	}
-	// create the page file as requested
-	FILE * pFile = fopen(fileName, "w");
-	if (NULL != pFile) {
-		fclose(pFile);
-		return SUCC;
-	} else {
+	// create the page file as requested, a thread that loses the race sees it exists
+	int fd = open(fileName, O_WRONLY | O_CREAT | O_EXCL, 0644);
+	if (fd < 0 && errno == EEXIST) {
+		PrintError("File exists in PagedFileManager::createFile");
+		return FILE_EXIST;
+	}
+	if (fd < 0) {
 		PrintFileStreamError("PagedFileManager::createFile: ");
 		return FILE_OPEN_FAILURE;
 	}
-
-    return UNKNOWN_FAILURE;
+	// the header takes a whole page, so the pages stay aligned
+	// a compressed file has an empty page map of one page after it
+	unsigned headerSize = (flags & FILE_COMPRESSED) ? 2 * pageSize : pageSize;
+	vector<char> header(headerSize, 0);
+	FileHeader fileHeader = {FILE_HEADER_MAGIC, pageSize,
+			flags & (FILE_COMPRESSED | FILE_SPACE_MAP | FILE_USER_FLAGS), 0, 0, 0};
+	if (flags & FILE_COMPRESSED) {
+		fileHeader.mapOffset = pageSize;
+		fileHeader.mapCapacity = pageSize / sizeof(CompressedPageSlot);
+	}
+	memcpy(&header[0], &fileHeader, sizeof(FileHeader));
+	bool written = pwrite(fd, &header[0], headerSize, 0) == (ssize_t)headerSize;
+	close(fd);
+	if (!written) {
+		PrintFileStreamError("PagedFileManager::createFile: ");
+		return FILE_STREAM_FAILURE;
+	}
+	return SUCC;
 }
 
 // This method destroys the paged file whose name is fileName. The file should exist.
@@ -54,6 +351,18 @@ RC PagedFileManager::destroyFile(const char *fileName)
 		PrintError("PagedFileManager::destroyFile: File not exist");
 		return FILE_NOT_EXIST;
 	}
+	// the buffered pages are out of date once the file is removed
+	RC rc = bufferManager.discardFile(fileName);
+	if (rc != SUCC) {
+		PrintError("PagedFileManager::destroyFile: a page of the file is pinned");
+		return rc;
+	}
+	// the logged pages must not be replayed into a file created with the name later
+	if (logManager.isOpen()) {
+		rc = logManager.appendDestroy(fileName);
+		if (rc != SUCC)
+			return rc;
+	}
 	if (remove(fileName) == 0) {
 		return SUCC;
 	}
@@ -74,26 +383,38 @@ RC PagedFileManager::openFile(const char *fileName, FileHandle &fileHandle)
 		return FILE_NOT_EXIST;
 	}
 
-	FILE *fp(NULL);
-	// if there are more than one handle than opens the file, use that FILE instead
-	if (get_refCounter(fileName, fp) > 0) {
-		fileHandle.pFile = fp;
+	// the shard is held until the file is registered, so it is opened once
+	FileRegistryShard &shard = getRegistryShard(fileName);
+	lock_guard<mutex> guard(shard.latch);
+	int fd(-1);
+	// if there are more than one handle than opens the file, use that descriptor instead
+	if (get_refCounter(shard, fileName, fd) > 0) {
+		fileHandle.fd = fd;
 		// Increase refCounter
 		fileHandle.fileName.assign(fileName);
-		inc_refCounter(fileName, fileHandle);
-		return SUCC;
+		return inc_refCounter(shard, fileName, fileHandle);
 	}
 	// Open file
-	fileHandle.pFile = fopen(fileName, "r+");
-	if (NULL == fileHandle.pFile) {
+	fileHandle.fd = open(fileName, O_RDWR | (directIO ? O_DIRECT : 0));
+	if (fileHandle.fd < 0 && directIO && errno == EINVAL) {
+		// the file system does not support O_DIRECT
+		fileHandle.fd = open(fileName, O_RDWR);
+	}
+	if (fileHandle.fd < 0) {
 		PrintFileStreamError("PagedFileManager::openFile");
 		return FILE_OPEN_FAILURE;
 	}
 	fileHandle.fileName.assign(fileName);
 	
 	// Increase refCounter
-	inc_refCounter(fileName, fileHandle);
-	return SUCC;
+	RC rc = inc_refCounter(shard, fileName, fileHandle);
+	if (rc != SUCC) {
+		PrintError("PagedFileManager::openFile: cannot load the page map");
+		close(fileHandle.fd);
+		fileHandle.fd = -1;
+		fileHandle.fileName = "";
+	}
+	return rc;
 }
 
 // This method closes the open file instance referred  by fileHandle.
@@ -102,49 +423,153 @@ RC PagedFileManager::openFile(const char *fileName, FileHandle &fileHandle)
 RC PagedFileManager::closeFile(FileHandle &fileHandle)
 {
 	// Check if the file is opened by openFile method
-	if (NULL == fileHandle.pFile) {
+	if (fileHandle.fd < 0) {
 		PrintFileStreamError("PagedFileManager::closeFile");
 		return FILE_NOT_OPEN_BY_HANDLE;
 	} else {
-		// Check whether if there is any error of the file
-		if (ferror (fileHandle.pFile)) {
+		//Check whether if the file was flushed to disk
+		// the pages pinned by other handles are left to them, the last handle finds none
+		RC flushRC = bufferManager.flushFile(fileHandle.fileName);
+		if (flushRC != SUCC && flushRC != BUFFER_PAGE_PINNED) {
 			PrintFileStreamError("PagedFileManager::closeFile");
 			return FILE_STREAM_FAILURE;
 		}
-		//Check whether if the file was flushed to disk
-		if (fflush(fileHandle.pFile) != 0) {
+		// the log may be emptied while the file is closed, so its pages go to the disk now
+		if (logManager.isOpen() && !syncFile(fileHandle.fd, fileHandle.fileInfo->stats)) {
 			PrintFileStreamError("PagedFileManager::closeFile");
 			return FILE_STREAM_FAILURE;
 		}
-		FILE *fp(NULL);
+		FileRegistryShard &shard = getRegistryShard(fileHandle.fileName);
+		lock_guard<mutex> guard(shard.latch);
+		int fd(-1);
+		int refs = get_refCounter(shard, fileHandle.fileName, fd);
+		// the last handle takes the pages of the file out of the pool,
+		// the file stays open while one of them is pinned
+		if (refs <= 1) {
+			RC rc = bufferManager.discardFile(fileHandle.fileName);
+			if (rc != SUCC) {
+				PrintError("PagedFileManager::closeFile: a page of the file is pinned");
+				return rc;
+			}
+		}
 		//Check the file's reference
-		if (get_refCounter(fileHandle.fileName, fp) > 0) {
-			dec_refCounter(fileHandle.fileName);
+		if (refs > 0) {
+			dec_refCounter(shard, fileHandle.fileName);
 		} else {
-			fclose(fileHandle.pFile);
-			close_refCounter(fileHandle.fileName);
+			close_refCounter(shard, fileHandle.fileName);
+			close(fileHandle.fd);
 		}
-		fileHandle.pFile = NULL;
+		fileHandle.fd = -1;
 		fileHandle.fileName = "";
+		fileHandle.fileInfo = NULL;
 		return SUCC;
 	}
     return UNKNOWN_FAILURE;
 }
+// Count the pages of a file, only done when the file is opened
+static unsigned countPages(int fd, unsigned pageSize, off_t dataOffset) {
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0) {
+		PagedFileManager::instance()->PrintFileStreamError("countPages");
+		return 0;
+	}
+	if (fileStat.st_size < dataOffset)
+		return 0;
+	return (fileStat.st_size - dataOffset) / pageSize;
+}
+// Read the file header, only done when the file is opened
+// The header is read as a whole page, so that O_DIRECT accepts the read
+static void readFileHeader(int fd, FileHeader &fileHeader, off_t &dataOffset) {
+	alignas(PAGE_SIZE) char page[PAGE_SIZE];
+	dataOffset = 0;
+	if (pread(fd, page, PAGE_SIZE, 0) == PAGE_SIZE) {
+		memcpy(&fileHeader, page, sizeof(FileHeader));
+		if (fileHeader.magic == FILE_HEADER_MAGIC && fileHeader.pageSize >= PAGE_SIZE &&
+				fileHeader.pageSize <= MAX_PAGE_SIZE) {
+			dataOffset = fileHeader.pageSize;
+			return;
+		}
+	}
+	memset(&fileHeader, 0, sizeof(FileHeader));
+	fileHeader.pageSize = PAGE_SIZE;
+}
+// Unmap all the mappings of a file, only done when the file is closed
+static void unmapFile(FileInfo &fileInfo) {
+	for (unsigned i = 0; i < fileInfo.maps.size(); ++i)
+		munmap(fileInfo.maps[i].first, fileInfo.maps[i].second);
+	fileInfo.maps.clear();
+}
+// Give back the preallocated pages past the end of a file, only done when
+// the file is closed. Truncating to the file size frees them.
+static void trimExtent(FileInfo &fileInfo) {
+	struct stat fileStat;
+	if (fileInfo.allocPages > fileInfo.numPages && fstat(fileInfo.fd, &fileStat) == 0)
+		ftruncate(fileInfo.fd, fileStat.st_size);
+}
+// Get the shard of the open file registry holding a file
+PagedFileManager::FileRegistryShard &PagedFileManager::getRegistryShard(const string &fileName) {
+	return fileRegistry[hash<string>()(fileName) % FILE_REGISTRY_SHARDS];
+}
+// Get the statistics kept for a file, the entry is created on first use
+// Entries are never erased, so the pointer stays valid
+IOCounters *PagedFileManager::getStatsEntry(const string &fileName) {
+	lock_guard<mutex> guard(statsLatch);
+	return &ioStats[fileName];
+}
+// Load the page map of a compressed file, NULL if the file is not compressed
+static RC loadCompressedFile(int fd, const FileHeader &fileHeader, IOCounters *stats,
+		CompressedFile *&compressed) {
+	compressed = NULL;
+	if (!(fileHeader.flags & FILE_COMPRESSED))
+		return SUCC;
+	// the slots are not aligned to the page, so O_DIRECT is turned off
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+	compressed = new CompressedFile(fd, fileHeader.pageSize, stats);
+	RC rc = compressed->load(fileHeader);
+	if (rc != SUCC) {
+		delete compressed;
+		compressed = NULL;
+	}
+	return rc;
+}
 // Reference increment
-void PagedFileManager::inc_refCounter(const string &fileName, FileHandle &fileHandle) {
+RC PagedFileManager::inc_refCounter(FileRegistryShard &shard, const string &fileName,
+		FileHandle &fileHandle) {
+	unordered_map<string, FileInfo> &refCounter = shard.refCounter;
 	unordered_map<string, FileInfo>::iterator itr = refCounter.find(fileName);
 	//Check the current reference, if not exist,  set as 1
 	if (itr == refCounter.end()) {
-		FileInfo fileInfo(fileHandle.pFile, 1);
-		refCounter.insert(pair<string, FileInfo>(fileName, fileInfo));
-		FileSpaceManager fsManager(fileHandle);
-		filesSpaceManager.insert(pair<string, FileSpaceManager>(fileName, fsManager));
+		FileHeader fileHeader;
+		off_t dataOffset;
+		readFileHeader(fileHandle.fd, fileHeader, dataOffset);
+		unsigned pageSize = fileHeader.pageSize;
+		IOCounters *stats = getStatsEntry(fileName);
+		CompressedFile *compressed;
+		RC rc = loadCompressedFile(fileHandle.fd, fileHeader, stats, compressed);
+		if (rc != SUCC)
+			return rc;
+		unsigned numPages = compressed != NULL ? compressed->getNumberOfPages() :
+				countPages(fileHandle.fd, pageSize, dataOffset);
+		// the free space is loaded when the first record is inserted
+		itr = refCounter.emplace(piecewise_construct, forward_as_tuple(fileName),
+				forward_as_tuple(fileHandle.fd, 1, numPages,
+				pageSize, dataOffset, (fcntl(fileHandle.fd, F_GETFL) & O_DIRECT) != 0)).first;
+		// compressed pages are never read in place
+		itr->second.mapped = mmapRead && compressed == NULL;
+		itr->second.flags = fileHeader.flags;
+		itr->second.spaceManager.setSpaceMap((fileHeader.flags & FILE_SPACE_MAP) != 0);
+		itr->second.stats = stats;
+		itr->second.compressed = compressed;
+		fileHandle.fileInfo = &itr->second;
 	} else {
 		itr->second.cnt += 1;
+		fileHandle.fileInfo = &itr->second;
 	}
+	return SUCC;
 }
 // reference decrement
-void PagedFileManager::dec_refCounter(const string &fileName) {
+void PagedFileManager::dec_refCounter(FileRegistryShard &shard, const string &fileName) {
+	unordered_map<string, FileInfo> &refCounter = shard.refCounter;
 	unordered_map<string, FileInfo>::iterator itr = refCounter.find(fileName);
 	//Check the current reference
 	if (itr == refCounter.end()) {
@@ -153,46 +578,120 @@ void PagedFileManager::dec_refCounter(const string &fileName) {
 		itr->second.cnt -= 1;
 	} else {
 		//if the reference is zero, delete the reference counter, close the file
-		fclose(itr->second.fp);
+		// the buffered pages were written back and discarded by closeFile
+		unmapFile(itr->second);
+		trimExtent(itr->second);
+		close(itr->second.fd);
+		// the file free space manager goes with the entry
 		refCounter.erase(itr);
-		// delete the file free space manager
-		filesSpaceManager.erase(fileName);
 	}
 }
 // Get reference count of a file
-int PagedFileManager::get_refCounter(const string &fileName, FILE *&fp) {
-	unordered_map<string, FileInfo>::iterator itr = refCounter.find(fileName);
+int PagedFileManager::get_refCounter(FileRegistryShard &shard, const string &fileName, int &fd) {
+	unordered_map<string, FileInfo>::iterator itr = shard.refCounter.find(fileName);
 	// If not exist, return 0, else return the reference
-	if (itr == refCounter.end()) {
-		fp = NULL;
+	if (itr == shard.refCounter.end()) {
+		fd = -1;
 		return 0;
 	} else {
-		fp = itr->second.fp;
+		fd = itr->second.fd;
 		return itr->second.cnt;
 	}
 }
 // Close the reference counter with given file name
-void PagedFileManager::close_refCounter(const string &fileName) {
-	refCounter.erase(fileName);
-	filesSpaceManager.erase(fileName);
+void PagedFileManager::close_refCounter(FileRegistryShard &shard, const string &fileName) {
+	unordered_map<string, FileInfo>::iterator itr = shard.refCounter.find(fileName);
+	if (itr != shard.refCounter.end())
+		unmapFile(itr->second);
+	shard.refCounter.erase(fileName);
 }
 // Try to close those files with zero reference
 void PagedFileManager::closeFileZeroRef() {
-	unordered_map<string, FileInfo>::iterator itr = refCounter.begin();
-	//check the reference counter, close those files with counter <= 0
-	while (itr != refCounter.end()) {
-		if (itr->second.cnt <= 0) {
-			fclose(itr->second.fp);
-			itr = refCounter.erase(itr);
-			//delete the file free space manager
-			filesSpaceManager.erase(itr->first);
-		} else {
-			++itr;
+	for (unsigned i = 0; i < FILE_REGISTRY_SHARDS; ++i) {
+		lock_guard<mutex> guard(fileRegistry[i].latch);
+		unordered_map<string, FileInfo> &refCounter = fileRegistry[i].refCounter;
+		unordered_map<string, FileInfo>::iterator itr = refCounter.begin();
+		//check the reference counter, close those files with counter <= 0
+		while (itr != refCounter.end()) {
+			if (itr->second.cnt <= 0) {
+				unmapFile(itr->second);
+				trimExtent(itr->second);
+				close(itr->second.fd);
+				itr = refCounter.erase(itr);
+			} else {
+				++itr;
+			}
+		}
+	}
+}
+
+// Get the I/O statistics of a file, kept across its handles and opens
+IOStats PagedFileManager::getIOStats(const string &fileName) {
+	lock_guard<mutex> guard(statsLatch);
+	unordered_map<string, IOCounters>::iterator itr = ioStats.find(fileName);
+	return itr == ioStats.end() ? IOStats() : itr->second.load();
+}
+
+// Get the I/O statistics of all the files and the log
+IOStats PagedFileManager::getIOStats() {
+	lock_guard<mutex> guard(statsLatch);
+	IOStats total;
+	unordered_map<string, IOCounters>::iterator itr;
+	for (itr = ioStats.begin(); itr != ioStats.end(); ++itr)
+		total += itr->second.load();
+	return total;
+}
+
+// Get the I/O statistics of each file
+void PagedFileManager::getIOStats(map<string, IOStats> &fileStats) {
+	lock_guard<mutex> guard(statsLatch);
+	fileStats.clear();
+	unordered_map<string, IOCounters>::iterator itr;
+	for (itr = ioStats.begin(); itr != ioStats.end(); ++itr)
+		fileStats[itr->first] = itr->second.load();
+}
+
+// Reset the I/O statistics of all the files
+// The entries are kept, since the open files point to them
+void PagedFileManager::resetIOStats() {
+	lock_guard<mutex> guard(statsLatch);
+	unordered_map<string, IOCounters>::iterator itr;
+	for (itr = ioStats.begin(); itr != ioStats.end(); ++itr)
+		itr->second.reset();
+}
+
+// Drop the cached state of the open files, the log replayed pages into them
+RC PagedFileManager::reloadFiles() {
+	for (unsigned i = 0; i < FILE_REGISTRY_SHARDS; ++i) {
+		lock_guard<mutex> guard(fileRegistry[i].latch);
+		unordered_map<string, FileInfo>::iterator itr;
+		for (itr = fileRegistry[i].refCounter.begin(); itr != fileRegistry[i].refCounter.end(); ++itr) {
+			FileInfo &fileInfo = itr->second;
+			RC rc = bufferManager.discardFile(itr->first);
+			if (rc != SUCC) {
+				PrintError("PagedFileManager::reloadFiles: a page of the file is pinned");
+				return rc;
+			}
+			fileInfo.spaceManager.unloadPageSpaceInfo();
+			lock_guard<mutex> fileGuard(fileInfo.latch);
+			if (fileInfo.compressed != NULL) {
+				// the replay wrote pages into new slots
+				FileHeader fileHeader;
+				off_t dataOffset;
+				readFileHeader(fileInfo.fd, fileHeader, dataOffset);
+				fileInfo.compressed->load(fileHeader);
+				fileInfo.numPages = fileInfo.compressed->getNumberOfPages();
+			} else {
+				fileInfo.numPages = countPages(fileInfo.fd, fileInfo.pageSize, fileInfo.dataOffset);
+			}
+			fileInfo.allocPages = max(fileInfo.allocPages.load(), fileInfo.numPages.load());
 		}
 	}
+	return SUCC;
 }
 
-FileHandle::FileHandle():pFile(NULL),fileName("")
+FileHandle::FileHandle():fd(-1),fileName(""),fileInfo(NULL),
+		lastReadPage(-1),sequentialReads(0),readAheadEnd(0)
 {
 }
 
@@ -202,6 +701,393 @@ FileHandle::~FileHandle()
 	//PagedFileManager::instance()->closeFile(*this);
 }
 
+// O_DIRECT needs the buffer aligned to the page
+static bool isAligned(const void *data) {
+	return ((unsigned long)data & (PAGE_SIZE - 1)) == 0;
+}
+// Read a page from the file without the buffer pool
+// The read is positional so the handles of a file do not share an offset
+static RC readRawPage(int fd, off_t offset, unsigned pageSize, void *data,
+		IOCounters *stats, bool direct = false) {
+	if (direct && !isAligned(data)) {
+		alignas(PAGE_SIZE) char bounce[MAX_PAGE_SIZE];
+		RC rc = readRawPage(fd, offset, pageSize, bounce, stats, false);
+		if (rc == SUCC)
+			memcpy(data, bounce, pageSize);
+		return rc;
+	}
+	unsigned long long start = ioClock();
+	ssize_t size = pread(fd, data, pageSize, offset);
+	countRead(stats, size, start);
+	if (size != (ssize_t)pageSize) {
+		PagedFileManager::instance()->PrintFileStreamError("FileHandle::readPage");
+		return FILE_STREAM_FAILURE;
+	}
+	return SUCC;
+}
+// Write a page to the file without the buffer pool
+static RC writeRawPage(int fd, off_t offset, unsigned pageSize, const void *data,
+		IOCounters *stats, bool direct = false) {
+	if (direct && !isAligned(data)) {
+		alignas(PAGE_SIZE) char bounce[MAX_PAGE_SIZE];
+		memcpy(bounce, data, pageSize);
+		return writeRawPage(fd, offset, pageSize, bounce, stats, false);
+	}
+	unsigned long long start = ioClock();
+	ssize_t size = pwrite(fd, data, pageSize, offset);
+	countWrite(stats, size, start);
+	if (size != (ssize_t)pageSize) {
+		PagedFileManager::instance()->PrintFileStreamError("FileHandle::writePage");
+		return FILE_STREAM_FAILURE;
+	}
+	return SUCC;
+}
+
+// Page codec
+#define LZ_MIN_MATCH 4
+#define LZ_HASH_BITS 12
+#define LZ_LAST_LITERALS 5		// a block ends with literals
+#define LZ_MATCH_LIMIT 12		// no match starts this close to the end
+static unsigned lzRead32(const char *p) {
+	unsigned value;
+	memcpy(&value, p, sizeof(unsigned));
+	return value;
+}
+// Write a length past the 4 bits of the token in bytes of 255
+static void lzWriteLength(char *dst, unsigned &out, unsigned length) {
+	for (; length >= 255; length -= 255)
+		dst[out++] = (char)255;
+	dst[out++] = (char)length;
+}
+// Write a sequence: the literals and a match, no match ends the block
+static bool lzWriteSequence(char *dst, unsigned capacity, unsigned &out,
+		const char *literals, unsigned numLiterals, unsigned offset, unsigned matchLength) {
+	unsigned needed = 1 + numLiterals + numLiterals / 255 + 1 +
+			(matchLength > 0 ? 2 + matchLength / 255 + 1 : 0);
+	if (out + needed > capacity)
+		return false;
+	unsigned matchCode = matchLength > 0 ? matchLength - LZ_MIN_MATCH : 0;
+	dst[out++] = (char)((min(numLiterals, 15u) << 4) | min(matchCode, 15u));
+	if (numLiterals >= 15)
+		lzWriteLength(dst, out, numLiterals - 15);
+	memcpy(dst + out, literals, numLiterals);
+	out += numLiterals;
+	if (matchLength == 0)
+		return true;
+	dst[out++] = (char)(offset & 0xff);
+	dst[out++] = (char)(offset >> 8);
+	if (matchCode >= 15)
+		lzWriteLength(dst, out, matchCode - 15);
+	return true;
+}
+
+// Compress a page, 0 if it does not fit in capacity
+// Matches are found through a hash of the next 4 bytes, the last position wins
+unsigned PageCodec::compress(const char *src, unsigned srcSize, char *dst, unsigned capacity) {
+	int table[1 << LZ_HASH_BITS];
+	memset(table, -1, sizeof(table));
+	unsigned out = 0;
+	unsigned anchor = 0;
+	unsigned pos = 0;
+	unsigned matchEnd = srcSize > LZ_LAST_LITERALS ? srcSize - LZ_LAST_LITERALS : 0;
+	while (srcSize > LZ_MATCH_LIMIT && pos < srcSize - LZ_MATCH_LIMIT) {
+		unsigned sequence = lzRead32(src + pos);
+		unsigned hash = (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+		int ref = table[hash];
+		table[hash] = pos;
+		if (ref < 0 || pos - ref > 0xffff || lzRead32(src + ref) != sequence) {
+			++pos;
+			continue;
+		}
+		unsigned length = LZ_MIN_MATCH;
+		while (pos + length < matchEnd && src[ref + length] == src[pos + length])
+			++length;
+		if (!lzWriteSequence(dst, capacity, out, src + anchor, pos - anchor, pos - ref, length))
+			return 0;
+		pos += length;
+		anchor = pos;
+	}
+	if (!lzWriteSequence(dst, capacity, out, src + anchor, srcSize - anchor, 0, 0))
+		return 0;
+	return out;
+}
+
+// Decompress a page, false unless it fills exactly dstSize bytes
+// Every length and offset is checked, so a corrupt page cannot overrun dst
+bool PageCodec::decompress(const char *src, unsigned srcSize, char *dst, unsigned dstSize) {
+	const unsigned char *in = (const unsigned char *)src;
+	unsigned pos = 0;
+	unsigned out = 0;
+	while (pos < srcSize) {
+		unsigned token = in[pos++];
+		unsigned numLiterals = token >> 4;
+		if (numLiterals == 15) {
+			unsigned byte;
+			do {
+				if (pos >= srcSize)
+					return false;
+				byte = in[pos++];
+				numLiterals += byte;
+			} while (byte == 255);
+		}
+		if (numLiterals > srcSize - pos || numLiterals > dstSize - out)
+			return false;
+		memcpy(dst + out, src + pos, numLiterals);
+		pos += numLiterals;
+		out += numLiterals;
+		// the last sequence has no match
+		if (pos == srcSize)
+			break;
+		if (srcSize - pos < 2)
+			return false;
+		unsigned offset = in[pos] | (in[pos + 1] << 8);
+		pos += 2;
+		if (offset == 0 || offset > out)
+			return false;
+		unsigned length = token & 15;
+		if (length == 15) {
+			unsigned byte;
+			do {
+				if (pos >= srcSize)
+					return false;
+				byte = in[pos++];
+				length += byte;
+			} while (byte == 255);
+		}
+		length += LZ_MIN_MATCH;
+		if (length > dstSize - out)
+			return false;
+		// the match may overlap the bytes it produces
+		for (unsigned i = 0; i < length; ++i, ++out)
+			dst[out] = dst[out - offset];
+	}
+	return out == dstSize;
+}
+
+// Compressed file
+CompressedFile::CompressedFile(int fd, unsigned pageSize, IOCounters *stats) : fd(fd),
+		pageSize(pageSize), flags(FILE_COMPRESSED), stats(stats), mapOffset(0), mapCapacity(0), fileEnd(0),
+		buffer(pageSize) {
+}
+
+// Load the page map named by the header
+RC CompressedFile::load(const FileHeader &fileHeader) {
+	lock_guard<mutex> guard(latch);
+	flags = fileHeader.flags;
+	mapOffset = fileHeader.mapOffset;
+	mapCapacity = fileHeader.mapCapacity;
+	slots.assign(fileHeader.numPages, CompressedPageSlot());
+	if (mapCapacity == 0 || fileHeader.numPages > mapCapacity) {
+		PagedFileManager::instance()->PrintError("CompressedFile::load: page map corrupt");
+		return FILE_PAGE_CORRUPT;
+	}
+	size_t size = slots.size() * sizeof(CompressedPageSlot);
+	if (size > 0) {
+		unsigned long long start = ioClock();
+		ssize_t readSize = pread(fd, &slots[0], size, mapOffset);
+		countRead(stats, readSize, start);
+		if (readSize != (ssize_t)size) {
+			PagedFileManager::instance()->PrintFileStreamError("CompressedFile::load");
+			return FILE_STREAM_FAILURE;
+		}
+	}
+	// the space between the header, the page map and the slots is free
+	vector<pair<unsigned long long, unsigned> > used;
+	used.push_back(make_pair(mapOffset, getMapSize(mapCapacity)));
+	for (PageNum i = 0; i < slots.size(); ++i) {
+		if (slots[i].offset != 0)
+			used.push_back(make_pair(slots[i].offset, slots[i].capacity));
+	}
+	sort(used.begin(), used.end());
+	freeSlots.clear();
+	fileEnd = pageSize;
+	for (size_t i = 0; i < used.size(); ++i) {
+		if (used[i].first > fileEnd)
+			freeSlots.insert(make_pair((unsigned)(used[i].first - fileEnd), fileEnd));
+		fileEnd = max(fileEnd, used[i].first + used[i].second);
+	}
+	return SUCC;
+}
+
+// Space taken by a page map, whole slots
+unsigned CompressedFile::getMapSize(unsigned capacity) {
+	return (capacity * sizeof(CompressedPageSlot) + COMPRESSED_SLOT_ALIGN - 1) /
+			COMPRESSED_SLOT_ALIGN * COMPRESSED_SLOT_ALIGN;
+}
+
+// Take the smallest free slot that fits, else the end of the file
+unsigned long long CompressedFile::allocateSlot(unsigned capacity) {
+	multimap<unsigned, unsigned long long>::iterator itr = freeSlots.lower_bound(capacity);
+	if (itr == freeSlots.end()) {
+		unsigned long long offset = fileEnd;
+		fileEnd += capacity;
+		return offset;
+	}
+	unsigned long long offset = itr->second;
+	unsigned rest = itr->first - capacity;
+	freeSlots.erase(itr);
+	if (rest > 0)
+		freeSlots.insert(make_pair(rest, offset + capacity));
+	return offset;
+}
+
+// Give back a slot, the end of the file moves back over it
+void CompressedFile::freeSlot(unsigned long long offset, unsigned capacity) {
+	if (offset + capacity == fileEnd)
+		fileEnd = offset;
+	else
+		freeSlots.insert(make_pair(capacity, offset));
+}
+
+unsigned CompressedFile::getNumberOfPages() {
+	lock_guard<mutex> guard(latch);
+	return slots.size();
+}
+
+// Read a page and decompress it into data
+// A page that is never written reads as zeros
+RC CompressedFile::readPage(PageNum pageNum, void *data) {
+	lock_guard<mutex> guard(latch);
+	if (pageNum >= slots.size())
+		return PAGE_NOT_EXIST;
+	const CompressedPageSlot &slot = slots[pageNum];
+	if (slot.offset == 0) {
+		memset(data, 0, pageSize);
+		return SUCC;
+	}
+	// a page kept as it is goes straight to data
+	char *target = slot.length == pageSize ? (char *)data : &buffer[0];
+	unsigned long long start = ioClock();
+	ssize_t size = pread(fd, target, slot.length, slot.offset);
+	countRead(stats, size, start);
+	if (size != (ssize_t)slot.length) {
+		PagedFileManager::instance()->PrintFileStreamError("CompressedFile::readPage");
+		return FILE_STREAM_FAILURE;
+	}
+	if (slot.length != pageSize &&
+			!PageCodec::decompress(&buffer[0], slot.length, (char *)data, pageSize)) {
+		PagedFileManager::instance()->PrintError("CompressedFile::readPage: page corrupt");
+		return FILE_PAGE_CORRUPT;
+	}
+	return SUCC;
+}
+
+// Compress a page and write it to its slot, the page past the last one is appended
+// Pages past it are appended too, the ones between read as zeros
+RC CompressedFile::writePage(PageNum pageNum, const void *data) {
+	lock_guard<mutex> guard(latch);
+	// a page that does not shrink is kept as it is
+	unsigned length = PageCodec::compress((const char *)data, pageSize, &buffer[0], pageSize - 1);
+	const char *slotData = length == 0 ? (const char *)data : &buffer[0];
+	if (length == 0)
+		length = pageSize;
+	unsigned capacity = (length + COMPRESSED_SLOT_ALIGN - 1) / COMPRESSED_SLOT_ALIGN *
+			COMPRESSED_SLOT_ALIGN;
+	unsigned numPages = slots.size();
+	if (pageNum >= numPages)
+		slots.resize(pageNum + 1, CompressedPageSlot());
+	CompressedPageSlot &slot = slots[pageNum];
+	if (slot.offset != 0 && slot.capacity < capacity &&
+			slot.offset + slot.capacity == fileEnd) {
+		// the last slot grows in place
+		fileEnd = slot.offset + capacity;
+		slot.capacity = capacity;
+	} else if (slot.offset == 0 || slot.capacity < capacity) {
+		// the old slot is freed once the page map no longer points to it
+		CompressedPageSlot oldSlot = slot;
+		slot.offset = allocateSlot(capacity);
+		slot.capacity = capacity;
+		if (oldSlot.offset != 0)
+			freeSlot(oldSlot.offset, oldSlot.capacity);
+	}
+	slot.length = length;
+	unsigned long long start = ioClock();
+	ssize_t size = pwrite(fd, slotData, length, slot.offset);
+	countWrite(stats, size, start);
+	if (size != (ssize_t)length) {
+		PagedFileManager::instance()->PrintFileStreamError("CompressedFile::writePage");
+		return FILE_STREAM_FAILURE;
+	}
+	// the page map goes after the page, then the header counts the page
+	if (slots.size() > mapCapacity) {
+		unsigned newCapacity = mapCapacity;
+		while (newCapacity < slots.size())
+			newCapacity *= 2;
+		return moveMap(newCapacity);
+	}
+	RC rc = writeMapEntry(pageNum);
+	if (rc != SUCC || slots.size() == numPages)
+		return rc;
+	for (PageNum i = numPages; i < pageNum && rc == SUCC; ++i)
+		rc = writeMapEntry(i);
+	if (rc != SUCC)
+		return rc;
+	return writeHeader();
+}
+
+RC CompressedFile::writeHeader() {
+	FileHeader fileHeader = {FILE_HEADER_MAGIC, pageSize, flags,
+			(unsigned)slots.size(), mapOffset, mapCapacity};
+	unsigned long long start = ioClock();
+	ssize_t size = pwrite(fd, &fileHeader, sizeof(FileHeader), 0);
+	countWrite(stats, size, start);
+	if (size != (ssize_t)sizeof(FileHeader)) {
+		PagedFileManager::instance()->PrintFileStreamError("CompressedFile::writeHeader");
+		return FILE_STREAM_FAILURE;
+	}
+	return SUCC;
+}
+
+RC CompressedFile::writeMapEntry(PageNum pageNum) {
+	unsigned long long start = ioClock();
+	ssize_t size = pwrite(fd, &slots[pageNum], sizeof(CompressedPageSlot),
+			mapOffset + (unsigned long long)pageNum * sizeof(CompressedPageSlot));
+	countWrite(stats, size, start);
+	if (size != (ssize_t)sizeof(CompressedPageSlot)) {
+		PagedFileManager::instance()->PrintFileStreamError("CompressedFile::writeMapEntry");
+		return FILE_STREAM_FAILURE;
+	}
+	return SUCC;
+}
+
+// Move the page map to the end of the file
+// The header points to the old map until the new one is written
+RC CompressedFile::moveMap(unsigned capacity) {
+	unsigned long long newOffset = fileEnd;
+	size_t size = slots.size() * sizeof(CompressedPageSlot);
+	unsigned long long start = ioClock();
+	ssize_t written = pwrite(fd, &slots[0], size, newOffset);
+	countWrite(stats, written, start);
+	if (written != (ssize_t)size) {
+		PagedFileManager::instance()->PrintFileStreamError("CompressedFile::moveMap");
+		return FILE_STREAM_FAILURE;
+	}
+	fileEnd += getMapSize(capacity);
+	unsigned long long oldOffset = mapOffset;
+	unsigned oldCapacity = mapCapacity;
+	mapOffset = newOffset;
+	mapCapacity = capacity;
+	RC rc = writeHeader();
+	if (rc == SUCC)
+		freeSlot(oldOffset, getMapSize(oldCapacity));
+	return rc;
+}
+
+// Read a page of a file without the buffer pool
+static RC readFilePage(const FileInfo &file, PageNum pageNum, void *data) {
+	if (file.compressed != NULL)
+		return file.compressed->readPage(pageNum, data);
+	return readRawPage(file.fd, file.getPageOffset(pageNum), file.pageSize, data,
+			file.stats, file.direct);
+}
+// Write a page of a file without the buffer pool
+static RC writeFilePage(const FileInfo &file, PageNum pageNum, const void *data) {
+	if (file.compressed != NULL)
+		return file.compressed->writePage(pageNum, data);
+	return writeRawPage(file.fd, file.getPageOffset(pageNum), file.pageSize, data,
+			file.stats, file.direct);
+}
+
 // This method reads the page into the memory block pointed by data. The page should exist.
 // Note the page number starts from 0.
 RC FileHandle::readPage(PageNum pageNum, void *data)
@@ -210,20 +1096,22 @@ RC FileHandle::readPage(PageNum pageNum, void *data)
     if (pageNum > getNumberOfPages()) {
     	PagedFileManager::instance()->PrintError("file does not exist in FileHandle::readPage");
     	return PAGE_NOT_EXIST;
-    } else {
-    	if (ferror(pFile)) {
-    		perror("1. FileHandle::readPage");
-    		return FILE_STREAM_FAILURE;
-    	} else {
-    		if (fseek(pFile, pageNum * PAGE_SIZE, SEEK_SET) != 0 ||		// seek file to specific page name
-    				fread(data, PAGE_SIZE, 1, pFile) != 1 ){	// read page
-    			PagedFileManager::instance()->PrintFileStreamError("2. FileHandle::readPage");
-    			return FILE_STREAM_FAILURE;
-    		} else {
-    			return SUCC;
-    		}
-    	}
     }
+    HandleIOScope scope(*this);
+    countPageIO(fileInfo->stats, &IOStats::pagesRead, 1);
+    readAhead(pageNum);
+    // copy the page from its frame
+    BufferManager &bm = PagedFileManager::instance()->bufferManager;
+    char *frame;
+    RC rc = bm.pinPage(fileName, *fileInfo, pageNum, frame);
+    if (rc == BUFFER_NO_FREE_FRAME) {
+    	// every frame is pinned, bypass the buffer pool
+    	return readFilePage(*fileInfo, pageNum, data);
+    } else if (rc != SUCC) {
+    	return rc;
+    }
+    memcpy(data, frame, fileInfo->pageSize);
+    return bm.unpinPage(fileName, pageNum, false);
 }
 
 // This method writes the data into a page specified by the pageNum.
@@ -234,123 +1122,1343 @@ RC FileHandle::writePage(PageNum pageNum, const void *data)
 	if (pageNum > getNumberOfPages()) {
 		cout << "file does not exist in FileHandle::writePage" << endl;
 		return PAGE_NOT_EXIST;
-	} else {
-		if (ferror(pFile)) {
-			PagedFileManager::instance()->PrintFileStreamError("1. FileHandle::writePage");
+	}
+	// writing right after the last page appends it
+	if (pageNum == getNumberOfPages())
+		return appendPage(data);
+	HandleIOScope scope(*this);
+	countPageIO(fileInfo->stats, &IOStats::pagesWritten, 1);
+	PagedFileManager *pfm = PagedFileManager::instance();
+	if (pfm->getWritePolicy() != WRITE_IMMEDIATE) {
+		// leave the page dirty in the buffer pool
+		RC rc = logPage(pageNum, data);
+		if (rc == SUCC)
+			rc = pfm->bufferManager.putPage(fileName, *fileInfo, pageNum, data);
+		if (rc != BUFFER_NO_FREE_FRAME)
+			return rc;
+		// the log goes to the disk before the page
+		rc = pfm->logManager.commit();
+		if (rc != SUCC)
+			return rc;
+	}
+	// keep the buffered copy up to date, then write through
+	pfm->bufferManager.updatePage(fileName, pageNum, data);
+	return writeFilePage(*fileInfo, pageNum, data);
+}
+
+// This method appends a new page to the file, and writes the data into the new allocated page.
+// Preallocate an extent of pages from the page on
+// The file size is kept, so it still marks the end of the written pages,
+// and appends into the extent do not allocate disk space one page at a time
+void FileHandle::allocateExtent(PageNum pageNum) {
+	unsigned extentSize = PagedFileManager::instance()->getExtentSize();
+	// the slots of a compressed file are not placed by page number
+	if (extentSize > 1 && fileInfo->compressed == NULL)
+		// failing only loses the preallocation, the page is allocated when written
+		fallocate(fd, FALLOC_FL_KEEP_SIZE, fileInfo->getPageOffset(pageNum),
+				(off_t)extentSize * fileInfo->pageSize);
+	fileInfo->allocPages = pageNum + (extentSize > 1 ? extentSize : 1);
+}
+
+// Append the page to the log under WRITE_LOGGED
+RC FileHandle::logPage(PageNum pageNum, const void *data) {
+	PagedFileManager *pfm = PagedFileManager::instance();
+	if (pfm->getWritePolicy() != WRITE_LOGGED)
+		return SUCC;
+	return pfm->logManager.appendPage(fileName, fileInfo->getPageOffset(pageNum),
+			fileInfo->pageSize, data);
+}
+
+RC FileHandle::appendPage(const void *data)
+{
+    PagedFileManager *pfm = PagedFileManager::instance();
+    if (NULL == fileInfo) {
+    	pfm->PrintError("FileHandle::appendPage: file not open");
+    	return FILE_NOT_OPEN_BY_HANDLE;
+    }
+    HandleIOScope scope(*this);
+    // the page count is taken and raised by one appender at a time
+    lock_guard<mutex> guard(fileInfo->latch);
+    countPageIO(fileInfo->stats, &IOStats::pagesAppended, 1);
+    PageNum pageNum = fileInfo->numPages;
+    if (pageNum >= fileInfo->allocPages)
+    	allocateExtent(pageNum);
+    if (pfm->getWritePolicy() != WRITE_IMMEDIATE) {
+    	// the new page stays dirty in the buffer pool, the file grows when it is written back
+    	RC rc = logPage(pageNum, data);
+    	if (rc == SUCC)
+    		rc = pfm->bufferManager.putPage(fileName, *fileInfo, pageNum, data);
+    	if (rc == SUCC)
+    		fileInfo->numPages.store(pageNum + 1, memory_order_release);
+    	if (rc != BUFFER_NO_FREE_FRAME)
+    		return rc;
+    	// the log goes to the disk before the page
+    	rc = pfm->logManager.commit();
+    	if (rc != SUCC)
+    		return rc;
+    }
+    // write the page right after the last page
+    RC rc = writeFilePage(*fileInfo, pageNum, data);
+    if (rc != SUCC)
+    	return rc;
+    fileInfo->numPages.store(pageNum + 1, memory_order_release);
+    return SUCC;
+}
+
+// Read adjacent pages into data, one page after another
+RC FileHandle::readPages(PageNum pageNum, unsigned numPages, void *data)
+{
+	vector<pair<PageNum, char *> > pages(numPages);
+	for (unsigned i = 0; i < numPages; ++i)
+		pages[i] = make_pair(pageNum + i, (char *)data + (size_t)i * getPageSize());
+	return readPageList(pages);
+}
+
+// Write adjacent pages from data, the pages past the last one are appended
+RC FileHandle::writePages(PageNum pageNum, unsigned numPages, const void *data)
+{
+	vector<pair<PageNum, char *> > pages(numPages);
+	for (unsigned i = 0; i < numPages; ++i)
+		pages[i] = make_pair(pageNum + i, (char *)data + (size_t)i * getPageSize());
+	return writePageList(pages);
+}
+
+// Read the listed pages into data, one page after another in the order listed
+RC FileHandle::readPages(const vector<PageNum> &pageNums, void *data)
+{
+	vector<pair<PageNum, char *> > pages(pageNums.size());
+	for (size_t i = 0; i < pageNums.size(); ++i)
+		pages[i] = make_pair(pageNums[i], (char *)data + i * getPageSize());
+	return readPageList(pages);
+}
+
+// Write the listed pages from data, one page after another in the order listed
+RC FileHandle::writePages(const vector<PageNum> &pageNums, const void *data)
+{
+	vector<pair<PageNum, char *> > pages(pageNums.size());
+	for (size_t i = 0; i < pageNums.size(); ++i)
+		pages[i] = make_pair(pageNums[i], (char *)data + i * getPageSize());
+	return writePageList(pages);
+}
+
+static bool comparePageNum(const pair<PageNum, char *> &a, const pair<PageNum, char *> &b) {
+	return a.first < b.first;
+}
+
+// Read pages into their buffers
+// The buffered pages are copied from their frames, since they may be newer
+// than the disk; the others are read with one preadv per run of adjacent pages
+RC FileHandle::readPageList(vector<pair<PageNum, char *> > &pages)
+{
+	if (NULL == fileInfo) {
+		PagedFileManager::instance()->PrintError("FileHandle::readPages: file not open");
+		return FILE_NOT_OPEN_BY_HANDLE;
+	}
+	stable_sort(pages.begin(), pages.end(), comparePageNum);
+	if (!pages.empty() && pages.back().first >= fileInfo->numPages) {
+		PagedFileManager::instance()->PrintError("page does not exist in FileHandle::readPages");
+		return PAGE_NOT_EXIST;
+	}
+	HandleIOScope scope(*this);
+	countPageIO(fileInfo->stats, &IOStats::pagesRead, pages.size());
+	BufferManager &bm = PagedFileManager::instance()->bufferManager;
+	unsigned pageSize = fileInfo->pageSize;
+	struct iovec iov[IOV_MAX];
+	size_t beg = 0;
+	while (beg < pages.size()) {
+		char *frame;
+		if (bm.pinBufferedPage(fileName, pages[beg].first, frame) == SUCC) {
+			memcpy(pages[beg].second, frame, pageSize);
+			bm.unpinPage(fileName, pages[beg].first, false);
+			++beg;
+			continue;
+		}
+		// O_DIRECT reads an unaligned buffer through a bounce page,
+		// and compressed pages are read from their slots one by one
+		if (fileInfo->compressed != NULL || (fileInfo->direct && !isAligned(pages[beg].second))) {
+			RC rc = readFilePage(*fileInfo, pages[beg].first, pages[beg].second);
+			if (rc != SUCC)
+				return rc;
+			++beg;
+			continue;
+		}
+		size_t end = beg + 1;
+		while (end < pages.size() && end - beg < IOV_MAX &&
+				pages[end].first == pages[beg].first + (end - beg) &&
+				(!fileInfo->direct || isAligned(pages[end].second)) &&
+				!bm.isPageBuffered(fileName, pages[end].first))
+			++end;
+		for (size_t i = beg; i < end; ++i) {
+			iov[i - beg].iov_base = pages[i].second;
+			iov[i - beg].iov_len = pageSize;
+		}
+		unsigned long long start = ioClock();
+		ssize_t size = preadv(fd, iov, end - beg, fileInfo->getPageOffset(pages[beg].first));
+		countRead(fileInfo->stats, size, start);
+		if (size != (ssize_t)((end - beg) * pageSize)) {
+			PagedFileManager::instance()->PrintFileStreamError("FileHandle::readPages");
 			return FILE_STREAM_FAILURE;
+		}
+		beg = end;
+	}
+	return SUCC;
+}
+
+// Write pages from their buffers, the pages past the last one are appended
+// A deferred policy leaves them dirty in the buffer pool, which writes them
+// back in runs; otherwise each run of adjacent pages takes one pwritev
+RC FileHandle::writePageList(vector<pair<PageNum, char *> > &pages)
+{
+	if (NULL == fileInfo) {
+		PagedFileManager::instance()->PrintError("FileHandle::writePages: file not open");
+		return FILE_NOT_OPEN_BY_HANDLE;
+	}
+	// a page listed twice keeps the later one
+	stable_sort(pages.begin(), pages.end(), comparePageNum);
+	PageNum numPages = fileInfo->numPages;
+	for (size_t i = 0; i < pages.size(); ++i) {
+		if (pages[i].first > numPages) {
+			PagedFileManager::instance()->PrintError("page does not exist in FileHandle::writePages");
+			return PAGE_NOT_EXIST;
+		}
+		if (pages[i].first == numPages)
+			++numPages;
+	}
+	PagedFileManager *pfm = PagedFileManager::instance();
+	if (pfm->getWritePolicy() != WRITE_IMMEDIATE) {
+		for (size_t i = 0; i < pages.size(); ++i) {
+			RC rc = writePage(pages[i].first, pages[i].second);
+			if (rc != SUCC)
+				return rc;
+		}
+		return SUCC;
+	}
+	HandleIOScope scope(*this);
+	lock_guard<mutex> guard(fileInfo->latch);
+	if (numPages > fileInfo->allocPages)
+		allocateExtent(fileInfo->numPages);
+	unsigned pageSize = fileInfo->pageSize;
+	struct iovec iov[IOV_MAX];
+	size_t beg = 0;
+	while (beg < pages.size()) {
+		size_t end = beg + 1;
+		while (end < pages.size() && end - beg < IOV_MAX && fileInfo->compressed == NULL &&
+				pages[end].first == pages[beg].first + (end - beg) &&
+				(!fileInfo->direct || (isAligned(pages[beg].second) && isAligned(pages[end].second))))
+			++end;
+		for (size_t i = beg; i < end; ++i) {
+			// keep the buffered copies up to date
+			pfm->bufferManager.updatePage(fileName, pages[i].first, pages[i].second);
+			if (pages[i].first < fileInfo->numPages)
+				countPageIO(fileInfo->stats, &IOStats::pagesWritten, 1);
+			else
+				countPageIO(fileInfo->stats, &IOStats::pagesAppended, 1);
+			iov[i - beg].iov_base = pages[i].second;
+			iov[i - beg].iov_len = pageSize;
+		}
+		off_t offset = fileInfo->getPageOffset(pages[beg].first);
+		RC rc = SUCC;
+		if (end - beg == 1) {
+			rc = writeFilePage(*fileInfo, pages[beg].first, pages[beg].second);
 		} else {
-			if (fseek(pFile, pageNum * PAGE_SIZE, SEEK_SET) != 0 ||		// seek to page num
-					fwrite(data, PAGE_SIZE, 1, pFile) != 1 ){	// write page
-				PagedFileManager::instance()->PrintFileStreamError("2. FileHandle::writePage");
-    			return FILE_STREAM_FAILURE;
-			} else {
-				//flush page and return success
-				fflush(pFile);
-				return SUCC;
+			unsigned long long start = ioClock();
+			ssize_t size = pwritev(fd, iov, end - beg, offset);
+			countWrite(fileInfo->stats, size, start);
+			if (size != (ssize_t)((end - beg) * pageSize)) {
+				pfm->PrintFileStreamError("FileHandle::writePages");
+				rc = FILE_STREAM_FAILURE;
 			}
 		}
+		if (rc != SUCC)
+			return rc;
+		if (pages[end - 1].first >= fileInfo->numPages)
+			fileInfo->numPages.store(pages[end - 1].first + 1, memory_order_release);
+		beg = end;
 	}
+	return SUCC;
 }
 
-// This method appends a new page to the file, and writes the data into the new allocated page.
-RC FileHandle::appendPage(const void *data)
+// Pin a page in the buffer pool, the page stays in memory until it is unpinned.
+// Modify the frame in place and unpin it as dirty to write it back.
+RC FileHandle::pinPage(PageNum pageNum, char *&page)
 {
-    if (ferror(pFile)) {
-    	PagedFileManager::instance()->PrintFileStreamError("FileHandle::appendPage");
-    	return FILE_STREAM_FAILURE;
-    } else {
-    	if (fseek(pFile, PAGE_SIZE * getNumberOfPages(), SEEK_SET) != 0 ||	// seek to the end of the last page
-    			fwrite(data, PAGE_SIZE, 1, pFile) != 1 ||			// write the page to the end
-    			fflush(pFile) != 0){										// flush the file
-    		PagedFileManager::instance()->PrintFileStreamError("FileHandle::appendPage");
-    		return FILE_STREAM_FAILURE;
-    	} else {
-    		return SUCC;
-    	}
-    }
+	if (pageNum >= getNumberOfPages()) {
+		PagedFileManager::instance()->PrintError("page does not exist in FileHandle::pinPage");
+		return PAGE_NOT_EXIST;
+	}
+	HandleIOScope scope(*this);
+	countPageIO(fileInfo->stats, &IOStats::pagesRead, 1);
+	return PagedFileManager::instance()->bufferManager.pinPage(fileName, *fileInfo, pageNum, page);
+}
+
+// Release a page pinned by pinPage
+RC FileHandle::unpinPage(PageNum pageNum, bool dirty)
+{
+	HandleIOScope scope(*this);
+	if (dirty && fileInfo != NULL)
+		countPageIO(fileInfo->stats, &IOStats::pagesWritten, 1);
+	PagedFileManager *pfm = PagedFileManager::instance();
+	if (dirty && pfm->getWritePolicy() == WRITE_LOGGED) {
+		// log the frame before it may be written back
+		char *page;
+		RC rc = pfm->bufferManager.pinBufferedPage(fileName, pageNum, page);
+		if (rc == SUCC) {
+			rc = logPage(pageNum, page);
+			pfm->bufferManager.unpinPage(fileName, pageNum, false);
+		}
+		if (rc != SUCC) {
+			pfm->bufferManager.unpinPage(fileName, pageNum, dirty);
+			return rc;
+		}
+	}
+	RC rc = pfm->bufferManager.unpinPage(fileName, pageNum, dirty);
+	if (rc != SUCC || pfm->getWritePolicy() != WRITE_IMMEDIATE)
+		return rc;
+	// write through, a page still pinned by others is written by the last of them
+	rc = pfm->bufferManager.flushPage(fileName, pageNum);
+	return rc == BUFFER_PAGE_PINNED ? SUCC : rc;
+}
+
+// Get a read-only page in place, the page must be released by releasePage.
+// A mapped file hands out its mapping unless the page is buffered, since a
+// buffered page may be newer than the disk. Others hand out a pinned frame.
+RC FileHandle::readPage(PageNum pageNum, const char *&page)
+{
+	if (pageNum >= getNumberOfPages()) {
+		PagedFileManager::instance()->PrintError("page does not exist in FileHandle::readPage");
+		return PAGE_NOT_EXIST;
+	}
+	HandleIOScope scope(*this);
+	countPageIO(fileInfo->stats, &IOStats::pagesRead, 1);
+	readAhead(pageNum);
+	BufferManager &bm = PagedFileManager::instance()->bufferManager;
+	char *frame;
+	if (fileInfo->mapped) {
+		if (bm.pinBufferedPage(fileName, pageNum, frame) == SUCC) {
+			page = frame;
+			return SUCC;
+		}
+		char *mapping;
+		if (mapPages(pageNum, mapping) == SUCC) {
+			page = mapping + fileInfo->getPageOffset(pageNum);
+			return SUCC;
+		}
+	}
+	RC rc = bm.pinPage(fileName, *fileInfo, pageNum, frame);
+	page = frame;
+	return rc;
+}
+
+// Start reading pages into the OS page cache without waiting for them
+// Direct I/O bypasses the page cache, so nothing is prefetched then
+void FileHandle::prefetchPages(PageNum pageNum, unsigned numPages) {
+	PageNum totalNumPage = getNumberOfPages();
+	if (fileInfo == NULL || fileInfo->direct || fileInfo->compressed != NULL ||
+			pageNum >= totalNumPage)
+		return;
+	if (numPages > totalNumPage - pageNum)
+		numPages = totalNumPage - pageNum;
+	HandleIOScope scope(*this);
+	posix_fadvise(fd, fileInfo->getPageOffset(pageNum), (off_t)numPages * fileInfo->pageSize,
+			POSIX_FADV_WILLNEED);
+	countPageIO(fileInfo->stats, &IOStats::pagesPrefetched, numPages);
+}
+
+// Track sequential reads of the handle and keep a window of pages prefetched
+// The window is refilled when half of it is consumed
+void FileHandle::readAhead(PageNum pageNum) {
+	unsigned window = PagedFileManager::instance()->getReadAhead();
+	if (pageNum == lastReadPage)
+		return;
+	if (pageNum == lastReadPage + 1) {
+		++sequentialReads;
+	} else {
+		sequentialReads = 0;
+		readAheadEnd = 0;
+	}
+	lastReadPage = pageNum;
+	if (window == 0 || sequentialReads < READ_AHEAD_TRIGGER ||
+			readAheadEnd > pageNum + window / 2)
+		return;
+	PageNum start = readAheadEnd > pageNum + 1 ? readAheadEnd : pageNum + 1;
+	readAheadEnd = pageNum + 1 + window;
+	if (start < readAheadEnd)
+		prefetchPages(start, readAheadEnd - start);
+}
+
+// Release a page got by readPage in place
+void FileHandle::releasePage(const char *page)
+{
+	PagedFileManager::instance()->bufferManager.releaseFrame(page);
+}
+
+// Map the file up to the page, the mapping doubles when the file outgrows it
+RC FileHandle::mapPages(PageNum pageNum, char *&mapping)
+{
+	lock_guard<mutex> guard(fileInfo->latch);
+	vector<pair<char *, size_t> > &maps = fileInfo->maps;
+	size_t needed = fileInfo->getPageOffset(pageNum + 1);
+	if (!maps.empty() && maps.back().second >= needed) {
+		mapping = maps.back().first;
+		return SUCC;
+	}
+	size_t size = maps.empty() ? MMAP_MIN_SIZE : maps.back().second;
+	while (size < needed)
+		size *= 2;
+	void *addr = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	if (addr == MAP_FAILED) {
+		PagedFileManager::instance()->PrintFileStreamError("FileHandle::mapPages");
+		return FILE_STREAM_FAILURE;
+	}
+	maps.push_back(make_pair((char *)addr, size));
+	mapping = (char *)addr;
+	return SUCC;
 }
 
 // This method returns the total number of pages in the file.
+// The count is kept in memory: seeded at openFile and increased by appendPage
 unsigned FileHandle::getNumberOfPages()
 {
-	if (ferror(pFile)) {
-		PagedFileManager::instance()->PrintFileStreamError("FileHandle::getNumberOfPages");
+	if (NULL == fileInfo) {
+		PagedFileManager::instance()->PrintError("FileHandle::getNumberOfPages: file not open");
 		return 0;
 	}
-	if (fseek (pFile , 0 , SEEK_END) != 0) {
-		PagedFileManager::instance()->PrintFileStreamError("FileHandle::getNumberOfPages");
-		return 0;
-	} else {
-		return ftell(pFile) / PAGE_SIZE;
-	}
+	return fileInfo->numPages.load(memory_order_acquire);
+}
+
+// This method returns the page size of the file, kept in its header
+unsigned FileHandle::getPageSize()
+{
+	return NULL == fileInfo ? PAGE_SIZE : fileInfo->pageSize;
+}
+
+// This method returns the flags of the file, 0 for the files without a header
+unsigned FileHandle::getFlags()
+{
+	return NULL == fileInfo ? 0 : fileInfo->flags;
+}
+
+// Get the free space of the file, shared by all its handles
+FileSpaceManager *FileHandle::getSpaceManager()
+{
+	return NULL == fileInfo ? NULL : &fileInfo->spaceManager;
 }
 
 // Get the free space associated with page num
 // Note that the page must be loaded already
 unsigned FileHandle::getSpaceOfPage(void *page) {
-	char *beg = (char *)page + PAGE_SIZE - sizeof(unsigned long);
+	unsigned pageSize = getPageSize();
+	char *beg = (char *)page + pageSize - sizeof(unsigned long);
 	unsigned long addr_beg = *((unsigned long *)(beg));
-	int space = PAGE_SIZE - addr_beg;
-	char *p = (char *)page + PAGE_SIZE - sizeof(unsigned long) - sizeof(unsigned short);
+	int space = pageSize - addr_beg;
+	char *p = (char *)page + pageSize - sizeof(unsigned long) - sizeof(unsigned short);
 	unsigned short slotNum =  *((unsigned short *)p);
 	space = space - slotNum * sizeof(SlotDir) - sizeof(unsigned short) - sizeof(unsigned long);
 	return space;
 }
 
 // File Space manager
-FileSpaceManager::FileSpaceManager(FileHandle &fileHandle) {
-	//get the total number of pages 
-	unsigned totalNumPage = fileHandle.getNumberOfPages();
-	//check every page
-	for (unsigned i = TABLE_PAGES_NUM; i < totalNumPage; ++i) {
-		char page[PAGE_SIZE];
-		fileHandle.readPage(i, page);
-		//get free space for that page
-		unsigned space = fileHandle.getSpaceOfPage(page);
-		//write free space information
-		pageQueue.insert(pair<unsigned, PageNum>(MAX_FREE_SPACE_SIZE-space, i));
+FileSpaceManager::FileSpaceManager(unsigned pageSize) : numListedPages(0),
+		spaceUnit(pageSize / PAGE_LEVEL), spaceMap(false), loaded(false) {
+	for (unsigned i = 0; i < PAGE_LEVEL; ++i)
+		levelHeads[i] = FSM_NULL_PAGE;
+	memset(levelMask, 0, sizeof(levelMask));
+}
+
+// Put a page at the head of the list of its level
+void FileSpaceManager::linkPage(const PageNum &pageNum, const unsigned &level) {
+	if (pageNum >= pageLinks.size()) {
+		PageSpaceLink link = {FSM_NULL_PAGE, FSM_NULL_PAGE, 0};
+		pageLinks.resize(pageNum + 1, link);
+	}
+	PageSpaceLink &link = pageLinks[pageNum];
+	link.prev = FSM_NULL_PAGE;
+	link.next = levelHeads[level];
+	link.level = level;
+	if (link.next != FSM_NULL_PAGE)
+		pageLinks[link.next].prev = pageNum;
+	levelHeads[level] = pageNum;
+	levelMask[level / 64] |= 1ULL << (level % 64);
+	++numListedPages;
+}
+
+// Take a page out of the list of its level
+void FileSpaceManager::unlinkPage(const PageNum &pageNum) {
+	if (pageNum >= pageLinks.size() || pageLinks[pageNum].level == 0)
+		return;
+	PageSpaceLink &link = pageLinks[pageNum];
+	if (link.prev != FSM_NULL_PAGE)
+		pageLinks[link.prev].next = link.next;
+	else
+		levelHeads[link.level] = link.next;
+	if (link.next != FSM_NULL_PAGE)
+		pageLinks[link.next].prev = link.prev;
+	if (levelHeads[link.level] == FSM_NULL_PAGE)
+		levelMask[link.level / 64] &= ~(1ULL << (link.level % 64));
+	link.level = 0;
+	--numListedPages;
+}
+
+// Load the page space info from the free space map pages
+// Only the map pages are read, one for every FSM_PAGE_SPAN data pages;
+// a file made without the map has every data page read instead
+RC FileSpaceManager::loadPageSpaceInfo(FileHandle &fileHandle) {
+	lock_guard<mutex> guard(latch);
+	if (loaded)
+		return SUCC;
+	PageNum totalNumPage = fileHandle.getNumberOfPages();
+	for (PageNum pageNum = TABLE_PAGES_NUM; !spaceMap && pageNum < totalNumPage; ++pageNum) {
+		const char *page;
+		RC rc = fileHandle.readPage(pageNum, page);
+		if (rc != SUCC)
+			return rc;
+		unsigned level = getSpaceLevel(fileHandle.getSpaceOfPage((void *)page));
+		fileHandle.releasePage(page);
+		unlinkPage(pageNum);
+		if (level > 0)
+			linkPage(pageNum, level);
 	}
+	for (PageNum mapPageNum = TABLE_PAGES_NUM; spaceMap && mapPageNum < totalNumPage;
+			mapPageNum += FSM_PAGE_SPAN + 1) {
+		const char *page;
+		RC rc = fileHandle.readPage(mapPageNum, page);
+		if (rc != SUCC)
+			return rc;
+		for (unsigned i = 0; i < FSM_PAGE_SPAN && mapPageNum + 1 + i < totalNumPage; ++i) {
+			PageNum pageNum = mapPageNum + 1 + i;
+			unlinkPage(pageNum);
+			if (page[i] != 0)
+				linkPage(pageNum, (unsigned char)page[i]);
+		}
+		fileHandle.releasePage(page);
+	}
+	loaded = true;
+	return SUCC;
 }
 
+// Record the free space of a page in the free space map
+// The space is rounded down, and the map is a hint that insertRecord checks
+// against the page, so it is written back with the buffer pool, not at once
+RC FileSpaceManager::savePageSpaceInfo(FileHandle &fileHandle,
+		const unsigned &freeSpaceSize, const PageNum &pageNum) {
+	if (!spaceMap)
+		return SUCC;
+	PageNum mapPageNum = getSpaceMapPage(pageNum);
+	char *page;
+	RC rc = fileHandle.pinPage(mapPageNum, page);
+	if (rc != SUCC)
+		return rc;
+	page[pageNum - mapPageNum - 1] = (char)getSpaceLevel(freeSpaceSize);
+	return PagedFileManager::instance()->bufferManager.unpinPage(fileHandle.fileName,
+			mapPageNum, true);
+}
+
+// Whether a page holds the free space map
+bool FileSpaceManager::isSpaceMapPage(const PageNum &pageNum) const {
+	return spaceMap && pageNum >= TABLE_PAGES_NUM &&
+			(pageNum - TABLE_PAGES_NUM) % (FSM_PAGE_SPAN + 1) == 0;
+}
 
-FileSpaceManager::FileSpaceManager() {
+// Get the free space map page covering a data page
+PageNum FileSpaceManager::getSpaceMapPage(const PageNum &pageNum) const {
+	return pageNum - (pageNum - TABLE_PAGES_NUM) % (FSM_PAGE_SPAN + 1);
 }
 
-// Get the page with the greatest free space size
+// Get the page with the least free space that fits the record
+// Every page listed at or above the level rounded up fits the record
 RC FileSpaceManager::getPageSpaceInfo(const unsigned &recordSize,
 		PageNum &pageNum) {
-	if (pageQueue.empty())
+	lock_guard<mutex> guard(latch);
+	if (numListedPages == 0)
 		return FILE_SPACE_EMPTY;
-	
-	//check whether if there is enough free space
-	unsigned freeSpaceSize = MAX_FREE_SPACE_SIZE - pageQueue.begin()->first;
-	if (freeSpaceSize < recordSize) {
-		// the free space of the page is less than the record to be inserted
-		return FILE_SPACE_NO_SPACE;
-	}
-	pageNum = pageQueue.begin()->second;
-	if (pageNum < TABLE_PAGES_NUM)
-		return FILE_SPACE_NO_SPACE;
+	unsigned level = (recordSize + spaceUnit - 1) / spaceUnit;
+	if (level == 0)
+		level = 1;
+	for (unsigned word = level / 64; word < PAGE_LEVEL / 64; ++word) {
+		unsigned long long bits = levelMask[word];
+		if (word == level / 64)
+			bits &= ~0ULL << (level % 64);
+		if (bits != 0) {
+			pageNum = levelHeads[word * 64 + __builtin_ctzll(bits)];
+			return SUCC;
+		}
+	}
+	// the free space of the pages is less than the record to be inserted
+	return FILE_SPACE_NO_SPACE;
+}
+
+// Update the page space info and record it in the free space map
+// A page below the first level is full, it is not listed
+RC FileSpaceManager::pushPageSpaceInfo(FileHandle &fileHandle,
+		const unsigned &freeSpaceSize, const unsigned &pageNum) {
+	if (pageNum < TABLE_PAGES_NUM || isSpaceMapPage(pageNum)) // not a user page
+		return SUCC;
+	lock_guard<mutex> guard(latch);
+	unsigned level = getSpaceLevel(freeSpaceSize);
+	if (pageNum >= pageLinks.size() || pageLinks[pageNum].level != level) {
+		unlinkPage(pageNum);
+		if (level > 0)
+			linkPage(pageNum, level);
+	}
+	return savePageSpaceInfo(fileHandle, freeSpaceSize, pageNum);
+}
+
+// Get the # of listed pages
+unsigned FileSpaceManager::getPageSpaceQueueSize() {
+	lock_guard<mutex> guard(latch);
+	return numListedPages;
+}
+
+// Get the greatest free space size of the listed pages, rounded down
+unsigned FileSpaceManager::getTopPageSpaceInfo() {
+	lock_guard<mutex> guard(latch);
+	for (unsigned word = PAGE_LEVEL / 64; word > 0; --word) {
+		if (levelMask[word - 1] != 0)
+			return ((word - 1) * 64 + 63 - __builtin_clzll(levelMask[word - 1])) * spaceUnit;
+	}
+	return 0;
+}
+
+// Clear all the page space info, the caller pushes every page again
+void FileSpaceManager::clearPageSpaceInfo() {
+	lock_guard<mutex> guard(latch);
+	pageLinks.clear();
+	for (unsigned i = 0; i < PAGE_LEVEL; ++i)
+		levelHeads[i] = FSM_NULL_PAGE;
+	memset(levelMask, 0, sizeof(levelMask));
+	numListedPages = 0;
+	loaded = true;
+}
+
+// Drop the page space info, the next insertion loads it from the free space map
+void FileSpaceManager::unloadPageSpaceInfo() {
+	clearPageSpaceInfo();
+	lock_guard<mutex> guard(latch);
+	loaded = false;
+}
+
+
+
+// Buffer manager
+BufferManager::BufferManager(unsigned numFrames) : pool(NULL), clockHand(0),
+		flusherStop(false), flushInterval(FLUSH_INTERVAL_MS) {
+	allocateFrames(numFrames);
+}
+
+BufferManager::~BufferManager() {
+	stopFlusher();
+	// write all the dirty frames back
+	flushAll();
+	free(pool);
+}
+
+void BufferManager::allocateFrames(unsigned numFrames) {
+	if (numFrames == 0)
+		numFrames = 1;
+	free(pool);
+	// frames are aligned to the page for O_DIRECT
+	void *mem = NULL;
+	// a frame holds the largest page, the memory past a smaller page is never touched
+	if (posix_memalign(&mem, PAGE_SIZE, (size_t)numFrames * MAX_PAGE_SIZE) != 0)
+		throw bad_alloc();
+	pool = (char *)mem;
+	frames.assign(numFrames, BufferFrame());
+	for (FrameNum i = 0; i < numFrames; ++i) {
+		frames[i].fd = -1;
+		frames[i].pageNum = 0;
+		frames[i].pageSize = PAGE_SIZE;
+		frames[i].offset = 0;
+		frames[i].stats = NULL;
+		frames[i].compressed = NULL;
+		frames[i].pinCount = 0;
+		frames[i].dirty = false;
+		frames[i].referenced = false;
+		frames[i].valid = false;
+		frames[i].io = false;
+		frames[i].data = pool + (size_t)i * MAX_PAGE_SIZE;
+	}
+	pageTable.clear();
+	clockHand = 0;
+}
+
+// Change the # of frames, all dirty pages are written back first
+RC BufferManager::setNumFrames(unsigned numFrames) {
+	unique_lock<mutex> guard(latch);
+	while (true) {
+		waitForIO(guard, NULL);
+		for (FrameNum i = 0; i < frames.size(); ++i) {
+			if (frames[i].valid && frames[i].pinCount > 0)
+				return BUFFER_PAGE_PINNED;
+		}
+		vector<FrameNum> dirtyFrames;
+		getDirtyFrames(NULL, dirtyFrames);
+		if (dirtyFrames.empty())
+			break;
+		// pages may be put while the latch is released, so look again
+		RC rc = writeFrames(guard, dirtyFrames);
+		if (rc != SUCC)
+			return rc;
+	}
+	allocateFrames(numFrames);
 	return SUCC;
 }
-// Pop the page space info
-RC FileSpaceManager::popPageSpaceInfo() {
-	if (pageQueue.empty())
-		return FILE_SPACE_EMPTY;
-	pageQueue.erase(pageQueue.begin());
+
+// Find the frame of a page, waiting while it is read or written
+RC BufferManager::findFrame(unique_lock<mutex> &guard, const string &fileName,
+		PageNum pageNum, FrameNum &frameNum) {
+	while (true) {
+		unordered_map<string, unordered_map<PageNum, FrameNum> >::iterator itrFile =
+				pageTable.find(fileName);
+		if (itrFile == pageTable.end())
+			return BUFFER_FILE_NOT_HIT;
+		unordered_map<PageNum, FrameNum>::iterator itr = itrFile->second.find(pageNum);
+		if (itr == itrFile->second.end())
+			return BUFFER_PAGENUM_NOT_HIT;
+		if (!frames[itr->second].io) {
+			frameNum = itr->second;
+			return SUCC;
+		}
+		// the frame may hold another page when the I/O is done
+		ioCond.wait(guard);
+	}
+}
+
+// Wait until no frame of the file, or of any file if fileName is NULL, is read or written
+void BufferManager::waitForIO(unique_lock<mutex> &guard, const string *fileName) {
+	FrameNum i = 0;
+	while (i < frames.size()) {
+		if (frames[i].io && (fileName == NULL || frames[i].fileName == *fileName)) {
+			// others may start I/O meanwhile, so all the frames are checked again
+			ioCond.wait(guard);
+			i = 0;
+		} else {
+			++i;
+		}
+	}
+}
+
+// Pin a page of the file; the page is loaded from the disk if not buffered
+// The frame is listed before the page is read, so the other users of the page
+// wait for the read instead of loading it again
+RC BufferManager::pinPage(const string &fileName, const FileInfo &file,
+		PageNum pageNum, char *&data) {
+	unique_lock<mutex> guard(latch);
+	FrameNum frameNum;
+	while (findFrame(guard, fileName, pageNum, frameNum) != SUCC) {
+		// buffer miss, load the page into a free frame
+		RC rc = getVictimFrame(guard, frameNum);
+		if (rc != SUCC)
+			return rc;
+		// the latch may be released while the victim is written back
+		if (pageTable[fileName].count(pageNum) > 0)
+			continue;
+		BufferFrame &frame = frames[frameNum];
+		frame.fileName = fileName;
+		frame.fd = file.fd;
+		frame.pageNum = pageNum;
+		frame.pageSize = file.pageSize;
+		frame.offset = file.getPageOffset(pageNum);
+		frame.stats = file.stats;
+		frame.compressed = file.compressed;
+		frame.pinCount = 1;
+		frame.dirty = false;
+		frame.referenced = true;
+		frame.valid = true;
+		frame.io = true;
+		pageTable[fileName][pageNum] = frameNum;
+		guard.unlock();
+		rc = readFilePage(file, pageNum, frame.data);
+		guard.lock();
+		frame.io = false;
+		ioCond.notify_all();
+		if (rc != SUCC) {
+			pageTable[fileName].erase(pageNum);
+			frame.pinCount = 0;
+			frame.valid = false;
+			return rc;
+		}
+		data = frame.data;
+		return SUCC;
+	}
+	// buffer hit
+	BufferFrame &frame = frames[frameNum];
+	++frame.pinCount;
+	frame.referenced = true;
+	data = frame.data;
+	return SUCC;
+}
+
+// Release a pinned page, mark it dirty if it is modified
+RC BufferManager::unpinPage(const string &fileName, PageNum pageNum, bool dirty) {
+	lock_guard<mutex> guard(latch);
+	unordered_map<string, unordered_map<PageNum, FrameNum> >::iterator itrFile =
+			pageTable.find(fileName);
+	if (itrFile == pageTable.end())
+		return BUFFER_FILE_NOT_HIT;
+	unordered_map<PageNum, FrameNum>::iterator itr = itrFile->second.find(pageNum);
+	if (itr == itrFile->second.end())
+		return BUFFER_PAGENUM_NOT_HIT;
+	BufferFrame &frame = frames[itr->second];
+	if (frame.pinCount > 0)
+		--frame.pinCount;
+	frame.dirty = frame.dirty || dirty;
+	return SUCC;
+}
+
+// Whether a page is buffered
+bool BufferManager::isPageBuffered(const string &fileName, PageNum pageNum) {
+	lock_guard<mutex> guard(latch);
+	unordered_map<string, unordered_map<PageNum, FrameNum> >::iterator itrFile =
+			pageTable.find(fileName);
+	return itrFile != pageTable.end() && itrFile->second.count(pageNum) > 0;
+}
+
+// Pin a page only if it is buffered
+RC BufferManager::pinBufferedPage(const string &fileName, PageNum pageNum, char *&data) {
+	unique_lock<mutex> guard(latch);
+	FrameNum frameNum;
+	RC rc = findFrame(guard, fileName, pageNum, frameNum);
+	if (rc != SUCC)
+		return rc;
+	BufferFrame &frame = frames[frameNum];
+	++frame.pinCount;
+	frame.referenced = true;
+	data = frame.data;
 	return SUCC;
 }
-// Push the page space info
-RC FileSpaceManager::pushPageSpaceInfo(const unsigned &freeSpaceSize,
-		const unsigned &pageNum) {
-	if (pageNum < TABLE_PAGES_NUM) // return because it's not a user page
+
+// Release a clean page by its frame, pointers outside the pool are ignored
+void BufferManager::releaseFrame(const char *data) {
+	lock_guard<mutex> guard(latch);
+	if (data < pool || data >= pool + frames.size() * MAX_PAGE_SIZE)
+		return;
+	BufferFrame &frame = frames[(data - pool) / MAX_PAGE_SIZE];
+	if (frame.pinCount > 0)
+		--frame.pinCount;
+}
+
+// Copy a page into its frame if it is buffered
+// Note the caller writes the page to the disk itself, so the frame is clean
+void BufferManager::updatePage(const string &fileName, PageNum pageNum,
+		const void *data) {
+	unique_lock<mutex> guard(latch);
+	FrameNum frameNum;
+	if (findFrame(guard, fileName, pageNum, frameNum) != SUCC)
+		return;
+	BufferFrame &frame = frames[frameNum];
+	if (frame.data != data)
+		memcpy(frame.data, data, frame.pageSize);
+	frame.dirty = false;
+	frame.referenced = true;
+}
+
+// Copy a page into a frame without reading it and mark it dirty
+RC BufferManager::putPage(const string &fileName, const FileInfo &file, PageNum pageNum,
+		const void *data) {
+	unique_lock<mutex> guard(latch);
+	FrameNum frameNum;
+	while (findFrame(guard, fileName, pageNum, frameNum) != SUCC) {
+		RC rc = getVictimFrame(guard, frameNum);
+		if (rc != SUCC)
+			return rc;
+		// the latch may be released while the victim is written back
+		if (pageTable[fileName].count(pageNum) > 0)
+			continue;
+		BufferFrame &frame = frames[frameNum];
+		frame.fileName = fileName;
+		frame.fd = file.fd;
+		frame.pageNum = pageNum;
+		frame.pageSize = file.pageSize;
+		frame.offset = file.getPageOffset(pageNum);
+		frame.stats = file.stats;
+		frame.compressed = file.compressed;
+		frame.pinCount = 0;
+		frame.valid = true;
+		pageTable[fileName][pageNum] = frameNum;
+		break;
+	}
+	BufferFrame &frame = frames[frameNum];
+	if (frame.data != data)
+		memcpy(frame.data, data, frame.pageSize);
+	frame.dirty = true;
+	frame.referenced = true;
+	return SUCC;
+}
+
+// Write a dirty page back to the disk
+// A pinned page may be modified by its holders while written, so it is left to them
+RC BufferManager::flushPage(const string &fileName, PageNum pageNum) {
+	unique_lock<mutex> guard(latch);
+	FrameNum frameNum;
+	RC rc = findFrame(guard, fileName, pageNum, frameNum);
+	if (rc != SUCC)
+		return rc;
+	if (!frames[frameNum].dirty)
+		return SUCC;
+	if (frames[frameNum].pinCount > 0)
+		return BUFFER_PAGE_PINNED;
+	vector<FrameNum> dirtyFrames(1, frameNum);
+	return writeFrames(guard, dirtyFrames);
+}
+
+// Write all the dirty pages of a file back to the disk
+// The pages being written by others are waited for, so all the unpinned ones
+// are on the disk on return
+RC BufferManager::flushFile(const string &fileName) {
+	unique_lock<mutex> guard(latch);
+	waitForIO(guard, &fileName);
+	vector<FrameNum> dirtyFrames;
+	bool pinned = getDirtyFrames(&fileName, dirtyFrames);
+	RC rc = writeFrames(guard, dirtyFrames);
+	return rc == SUCC && pinned ? BUFFER_PAGE_PINNED : rc;
+}
+
+// Write all the dirty pages back to the disk
+RC BufferManager::flushAll() {
+	unique_lock<mutex> guard(latch);
+	waitForIO(guard, NULL);
+	vector<FrameNum> dirtyFrames;
+	bool pinned = getDirtyFrames(NULL, dirtyFrames);
+	RC rc = writeFrames(guard, dirtyFrames);
+	return rc == SUCC && pinned ? BUFFER_PAGE_PINNED : rc;
+}
+
+// Drop all the frames of a file without writing them back
+// A pinned frame is still read by its holder, so it is never given to another page
+RC BufferManager::discardFile(const string &fileName) {
+	unique_lock<mutex> guard(latch);
+	waitForIO(guard, &fileName);
+	unordered_map<string, unordered_map<PageNum, FrameNum> >::iterator itrFile =
+			pageTable.find(fileName);
+	if (itrFile == pageTable.end())
 		return SUCC;
-	pageQueue.insert(pair<unsigned, PageNum>(MAX_FREE_SPACE_SIZE-freeSpaceSize, pageNum));
+	unordered_map<PageNum, FrameNum>::iterator itr;
+	for (itr = itrFile->second.begin(); itr != itrFile->second.end(); ++itr) {
+		if (frames[itr->second].pinCount > 0)
+			return BUFFER_PAGE_PINNED;
+	}
+	for (itr = itrFile->second.begin(); itr != itrFile->second.end(); ++itr) {
+		BufferFrame &frame = frames[itr->second];
+		frame.valid = false;
+		frame.dirty = false;
+		frame.referenced = false;
+		frame.pinCount = 0;
+		frame.fd = -1;
+		frame.fileName.clear();
+	}
+	pageTable.erase(itrFile);
 	return SUCC;
 }
-// Clear all the page space info
-void FileSpaceManager::clearPageSpaceInfo() {
-	pageQueue.clear();
+
+// Start the background thread flushing the pool every intervalMs
+void BufferManager::startFlusher(unsigned intervalMs) {
+	stopFlusher();
+	flushInterval = intervalMs == 0 ? 1 : intervalMs;
+	flusherStop = false;
+	flusher = thread(&BufferManager::flusherLoop, this);
+}
+
+// Stop the background flusher and wait for it to exit
+void BufferManager::stopFlusher() {
+	if (!flusher.joinable())
+		return;
+	{
+		lock_guard<mutex> guard(latch);
+		flusherStop = true;
+	}
+	flusherCond.notify_all();
+	flusher.join();
+}
+
+// The pinned frames may be modified by their users, leave them to the next round
+void BufferManager::flusherLoop() {
+	unique_lock<mutex> guard(latch);
+	while (!flusherStop) {
+		flusherCond.wait_for(guard, chrono::milliseconds(flushInterval));
+		if (flusherStop)
+			break;
+		vector<FrameNum> dirtyFrames;
+		getDirtyFrames(NULL, dirtyFrames);
+		RC rc = writeFrames(guard, dirtyFrames);
+		if (rc != SUCC)
+			cerr << "BufferManager::flusherLoop: flush error " << rc << endl;
+	}
+}
+
+// Clock replacement: skip the pinned frames and the ones in I/O, give the
+// referenced ones a second chance, and evict the first frame that is neither.
+// A dirty victim is written back first, which releases the latch
+RC BufferManager::getVictimFrame(unique_lock<mutex> &guard, FrameNum &frameNum) {
+	while (true) {
+		unsigned numFrames = frames.size();
+		bool busy = false;
+		for (unsigned i = 0; i < 2 * numFrames; ++i) {
+			BufferFrame &frame = frames[clockHand];
+			FrameNum cur = clockHand;
+			clockHand = (clockHand + 1) % numFrames;
+			if (!frame.valid) {
+				frameNum = cur;
+				return SUCC;
+			}
+			if (frame.io) {
+				busy = true;
+				continue;
+			}
+			if (frame.pinCount > 0)
+				continue;
+			if (frame.referenced) {
+				frame.referenced = false;
+				continue;
+			}
+			// evict the page
+			if (frame.dirty) {
+				vector<FrameNum> victim(1, cur);
+				RC rc = writeFrames(guard, victim);
+				if (rc != SUCC)
+					return rc;
+				if (frame.pinCount > 0 || frame.dirty)
+					continue;
+			}
+			pageTable[frame.fileName].erase(frame.pageNum);
+			frame.valid = false;
+			frameNum = cur;
+			return SUCC;
+		}
+		if (!busy)
+			return BUFFER_NO_FREE_FRAME;
+		// the frames in I/O may be free when it is done
+		ioCond.wait(guard);
+	}
+}
+
+// The pinned frames are skipped, whether one of them is dirty is returned
+bool BufferManager::getDirtyFrames(const string *fileName, vector<FrameNum> &frameNums) {
+	bool pinned = false;
+	for (FrameNum i = 0; i < frames.size(); ++i) {
+		const BufferFrame &frame = frames[i];
+		if (!frame.valid || !frame.dirty || frame.io)
+			continue;
+		if (fileName != NULL && frame.fileName != *fileName)
+			continue;
+		if (frame.pinCount > 0)
+			pinned = true;
+		else
+			frameNums.push_back(i);
+	}
+	return pinned;
+}
+
+// Write frames back with one vectored write per run of adjacent pages
+// The frames are marked clean and in I/O, then written without the latch;
+// a frame dirtied meanwhile stays dirty, and the frames not written are dirty again
+RC BufferManager::writeFrames(unique_lock<mutex> &guard, vector<FrameNum> &frameNums) {
+	if (frameNums.empty())
+		return SUCC;
+	sort(frameNums.begin(), frameNums.end(), [this](FrameNum a, FrameNum b) {
+		if (frames[a].fd != frames[b].fd)
+			return frames[a].fd < frames[b].fd;
+		return frames[a].pageNum < frames[b].pageNum;
+	});
+	for (size_t i = 0; i < frameNums.size(); ++i) {
+		frames[frameNums[i]].io = true;
+		frames[frameNums[i]].dirty = false;
+	}
+	// the frames are not evicted, discarded nor reallocated while in I/O
+	guard.unlock();
+	RC rc = PagedFileManager::instance()->logManager.commit();
+	struct iovec iov[IOV_MAX];
+	size_t beg = 0;
+	while (rc == SUCC && beg < frameNums.size()) {
+		BufferFrame &first = frames[frameNums[beg]];
+		if (first.compressed != NULL) {
+			// compressed pages go to their slots one by one
+			rc = first.compressed->writePage(first.pageNum, first.data);
+			if (rc == SUCC)
+				++beg;
+			continue;
+		}
+		size_t end = beg;
+		ssize_t size = 0;
+		while (end < frameNums.size() && end - beg < IOV_MAX) {
+			BufferFrame &frame = frames[frameNums[end]];
+			if (frame.fd != first.fd || frame.offset != first.offset + size)
+				break;
+			iov[end - beg].iov_base = frame.data;
+			iov[end - beg].iov_len = frame.pageSize;
+			size += frame.pageSize;
+			++end;
+		}
+		unsigned long long start = ioClock();
+		ssize_t written = pwritev(first.fd, iov, end - beg, first.offset);
+		countWrite(first.stats, written, start);
+		if (written != size) {
+			PagedFileManager::instance()->PrintFileStreamError("BufferManager::writeFrames");
+			rc = FILE_STREAM_FAILURE;
+			break;
+		}
+		beg = end;
+	}
+	guard.lock();
+	for (size_t i = 0; i < frameNums.size(); ++i) {
+		frames[frameNums[i]].io = false;
+		if (i >= beg)
+			frames[frameNums[i]].dirty = true;
+	}
+	ioCond.notify_all();
+	return rc;
+}
+
+// Write-ahead log
+LogManager::LogManager() : fd(-1), stats(NULL), appendedSize(0), durableSize(0), writing(false) {
+}
+
+LogManager::~LogManager() {
+	if (fd >= 0)
+		::close(fd);
+}
+
+// FNV-1a of a record past its checksum
+static unsigned logChecksum(const LogRecordHeader &header, const char *fileName,
+		const void *data) {
+	unsigned hash = 2166136261u;
+	const unsigned char *bytes[3] = {(const unsigned char *)&header.type,
+			(const unsigned char *)fileName, (const unsigned char *)data};
+	size_t sizes[3] = {sizeof(LogRecordHeader) - offsetof(LogRecordHeader, type),
+			header.nameLength, header.pageSize};
+	for (int i = 0; i < 3; ++i) {
+		for (size_t j = 0; j < sizes[i]; ++j) {
+			hash ^= bytes[i][j];
+			hash *= 16777619u;
+		}
+	}
+	return hash;
+}
+
+// Open the log, the records left in it are replayed first
+RC LogManager::open(const char *logName, IOCounters *stats) {
+	if (fd >= 0)
+		return SUCC;
+	fd = ::open(logName, O_RDWR | O_CREAT | O_APPEND, 0644);
+	if (fd < 0) {
+		PagedFileManager::instance()->PrintFileStreamError("LogManager::open");
+		return LOG_OPEN_FAILURE;
+	}
+	this->logName = logName;
+	this->stats = stats;
+	RC rc = replay();
+	if (rc != SUCC) {
+		::close(fd);
+		fd = -1;
+	}
+	return rc;
+}
+
+// Close the log without a checkpoint, an empty log is removed
+void LogManager::close() {
+	if (fd < 0)
+		return;
+	commit();
+	::close(fd);
+	fd = -1;
+	if (appendedSize == 0)
+		remove(logName.c_str());
+	appendedSize = durableSize = 0;
+}
+
+RC LogManager::append(const LogRecordHeader &header, const string &fileName,
+		const void *data) {
+	lock_guard<mutex> guard(latch);
+	if (fd < 0)
+		return LOG_WRITE_FAILURE;
+	records.insert(records.end(), (const char *)&header,
+			(const char *)&header + sizeof(LogRecordHeader));
+	records.insert(records.end(), fileName.begin(), fileName.end());
+	records.insert(records.end(), (const char *)data, (const char *)data + header.pageSize);
+	appendedSize += sizeof(LogRecordHeader) + header.nameLength + header.pageSize;
+	return SUCC;
+}
+
+// Append the image of a page, it is durable once committed
+RC LogManager::appendPage(const string &fileName, off_t offset, unsigned pageSize,
+		const void *data) {
+	LogRecordHeader header;
+	memset(&header, 0, sizeof(LogRecordHeader));
+	header.magic = LOG_RECORD_MAGIC;
+	header.type = LOG_PAGE;
+	header.nameLength = fileName.size();
+	header.pageSize = pageSize;
+	header.offset = offset;
+	header.checksum = logChecksum(header, fileName.c_str(), data);
+	return append(header, fileName, data);
+}
+
+// Append a destroy record of a file and commit it
+RC LogManager::appendDestroy(const string &fileName) {
+	LogRecordHeader header;
+	memset(&header, 0, sizeof(LogRecordHeader));
+	header.magic = LOG_RECORD_MAGIC;
+	header.type = LOG_DESTROY;
+	header.nameLength = fileName.size();
+	header.checksum = logChecksum(header, fileName.c_str(), NULL);
+	RC rc = append(header, fileName, NULL);
+	if (rc != SUCC)
+		return rc;
+	return commit();
+}
+
+// Group commit: the first caller to find records not on the disk writes all
+// of them, the callers arriving meanwhile wait for it and append to the next group
+RC LogManager::commit() {
+	unique_lock<mutex> guard(latch);
+	unsigned long long target = appendedSize;
+	while (durableSize < target) {
+		if (writing) {
+			durableCond.wait(guard);
+			continue;
+		}
+		writing = true;
+		vector<char> group;
+		group.swap(records);
+		unsigned long long groupEnd = appendedSize;
+		guard.unlock();
+		bool written = true;
+		for (size_t done = 0; written && done < group.size(); ) {
+			unsigned long long start = ioClock();
+			ssize_t size = write(fd, &group[done], group.size() - done);
+			countWrite(stats, size, start);
+			written = size > 0;
+			done += written ? size : 0;
+		}
+		written = written && syncFile(fd, stats);
+		guard.lock();
+		writing = false;
+		if (written) {
+			durableSize = groupEnd;
+		} else {
+			// drop the partial write, the group is written again by the next commit
+			if (ftruncate(fd, durableSize) != 0)
+				PagedFileManager::instance()->PrintFileStreamError("LogManager::commit");
+			records.insert(records.begin(), group.begin(), group.end());
+		}
+		durableCond.notify_all();
+		if (!written) {
+			PagedFileManager::instance()->PrintFileStreamError("LogManager::commit");
+			return LOG_WRITE_FAILURE;
+		}
+	}
+	return SUCC;
+}
+
+// # of bytes appended since the log was emptied
+unsigned long long LogManager::getSize() {
+	lock_guard<mutex> guard(latch);
+	return appendedSize;
 }
 
+// Empty the log if nothing is appended past size
+RC LogManager::truncate(unsigned long long size) {
+	lock_guard<mutex> guard(latch);
+	if (fd < 0 || appendedSize != size || durableSize != size || writing)
+		return SUCC;
+	if (ftruncate(fd, 0) != 0) {
+		PagedFileManager::instance()->PrintFileStreamError("LogManager::truncate");
+		return LOG_WRITE_FAILURE;
+	}
+	appendedSize = durableSize = 0;
+	return SUCC;
+}
 
+// Redo the records of the log in order, a torn record ends the log
+// A file is only redone from its last destroy record on
+RC LogManager::replay() {
+	struct ReplayRecord {
+		LogRecordHeader header;
+		off_t position;			// of the file name
+		string fileName;
+	};
+	vector<ReplayRecord> replayRecords;
+	unordered_map<string, size_t> lastDestroy;
+	vector<char> page(MAX_PAGE_SIZE);
+	char name[PATH_MAX];
+	off_t position = 0;
+	LogRecordHeader header;
+	while (pread(fd, &header, sizeof(LogRecordHeader), position) ==
+			(ssize_t)sizeof(LogRecordHeader)) {
+		if (header.magic != LOG_RECORD_MAGIC || header.nameLength >= PATH_MAX ||
+				header.pageSize > MAX_PAGE_SIZE)
+			break;
+		off_t namePosition = position + sizeof(LogRecordHeader);
+		if (pread(fd, name, header.nameLength, namePosition) != (ssize_t)header.nameLength ||
+				pread(fd, &page[0], header.pageSize, namePosition + header.nameLength) !=
+				(ssize_t)header.pageSize ||
+				logChecksum(header, name, &page[0]) != header.checksum)
+			break;
+		ReplayRecord record = {header, namePosition, string(name, header.nameLength)};
+		if (header.type == LOG_DESTROY)
+			lastDestroy[record.fileName] = replayRecords.size();
+		replayRecords.push_back(record);
+		position = namePosition + header.nameLength + header.pageSize;
+	}
+	// redo the pages, the files stay open until all the pages are synced
+	// the pages of a compressed file are redone through its page map
+	struct ReplayFile {
+		int fd;
+		off_t dataOffset;
+		CompressedFile *compressed;
+	};
+	unordered_map<string, ReplayFile> files;
+	RC rc = SUCC;
+	for (size_t i = 0; rc == SUCC && i < replayRecords.size(); ++i) {
+		ReplayRecord &record = replayRecords[i];
+		unordered_map<string, size_t>::iterator itrDestroy = lastDestroy.find(record.fileName);
+		if (record.header.type != LOG_PAGE ||
+				(itrDestroy != lastDestroy.end() && itrDestroy->second > i))
+			continue;
+		unordered_map<string, ReplayFile>::iterator itr = files.find(record.fileName);
+		if (itr == files.end()) {
+			ReplayFile file = {::open(record.fileName.c_str(), O_RDWR), 0, NULL};
+			if (file.fd >= 0) {
+				FileHeader fileHeader;
+				readFileHeader(file.fd, fileHeader, file.dataOffset);
+				if (loadCompressedFile(file.fd, fileHeader, NULL, file.compressed) != SUCC)
+					rc = LOG_WRITE_FAILURE;
+			}
+			itr = files.insert(pair<string, ReplayFile>(record.fileName, file)).first;
+		}
+		// the file is gone, nothing to redo
+		if (itr->second.fd < 0 || rc != SUCC)
+			continue;
+		unsigned pageSize = record.header.pageSize;
+		if (pread(fd, &page[0], pageSize, record.position + record.header.nameLength) !=
+				(ssize_t)pageSize) {
+			rc = LOG_WRITE_FAILURE;
+		} else if (itr->second.compressed != NULL) {
+			PageNum pageNum = (record.header.offset - itr->second.dataOffset) / pageSize;
+			if (itr->second.compressed->writePage(pageNum, &page[0]) != SUCC)
+				rc = LOG_WRITE_FAILURE;
+		} else if (pwrite(itr->second.fd, &page[0], pageSize, record.header.offset) !=
+				(ssize_t)pageSize) {
+			rc = LOG_WRITE_FAILURE;
+		}
+	}
+	for (unordered_map<string, ReplayFile>::iterator itr = files.begin(); itr != files.end(); ++itr) {
+		if (itr->second.fd < 0)
+			continue;
+		if (fdatasync(itr->second.fd) != 0)
+			rc = LOG_WRITE_FAILURE;
+		delete itr->second.compressed;
+		::close(itr->second.fd);
+	}
+	if (rc != SUCC) {
+		PagedFileManager::instance()->PrintFileStreamError("LogManager::replay");
+		return rc;
+	}
+	// the records are redone, start an empty log
+	if (ftruncate(fd, 0) != 0) {
+		PagedFileManager::instance()->PrintFileStreamError("LogManager::replay");
+		return LOG_WRITE_FAILURE;
+	}
+	appendedSize = durableSize = 0;
+	records.clear();
+	return SUCC;
+}
@@ -8,7 +8,15 @@
 #include <map>
 #include <cstdlib>
 #include <cstring>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 using namespace std;
 
@@ -21,25 +29,57 @@ typedef int RC;
 #define FILE_REMOVE_FAILURE 4
 #define FILE_NOT_OPEN_BY_HANDLE 5
 #define FILE_STREAM_FAILURE 6
+#define FILE_PAGE_SIZE_INVALID 7
+#define FILE_PAGE_CORRUPT 8
 
 #define PAGE_NOT_EXIST 100
 
 // define buffer management error code
 #define BUFFER_FILE_NOT_HIT 10000
 #define BUFFER_PAGENUM_NOT_HIT 10001
+#define BUFFER_NO_FREE_FRAME 10002
+#define BUFFER_PAGE_PINNED 10003
 // define Page list error code
 #define FILE_SPACE_NO_SPACE 20
 #define FILE_SPACE_EMPTY 21
+// define log error code
+#define LOG_OPEN_FAILURE 30
+#define LOG_WRITE_FAILURE 31
 
 typedef unsigned PageNum;
 
-#define PAGE_SIZE 4096
+#define PAGE_SIZE 4096				// defines the default page size of a file
+#define MAX_PAGE_SIZE (PAGE_SIZE * 8)	// defines the largest page size of a file
 #define PAGE_ALMOST_FULL_RATIO	5	// defines the ratio that a page is almost full
-#define PAGE_LEVEL 4 				// defines # of lists for different degrees of free space
-#define MAX_PAGE_IN_MEM 1024		// defines the maximum # of pages opened in a file 262144
+#define PAGE_LEVEL 256 				// defines # of lists for different degrees of free space
+#define MAX_PAGE_IN_MEM 1024		// defines the default # of frames in the buffer pool 262144
+
+// write policy of the dirty pages
+typedef enum {
+	WRITE_IMMEDIATE = 0,	// write a page to the disk as soon as it is modified
+	WRITE_DEFERRED,			// keep dirty pages in the buffer pool until closeFile or flush
+	WRITE_PERIODIC,			// deferred, and a background thread flushes the pool periodically
+	WRITE_LOGGED			// deferred, and every page written is appended to the log first
+} WritePolicy;
+#define FLUSH_INTERVAL_MS 1000		// defines the default interval of the periodic flush
+#define MMAP_MIN_SIZE (64 << 20)	// defines the initial size of a file mapping
+#define READ_AHEAD_PAGES 32			// defines the default # of pages read ahead of a sequential read
+#define READ_AHEAD_TRIGGER 2		// defines # of sequential reads before reading ahead
+#define EXTENT_PAGES 64				// defines the default # of pages preallocated when a file grows
+#define BATCH_PAGES 64				// defines # of pages a caller moves with one readPages/writePages
+#define LOG_FILE_NAME "pfm.log"		// defines the default log of WRITE_LOGGED
+#define LOG_CHECKPOINT_SIZE (32 << 20)	// defines the default log size that triggers a checkpoint
+#define FILE_REGISTRY_SHARDS 16		// defines # of shards of the open file registry
 
 // define pages for table data
 #define TABLE_PAGES_NUM 2
+// define free space map pages of the files made with FILE_SPACE_MAP
+// A map page follows the table pages and then every FSM_PAGE_SPAN data pages.
+// It keeps one byte per data page: the free space of the page in units of
+// 1/PAGE_LEVEL of the page size. The pages of the files made without it are
+// all data pages, read whole to find their free space.
+#define FSM_PAGE_SPAN PAGE_SIZE
+#define FSM_NULL_PAGE ((PageNum)-1)
 
 typedef unsigned long FieldAddress; 		// for address
 // slot directory: saved in pages
@@ -51,44 +91,361 @@ typedef struct {
 class FileHandle;
 
 /*
- * File information to main the reference counter
+ * I/O statistics
+ * The page counts are the calls made through the file handles; the bytes,
+ * system calls and time are the disk I/O done for them
  */
-struct FileInfo {
-	FILE *fp;
-	int cnt;
-	FileInfo(FILE *f, int c) : fp(f), cnt(c){}
-	FileInfo(const FileInfo &fi) : fp(fi.fp) , cnt(fi.cnt) {}
-	FileInfo & operator=(const FileInfo &fi) {
-		if (this == &fi)
-			return *this;
-		this->fp = fi.fp;
-		this->cnt = fi.cnt;
-		return *this;
-	}
+struct IOStats {
+	unsigned long long pagesRead;
+	unsigned long long pagesWritten;
+	unsigned long long pagesAppended;
+	unsigned long long pagesPrefetched;	// pages asked of the OS ahead of the reads
+	unsigned long long bytesRead;
+	unsigned long long bytesWritten;
+	unsigned long long readCalls;
+	unsigned long long writeCalls;
+	unsigned long long syncCalls;
+	unsigned long long ioTime;		// time spent in the system calls, in nanoseconds
+	IOStats() { reset(); }
+	void reset() { memset(this, 0, sizeof(IOStats)); }
+	IOStats & operator+=(const IOStats &stats);
+	IOStats operator-(const IOStats &stats) const;
+	void print(ostream &out) const;
+};
+// Statistics updated by concurrent calls, each counter is atomic
+struct IOCounters {
+	atomic<unsigned long long> pagesRead;
+	atomic<unsigned long long> pagesWritten;
+	atomic<unsigned long long> pagesAppended;
+	atomic<unsigned long long> pagesPrefetched;
+	atomic<unsigned long long> bytesRead;
+	atomic<unsigned long long> bytesWritten;
+	atomic<unsigned long long> readCalls;
+	atomic<unsigned long long> writeCalls;
+	atomic<unsigned long long> syncCalls;
+	atomic<unsigned long long> ioTime;
+	IOCounters() { reset(); }
+	void reset();
+	void add(const IOStats &stats);
+	IOStats load() const;
+private:
+	IOCounters(const IOCounters &counters);
+	IOCounters & operator=(const IOCounters &counters);
+};
+
+/*
+ * File header, kept in the physical page before page 0
+ * Files without it are read as pages of PAGE_SIZE from the start of the file
+ */
+#define FILE_HEADER_MAGIC 0x31464450	// "PDF1"
+#define FILE_COMPRESSED 0x1				// the pages are compressed into slots located by a page map
+#define FILE_SPACE_MAP 0x2				// the pages hold a free space map, see FileSpaceManager
+#define FILE_USER_FLAGS 0xffff0000		// kept for the layers above, not read by the paged file
+typedef struct {
+	unsigned magic;
+	unsigned pageSize;
+	unsigned flags;					// FILE_COMPRESSED, FILE_SPACE_MAP and FILE_USER_FLAGS, 0 in the files made before the flags
+	unsigned numPages;				// pages of a compressed file
+	unsigned long long mapOffset;	// page map of a compressed file
+	unsigned mapCapacity;			// # of entries the page map has room for
+} FileHeader;
+
+/*
+ * Page codec, an LZ77 block format in the manner of LZ4
+ * A sequence is a token (literal length, match length - 4), the literals and
+ * a 2-byte match offset; lengths of 15 and more continue in bytes of 255
+ */
+class PageCodec {
+public:
+	// Compress a page, 0 if it does not fit in capacity
+	static unsigned compress(const char *src, unsigned srcSize, char *dst, unsigned capacity);
+	// Decompress a page, false unless it fills exactly dstSize bytes
+	static bool decompress(const char *src, unsigned srcSize, char *dst, unsigned dstSize);
+};
+
+/*
+ * Compressed file
+ * Each page is kept in a slot of its compressed size, rounded up to
+ * COMPRESSED_SLOT_ALIGN. A page is rewritten in place while it fits in its
+ * slot, else it moves to a free slot or the end of the file, and its old slot
+ * is freed; the slot at the end of the file grows in place. Pages that do not
+ * compress are kept as they are.
+ * The page map, one entry per page, follows the header and moves to the end
+ * of the file, twice as large, when it is full.
+ */
+#define COMPRESSED_SLOT_ALIGN 256		// defines the granularity of the slots of a compressed file
+typedef struct {
+	unsigned long long offset;		// position of the slot, 0 if the page is never written
+	unsigned length;				// compressed size, the page size if kept as it is
+	unsigned capacity;				// size of the slot
+} CompressedPageSlot;
+class CompressedFile {
+public:
+	CompressedFile(int fd, unsigned pageSize, IOCounters *stats);
+	// Load the page map named by the header
+	RC load(const FileHeader &fileHeader);
+	unsigned getNumberOfPages();
+	// Read a page and decompress it into data
+	RC readPage(PageNum pageNum, void *data);
+	// Compress a page and write it to its slot, the page past the last one is appended
+	RC writePage(PageNum pageNum, const void *data);
+private:
+	int fd;
+	unsigned pageSize;
+	unsigned flags;					// flags of the header, written back with it
+	IOCounters *stats;
+	vector<CompressedPageSlot> slots;
+	unsigned long long mapOffset;
+	unsigned mapCapacity;
+	unsigned long long fileEnd;		// new slots are placed from here on
+	multimap<unsigned, unsigned long long> freeSlots;	// free space before fileEnd by size
+	vector<char> buffer;			// a compressed page
+	mutex latch;					// guards the page map and the buffer
+	RC writeHeader();
+	RC writeMapEntry(PageNum pageNum);
+	RC moveMap(unsigned capacity);	// move the page map to the end of the file
+	unsigned long long allocateSlot(unsigned capacity);
+	void freeSlot(unsigned long long offset, unsigned capacity);
+	unsigned getMapSize(unsigned capacity);	// space taken by a page map
 };
+
 /*
  * Heap file management
  */
 const unsigned short MAX_FREE_SPACE_SIZE = PAGE_SIZE+1;
 class FileSpaceManager {
 private:
-	FileSpaceManager();
-	// priority_queue<PageSpaceInfo, vector<PageSpaceInfo>, spaceComparator> pageQueue;
-	map<unsigned, PageNum> pageQueue;
+	// Pages are listed by their free space level, one list per level.
+	// The lists are chained through the page numbers, so a page is listed once.
+	struct PageSpaceLink {
+		PageNum prev;
+		PageNum next;
+		unsigned char level;	// 0 if the page is not listed
+	};
+	vector<PageSpaceLink> pageLinks;
+	PageNum levelHeads[PAGE_LEVEL];
+	unsigned long long levelMask[PAGE_LEVEL / 64];	// the non-empty levels
+	unsigned numListedPages;
+	unsigned spaceUnit;		// free space size of a level
+	bool spaceMap;			// the file has free space map pages
+	bool loaded;			// the lists are loaded from the free space map
+	mutex latch;			// guards the lists, the pages of a file are listed by one thread at a time
+	void linkPage(const PageNum &pageNum, const unsigned &level);
+	void unlinkPage(const PageNum &pageNum);
+	// Record the free space of a page in the free space map
+	RC savePageSpaceInfo(FileHandle &fileHandle, const unsigned &freeSpaceSize,
+			const PageNum &pageNum);
+	// Get the free space map page covering a data page
+	PageNum getSpaceMapPage(const PageNum &pageNum) const;
 public:
-	FileSpaceManager(FileHandle &fileHandle);
-	// Get the page number with the greatest free space size
+	FileSpaceManager(unsigned pageSize = PAGE_SIZE);
+	// Set whether the file has free space map pages, done when it is opened
+	void setSpaceMap(bool spaceMap) { this->spaceMap = spaceMap; }
+	bool hasSpaceMap() const { return spaceMap; }
+	// Load the page space info from the free space map pages, or from the
+	// data pages of a file without them; only done once
+	RC loadPageSpaceInfo(FileHandle &fileHandle);
+	// Whether a page holds the free space map
+	bool isSpaceMapPage(const PageNum &pageNum) const;
+	// Get the first data page from pageNum on
+	PageNum getDataPage(const PageNum &pageNum) const {
+		return isSpaceMapPage(pageNum) ? pageNum + 1 : pageNum;
+	}
+	// Get the level of a free space size, rounded down
+	unsigned getSpaceLevel(const unsigned &freeSpaceSize) {
+		unsigned level = freeSpaceSize / spaceUnit;
+		return level < PAGE_LEVEL ? level : PAGE_LEVEL - 1;
+	}
+	// Get the page with the least free space that fits the record
 	RC getPageSpaceInfo(const unsigned &recordSize, PageNum &pageNum);
-	// Pop the page space info
-	RC popPageSpaceInfo();
-	// Push the page space info
-	RC pushPageSpaceInfo(const unsigned &freeSpaceSize, const unsigned &pageNum);
-	unsigned getPageSpaceQueueSize() { return pageQueue.size();}
-	unsigned getTopPageSpaceInfo() { return pageQueue.empty() ? 0 : MAX_FREE_SPACE_SIZE-pageQueue.begin()->first; }
+	// Update the page space info and record it in the free space map
+	RC pushPageSpaceInfo(FileHandle &fileHandle, const unsigned &freeSpaceSize,
+			const unsigned &pageNum);
+	unsigned getPageSpaceQueueSize();
+	// Get the greatest free space size of the listed pages, rounded down
+	unsigned getTopPageSpaceInfo();
 	// Clear all the page space info
 	void clearPageSpaceInfo();
+	// Drop the page space info, it is loaded again from the free space map
+	void unloadPageSpaceInfo();
+};
+/*
+ * File information to main the reference counter
+ * The descriptor, the page count and the free space are shared by all the handles of the file
+ */
+struct FileInfo {
+	int fd;
+	int cnt;
+	// the counts are raised under the latch and read without it
+	atomic<unsigned> numPages;
+	unsigned pageSize;
+	unsigned flags;			// flags of the file header
+	off_t dataOffset;		// where page 0 starts, after the file header
+	atomic<unsigned> allocPages;	// pages allocated on the disk, the ones past numPages are preallocated
+	bool direct;			// the file is opened with O_DIRECT
+	bool mapped;			// pages are read in place from a mapping of the file
+	IOCounters *stats;		// I/O statistics of the file, kept by the manager
+	FileSpaceManager spaceManager;	// free space of the pages, loaded at the first insertion
+	CompressedFile *compressed;		// pages of a compressed file, NULL if the file is not compressed
+	mutex latch;			// guards the page count and the mappings while the file grows
+	// mappings of the file, the last one is current; the older ones stay
+	// valid for the pages handed out before the file grew
+	vector<pair<char *, size_t> > maps;
+	FileInfo(int f, int c, unsigned n, unsigned s, off_t o, bool d) : fd(f), cnt(c),
+			numPages(n), pageSize(s), flags(0), dataOffset(o), allocPages(n), direct(d), mapped(false),
+			stats(NULL), spaceManager(s), compressed(NULL) {}
+	~FileInfo() { delete compressed; }
+	// Get the position of a page in the file
+	off_t getPageOffset(PageNum pageNum) const {
+		return dataOffset + (off_t)pageNum * pageSize;
+	}
+private:
+	// the handles point to the entry, so it is never copied
+	FileInfo(const FileInfo &fi);
+	FileInfo & operator=(const FileInfo &fi);
+};
+
+/*
+ * Buffer pool
+ * Frames are shared by all the handles of a file and keyed by (file, page)
+ */
+typedef unsigned FrameNum;
+struct BufferFrame {
+	string fileName;		// owner of the page held by the frame
+	int fd;					// file descriptor used to write the frame back
+	PageNum pageNum;
+	unsigned pageSize;
+	off_t offset;			// position of the page in the file
+	IOCounters *stats;		// I/O statistics of the file
+	CompressedFile *compressed;	// writes the frame back into its slot if the file is compressed
+	int pinCount;			// # of users currently holding the frame
+	bool dirty;				// the frame differs from the page on disk
+	bool referenced;		// reference bit of the clock replacement
+	bool valid;				// the frame holds a page
+	bool io;				// the page is being read or written without the latch
+	char *data;
+};
+class BufferManager {
+public:
+	BufferManager(unsigned numFrames);
+	~BufferManager();
+	// Pin a page of the file; the page is loaded from the disk if not buffered
+	RC pinPage(const string &fileName, const FileInfo &file, PageNum pageNum, char *&data);
+	// Release a pinned page, mark it dirty if it is modified
+	RC unpinPage(const string &fileName, PageNum pageNum, bool dirty);
+	// Whether a page is buffered
+	bool isPageBuffered(const string &fileName, PageNum pageNum);
+	// Pin a page only if it is buffered
+	RC pinBufferedPage(const string &fileName, PageNum pageNum, char *&data);
+	// Release a clean page by its frame, pointers outside the pool are ignored
+	void releaseFrame(const char *data);
+	// Copy a page into its frame if it is buffered
+	void updatePage(const string &fileName, PageNum pageNum, const void *data);
+	// Copy a page into a frame without reading it and mark it dirty
+	RC putPage(const string &fileName, const FileInfo &file, PageNum pageNum, const void *data);
+	// Write a dirty page back to the disk, BUFFER_PAGE_PINNED and nothing written if it is pinned
+	RC flushPage(const string &fileName, PageNum pageNum);
+	// Write all the dirty pages of a file back to the disk,
+	// BUFFER_PAGE_PINNED if a dirty page is pinned and left to its holders
+	RC flushFile(const string &fileName);
+	// Write all the dirty pages back to the disk, the pinned ones are left as above
+	RC flushAll();
+	// Start/stop the background thread flushing the pool every intervalMs
+	void startFlusher(unsigned intervalMs);
+	void stopFlusher();
+	// Drop all the frames of a file without writing them back,
+	// BUFFER_PAGE_PINNED and nothing dropped while a page of the file is pinned
+	RC discardFile(const string &fileName);
+	// Change the # of frames, no page may be pinned
+	RC setNumFrames(unsigned numFrames);
+	unsigned getNumFrames() { return frames.size(); }
+private:
+	vector<BufferFrame> frames;
+	char *pool;
+	unsigned clockHand;
+	unordered_map<string, unordered_map<PageNum, FrameNum> > pageTable;
+	// the pool is shared with the background flusher
+	// The latch is released during disk I/O; the frames in I/O are marked,
+	// and their users wait on ioCond
+	mutex latch;
+	condition_variable ioCond;
+	thread flusher;
+	condition_variable flusherCond;
+	bool flusherStop;
+	unsigned flushInterval;
+	// find the frame of a page, waiting while it is in I/O
+	RC findFrame(unique_lock<mutex> &guard, const string &fileName, PageNum pageNum,
+			FrameNum &frameNum);
+	// wait until no frame of a file, or of all files if fileName is NULL, is in I/O
+	void waitForIO(unique_lock<mutex> &guard, const string *fileName);
+	// find a frame to hold a new page, write the victim back if dirty
+	RC getVictimFrame(unique_lock<mutex> &guard, FrameNum &frameNum);
+	// write frames back with one vectored write per run of adjacent pages
+	RC writeFrames(unique_lock<mutex> &guard, vector<FrameNum> &frameNums);
+	// collect the unpinned dirty frames of a file, or of all files if fileName is NULL,
+	// and tell whether a pinned one is dirty
+	bool getDirtyFrames(const string *fileName, vector<FrameNum> &frameNums);
+	void flusherLoop();
+	void allocateFrames(unsigned numFrames);
+	BufferManager(const BufferManager &);
+	BufferManager & operator=(const BufferManager &);
+};
+/*
+ * Write-ahead log
+ * Each record is the image of a page written to a file, so replaying the
+ * records in order redoes the writes. A destroy record marks where a file
+ * was removed; the records before it are not replayed.
+ */
+#define LOG_RECORD_MAGIC 0x474f4c50		// "PLOG"
+typedef enum {
+	LOG_PAGE = 0,
+	LOG_DESTROY
+} LogRecordType;
+typedef struct {
+	unsigned magic;
+	unsigned checksum;		// of the rest of the record, a torn record fails it
+	unsigned type;
+	unsigned nameLength;	// the file name follows the header
+	unsigned pageSize;		// the page image follows the name, 0 for LOG_DESTROY
+	off_t offset;			// position of the page in the file
+} LogRecordHeader;
+class LogManager {
+public:
+	LogManager();
+	~LogManager();
+	// Open the log, the records left in it are replayed first
+	RC open(const char *logName, IOCounters *stats = NULL);
+	// Close the log without a checkpoint, an empty log is removed
+	void close();
+	bool isOpen() { return fd >= 0; }
+	// Append the image of a page, it is durable once committed
+	RC appendPage(const string &fileName, off_t offset, unsigned pageSize, const void *data);
+	// Append a destroy record of a file and commit it
+	RC appendDestroy(const string &fileName);
+	// Write the appended records to the disk; callers committing at the same
+	// time are served by one write
+	RC commit();
+	// # of bytes appended since the log was emptied
+	unsigned long long getSize();
+	// Empty the log if nothing is appended past size; the pages of the
+	// records must be on the disk
+	RC truncate(unsigned long long size);
+private:
+	int fd;
+	string logName;
+	IOCounters *stats;
+	vector<char> records;			// records not written yet
+	unsigned long long appendedSize;
+	unsigned long long durableSize;
+	bool writing;					// a caller is writing the records of the group
+	mutex latch;
+	condition_variable durableCond;
+	RC append(const LogRecordHeader &header, const string &fileName, const void *data);
+	// redo the records of the log, stop at the first torn one
+	RC replay();
+	LogManager(const LogManager &);
+	LogManager & operator=(const LogManager &);
 };
-typedef unordered_map<string, FileSpaceManager> MultipleFilesSpaceManager;
 /*
  * Paged File Manager
  */
@@ -98,7 +455,8 @@ class PagedFileManager
 public:
     static PagedFileManager* instance();                     // Access to the _pf_manager instance
 
-    RC createFile    (const char *fileName);                         // Create a new file
+    RC createFile    (const char *fileName,
+    		unsigned pageSize = PAGE_SIZE, unsigned flags = 0);           // Create a new file with the page size, FILE_COMPRESSED and FILE_USER_FLAGS
     RC destroyFile   (const char *fileName);                         // Destroy a file
     RC openFile      (const char *fileName, FileHandle &fileHandle); // Open a file
     RC closeFile     (FileHandle &fileHandle);                       // Close a file
@@ -112,20 +470,79 @@ public:
     	cerr << str << endl;
     #endif
     }
-    MultipleFilesSpaceManager filesSpaceManager; // manage the file space
+    BufferManager bufferManager;				// buffer pool shared by all files
+    LogManager logManager;					// write-ahead log of WRITE_LOGGED
     bool fileExist(const char *fileName);
+    // Set the # of frames in the buffer pool
+    RC setBufferSize(unsigned numFrames) { return bufferManager.setNumFrames(numFrames); }
+    // Set when dirty pages are written to the disk
+    RC setWritePolicy(WritePolicy policy, unsigned flushIntervalMs = FLUSH_INTERVAL_MS);
+    WritePolicy getWritePolicy() { return writePolicy; }
+    // Write all the dirty pages of every file to the disk
+    // Under WRITE_LOGGED this takes a checkpoint
+    // BUFFER_PAGE_PINNED if a dirty page is pinned, it is left to its holders
+    RC flush();
+    // Make the pages written so far durable, a no-op unless WRITE_LOGGED
+    RC commit();
+    // Write the dirty pages back in page order and empty the log,
+    // the log is kept and BUFFER_PAGE_PINNED returned if a dirty page is pinned
+    RC checkpoint();
+    // Set the log opened by WRITE_LOGGED afterwards
+    void setLogFile(const char *logName) { this->logName = logName; }
+    // Set the log size that triggers a checkpoint at commit
+    void setCheckpointSize(unsigned long long size) { checkpointSize = size; }
+    unsigned long long getCheckpointSize() { return checkpointSize; }
+    // Get the I/O statistics of a file, kept across its handles and opens
+    IOStats getIOStats(const string &fileName);
+    // Get the I/O statistics of all the files and the log
+    IOStats getIOStats();
+    // Get the I/O statistics of each file
+    void getIOStats(map<string, IOStats> &fileStats);
+    // Reset the I/O statistics of all the files
+    void resetIOStats();
+    // Bypass the OS page cache with O_DIRECT for the files opened afterwards
+    void setDirectIO(bool direct) { directIO = direct; }
+    bool getDirectIO() { return directIO; }
+    // Read pages in place from a mapping of the files opened afterwards
+    void setMmapRead(bool mmapRead) { this->mmapRead = mmapRead; }
+    bool getMmapRead() { return mmapRead; }
+    // Set the # of pages read ahead of sequential reads, 0 turns it off
+    void setReadAhead(unsigned numPages) { readAhead = numPages; }
+    unsigned getReadAhead() { return readAhead; }
+    // Set the # of pages preallocated each time a file grows past its extent
+    void setExtentSize(unsigned numPages) { extentSize = numPages; }
+    unsigned getExtentSize() { return extentSize; }
 protected:
     PagedFileManager();                                   // Constructor
     ~PagedFileManager();                                  // Destructor
 
 private:
     static PagedFileManager *_pf_manager;
-    unordered_map<string, FileInfo> refCounter;			// count each file's reference
-    void inc_refCounter(const string &fileName, FileHandle &fileHandle);		// reference increment
-    void dec_refCounter(const string &fileName);		// reference decrement
-    int get_refCounter(const string &fileName, FILE *&fp);		// get reference of a file
-    void close_refCounter(const string &fileName);	// close the reference counter given file name
+    WritePolicy writePolicy;
+    bool directIO;
+    bool mmapRead;
+    unsigned readAhead;
+    unsigned extentSize;
+    string logName;
+    unsigned long long checkpointSize;
+    unordered_map<string, IOCounters> ioStats;			// I/O statistics by file name
+    mutex statsLatch;									// guards the entries of ioStats
+    // Open files, sharded by name so that threads opening and closing
+    // different files seldom wait for each other
+    struct FileRegistryShard {
+    	mutex latch;
+    	unordered_map<string, FileInfo> refCounter;		// count each file's reference
+    };
+    FileRegistryShard fileRegistry[FILE_REGISTRY_SHARDS];
+    FileRegistryShard &getRegistryShard(const string &fileName);
+    IOCounters *getStatsEntry(const string &fileName);	// get the statistics kept for a file
+    // The shard of the file is held by the callers of the reference counter
+    RC inc_refCounter(FileRegistryShard &shard, const string &fileName, FileHandle &fileHandle);		// reference increment
+    void dec_refCounter(FileRegistryShard &shard, const string &fileName);		// reference decrement
+    int get_refCounter(FileRegistryShard &shard, const string &fileName, int &fd);		// get reference of a file
+    void close_refCounter(FileRegistryShard &shard, const string &fileName);	// close the reference counter given file name
     void closeFileZeroRef();						// try to close those files with zero reference
+    RC reloadFiles();								// drop the cached state of the open files
 };
 
 /*
@@ -141,12 +558,38 @@ public:
     RC readPage(PageNum pageNum, void *data);                           // Get a specific page
     RC writePage(PageNum pageNum, const void *data);                    // Write a specific page
     RC appendPage(const void *data);                                    // Append a specific page
+    RC readPages(PageNum pageNum, unsigned numPages, void *data);       // Get adjacent pages
+    RC writePages(PageNum pageNum, unsigned numPages, const void *data);  // Write or append adjacent pages
+    RC readPages(const vector<PageNum> &pageNums, void *data);          // Get pages in the order listed
+    RC writePages(const vector<PageNum> &pageNums, const void *data);   // Write pages in the order listed
     unsigned getNumberOfPages();                                        // Get the number of pages in the file
+    unsigned getPageSize();                                             // Get the page size of the file
+    unsigned getFlags();                                                // Get the flags the file was created with
+    FileSpaceManager *getSpaceManager();                               // Get the free space of the file, NULL if not open
+    RC pinPage(PageNum pageNum, char *&page);                           // Pin a page in the buffer pool
+    RC unpinPage(PageNum pageNum, bool dirty = false);                  // Release a pinned page
+    RC readPage(PageNum pageNum, const char *&page);                    // Get a read-only page in place
+    void releasePage(const char *page);                                 // Release a page got in place
+    void prefetchPages(PageNum pageNum, unsigned numPages);             // Start reading pages in the background
+    IOStats getIOStats() { return ioStats.load(); }                     // Get the I/O statistics of the handle
+    void resetIOStats() { ioStats.reset(); }                            // Reset the I/O statistics of the handle
 
-    FILE * pFile;
+    int fd;																// file descriptor shared by the handles of the file
     string fileName;													// file name of the handler
+    FileInfo *fileInfo;													// reference info shared by the handles of the file
     unsigned getSpaceOfPage(void *page);			// Get the free space associated with page num
 private:
+    RC mapPages(PageNum pageNum, char *&mapping);		// map the file up to the page, get the current mapping
+    void readAhead(PageNum pageNum);					// prefetch after sequential reads
+    void allocateExtent(PageNum pageNum);				// preallocate pages from the page on
+    RC logPage(PageNum pageNum, const void *data);		// append the page to the log under WRITE_LOGGED
+    RC readPageList(vector<pair<PageNum, char *> > &pages);			// read pages into their buffers
+    RC writePageList(vector<pair<PageNum, char *> > &pages);		// write pages from their buffers
+    PageNum lastReadPage;								// the last page read by the handle
+    unsigned sequentialReads;							// # of sequential reads up to the last page
+    PageNum readAheadEnd;								// pages before it are prefetched
+    IOCounters ioStats;								// I/O of the calls made through the handle
+    friend class HandleIOScope;
     FileHandle & operator=(const FileHandle &);			// prevent accidentally copy class
     FileHandle(const FileHandle &);						// prevent copy constructor
  };
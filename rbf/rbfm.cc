@@ -1,8 +1,24 @@
 
 #include "rbfm.h"
+#include <algorithm>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#define SELECT_SSE2
+#if defined(__GNUC__)
+#define SELECT_AVX2
+#endif
+#endif
 
 RecordBasedFileManager* RecordBasedFileManager::_rbf_manager = 0;
 VersionManager* VersionManager::_ver_manager = 0;
+// each thread works on its own file with its own page
+thread_local char RecordBasedFileManager::pageContent[MAX_PAGE_SIZE];
+thread_local unsigned RecordBasedFileManager::pageSize = PAGE_SIZE;
+thread_local bool RecordBasedFileManager::fieldOffsets = false;
+thread_local char RecordBasedFileManager::recordContent[MAX_PAGE_SIZE];
+thread_local bool RecordBasedFileManager::paxPages = false;
+thread_local char RecordBasedFileManager::paxContent[MAX_PAGE_SIZE];
+thread_local char RecordBasedFileManager::paxRecord[MAX_PAGE_SIZE];
 
 /*
  * Record based file manager
@@ -24,86 +40,340 @@ RecordBasedFileManager::~RecordBasedFileManager()
 {
 }
 // This method creates a record-based file called fileName.
-RC RecordBasedFileManager::createFile(const string &fileName) {
-	return PagedFileManager::instance()->createFile(fileName.c_str());
+RC RecordBasedFileManager::createFile(const string &fileName, unsigned pageSize,
+		unsigned flags) {
+	PagedFileManager *pfm = PagedFileManager::instance();
+	RC rc = pfm->createFile(fileName.c_str(), pageSize,
+			flags | FILE_FIELD_OFFSETS | FILE_SPACE_MAP);
+	if (rc != SUCC || !(flags & FILE_ZONE_MAPS))
+		return rc;
+	// the zone map starts empty, a side file left by an old file of the name is stale
+	string zoneFileName = fileName + ZONE_FILE_SUFFIX;
+	if (pfm->fileExist(zoneFileName.c_str()))
+		pfm->destroyFile(zoneFileName.c_str());
+	rc = pfm->createFile(zoneFileName.c_str());
+	if (rc != SUCC) {
+		cerr << "createFile: cannot create the zone map " << rc << endl;
+		pfm->destroyFile(fileName.c_str());
+	}
+	return rc;
 }
 // This method destroys the record-based file whose name is fileName.
 RC RecordBasedFileManager::destroyFile(const string &fileName) {
-    return PagedFileManager::instance()->destroyFile(fileName.c_str());
+	PagedFileManager *pfm = PagedFileManager::instance();
+	RC rc = pfm->destroyFile(fileName.c_str());
+	if (rc != SUCC)
+		return rc;
+	string zoneFileName = fileName + ZONE_FILE_SUFFIX;
+	if (pfm->fileExist(zoneFileName.c_str()))
+		rc = pfm->destroyFile(zoneFileName.c_str());
+	return rc;
 }
 // This method opens the record-based file whose name is fileName.
 RC RecordBasedFileManager::openFile(const string &fileName, FileHandle &fileHandle) {
-    return PagedFileManager::instance()->openFile(fileName.c_str(), fileHandle);
+	PagedFileManager *pfm = PagedFileManager::instance();
+	RC rc = pfm->openFile(fileName.c_str(), fileHandle);
+	if (rc != SUCC || !(fileHandle.getFlags() & FILE_ZONE_MAPS))
+		return rc;
+	// the zone map stays open while a handle of the file is
+	ZoneMap *zoneMap;
+	rc = acquireZoneMap(fileName, zoneMap);
+	if (rc != SUCC)
+		pfm->closeFile(fileHandle);
+	return rc;
 }
 // This method closes the open file instance referred to by fileHandle.
 RC RecordBasedFileManager::closeFile(FileHandle &fileHandle) {
-    return PagedFileManager::instance()->closeFile(fileHandle);
+	bool zoneMaps = (fileHandle.getFlags() & FILE_ZONE_MAPS) != 0;
+	string fileName = fileHandle.fileName;
+	RC rc = PagedFileManager::instance()->closeFile(fileHandle);
+	if (rc == SUCC && zoneMaps)
+		releaseZoneMap(fileName);
+	return rc;
+}
+
+// get the zone map of a file made with FILE_ZONE_MAPS, opened by the first user
+RC RecordBasedFileManager::acquireZoneMap(const string &fileName, ZoneMap *&zoneMap) {
+	lock_guard<mutex> guard(zoneLatch);
+	unordered_map<string, ZoneMap *>::iterator itr = zoneMaps.find(fileName);
+	if (itr != zoneMaps.end()) {
+		zoneMap = itr->second;
+		++zoneMap->refCount;
+		return SUCC;
+	}
+	zoneMap = new ZoneMap(fileName);
+	RC rc = zoneMap->open();
+	if (rc != SUCC) {
+		cerr << "acquireZoneMap: cannot open the zone map " << rc << endl;
+		delete zoneMap;
+		zoneMap = NULL;
+		return rc;
+	}
+	zoneMap->refCount = 1;
+	zoneMaps[fileName] = zoneMap;
+	return SUCC;
+}
+// the zone map is written and closed by its last user
+void RecordBasedFileManager::releaseZoneMap(const string &fileName) {
+	lock_guard<mutex> guard(zoneLatch);
+	unordered_map<string, ZoneMap *>::iterator itr = zoneMaps.find(fileName);
+	if (itr == zoneMaps.end() || --itr->second->refCount > 0)
+		return;
+	delete itr->second;
+	zoneMaps.erase(itr);
+}
+// widen the zone map of a page with records, nothing to do unless the file keeps one
+// It is called before the page is released with them, the summaries are written at close
+RC RecordBasedFileManager::summarizeRecords(FileHandle &fileHandle,
+		const vector<Attribute> &recordDescriptor, const void * const *data,
+		const unsigned &numRecords, const PageNum &pageNum) {
+	if (!(fileHandle.getFlags() & FILE_ZONE_MAPS) || numRecords == 0)
+		return SUCC;
+	ZoneMap *zoneMap;
+	RC rc = acquireZoneMap(fileHandle.fileName, zoneMap);
+	if (rc != SUCC)
+		return rc;
+	for (unsigned i = 0; i < numRecords && rc == SUCC; ++i)
+		rc = zoneMap->addRecord(pageNum, recordDescriptor, data[i]);
+	releaseZoneMap(fileHandle.fileName);
+	if (rc != SUCC)
+		cerr << "summarizeRecords: cannot write the zone map " << rc << endl;
+	return rc;
 }
 
 // Given a record descriptor, insert a record into a given file identifed by the provided handle.
 RC RecordBasedFileManager::insertRecord(FileHandle &fileHandle,
 		const vector<Attribute> &recordDescriptor, const void *data, RID &rid) {
+	setFileLayout(fileHandle);
 	// get record size to be inserted
 	// translate the data to the raw data version
-	unsigned recordSize = getRecordSize(data, recordDescriptor);
+	const char *record;
+	unsigned recordSize = getStoredRecord(data, recordDescriptor, record);
 	// to determine whether a record can be inserted, must include the slot directory size
-	unsigned recordDirectorySize = recordSize + sizeof(SlotDir);
+	unsigned recordDirectorySize = getRecordSpace(record, recordSize);
+	if (recordDirectorySize > getEmptySpaceSize()) {
+		cerr << "Insert record: the record does not fit in a page " << RECORD_OVERFLOW << endl;
+		return RECORD_OVERFLOW;
+	}
 
 	// get the first page that is available
 	// first find the file handle. determine if it is existed
 	PagedFileManager * pmfInstance = PagedFileManager::instance();
-	MultipleFilesSpaceManager::iterator itr = pmfInstance->filesSpaceManager.find(fileHandle.fileName);
-	if (itr == pmfInstance->filesSpaceManager.end()) {
+	FileSpaceManager *spaceManager = fileHandle.getSpaceManager();
+	if (spaceManager == NULL) {
 		cerr << "insertRecord: fail to find the space manager " << RECORD_FILE_HANDLE_NOT_FOUND << endl;
 		return RECORD_FILE_HANDLE_NOT_FOUND;
 	}
 	// obtain the page number
 	PageNum pageNum = -1;
-	RC rc = itr->second.getPageSpaceInfo(recordDirectorySize, pageNum);
-	if (rc == FILE_SPACE_EMPTY || rc == FILE_SPACE_NO_SPACE) {
-		// the record is too big to fit into the page
-		// create a new page
-		setPageEmpty(pageContent);
-		rc = fileHandle.appendPage(pageContent);
-		if (rc != SUCC) {
-			cerr << "Insert record: cannot append a new page" << endl;
-			return rc;
+	char *page;
+	RC rc = pinPageForRecord(fileHandle, record, recordDirectorySize, pageNum, page);
+	if (rc != SUCC)
+		return rc;
+
+	// summarize the record before the page holding it can be written
+	rc = summarizeRecords(fileHandle, recordDescriptor, &data, 1, pageNum);
+	if (rc != SUCC) {
+		fileHandle.unpinPage(pageNum, false);
+		return rc;
+	}
+	SlotNum slotNum = 1;
+	rc = placeRecord(page, record, recordSize, slotNum);
+	if (rc != SUCC) {
+		fileHandle.unpinPage(pageNum, true);
+		return rc;
+	}
+
+	// update the priority queue
+	unsigned freeSpaceSize = getFreeSpaceSize(page);
+
+	// write page into the file
+	rc = fileHandle.unpinPage(pageNum, true);
+	if (rc != SUCC) {
+		cerr << "Insert record: write page " << rc << endl;
+		return rc;
+	}
+
+	// update the record id, the record is inserted
+	rid.pageNum = pageNum;
+	rid.slotNum = slotNum;
+	rc = spaceManager->pushPageSpaceInfo(fileHandle, freeSpaceSize, pageNum);
+	if (rc != SUCC)
+		cerr << "Insert record: cannot update the free space map " << rc << endl;
+	return pmfInstance->commit();
+}
+
+// Insert records in a batch
+// A page is filled with as many records as fit before it is released, so it
+// is written and logged once; the batch is committed once at the end.
+// Note a record too big for a page stops the batch, the ones before it stay inserted;
+// rids holds the ids of the records inserted on every return
+RC RecordBasedFileManager::insertRecords(FileHandle &fileHandle,
+		const vector<Attribute> &recordDescriptor, const vector<const void *> &data,
+		vector<RID> &rids) {
+	setFileLayout(fileHandle);
+	rids.clear();
+	FileSpaceManager *spaceManager = fileHandle.getSpaceManager();
+	if (spaceManager == NULL) {
+		cerr << "insertRecords: fail to find the space manager " << RECORD_FILE_HANDLE_NOT_FOUND << endl;
+		return RECORD_FILE_HANDLE_NOT_FOUND;
+	}
+	rids.resize(data.size());
+
+	RC rc = SUCC;
+	unsigned next = 0;
+	while (next < data.size() && rc == SUCC) {
+		// the first record to place picks the page
+		const char *record;
+		unsigned recordSize = getStoredRecord(data[next], recordDescriptor, record);
+		unsigned recordSpace = getRecordSpace(record, recordSize);
+		if (recordSpace > getEmptySpaceSize()) {
+			rc = RECORD_OVERFLOW;
+			break;
 		}
-		// obtain the newly allocated page's num
-		pageNum = fileHandle.getNumberOfPages()-1;
-	} else {
-		itr->second.popPageSpaceInfo();
+		PageNum pageNum = -1;
+		char *page;
+		rc = pinPageForRecord(fileHandle, record, recordSpace, pageNum, page);
+		if (rc != SUCC)
+			break;
+
+		// fill the page
+		SlotNum slotNum = 1;
+		while (true) {
+			// summarize the record before the page holding it can be written
+			rc = summarizeRecords(fileHandle, recordDescriptor, &data[next], 1, pageNum);
+			if (rc != SUCC)
+				break;
+			rc = placeRecord(page, record, recordSize, slotNum);
+			if (rc == RECORD_PAGE_FULL || rc == RECORD_PAGE_MISMATCH) {
+				// the record goes to another page
+				rc = SUCC;
+				break;
+			}
+			if (rc != SUCC)
+				break;
+			rids[next].pageNum = pageNum;
+			rids[next].slotNum = slotNum;
+			if (++next == data.size())
+				break;
+			recordSize = getStoredRecord(data[next], recordDescriptor, record);
+			recordSpace = getRecordSpace(record, recordSize);
+			if (recordSpace > getEmptySpaceSize()) {
+				rc = RECORD_OVERFLOW;
+				break;
+			}
+			if (getFreeSpaceSize(page) < int(recordSpace))
+				break;
+		}
+
+		// write the page once
+		unsigned freeSpaceSize = getFreeSpaceSize(page);
+		RC unpinRC = fileHandle.unpinPage(pageNum, true);
+		if (unpinRC != SUCC) {
+			cerr << "insertRecords: write page " << unpinRC << endl;
+			rids.resize(next);
+			return unpinRC;
+		}
+		unpinRC = spaceManager->pushPageSpaceInfo(fileHandle, freeSpaceSize, pageNum);
+		if (unpinRC != SUCC) {
+			cerr << "insertRecords: cannot update the free space map " << unpinRC << endl;
+			rids.resize(next);
+			return unpinRC;
+		}
+	}
+	if (rc != SUCC) {
+		cerr << "insertRecords: insert record " << next << " error " << rc << endl;
+		rids.resize(next);
+		PagedFileManager::instance()->commit();
+		return rc;
 	}
+	return PagedFileManager::instance()->commit();
+}
 
-	// load the page data
-	rc = fileHandle.readPage(pageNum, pageContent);
+// pin a page with room for the record and its slot directory, a page is appended if none has
+// A PAX page must also hold rows of the format of the record
+RC RecordBasedFileManager::pinPageForRecord(FileHandle &fileHandle, const char *record,
+		const unsigned &recordDirectorySize, PageNum &pageNum, char *&page) {
+	FileSpaceManager *spaceManager = fileHandle.getSpaceManager();
+	RC rc = spaceManager->loadPageSpaceInfo(fileHandle);
 	if (rc != SUCC) {
-		cerr << "Insert record: Read page " << rc << endl;
+		cerr << "Insert record: cannot load the free space map " << rc << endl;
 		return rc;
 	}
+	while (true) {
+		rc = spaceManager->getPageSpaceInfo(recordDirectorySize, pageNum);
+		if (rc == FILE_SPACE_EMPTY || rc == FILE_SPACE_NO_SPACE) {
+			// the record is too big to fit into the page
+			// create a new page
+			rc = appendDataPage(fileHandle, pageNum);
+			if (rc != SUCC) {
+				cerr << "Insert record: cannot append a new page" << endl;
+				return rc;
+			}
+		}
 
-	// available space
-	unsigned spaceSize = getFreeSpaceSize(pageContent);
-	if (spaceSize < recordDirectorySize)
-		cerr << "not enough space " << spaceSize << "\t" << recordDirectorySize << endl;
+		// pin the page and fill the record in place
+		rc = fileHandle.pinPage(pageNum, page);
+		if (rc != SUCC) {
+			cerr << "Insert record: Read page " << rc << endl;
+			return rc;
+		}
 
+		// the free space map is a hint, check it against the page
+		int spaceSize = getFreeSpaceSize(page);
+		if (spaceSize >= int(recordDirectorySize)) {
+			if (!paxPages)
+				return SUCC;
+			// the rows of a PAX page may take more room with the record than it alone
+			PaxPage source;
+			vector<PaxRow> rows;
+			vector<char> layouts;
+			SlotNum slotNum = 1, numSlots;
+			rc = getPaxRows(page, record, slotNum, false, source, rows, numSlots);
+			if (rc == SUCC && getPaxPageSize(source, rows, layouts) +
+					numSlots * sizeof(SlotDir) <= getEmptySpaceSize())
+				return SUCC;
+			if (rc == SUCC && rows.size() == 1) {
+				// the record does not fit in a page of its own
+				fileHandle.unpinPage(pageNum);
+				cerr << "Insert record: the record does not fit in a page " << RECORD_OVERFLOW << endl;
+				return RECORD_OVERFLOW;
+			}
+			// a page of another format takes no more records
+			spaceSize = rc == RECORD_PAGE_MISMATCH ? 0 : recordDirectorySize - 1;
+		}
+		fileHandle.unpinPage(pageNum);
+		rc = spaceManager->pushPageSpaceInfo(fileHandle, spaceSize < 0 ? 0 : spaceSize, pageNum);
+		if (rc != SUCC) {
+			cerr << "Insert record: cannot update the free space map " << rc << endl;
+			return rc;
+		}
+	}
+}
 
+// place a stored record at the free space of a page
+// slotNum is where the search for a free slot starts, and the slot taken on return
+RC RecordBasedFileManager::placeRecord(char *page, const char *record,
+		const unsigned &recordSize, SlotNum &slotNum) {
+	if (paxPages)
+		return placePaxRecord(page, record, slotNum, false);
+	RC rc = SUCC;
 	// get the start point to write with
-	char *startPoint = (char*)(getFreeSpaceStartPoint(pageContent));
+	char *startPoint = (char*)(getFreeSpaceStartPoint(page));
 	char *originalStartPoint = startPoint;
 
 	//  write data onto the page memory
-	memcpy(startPoint, data, recordSize);
+	memcpy(startPoint, record, recordSize);
 
     // update the free space pointer of the page
 	startPoint += recordSize;
-	setFreeSpaceStartPoint(pageContent, startPoint);
+	setFreeSpaceStartPoint(page, startPoint);
 	// get the # of slots
-	SlotNum totalNumSlots = getNumSlots(pageContent);
-	SlotNum nextAvailableSlot = getNextAvailableSlot(pageContent);
+	SlotNum totalNumSlots = getNumSlots(page);
+	SlotNum nextAvailableSlot = getNextAvailableSlot(page, slotNum);
 	// update the number of slots in this page
 	if (totalNumSlots+1 == nextAvailableSlot) // must allocate new slot num
-		rc = setNumSlots(pageContent, nextAvailableSlot);
+		rc = setNumSlots(page, nextAvailableSlot);
 	if (rc != SUCC) {
 		cerr << "Insert record: fail to set number of slots " << rc << endl;
 		return rc;
@@ -113,31 +383,18 @@ RC RecordBasedFileManager::insertRecord(FileHandle &fileHandle,
 	SlotDir slotDir;
 	slotDir.recordLength = recordSize;
 	slotDir.recordOffset = (FieldAddress)originalStartPoint -
-			(FieldAddress)pageContent;
-	rc = setSlotDir(pageContent, slotDir, nextAvailableSlot);
+			(FieldAddress)page;
+	rc = setSlotDir(page, slotDir, nextAvailableSlot);
 	if (rc != SUCC) {
 		cerr << "Insert record: fail to update the director of the slot " << rc << endl;
 		return rc;
 	}
-
-	// write page into the file
-	rc = fileHandle.writePage(pageNum, pageContent);
-	if (rc != SUCC) {
-		cerr << "Insert record: write page " << rc << endl;
-		return rc;
-	}
-
-	// update the priority queue
-	unsigned freeSpaceSize = getFreeSpaceSize(pageContent);
-	itr->second.pushPageSpaceInfo(freeSpaceSize, pageNum);
-
-	// update the record id
-	rid.pageNum = pageNum;
-	rid.slotNum = nextAvailableSlot;
+	slotNum = nextAvailableSlot;
 	return SUCC;
 }
 
 RC RecordBasedFileManager::readRecord(char *readPage, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const RID &rid, void *data) {
+	setFileLayout(fileHandle);
 	RC rc;
 	// get slot directory
 	SlotDir slotDir;
@@ -167,111 +424,145 @@ RC RecordBasedFileManager::readRecord(char *readPage, FileHandle &fileHandle, co
 	}
 
 	// get the slot directory info
-	char *slot = readPage + slotDir.recordOffset;
+	const char *slot = getRecord(readPage, slotDir);
 
 	// translate the slot record to printable data
-	memcpy(data, slot, slotDir.recordLength);
+	getRecordData(slot, slotDir.recordLength, data);
 
     return SUCC;
 }
 // Given a record descriptor, read the record identified by the given rid.
 RC RecordBasedFileManager::readRecord(FileHandle &fileHandle,
 		const vector<Attribute> &recordDescriptor, const RID &rid, void *data) {
-	RC rc = fileHandle.readPage(rid.pageNum, pageContent);
+	setFileLayout(fileHandle);
+	// read the page in place
+	const char *page;
+	RC rc = fileHandle.readPage(rid.pageNum, page);
 	if (rc != SUCC) {
 		cerr << "Read Record: Reading Page error: " << rc << endl;
 		return rc;
 	}
-
-	// get slot directory
-	SlotDir slotDir;
-	rc = getSlotDir(pageContent, slotDir, rid.slotNum);
-	// cout << "read slot num " << rid.slotNum << endl;
-	if (rc != SUCC) {
-		cerr << "Read record: Reading slot directory error: " << rc << endl;
-		cerr << "While try to read slot num " << rid.slotNum << " at page " << rid.pageNum << endl;
-		SlotNum totalNumSlots = getNumSlots(pageContent);
-		cerr << "The total number of slots is " << totalNumSlots << endl;
-		return rc;
-	}
-
-	// check if the data has been deleted
-	if (slotDir.recordLength == RECORD_DEL) {
-		return RC_RECORD_DELETED;
+	rc = readRecord((char *)page, fileHandle, recordDescriptor, rid, data);
+	fileHandle.releasePage(page);
+	return rc;
+}
+// append an empty data page, and a free space map page before it if due
+RC RecordBasedFileManager::appendDataPage(FileHandle &fileHandle, PageNum &pageNum) {
+	RC rc;
+	FileSpaceManager *spaceManager = fileHandle.getSpaceManager();
+	if (spaceManager == NULL)
+		return RECORD_FILE_HANDLE_NOT_FOUND;
+	if (spaceManager->isSpaceMapPage(fileHandle.getNumberOfPages())) {
+		// the pages covered by a new map page have no free space until recorded
+		memset(pageContent, 0, pageSize);
+		rc = fileHandle.appendPage(pageContent);
+		if (rc != SUCC)
+			return rc;
 	}
-
-	// check if the data has been forwarded
-	if (slotDir.recordLength == RECORD_FORWARD) {
-		// get the forward RID
-		RID forwardRID;
-		getForwardRID(forwardRID, slotDir.recordOffset);
-		// goto forwarded RID to read the data
-		return readRecord(fileHandle, recordDescriptor,
-				forwardRID, data);
+	setPageEmpty(pageContent);
+	rc = fileHandle.appendPage(pageContent);
+	if (rc != SUCC)
+		return rc;
+	// obtain the newly allocated page's num
+	pageNum = fileHandle.getNumberOfPages()-1;
+	// the page is summarized from empty, as it holds no records
+	if (fileHandle.getFlags() & FILE_ZONE_MAPS) {
+		ZoneMap *zoneMap;
+		rc = acquireZoneMap(fileHandle.fileName, zoneMap);
+		if (rc != SUCC)
+			return rc;
+		rc = zoneMap->setSummary(pageNum, vector<char>());
+		releaseZoneMap(fileHandle.fileName);
 	}
-
-	// get the slot directory info
-	char *slot = pageContent + slotDir.recordOffset;
-
-	// translate the slot record to printable data
-	memcpy(data, slot, slotDir.recordLength);
-
-    return SUCC;
+	return rc;
+}
+// update the free space of a page in the space manager of its file
+RC RecordBasedFileManager::updatePageSpace(FileHandle &fileHandle,
+		const unsigned &freeSpaceSize, const PageNum &pageNum) {
+	FileSpaceManager *spaceManager = fileHandle.getSpaceManager();
+	if (spaceManager == NULL)
+		return RECORD_FILE_HANDLE_NOT_FOUND;
+	return spaceManager->pushPageSpaceInfo(fileHandle, freeSpaceSize, pageNum);
 }
 // delete all records
 RC RecordBasedFileManager::deleteRecords(FileHandle &fileHandle) {
+	setFileLayout(fileHandle);
 	PageNum totalPageNum = fileHandle.getNumberOfPages();
 	RC rc;
+	FileSpaceManager *spaceManager = fileHandle.getSpaceManager();
+	if (spaceManager == NULL) {
+		return RECORD_FILE_HANDLE_NOT_FOUND;
+	}
 	// NOTE: only delete user records in data pages
-	for (PageNum i = TABLE_PAGES_NUM; i < totalPageNum; ++i) {
-		// read the page
-		rc = fileHandle.readPage(i, pageContent);
+	// the data pages between two free space map pages are moved in batches
+	vector<char> batch((size_t)BATCH_PAGES * pageSize);
+	PageNum i = spaceManager->getDataPage(TABLE_PAGES_NUM);
+	while (i < totalPageNum) {
+		unsigned numPages = 0;
+		while (numPages < BATCH_PAGES && i + numPages < totalPageNum &&
+				!spaceManager->isSpaceMapPage(i + numPages))
+			++numPages;
+		// read the pages
+		rc = fileHandle.readPages(i, numPages, &batch[0]);
 		if (rc != SUCC){
 			cerr << "delete records: read page error " << rc << endl;
 			return rc;
 		}
-		// set the free space to the top of the page
-		setFreeSpaceStartPoint(pageContent, pageContent);
-		// set the number of slot directory to be zero
-		rc = setNumSlots(pageContent, 0);
-		if (rc != SUCC){
-			cerr << "delete records: set num slots error " << rc << endl;
-			return rc;
+		for (unsigned j = 0; j < numPages; ++j) {
+			char *page = &batch[(size_t)j * pageSize];
+			// set the free space to the top of the page
+			setFreeSpaceStartPoint(page, page);
+			// set the number of slot directory to be zero
+			rc = setNumSlots(page, 0);
+			if (rc != SUCC){
+				cerr << "delete records: set num slots error " << rc << endl;
+				return rc;
+			}
 		}
-		// write the page
-		rc = fileHandle.writePage(i, pageContent);
+		// write the pages
+		rc = fileHandle.writePages(i, numPages, &batch[0]);
 		if (rc != SUCC){
 			cerr << "delete records: write page error " << rc << endl;
 			return rc;
 		}
+		i = spaceManager->getDataPage(i + numPages);
 	}
 
 	// refresh the space manager
-	// get the first page that is available
-	// first find the file handle. determine if it is existed
-	PagedFileManager * pmfInstance = PagedFileManager::instance();
-	MultipleFilesSpaceManager::iterator itr = pmfInstance->filesSpaceManager.find(fileHandle.fileName);
-	if (itr == pmfInstance->filesSpaceManager.end()) {
-		return RECORD_FILE_HANDLE_NOT_FOUND;
-	}
 	// empty the page space queue
-	itr->second.clearPageSpaceInfo();
+	spaceManager->clearPageSpaceInfo();
 	// insert the new page space
 	for (PageNum i = TABLE_PAGES_NUM; i < totalPageNum; ++i) {
-		rc = itr->second.pushPageSpaceInfo(getEmptySpaceSize(), i);
+		if (spaceManager->isSpaceMapPage(i))
+			continue;
+		rc = spaceManager->pushPageSpaceInfo(fileHandle, getEmptySpaceSize(), i);
 		if (rc != SUCC){
 			cerr << "delete records: find page space error " << rc << endl;
 			return rc;
 		}
 	}
-	return SUCC;
+	// every page is empty
+	if (fileHandle.getFlags() & FILE_ZONE_MAPS) {
+		ZoneMap *zoneMap;
+		rc = acquireZoneMap(fileHandle.fileName, zoneMap);
+		if (rc != SUCC)
+			return rc;
+		rc = zoneMap->clear(totalPageNum);
+		releaseZoneMap(fileHandle.fileName);
+		if (rc != SUCC) {
+			cerr << "delete records: write zone map error " << rc << endl;
+			return rc;
+		}
+	}
+	return PagedFileManager::instance()->commit();
 }
 // delete specific record
 RC RecordBasedFileManager::deleteRecord(FileHandle &fileHandle,
 		const vector<Attribute> &recordDescriptor, const RID &rid) {
-	char page[PAGE_SIZE];
-	// read the page into the memory
-	RC rc = fileHandle.readPage(rid.pageNum, page);
+	setFileLayout(fileHandle);
+	char *page;
+	// pin the page in the memory
+	RC rc = fileHandle.pinPage(rid.pageNum, page);
 	if (rc != SUCC) {
 		cerr << "Delete record: Reading Page error " << rc << endl;
 		return rc;
@@ -282,34 +573,37 @@ RC RecordBasedFileManager::deleteRecord(FileHandle &fileHandle,
 	rc = getSlotDir(page, slotDir, rid.slotNum);
 	if (rc != SUCC) {
 		cerr << "Delete record: Reading slot directory error " << rc << endl;
+		fileHandle.unpinPage(rid.pageNum);
 		return rc;
 	}
 
 	// check if the data has been deleted
 	if (slotDir.recordLength == RECORD_DEL) {
+		fileHandle.unpinPage(rid.pageNum);
 		return SUCC;
 	}
 
 	// check if the data has been forwarded
 	if (slotDir.recordLength == RECORD_FORWARD) {
+		// get the forward RID before the slot is overwritten
+		RID forwardRID;
+		getForwardRID(forwardRID, slotDir.recordOffset);
 		// delete the record
 		slotDir.recordLength = RECORD_DEL;
 		// set the slot directory
 		rc = setSlotDir(page, slotDir, rid.slotNum);
 		if (rc != SUCC){
 			cerr << "Delete record: set slot dir error " << rc << endl;
+			fileHandle.unpinPage(rid.pageNum);
 			return rc;
 		}
 		// write page back
-		rc = fileHandle.writePage(rid.pageNum, page);
+		rc = fileHandle.unpinPage(rid.pageNum, true);
 		if (rc != SUCC){
 			cerr << "Delete record: write page error " << rc << endl;
 			return rc;
 		}
 
-		// get the forward RID
-		RID forwardRID;
-		getForwardRID(forwardRID, slotDir.recordOffset);
 		// goto forwarded RID to read the data
 		return deleteRecord(fileHandle, recordDescriptor, forwardRID);
 	}
@@ -321,111 +615,143 @@ RC RecordBasedFileManager::deleteRecord(FileHandle &fileHandle,
 	rc = setSlotDir(page, slotDir, rid.slotNum);
 	if (rc != SUCC){
 		cerr << "Delete record 2: set slot dir error " << rc << endl;
+		fileHandle.unpinPage(rid.pageNum);
 		return rc;
 	}
 
 	// write page back
-	rc = fileHandle.writePage(rid.pageNum, page);
+	rc = fileHandle.unpinPage(rid.pageNum, true);
 	if (rc != SUCC){
 		cerr << "Delete record 2: write page error " << rc << endl;
 		return rc;
 	}
 
-	return SUCC;
+	return PagedFileManager::instance()->commit();
 }
 // update the record without changing the rid
 RC RecordBasedFileManager::RecordBasedFileManager::updateRecord(FileHandle &fileHandle,
 		const vector<Attribute> &recordDescriptor,
 		const void *data, const RID &rid) {
+	setFileLayout(fileHandle);
 	RC rc;
-	// char page[PAGE_SIZE];
-	// read page
-	rc = fileHandle.readPage(rid.pageNum, pageContent);
+	char *page;
+	// pin page
+	rc = fileHandle.pinPage(rid.pageNum, page);
 	if (rc != SUCC){
 		cerr << "Update record: read page error " << rc << endl;
 		return rc;
 	}
 
 	// get the # of slots
-	SlotNum numSlots = getNumSlots(pageContent);
+	SlotNum numSlots = getNumSlots(page);
 	// get the offset of the slot
 	SlotDir curSlot;
-	rc = getSlotDir(pageContent, curSlot, rid.slotNum);
+	rc = getSlotDir(page, curSlot, rid.slotNum);
 	if (rc != SUCC){
 		cerr << "Update record: get slot dir error " << rc << endl;
+		fileHandle.unpinPage(rid.pageNum);
 		return rc;
 	}
 	// determine whether the record is deleted
 	if (curSlot.recordLength == RECORD_DEL) {
+		fileHandle.unpinPage(rid.pageNum);
 		return SUCC;
 	}
 	if (curSlot.recordLength == RECORD_FORWARD) {
 		// get the forwarded RID
 		RID newRID;
 		getForwardRID(newRID, curSlot.recordOffset);
+		fileHandle.unpinPage(rid.pageNum);
 		return updateRecord(fileHandle,
 				recordDescriptor, data, newRID);
 	}
 
 	// get record size to be inserted
 	// translate the record to formatted version
-	unsigned recordSize = getRecordSize(data, recordDescriptor);
+	const char *record;
+	unsigned recordSize = getStoredRecord(data, recordDescriptor, record);
+	// summarize the record before the page can be written with it
+	rc = summarizeRecords(fileHandle, recordDescriptor, &data, 1, rid.pageNum);
+	if (rc != SUCC) {
+		fileHandle.unpinPage(rid.pageNum);
+		return rc;
+	}
 	// determine if the record can be fitted into the original slot
+	// Note a PAX page is rewritten with the record if the rows still fit
 	unsigned recordSpaceAvailable = curSlot.recordLength;
+	bool fitted = recordSpaceAvailable >= recordSize;
+	if (paxPages) {
+		SlotNum slotNum = rid.slotNum;
+		fitted = placePaxRecord(page, record, slotNum, true) == SUCC;
+	}
 
 	// if it can be fitted
-	if (recordSpaceAvailable >= recordSize) {
-		char *writtenRecord = (char *)pageContent + curSlot.recordOffset;
-		// copy the record
-		memcpy(writtenRecord, data, recordSize);
-		// reset the slot directory
-		curSlot.recordLength = recordSize;
-		rc = setSlotDir(pageContent, curSlot, rid.slotNum);
-		if (rc != SUCC){
-			cerr << "Update record: set dir error " << rc << endl;
-			return rc;
-		}
+	if (fitted) {
 		// set the free space for its the last record
-		if (rid.slotNum == numSlots) {
-			setFreeSpaceStartPoint(pageContent, writtenRecord+recordSize);
+		bool spaceChanged = paxPages || rid.slotNum == numSlots;
+		if (!paxPages) {
+			char *writtenRecord = (char *)page + curSlot.recordOffset;
+			// copy the record
+			memcpy(writtenRecord, record, recordSize);
+			// reset the slot directory
+			curSlot.recordLength = recordSize;
+			rc = setSlotDir(page, curSlot, rid.slotNum);
+			if (rc != SUCC){
+				cerr << "Update record: set dir error " << rc << endl;
+				fileHandle.unpinPage(rid.pageNum);
+				return rc;
+			}
+			if (spaceChanged) {
+				setFreeSpaceStartPoint(page, writtenRecord+recordSize);
+			}
 		}
+		unsigned freeSpaceSize = getFreeSpaceSize(page);
 		// write page
-		rc = fileHandle.writePage(rid.pageNum, pageContent);
+		rc = fileHandle.unpinPage(rid.pageNum, true);
 		if (rc != SUCC){
 			cerr << "Update record: write page error " << rc << endl;
 			return rc;
 		}
+		if (spaceChanged) {
+			rc = updatePageSpace(fileHandle, freeSpaceSize, rid.pageNum);
+			if (rc != SUCC){
+				cerr << "Update record: free space map error " << rc << endl;
+				return rc;
+			}
+		}
 	} else { // the updated record cannot be fitted into the page
 		// insert the record
+		// Note the frame stays pinned, so an insertion into the same page
+		// is visible through it
 		RID newRID;
 		rc = insertRecord(fileHandle, recordDescriptor, data, newRID);
 		if (rc != SUCC){
 			cerr << "Update record: insert record error " << rc << endl;
+			fileHandle.unpinPage(rid.pageNum);
 			return rc;
 		}
-		// reload the page in case the record is inserted into the same page
-		rc = fileHandle.readPage(rid.pageNum, pageContent);
 
 		// set the original slot in page as forwarded
 		curSlot.recordLength = RECORD_FORWARD;
 		// set the slot directory
 		setForwardRID(newRID, curSlot.recordOffset);
-		setSlotDir(pageContent, curSlot, rid.slotNum);
+		setSlotDir(page, curSlot, rid.slotNum);
 		// write page
-		rc = fileHandle.writePage(rid.pageNum, pageContent);
+		rc = fileHandle.unpinPage(rid.pageNum, true);
 		if (rc != SUCC){
 			cerr << "Update record: write page error " << rc << endl;
 			return rc;
 		}
 	}
 
-	return SUCC;
+	return PagedFileManager::instance()->commit();
 }
 
 // read values associating with the attribute
 RC RecordBasedFileManager::readAttribute(char *readPage, FileHandle &fileHandle,
 		const vector<Attribute> &recordDescriptor,
 		const RID &rid, const string attributeName, void *data) {
+	setFileLayout(fileHandle);
 	RC rc;
 	// read the record
 	// get the Slot Directory
@@ -448,67 +774,28 @@ RC RecordBasedFileManager::readAttribute(char *readPage, FileHandle &fileHandle,
 	}
 
 	// read the record
-	char *record = ((char *)readPage) + slotDir.recordOffset;
+	const char *record = getRecord(readPage, slotDir);
 	// get the current record's version
-	VersionNumber curVer = *((VersionNumber *)record);
+	VersionNumber curVer = getRecordVersion(record);
 
 	// see if the attribute exists in current version
 	VersionManager *vm = VersionManager::instance();
-	vector<Attribute> currentRD;
-	rc = vm->getAttributes(fileHandle.fileName, currentRD, curVer);
+	VersionDescriptorPtr descriptor;
+	rc = vm->getDescriptor(fileHandle.fileName, descriptor, curVer);
 	if (rc != SUCC) {
 		cerr << "readAttribute: get attribute error " << rc << endl;
 		return rc;
 	}
-
-	int offset = 0;	// offset to the attribute
-	int lenAttr = 0; // attribute length
-	int index = 0;
-	// go through the record descriptor until find the attribute name
-	for (; index < int(currentRD.size()); ++index) {
-		if (attributeName == currentRD[index].name) {
-			// locate the attribute
-			break;
-		} else {
-			switch(currentRD[index].type) {
-			case TypeInt:
-				offset += sizeof(int);
-				break;
-			case TypeReal:
-				offset += sizeof(float);
-				break;
-			case TypeVarChar:
-				int len = *((int *)(record + offset));
-				offset += len + sizeof(int);
-				break;
-			}
-		}
-	}
-
-	if (index == int(currentRD.size())) {
+	const char *field;
+	unsigned length;
+	if (getRecordAttribute(record, *descriptor, descriptor->getIndex(attributeName),
+			field, length)) {
+		memcpy(data, field, length);
+	} else {
 		// no such attribute found
 		// return a default value
-		// the default value for Varchar is (int)0NULL
-		// the default value for Int is (int)0
-		// the default value for Real is (float)0.0
 		int defaultVal = 0;
 		memcpy(data, &defaultVal, sizeof(int));
-	} else {
-		// got the attribute hit
-		// read length of data
-		switch(currentRD[index].type) {
-		case TypeInt:
-			lenAttr = sizeof(int);
-			break;
-		case TypeReal:
-			lenAttr = sizeof(float);
-			break;
-		case TypeVarChar:
-			lenAttr = *((int *)(record + offset))+sizeof(int);
-			break;
-		}
-		// read the attribute
-		memcpy(data, record+offset, lenAttr);
 	}
 
 	return SUCC;
@@ -516,121 +803,61 @@ RC RecordBasedFileManager::readAttribute(char *readPage, FileHandle &fileHandle,
 RC RecordBasedFileManager::readAttribute(FileHandle &fileHandle,
 		const vector<Attribute> &recordDescriptor,
 		const RID &rid, const string attributeName, void *data) {
-	// read the page
-	RC rc = fileHandle.readPage(rid.pageNum, pageContent);
+	setFileLayout(fileHandle);
+	// read the page in place
+	const char *page;
+	RC rc = fileHandle.readPage(rid.pageNum, page);
 	if (rc != SUCC) {
 		cerr << "readAttribute: read page error " << rc << endl;
 		return rc;
 	}
-	// read the record
-	// get the Slot Directory
-	SlotDir slotDir;
-	rc = getSlotDir(pageContent, slotDir, rid.slotNum);
-	if (rc != SUCC) {
-		cerr << "readAttribute: read slot direcotry error " << rc << endl;
-		return rc;
-	}
-	// see if the record is deleted or forwarded
-	if (slotDir.recordLength == RECORD_DEL) {
-		return RC_RECORD_DELETED;
-	}
-	if (slotDir.recordLength == RECORD_FORWARD) {
-		// get the forward RID
-		RID forwardRID;
-		getForwardRID(forwardRID, slotDir.recordOffset);
-		return readAttribute(fileHandle, recordDescriptor, forwardRID,
-				attributeName, data);
-	}
-
-	// read the record
-	char *record = ((char *)pageContent) + slotDir.recordOffset;
-	// get the current record's version
-	VersionNumber curVer = *((VersionNumber *)record);
-
-	// see if the attribute exists in current version
-	VersionManager *vm = VersionManager::instance();
-	vector<Attribute> currentRD;
-	rc = vm->getAttributes(fileHandle.fileName, currentRD, curVer);
-	if (rc != SUCC) {
-		cerr << "readAttribute: get attribute error " << rc << endl;
-		return rc;
-	}
-
-	int offset = 0;	// offset to the attribute
-	int lenAttr = 0; // attribute length
-	int index = 0;
-	// go through the record descriptor until find the attribute name
-	for (; index < int(currentRD.size()); ++index) {
-		if (attributeName == currentRD[index].name) {
-			// locate the attribute
-			break;
-		} else {
-			switch(currentRD[index].type) {
-			case TypeInt:
-				offset += sizeof(int);
-				break;
-			case TypeReal:
-				offset += sizeof(float);
-				break;
-			case TypeVarChar:
-				int len = *((int *)(record + offset));
-				offset += len + sizeof(int);
-				break;
-			}
-		}
-	}
-
-	if (index == int(currentRD.size())) {
-		// no such attribute found
-		// return a default value
-		// the default value for Varchar is (int)0NULL
-		// the default value for Int is (int)0
-		// the default value for Real is (float)0.0
-		int defaultVal = 0;
-		memcpy(data, &defaultVal, sizeof(int));
-	} else {
-		// got the attribute hit
-		// read length of data
-		switch(currentRD[index].type) {
-		case TypeInt:
-			lenAttr = sizeof(int);
-			break;
-		case TypeReal:
-			lenAttr = sizeof(float);
-			break;
-		case TypeVarChar:
-			lenAttr = *((int *)(record + offset))+sizeof(int);
-			break;
-		}
-		// read the attribute
-		memcpy(data, record+offset, lenAttr);
-	}
-
-	return SUCC;
+	rc = readAttribute((char *)page, fileHandle, recordDescriptor, rid,
+			attributeName, data);
+	fileHandle.releasePage(page);
+	return rc;
 }
 
 RC RecordBasedFileManager::reorganizePage(FileHandle &fileHandle,
 		const vector<Attribute> &recordDescriptor, const unsigned pageNumber) {
+	setFileLayout(fileHandle);
 	RC rc;
-	// read page
-	rc = fileHandle.readPage(pageNumber, pageContent);
+	FileSpaceManager *spaceManager = fileHandle.getSpaceManager();
+	if (spaceManager == NULL)
+		return RECORD_FILE_HANDLE_NOT_FOUND;
+	if (pageNumber < TABLE_PAGES_NUM || spaceManager->isSpaceMapPage(pageNumber))
+		return RECORD_NOT_DATA_PAGE;
+	// pin page, it is compacted in its frame
+	char *page;
+	rc = fileHandle.pinPage(pageNumber, page);
 	if (rc != SUCC){
-		cerr << "Reorganize record: read page error " << rc << endl;
+		cerr << "Reorganize record: pin page error " << rc << endl;
 		return rc;
 	}
 
 	// get the number of slots
-	SlotNum slotsNum = getNumSlots(pageContent);
-	char *curWrittenPoint = pageContent;
-	char *curReadPoint = pageContent;
+	SlotNum slotsNum = getNumSlots(page);
+	char *curWrittenPoint = page;
+	char *curReadPoint = page;
 	SlotDir slotDir;
 
+	// a PAX page is rewritten with the rows left
+	if (paxPages) {
+		PaxPage source;
+		vector<PaxRow> rows;
+		SlotNum slotNum = 0;
+		getPaxRows(page, NULL, slotNum, false, source, rows, slotsNum);
+		writePaxPage(page, source, rows, slotsNum);
+		curWrittenPoint = page + getDataSize(page);
+		slotsNum = 0;
+	}
+
 	// Note: as written in insertRecord, the slot num starts from 1
 	for (SlotNum slot = 1; slot <= slotsNum; ++slot) {
 		// get the slot directory
-		rc = getSlotDir(pageContent, slotDir, slot);
+		rc = getSlotDir(page, slotDir, slot);
 		if (rc != SUCC){
 			cerr << "Reorganize record: get slot dir error " << rc << endl;
+			fileHandle.unpinPage(pageNumber);
 			return rc;
 		}
 
@@ -638,20 +865,21 @@ RC RecordBasedFileManager::reorganizePage(FileHandle &fileHandle,
 		if (slotDir.recordLength != RECORD_DEL &&
 				slotDir.recordLength != RECORD_FORWARD) {
 			// set the reading start point
-			curReadPoint = pageContent + slotDir.recordOffset;
+			curReadPoint = page + slotDir.recordOffset;
 			// get the record size
 			unsigned recordSize = slotDir.recordLength;
 			// update the offset of the slot directory
 			slotDir.recordOffset =  (FieldAddress)curWrittenPoint -
-					(FieldAddress)pageContent;
-			rc = setSlotDir(pageContent, slotDir, slot);
+					(FieldAddress)page;
+			rc = setSlotDir(page, slotDir, slot);
 			if (rc != SUCC){
 				cerr << "Reorganize record: set dir error " << rc << endl;
+				fileHandle.unpinPage(pageNumber);
 				return rc;
 			}
 /*
  * Debug Info
-			cout << "curWrittenPoint " << curWrittenPoint - pageContent;
+			cout << "curWrittenPoint " << curWrittenPoint - page;
 			cout << ", written size " << recordSize << endl;
 */
 			// move the data
@@ -661,39 +889,68 @@ RC RecordBasedFileManager::reorganizePage(FileHandle &fileHandle,
 	}
 
 	// set the free space size
-	setFreeSpaceStartPoint(pageContent, curWrittenPoint);
+	setFreeSpaceStartPoint(page, curWrittenPoint);
+	int freeSpace = getFreeSpaceSize(page);
 	// write page
-	return fileHandle.writePage(pageNumber, pageContent);
+	rc = fileHandle.unpinPage(pageNumber, true);
+	if (rc != SUCC){
+		cerr << "Reorganize record: write page error " << rc << endl;
+		return rc;
+	}
+	rc = updatePageSpace(fileHandle, freeSpace, pageNumber);
+	if (rc != SUCC)
+		return rc;
+	return PagedFileManager::instance()->commit();
 }
 
 // reorganize the database
 RC RecordBasedFileManager::reorganizeFile(FileHandle &fileHandle,
 		const vector<Attribute> &recordDescriptor) {
+	setFileLayout(fileHandle);
 	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
 	RC rc;
 	PagedFileManager * pfm = PagedFileManager::instance();
-	MultipleFilesSpaceManager::iterator itr = pfm->filesSpaceManager.find(fileHandle.fileName);
-	if (itr == pfm->filesSpaceManager.end()) {
+	FileSpaceManager *spaceManager = fileHandle.getSpaceManager();
+	if (spaceManager == NULL) {
 		cerr << "reorganizedFile: fail to find the space manager " << RECORD_FILE_HANDLE_NOT_FOUND << endl;
 		return RECORD_FILE_HANDLE_NOT_FOUND;
 	}
-	itr->second.clearPageSpaceInfo();
+	spaceManager->clearPageSpaceInfo();
 
 	// create buffer in a list
 	list<char *> buffer;
+	// the pages the records of each buffer page come from, for the zone map
+	list<vector<PageNum> > bufferSources;
+	vector<PageNum> curSources;
+	map<PageNum, vector<PageNum> > zoneSources;
 	// read ptr is always ahead of write ptr
-	PageNum readPagePtr(TABLE_PAGES_NUM), writePagePtr(TABLE_PAGES_NUM);
+	// the free space map pages are skipped by both
+	PageNum readPagePtr(spaceManager->getDataPage(TABLE_PAGES_NUM));
+	PageNum writePagePtr(readPagePtr);
 	// get the total number of pages
 	PageNum totalPageNum = fileHandle.getNumberOfPages();
+	if (readPagePtr >= totalPageNum)
+		return SUCC;
+	// the summaries are behind the pages until they are merged
+	if (fileHandle.getFlags() & FILE_ZONE_MAPS) {
+		ZoneMap *zoneMap;
+		rc = acquireZoneMap(fileHandle.fileName, zoneMap);
+		if (rc != SUCC)
+			return rc;
+		rc = zoneMap->markChanged();
+		releaseZoneMap(fileHandle.fileName);
+		if (rc != SUCC)
+			return rc;
+	}
 
 	// current operating page
-	char *bufferPage = new char[PAGE_SIZE];
+	char *bufferPage = new char[pageSize];
 	// set page free space to the head of the page
 	rbfm->setPageEmpty(bufferPage);
 	// set the bufferOffset of the buffer page
 	unsigned bufferOffset(0);
 
-	char curReadPage[PAGE_SIZE];
+	char curReadPage[MAX_PAGE_SIZE];
 
 	// read ptr from first to end
 	while (readPagePtr < totalPageNum) {
@@ -706,7 +963,7 @@ RC RecordBasedFileManager::reorganizeFile(FileHandle &fileHandle,
 
 			// add the page size to the space manager
 			unsigned space = rbfm->getFreeSpaceSize(page2Write);
-			itr->second.pushPageSpaceInfo(space, writePagePtr);
+			spaceManager->pushPageSpaceInfo(fileHandle, space, writePagePtr);
 
 			rc = fileHandle.writePage(writePagePtr, page2Write);
 			if (rc != SUCC) {
@@ -715,10 +972,12 @@ RC RecordBasedFileManager::reorganizeFile(FileHandle &fileHandle,
 			}
 			// pop the page from the buffer
 			buffer.pop_front();
+			zoneSources[writePagePtr].swap(bufferSources.front());
+			bufferSources.pop_front();
 			// free the page
 			delete []page2Write;
 			// inc the write page pointer
-			++writePagePtr;
+			writePagePtr = spaceManager->getDataPage(writePagePtr + 1);
 		} //while (buffer.size() > 0 && writePagePtr < readPagePtr)
 
 		// load next page to read in
@@ -751,18 +1010,35 @@ RC RecordBasedFileManager::reorganizeFile(FileHandle &fileHandle,
 			// get the record size
 			unsigned recordSize = slotDir.recordLength;
 			curOffset = slotDir.recordOffset;
+			// the record of a PAX page is built from its row, and placed at once if it fits
+			const char *record = rbfm->getRecord(curReadPage, slotDir);
+			SlotNum slotNum = rbfm->getNumSlots(bufferPage) + 1;
+			bool placed = paxPages && placePaxRecord(bufferPage, record, slotNum, false) == SUCC;
 
 			// if not move data to buffer page
 			// first verify the free space available for the buffer page
 			int availableSpace = rbfm->getFreeSpaceSize(bufferPage);
-			if (availableSpace < int(recordSize)) {
+			if (paxPages ? !placed : availableSpace < int(recordSize)) {
 				// new a page for reorganizing
 				buffer.push_back(bufferPage);
-				bufferPage = new char[PAGE_SIZE];
+				bufferSources.push_back(curSources);
+				curSources.clear();
+				bufferPage = new char[pageSize];
 				rbfm->setPageEmpty(bufferPage);
 				bufferOffset = 0;
+				slotNum = 1;
 			}
 			// begin move
+			if (curSources.empty() || curSources.back() != readPagePtr)
+				curSources.push_back(readPagePtr);
+			if (paxPages) {
+				rc = placed ? SUCC : placePaxRecord(bufferPage, record, slotNum, false);
+				if (rc != SUCC) {
+					cerr << "RecordBasedFileManager::reorganizeFile: place record error " << rc << endl;
+					return rc;
+				}
+				continue;
+			}
 			memcpy(bufferPage + bufferOffset,
 					curReadPage + curOffset, recordSize);
 			// save the slot dir for later saving dir
@@ -787,11 +1063,12 @@ RC RecordBasedFileManager::reorganizeFile(FileHandle &fileHandle,
 		} // for
 
 		// increase the read page pointer to the next page to process
-		++readPagePtr;
+		readPagePtr = spaceManager->getDataPage(readPagePtr + 1);
 	}
 
 	// set the rest page to the buffer
 	buffer.push_back(bufferPage);
+	bufferSources.push_back(curSources);
 
 	// there is non written page in the buffer
 	while (buffer.size() > 0) {
@@ -799,7 +1076,7 @@ RC RecordBasedFileManager::reorganizeFile(FileHandle &fileHandle,
 
 		// add the page size to the space manager
 		unsigned space = rbfm->getFreeSpaceSize(page2Write);
-		itr->second.pushPageSpaceInfo(space, writePagePtr);
+		spaceManager->pushPageSpaceInfo(fileHandle, space, writePagePtr);
 
 		rc = fileHandle.writePage(writePagePtr, page2Write);
 		if (rc != SUCC) {
@@ -808,10 +1085,12 @@ RC RecordBasedFileManager::reorganizeFile(FileHandle &fileHandle,
 		}
 		// pop the page from the buffer
 		buffer.pop_front();
+		zoneSources[writePagePtr].swap(bufferSources.front());
+		bufferSources.pop_front();
 		// free the page
 		delete []page2Write;
 		// inc the write page pointer
-		++writePagePtr;
+		writePagePtr = spaceManager->getDataPage(writePagePtr + 1);
 	} // while (buffer.size() > 0)
 
 	// set the rest page to be empty
@@ -819,17 +1098,46 @@ RC RecordBasedFileManager::reorganizeFile(FileHandle &fileHandle,
 	unsigned space = rbfm->getFreeSpaceSize(curReadPage);
 	while (writePagePtr < totalPageNum) {
 		// add the page size to the space manager
-		itr->second.pushPageSpaceInfo(space, writePagePtr);
+		spaceManager->pushPageSpaceInfo(fileHandle, space, writePagePtr);
 
 		rc = fileHandle.writePage(writePagePtr, curReadPage);
 		if (rc != SUCC) {
 			cerr << "RecordBasedFileManager::reorganizeFile: write empty page error " << rc << endl;
 			return rc;
 		}
-		++writePagePtr;
+		zoneSources[writePagePtr].clear();
+		writePagePtr = spaceManager->getDataPage(writePagePtr + 1);
 	}
 
-	return SUCC;
+	// the summary of a page written merges the ones of the pages its records came from
+	if (fileHandle.getFlags() & FILE_ZONE_MAPS) {
+		ZoneMap *zoneMap;
+		rc = acquireZoneMap(fileHandle.fileName, zoneMap);
+		if (rc != SUCC)
+			return rc;
+		vector<vector<char> > summaries;
+		vector<char> other;
+		for (map<PageNum, vector<PageNum> >::iterator itr = zoneSources.begin();
+				itr != zoneSources.end(); ++itr) {
+			summaries.push_back(vector<char>());
+			for (int i = 0; i < int(itr->second.size()); ++i) {
+				zoneMap->getSummary(itr->second[i], other);
+				zoneMap->mergeSummary(summaries.back(), other);
+			}
+		}
+		int i = 0;
+		rc = SUCC;
+		for (map<PageNum, vector<PageNum> >::iterator itr = zoneSources.begin();
+				itr != zoneSources.end() && rc == SUCC; ++itr)
+			rc = zoneMap->setSummary(itr->first, summaries[i++]);
+		releaseZoneMap(fileHandle.fileName);
+		if (rc != SUCC) {
+			cerr << "RecordBasedFileManager::reorganizeFile: write zone map error " << rc << endl;
+			return rc;
+		}
+	}
+
+	return pfm->commit();
 }
 
 // scan returns an iterator to allow the caller to go through the results one by one.
@@ -844,6 +1152,7 @@ RC RecordBasedFileManager::scan(FileHandle &fileHandle,
 	// clear state of all the internal variables
 	if (rbfm_ScanIterator.value != NULL)
 		delete []rbfm_ScanIterator.value;
+	rbfm_ScanIterator.releaseCurrentPage();
 
 	VersionManager *vm = VersionManager::instance();
 	vector<Attribute> rd;
@@ -889,6 +1198,8 @@ RC RecordBasedFileManager::scan(FileHandle &fileHandle,
 
 	// set the comp operator
 	rbfm_ScanIterator.compOp = compOp;
+	// the positions of the attributes are found again for the new condition and projection
+	rbfm_ScanIterator.versionPlans.clear();
 
 	// set the value of comp attribute
 	unsigned recordLen = 0;
@@ -911,6 +1222,17 @@ RC RecordBasedFileManager::scan(FileHandle &fileHandle,
 		rbfm_ScanIterator.value = NULL;
 	}
 
+	// the zone map skips the pages that cannot meet the condition
+	rbfm_ScanIterator.releaseZoneMap();
+	if (rbfm_ScanIterator.value != NULL && !conditionAttribute.empty() && compOp != NO_OP &&
+			(fileHandle.getFlags() & FILE_ZONE_MAPS) &&
+			acquireZoneMap(fileHandle.fileName, rbfm_ScanIterator.zoneMap) == SUCC) {
+		rbfm_ScanIterator.zoneIndex = rbfm_ScanIterator.zoneMap->getIndex(conditionAttribute,
+				conditionAttrType);
+		if (rbfm_ScanIterator.zoneIndex < 0)
+			rbfm_ScanIterator.releaseZoneMap();
+	}
+
 	// set the previous page number to be -1
 	rbfm_ScanIterator.prevPageNum = -1;
 
@@ -936,164 +1258,355 @@ RC RecordBasedFileManager::scan(FileHandle &fileHandle,
 	return SUCC;
 }
 
+// scan with numThreads workers, the records come out of the iterator in no particular order
+RC RecordBasedFileManager::parallelScan(FileHandle &fileHandle,
+    const vector<Attribute> &recordDescriptor,
+    const string &conditionAttribute,
+    const CompOp compOp,
+    const void *value,
+    const vector<string> &attributeNames,
+    const unsigned numThreads,
+    RBFM_ParallelScanIterator &rbfm_ParallelScanIterator) {
+	RBFM_ParallelScanIterator &iterator = rbfm_ParallelScanIterator;
+	iterator.close();
+
+	// get the type of the condition and the projected attributes, as scan does
+	bool hitFlag = false;
+	AttrType conditionAttrType(TypeInt);
+	iterator.projectedAttrs.assign(attributeNames.size(), Attribute());
+	for (int i = 0; i < int(attributeNames.size()); ++i) {
+		iterator.projectedAttrs[i].name = attributeNames[i];
+		iterator.projectedAttrs[i].type = TypeInt;
+	}
+	for (int i = 0; i < int(recordDescriptor.size()); ++i) {
+		if (recordDescriptor[i].name == conditionAttribute) {
+			conditionAttrType = recordDescriptor[i].type;
+			hitFlag = true;
+		}
+		for (int j = 0; j < int(attributeNames.size()); ++j) {
+			if (attributeNames[j] == recordDescriptor[i].name)
+				iterator.projectedAttrs[j] = recordDescriptor[i];
+		}
+	}
+	if (value != NULL && !conditionAttribute.empty() && !hitFlag) {
+		cerr << "parallelScan: cannot find the condition attribute" << endl;
+		return SCANITER_COND_PROJ_NOT_FOUND;
+	}
+
+	// the value is kept for the workers
+	iterator.value.clear();
+	if (value != NULL) {
+		unsigned length = sizeof(int);
+		if (conditionAttrType == TypeVarChar)
+			length += *((const int *)value);
+		iterator.value.assign((const char *)value, (const char *)value + length);
+	}
+	iterator.fileName = fileHandle.fileName;
+	iterator.recordDescriptor = recordDescriptor;
+	iterator.conditionName = conditionAttribute;
+	iterator.compOp = compOp;
+	iterator.projectedName = attributeNames;
+	iterator.totalPageNum = fileHandle.getNumberOfPages();
+	iterator.nextPage = TABLE_PAGES_NUM;
+	iterator.stopping = false;
+	iterator.error = SUCC;
+
+	// no more workers than morsels
+	unsigned numMorsels = iterator.totalPageNum > TABLE_PAGES_NUM ?
+			(iterator.totalPageNum - TABLE_PAGES_NUM + PARALLEL_SCAN_MORSEL_PAGES - 1) /
+			PARALLEL_SCAN_MORSEL_PAGES : 0;
+	unsigned numWorkers = min(max(numThreads, 1u), max(numMorsels, 1u));
+	iterator.maxQueued = PARALLEL_SCAN_QUEUE_BATCHES * numWorkers;
+	iterator.runningWorkers = numWorkers;
+	for (unsigned i = 0; i < numWorkers; ++i)
+		iterator.workers.push_back(thread(&RBFM_ParallelScanIterator::work, &iterator, i));
+	return SUCC;
+}
+// scan with numThreads workers, each record is given to the sink by the worker that found it
+RC RecordBasedFileManager::parallelScan(FileHandle &fileHandle,
+    const vector<Attribute> &recordDescriptor,
+    const string &conditionAttribute,
+    const CompOp compOp,
+    const void *value,
+    const vector<string> &attributeNames,
+    const unsigned numThreads,
+    const ScanSink &sink) {
+	RBFM_ParallelScanIterator iterator;
+	iterator.sink = sink;
+	RC rc = parallelScan(fileHandle, recordDescriptor, conditionAttribute, compOp,
+			value, attributeNames, numThreads, iterator);
+	if (rc != SUCC)
+		return rc;
+	// nothing is queued, this waits for the workers
+	RID rid;
+	rc = iterator.getNextRecord(rid, NULL);
+	iterator.close();
+	return rc == RBFM_EOF ? SUCC : rc;
+}
+
 /*
  * Iterator
  */
+// value of an attribute a version does not have: 0, 0.0 or the empty string
+static const int defaultValue = 0;
+
 RBFM_ScanIterator::RBFM_ScanIterator() :
-		compOp(NO_OP), value(NULL), totalPageNum(0), conditionType(TypeInt),
-		fHandle(NULL){
+		compOp(NO_OP), value(NULL), totalPageNum(0), prevPageNum(-1),
+		conditionType(TypeInt), fHandle(NULL), page(NULL), zoneMap(NULL), zoneIndex(-1){
 }
 RBFM_ScanIterator::~RBFM_ScanIterator() {
 	if (value != NULL)
 		delete []value;
+	releaseCurrentPage();
+	releaseZoneMap();
+}
+// release the page read by the iterator
+// Note the frame is released by its pointer instead of the file handle,
+// which may be released before the iterator
+void RBFM_ScanIterator::releaseCurrentPage() {
+	if (page != NULL)
+		PagedFileManager::instance()->bufferManager.releaseFrame(page);
+	page = NULL;
+	prevPageNum = -1;
+}
+// release the zone map used for the condition
+void RBFM_ScanIterator::releaseZoneMap() {
+	if (zoneMap != NULL)
+		RecordBasedFileManager::instance()->releaseZoneMap(zoneMap->fileName);
+	zoneMap = NULL;
+	zoneIndex = -1;
 }
 RC RBFM_ScanIterator::getNextRecord(RID &rid, void *data) {
+	unsigned count;
+	return nextRecords((char *)data, UINT_MAX, 1, rid, NULL, count);
+}
+// fill the buffer with the records that qualify from the current and the
+// following pages, as many as fit in the capacity
+RC RBFM_ScanIterator::getNextBatch(void *buffer, unsigned capacity, vector<RID> &rids,
+		unsigned &count) {
+	RID rid;
+	rids.clear();
+	return nextRecords((char *)buffer, capacity, UINT_MAX, rid, &rids, count);
+}
+// copy up to maxRecords records that qualify into data, the scan stops at the
+// first record that does not fit in the capacity and resumes from it
+// rid is the last record copied, all of them are added to rids if it is given
+RC RBFM_ScanIterator::nextRecords(char *data, const unsigned &capacity,
+		const unsigned &maxRecords, RID &rid, vector<RID> *rids, unsigned &count) {
 	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
-	VersionManager *vm = VersionManager::instance();
 	RC rc;
+	unsigned used = 0;
+	count = 0;
 
-	// FileHandle fileHandle;
-	// open file handle
-//	rc = rbfm->openFile(tableName, *fHandle);
-//	if (rc != SUCC) {
-//		cerr << "RBFM_ScanIterator::getNextRecord: open file error " << rc << endl;
-//		return rc;
-//	}
-
-	bool flag_NOT_EOF = true;
-	vector<Attribute> attrs;
-	if(curRid.pageNum >= totalPageNum)
-		flag_NOT_EOF = false;
 	// iterate to each page
-	for (PageNum pageNum = curRid.pageNum;
-			flag_NOT_EOF && pageNum < totalPageNum; ++pageNum) {
-		// read the page
+	for (PageNum pageNum = curRid.pageNum; pageNum < totalPageNum; ++pageNum) {
+		if (fHandle->getSpaceManager()->isSpaceMapPage(pageNum))
+			continue;
+		// the page is not read if its summary cannot meet the condition
+		if (zoneMap != NULL && !zoneMap->mayMatch(pageNum, zoneIndex, compOp, value)) {
+			curRid.pageNum = pageNum + 1, curRid.slotNum = 0;
+			continue;
+		}
+		// read the page in place, the previous one is released
 		if (prevPageNum != pageNum) {
+			releaseCurrentPage();
 			rc = fHandle->readPage(pageNum, page);
 			if (rc != SUCC) {
-				cerr << "RBFM_ScanIterator::getNextRecord: read page error " << rc << endl;
+				page = NULL;
+				cerr << "RBFM_ScanIterator::nextRecords: read page error " << rc << endl;
 				return rc;
 			}
 			prevPageNum = pageNum;
 		}
+		// the page is only read
+		char *curPage = (char *)page;
+		rbfm->setFileLayout(*fHandle);
 		// get the total number slots
-		SlotNum totalSlotNum = rbfm->getNumSlots(page);
-		if (curRid.slotNum + 1 > totalSlotNum &&
-				curRid.pageNum >= totalPageNum - 1)
-			flag_NOT_EOF = false;
-		for (SlotNum slotNum = curRid.slotNum+1;
-				flag_NOT_EOF && slotNum <= totalSlotNum; ++slotNum) {
-			// read the current data
-			rid.pageNum = pageNum;
-			rid.slotNum = slotNum;
-
+		SlotNum totalSlotNum = rbfm->getNumSlots(curPage);
+		// the rows of a PAX page are gone through in the order of their slots,
+		// only the minipages of the condition and the projected attributes are read
+		SlotNum first = curRid.slotNum + 1, last = totalSlotNum;
+		if (rbfm->hasPaxPages()) {
+			paxPage.load(curPage, rbfm->getDataSize(curPage));
+			first = upper_bound(paxPage.rowSlots, paxPage.rowSlots + paxPage.numRows,
+					curRid.slotNum) - paxPage.rowSlots + 1;
+			last = paxPage.numRows;
+		}
+		// the condition values of a fixed minipage are compared a run at a time,
+		// as the rows are met; rows before selectedEnd have their bit in the selection
+		const char *conditionRun = getConditionRun();
+		SlotNum selectedEnd = first - 1;
+		for (SlotNum position = first; position <= last; ++position) {
+			SlotNum slotNum = rbfm->hasPaxPages() ? paxPage.rowSlots[position - 1] : position;
 			//  see if the data is deleted or forwarded by checking its directory
 			SlotDir slotDir;
-			rc = rbfm->getSlotDir(page, slotDir, slotNum);
+			rc = rbfm->getSlotDir(curPage, slotDir, slotNum);
 			if (rc != SUCC) {
-				cerr << "RBFM_ScanIterator::getNextRecord: get slot directory error " << rc << endl;
+				cerr << "RBFM_ScanIterator::nextRecords: get slot directory error " << rc << endl;
 				return rc;
 			}
 			if (slotDir.recordLength == RECORD_DEL || slotDir.recordLength == RECORD_FORWARD)
 				continue;
 
-			rc = rbfm->readRecord(page, *fHandle, attrs, rid, tuple);
-			if (rc != SUCC) {
-				cerr << "RBFM_ScanIterator::getNextRecord: read record error " << rc << endl;
-				return rc;
-			}
-			// get the version number of current data
-			VersionNumber curVer = VersionNumber(*((int *)tuple));
-			// get the current attribute descriptor of  data
-			rc = vm->getAttributes(tableName, attrs, curVer);
+			// the record is read in place, the rows of a PAX page have the version of the page
+			const char *record = NULL;
+			SlotNum row = position - 1;
+			VersionNumber curVer = paxPage.version;
+			if (!rbfm->hasPaxPages()) {
+				record = curPage + slotDir.recordOffset;
+				// get the version number of current data
+				curVer = rbfm->getRecordVersion(record);
+			} else if (slotDir.recordOffset != row)
+				continue;
+			// get the positions of the attributes in the version
+			VersionPlan *plan;
+			rc = getVersionPlan(curVer, plan);
 			if (rc != SUCC) {
-				cerr << "RBFM_ScanIterator::getNextRecord: read attribute error " << rc << endl;
+				cerr << "RBFM_ScanIterator::nextRecords: read attribute error " << rc << endl;
 				return rc;
 			}
 
-			// get the condition value
-			rc = rbfm->readAttribute(page, *fHandle, attrs, rid, conditionName, attrData);
-			if (rc != SUCC) {
-				cerr << "RBFM_ScanIterator::getNextRecord: read attribute value error " << rc << endl;
-				return rc;
-			}
-			// the value meets the requirement, prepare output data
-			if (value == NULL || conditionName.empty() ||
-					compareValue(attrData, conditionType)) {
-				rc = prepareData(page, *fHandle, attrs, rid, data);
-				if (rc != SUCC) {
-					cerr << "RBFM_ScanIterator::getNextRecord: prepare data error " << rc << endl;
-					return rc;
+			// the condition is evaluated on the page, only the records that qualify are copied
+			bool hit = value == NULL || conditionName.empty();
+			if (!hit && conditionRun != NULL) {
+				if (row >= selectedEnd) {
+					selectedEnd = min<unsigned>(row + SCAN_SELECTION_ROWS, paxPage.numRows);
+					selectRows(conditionRun, row / 8 * 8, selectedEnd);
 				}
+				hit = selection[row / 8] & (1 << (row % 8));
+			} else if (!hit) {
+				// get the condition value, the default value if the version does not have it
+				const char *field = (const char *)&defaultValue;
+				unsigned length;
+				getAttribute(record, row, *plan, plan->conditionIndex, field, length);
+				hit = compareValue(field, conditionType);
+			}
+			if (!hit)
+				continue;
 
-				// save the current RID
-				if (totalSlotNum == rid.slotNum){
-					curRid.pageNum = rid.pageNum+1, curRid.slotNum = 0;
-				} else {
-					curRid.pageNum = rid.pageNum, curRid.slotNum = rid.slotNum;
-				}
-				// exit
-//				rc = rbfm->closeFile(fileHandle);
-//				if (rc != SUCC) {
-//					cerr << "RBFM_ScanIterator::getNextRecord: open file error " << rc << endl;
-//					return rc;
-//				}
-				return SUCC;
+			// the value meets the requirement, prepare output data
+			unsigned size;
+			if (!prepareData(record, row, *plan, data + used, capacity - used, size)) {
+				// the record is left for the next call
+				curRid.pageNum = pageNum, curRid.slotNum = slotNum - 1;
+				return count > 0 ? SUCC : SCANITER_BATCH_TOO_SMALL;
 			}
+			used += size;
+			rid.pageNum = pageNum;
+			rid.slotNum = slotNum;
+			if (rids != NULL)
+				rids->push_back(rid);
+			// save the current RID
+			curRid = rid;
+			if (++count >= maxRecords)
+				return SUCC;
 		}
-		if (curRid.slotNum + 1 > totalSlotNum &&
-				curRid.pageNum >= totalPageNum - 1)
-			flag_NOT_EOF = false;
+		// the next page is scanned from its first slot
+		curRid.pageNum = pageNum + 1, curRid.slotNum = 0;
 	}
 
-//	rc = rbfm->closeFile(fileHandle);
-//	if (rc != SUCC) {
-//		cerr << "RBFM_ScanIterator::getNextRecord: open file error " << rc << endl;
-//		return rc;
-//	}
+	// no more pages to read, release the frame
+	releaseCurrentPage();
+	return count > 0 ? SUCC : RBFM_EOF;
+}
 
-	return RBFM_EOF;
+// get the positions of the condition and the projected attributes in a version
+// The descriptor of a version is looked up once per scan
+RC RBFM_ScanIterator::getVersionPlan(const VersionNumber &ver, VersionPlan *&plan) {
+	if (ver >= versionPlans.size())
+		versionPlans.resize(ver + 1);
+	plan = &versionPlans[ver];
+	if (plan->loaded)
+		return SUCC;
 
+	RC rc = VersionManager::instance()->getDescriptor(tableName, plan->descriptor, ver);
+	if (rc != SUCC)
+		return rc;
+	plan->conditionIndex = plan->descriptor->getIndex(conditionName);
+	plan->projectedIndex.resize(projectedName.size());
+	for (int i = 0; i < int(projectedName.size()); ++i)
+		plan->projectedIndex[i] = plan->descriptor->getIndex(projectedName[i]);
+	plan->loaded = true;
+	return SUCC;
+}
+// locate an attribute of a record in place, or of a row in its minipage if record is NULL
+bool RBFM_ScanIterator::getAttribute(const char *record, const SlotNum &row,
+		const VersionPlan &plan, const int &index, const char *&field, unsigned &length) {
+	if (record != NULL)
+		return RecordBasedFileManager::instance()->getRecordAttribute(record,
+				*plan.descriptor, index, field, length);
+	if (index < 0 || index >= int(paxPage.numFields))
+		return false;
+	paxPage.getField(index, row, field, length);
+	return true;
 }
+// prepare the data of a record that qualifies
+// an attribute the version does not have gets the default value
+// nothing is copied if the data takes more than the capacity
+bool RBFM_ScanIterator::prepareData(const char *record, const SlotNum &row,
+		const VersionPlan &plan, void *data, const unsigned &capacity, unsigned &size) {
+	int numProjected = plan.projectedIndex.size();
+	const char *field;
+	unsigned length;
+
+	// the size is found first, so a record is copied whole or not at all
+	size = 0;
+	if (capacity != UINT_MAX) {
+		for (int i = 0; i < numProjected; ++i) {
+			field = (const char *)&defaultValue;
+			length = sizeof(int);
+			getAttribute(record, row, plan, plan.projectedIndex[i], field, length);
+			size += length;
+		}
+		if (size > capacity)
+			return false;
+		size = 0;
+	}
 
-RC RBFM_ScanIterator::prepareData(char *readPage, FileHandle &fileHandle,
-		  const vector<Attribute> &recordDescriptor,
-		  const RID &rid, void *data) {
 	char *returnedData = (char *)data;
-	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
-	RC rc;
-
-	for (int i = 0; i < int(projectedName.size()); ++i) {
-		// get the condition value
-		rc = rbfm->readAttribute(readPage, fileHandle, recordDescriptor,
-				rid, projectedName[i], returnedData);
-		if (rc != SUCC) {
-			cerr << "RBFM_ScanIterator::getNextRecord: read attribute value error " << rc << endl;
-			return rc;
-		}
-		switch(projectedType[i]) {
-		case TypeInt:
-			returnedData += sizeof(int);
-			break;
-		case TypeReal:
-			returnedData += sizeof(float);
-			break;
-		case TypeVarChar:
-			int len = *((int *)returnedData);
-			returnedData += sizeof(int) + len;
-			break;
-		}
+	for (int i = 0; i < numProjected; ++i) {
+		field = (const char *)&defaultValue;
+		length = sizeof(int);
+		getAttribute(record, row, plan, plan.projectedIndex[i], field, length);
+		memcpy(returnedData + size, field, length);
+		size += length;
 	}
-	return SUCC;
+	return true;
+}
+// get the minipage of the condition attribute if its values are compared a run
+// at a time: the page is a PAX page, and the values are ints or reals in an array
+const char *RBFM_ScanIterator::getConditionRun() {
+	if (!RecordBasedFileManager::instance()->hasPaxPages() || paxPage.numRows == 0 ||
+			value == NULL || conditionName.empty() || compOp == NO_OP ||
+			conditionType == TypeVarChar)
+		return NULL;
+	VersionPlan *plan;
+	if (getVersionPlan(paxPage.version, plan) != SUCC)
+		return NULL;
+	int index = plan->conditionIndex;
+	if (index < 0 || index >= int(paxPage.numFields) || paxPage.layouts[index] != PAX_FIXED ||
+			plan->descriptor->attrs[index].type != conditionType)
+		return NULL;
+	return paxPage.columns[index];
+}
+// select the rows [begin, end) of the PAX page with the predicate kernels
+void RBFM_ScanIterator::selectRows(const char *conditionRun, const SlotNum &begin,
+		const SlotNum &end) {
+	selection.resize(SELECTION_BYTES(paxPage.numRows));
+	if (conditionType == TypeInt)
+		selectValues((const int *)conditionRun + begin, end - begin, compOp,
+				*((int *)value), &selection[begin / 8]);
+	else
+		selectValues((const float *)conditionRun + begin, end - begin, compOp,
+				*((float *)value), &selection[begin / 8]);
 }
-// compare the two attribute data
+// compare an attribute value with the value of the condition
+// strings are compared in place, in the order of string::compare
 bool RBFM_ScanIterator::compareValue(const void *record, const AttrType &type) {
 	if (compOp == NO_OP)
 		return true;
-	int lhs_int(0), rhs_int(0), len_lhs(0), len_rhs(0);
+	int lhs_int(0), rhs_int(0), len_lhs(0), len_rhs(0), cmp(0);
 	float lhs_float(0.), rhs_float(0.);
-	char *lhs_cstr(NULL), *rhs_cstr(NULL);
-	string lhs_str, rhs_str;
 	switch(type) {
 	case TypeInt:
 		lhs_int = *((int *)record);
@@ -1108,53 +1621,145 @@ bool RBFM_ScanIterator::compareValue(const void *record, const AttrType &type) {
 	case TypeVarChar:
 		len_lhs = *((int *)record);
 		len_rhs = *((int *)value);
-		lhs_cstr = new char[len_lhs+1];
-		rhs_cstr = new char[len_rhs+1];
-		memcpy(lhs_cstr, (char *)record+sizeof(int), len_lhs);
-		memcpy(rhs_cstr, (char *)value+sizeof(int), len_rhs);
-		lhs_cstr[len_lhs] = '\0';
-		rhs_cstr[len_rhs] = '\0';
-		lhs_str.assign(lhs_cstr);
-		rhs_str.assign(rhs_cstr);
-		delete []lhs_cstr;
-		delete []rhs_cstr;
-		return compareValueTemplate(lhs_str, rhs_str);
+		cmp = memcmp((char *)record + sizeof(int), value + sizeof(int),
+				min(len_lhs, len_rhs));
+		if (cmp == 0)
+			cmp = len_lhs - len_rhs;
+		return compareValueTemplate(cmp, 0);
 		break;
 	}
 	return false;
 }
 
-bool RBFM_ScanIterator::compareString(const string &lhs, const string &rhs) {
-	switch(compOp) {
-	case EQ_OP:
-		return lhs.compare(rhs) == 0;
-		break;
-	case LT_OP:
-		return lhs.compare(rhs) < 0;
-		break;
-	case GT_OP:
-		return lhs.compare(rhs) > 0;
-		break;
-	case LE_OP:
-		return lhs.compare(rhs) <= 0;
-		break;
-	case GE_OP:
-		return lhs.compare(rhs) >= 0;
-		break;
-	case NE_OP:
-		return lhs.compare(rhs) != 0;
-		break;
-	default:
-		return true;
-	}
-	return true;
-}
 RC RBFM_ScanIterator::close() {
 	if (value != NULL)
 		delete []value;
 	value = NULL;
+	releaseCurrentPage();
+	releaseZoneMap();
+	return SUCC;
+}
+// scan the pages [first, end) only, from the first record of the first
+void RBFM_ScanIterator::setPageRange(const PageNum &first, const PageNum &end) {
+	releaseCurrentPage();
+	curRid.pageNum = first;
+	curRid.slotNum = 0;
+	totalPageNum = end;
+}
+
+/*
+ * Parallel scan iterator
+ */
+RBFM_ParallelScanIterator::RBFM_ParallelScanIterator() :
+		compOp(NO_OP), totalPageNum(0), nextPage(0), stopping(false), maxQueued(0),
+		runningWorkers(0), error(SUCC), currentIndex(0) {
+}
+RBFM_ParallelScanIterator::~RBFM_ParallelScanIterator() {
+	close();
+}
+RC RBFM_ParallelScanIterator::getNextRecord(RID &rid, void *data) {
+	// take the next batch, waiting for the workers to fill one
+	while (currentIndex >= current.rids.size()) {
+		unique_lock<mutex> lock(latch);
+		while (queue.empty() && runningWorkers > 0)
+			queueCond.wait(lock);
+		if (queue.empty())
+			return error != SUCC ? error : RBFM_EOF;
+		swap(current, queue.front());
+		queue.pop_front();
+		currentIndex = 0;
+		queueCond.notify_all();
+	}
+	rid = current.rids[currentIndex];
+	unsigned offset = current.offsets[currentIndex];
+	unsigned end = currentIndex + 1 < current.offsets.size() ?
+			current.offsets[currentIndex + 1] : current.data.size();
+	memcpy(data, &current.data[offset], end - offset);
+	++currentIndex;
 	return SUCC;
 }
+// stop the workers and drop the records not read
+RC RBFM_ParallelScanIterator::close() {
+	{
+		lock_guard<mutex> guard(latch);
+		stopping = true;
+		queueCond.notify_all();
+	}
+	for (int i = 0; i < int(workers.size()); ++i)
+		workers[i].join();
+	workers.clear();
+	queue.clear();
+	current = ScanBatch();
+	currentIndex = 0;
+	runningWorkers = 0;
+	return SUCC;
+}
+// the work of each thread, morsel after morsel
+void RBFM_ParallelScanIterator::work(unsigned worker) {
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+	// the handle keeps the read-ahead state of the worker
+	FileHandle fileHandle;
+	RBFM_ScanIterator scanIterator;
+	RC rc = rbfm->openFile(fileName, fileHandle);
+	if (rc == SUCC)
+		rc = rbfm->scan(fileHandle, recordDescriptor, conditionName, compOp,
+				value.empty() ? NULL : &value[0], projectedName, scanIterator);
+
+	vector<char> data(MAX_PAGE_SIZE);
+	ScanBatch batch;
+	RID rid;
+	while (rc == SUCC && !stopping) {
+		PageNum first = nextPage.fetch_add(PARALLEL_SCAN_MORSEL_PAGES);
+		if (first >= totalPageNum)
+			break;
+		scanIterator.setPageRange(first, min(first + PARALLEL_SCAN_MORSEL_PAGES, totalPageNum));
+		while (!stopping && (rc = scanIterator.getNextRecord(rid, &data[0])) == SUCC) {
+			if (sink) {
+				rc = sink(worker, rid, &data[0]);
+				if (rc != SUCC)
+					break;
+				continue;
+			}
+			batch.rids.push_back(rid);
+			batch.offsets.push_back(batch.data.size());
+			unsigned size = rbfm->getRecordSize(&data[0], projectedAttrs);
+			batch.data.insert(batch.data.end(), data.begin(), data.begin() + size);
+			if (batch.rids.size() >= PARALLEL_SCAN_BATCH_RECORDS)
+				pushBatch(batch);
+		}
+		if (rc == RBFM_EOF)
+			rc = SUCC;
+	}
+	if (rc == SUCC && !batch.rids.empty())
+		pushBatch(batch);
+	scanIterator.close();
+	if (fileHandle.fd >= 0)
+		rbfm->closeFile(fileHandle);
+
+	lock_guard<mutex> guard(latch);
+	if (rc != SUCC && error == SUCC) {
+		cerr << "RBFM_ParallelScanIterator: worker " << worker << " error " << rc << endl;
+		error = rc;
+		stopping = true;
+	}
+	--runningWorkers;
+	queueCond.notify_all();
+}
+// queue a batch, waits while the queue is full
+void RBFM_ParallelScanIterator::pushBatch(ScanBatch &batch) {
+	unique_lock<mutex> lock(latch);
+	while (queue.size() >= maxQueued && !stopping)
+		queueCond.wait(lock);
+	if (!stopping) {
+		queue.push_back(ScanBatch());
+		swap(queue.back(), batch);
+		queueCond.notify_all();
+	}
+	batch.rids.clear();
+	batch.offsets.clear();
+	batch.data.clear();
+}
+
 /*
  * Tools
  */
@@ -1229,117 +1834,1109 @@ unsigned RecordBasedFileManager::getRecordSize(
 			break;
 		}
 	}
-	return recordSize;
+	return recordSize;
+}
+// get the record as stored in the page, the size is returned
+// Note the record with field offsets is built in recordContent
+unsigned RecordBasedFileManager::getStoredRecord(const void *data,
+		const vector<Attribute> &recordDescriptor, const char *&record) {
+	unsigned dataSize = getRecordSize(data, recordDescriptor);
+	record = (const char *)data;
+	if (!fieldOffsets)
+		return dataSize;
+
+	FieldOffset numFields = recordDescriptor.size();
+	unsigned headerSize = sizeof(FieldOffset) * (numFields + 1) + (numFields + 7) / 8;
+	// a record too big for the page is not built, the caller rejects it
+	if (headerSize + dataSize > pageSize)
+		return headerSize + dataSize;
+	// the number of fields and the end of each field
+	memcpy(recordContent, &numFields, sizeof(FieldOffset));
+	FieldOffset *ends = (FieldOffset *)(recordContent + sizeof(FieldOffset));
+	FieldOffset end = headerSize;
+	for (int i = 0; i < int(numFields); ++i) {
+		switch(recordDescriptor[i].type) {
+		case TypeInt:
+			end += sizeof(int);
+			break;
+		case TypeReal:
+			end += sizeof(float);
+			break;
+		case TypeVarChar:
+			end += sizeof(int) + *((int *)((char *)data + end - headerSize));
+			break;
+		}
+		ends[i] = end;
+	}
+	// the API format has no nulls, so the bitmap starts clear
+	memset(ends + numFields, 0, (numFields + 7) / 8);
+	memcpy(recordContent + headerSize, data, dataSize);
+	record = recordContent;
+	return headerSize + dataSize;
+}
+// translate a stored record to the API format
+void RecordBasedFileManager::getRecordData(const char *record, unsigned recordSize,
+		void *data) {
+	if (!fieldOffsets) {
+		memcpy(data, record, recordSize);
+		return;
+	}
+	FieldOffset numFields = *((FieldOffset *)record);
+	unsigned headerSize = sizeof(FieldOffset) * (numFields + 1) + (numFields + 7) / 8;
+	// the values follow the header as they are
+	memcpy(data, record + headerSize, recordSize - headerSize);
+}
+// locate the i'th field of a record with FILE_FIELD_OFFSETS, false if it is null or missing
+// Note a record written before an attribute was added has fewer fields
+bool RecordBasedFileManager::getRecordField(const char *record, unsigned index,
+		const char *&field, unsigned &length) {
+	FieldOffset numFields = *((FieldOffset *)record);
+	if (index >= numFields)
+		return false;
+	const FieldOffset *ends = (const FieldOffset *)(record + sizeof(FieldOffset));
+	const unsigned char *nulls = (const unsigned char *)(ends + numFields);
+	if (nulls[index / 8] & (1 << (index % 8)))
+		return false;
+	FieldOffset start = index == 0 ? (const char *)(nulls + (numFields + 7) / 8) - record :
+			ends[index - 1];
+	field = record + start;
+	length = ends[index] - start;
+	return true;
+}
+// locate the index'th attribute of a stored record in place, given the
+// descriptor of its version; false if the record does not have it
+bool RecordBasedFileManager::getRecordAttribute(const char *record,
+		const vector<Attribute> &recordDescriptor, int index,
+		const char *&field, unsigned &length) {
+	if (index < 0 || index >= int(recordDescriptor.size()))
+		return false;
+	// locate the field by its offset
+	if (fieldOffsets)
+		return getRecordField(record, index, field, length);
+
+	// go through the fields before the attribute
+	unsigned offset = 0;
+	for (int i = 0; i < index; ++i) {
+		switch(recordDescriptor[i].type) {
+		case TypeInt:
+			offset += sizeof(int);
+			break;
+		case TypeReal:
+			offset += sizeof(float);
+			break;
+		case TypeVarChar:
+			offset += *((int *)(record + offset)) + sizeof(int);
+			break;
+		}
+	}
+	field = record + offset;
+	switch(recordDescriptor[index].type) {
+	case TypeInt:
+		length = sizeof(int);
+		break;
+	case TypeReal:
+		length = sizeof(float);
+		break;
+	case TypeVarChar:
+		length = *((int *)field) + sizeof(int);
+		break;
+	}
+	return true;
+}
+// the same with the compiled descriptor, whose fixed offsets save going through the fields
+bool RecordBasedFileManager::getRecordAttribute(const char *record,
+		const VersionDescriptor &descriptor, int index,
+		const char *&field, unsigned &length) {
+	if (index < 0 || index >= int(descriptor.attrs.size()))
+		return false;
+	if (fieldOffsets || descriptor.fixedOffsets[index] < 0)
+		return getRecordAttribute(record, descriptor.attrs, index, field, length);
+	field = record + descriptor.fixedOffsets[index];
+	length = descriptor.attrs[index].type == TypeVarChar ?
+			*((int *)field) + sizeof(int) : sizeof(int);
+	return true;
+}
+// read an attribute of a stored record, given the descriptor of its version
+// the size of the value written to data is returned
+unsigned RecordBasedFileManager::readRecordAttribute(const char *record,
+		const vector<Attribute> &recordDescriptor, const string &attributeName,
+		void *data) {
+	int index = 0;
+	while (index < int(recordDescriptor.size()) &&
+			recordDescriptor[index].name != attributeName)
+		++index;
+
+	const char *field;
+	unsigned length;
+	if (!getRecordAttribute(record, recordDescriptor, index, field, length)) {
+		// no such attribute found
+		// return a default value
+		// the default value for Varchar is (int)0NULL
+		// the default value for Int is (int)0
+		// the default value for Real is (float)0.0
+		int defaultVal = 0;
+		memcpy(data, &defaultVal, sizeof(int));
+		return sizeof(int);
+	}
+	memcpy(data, field, length);
+	return length;
+}
+// get the version of a stored record, kept in its first field
+VersionNumber RecordBasedFileManager::getRecordVersion(const char *record) {
+	const char *field;
+	unsigned length;
+	if (!fieldOffsets)
+		return *((VersionNumber *)record);
+	if (!getRecordField(record, 0, field, length))
+		return 0;
+	return *((VersionNumber *)field);
+}
+// Create an empty page
+void RecordBasedFileManager::setPageEmpty(void *page) {
+	// set the page to be zeros
+	memset(page, 0, pageSize);
+	// set the free space point to the start of the page
+	setFreeSpaceStartPoint(page, page);
+	// set number of slots as zero
+	setNumSlots(page, 0);
+}
+// get the size of a record
+unsigned RecordBasedFileManager::getRecordDirectorySize(const vector<Attribute> &recordDescriptor,
+		unsigned &recordSize){
+	unsigned len(0);
+	recordSize = 0;
+	for (int i = 0; i < int(recordDescriptor.size()); ++i) {
+		recordSize += recordDescriptor[i].length;
+		len += recordDescriptor[i].length + sizeof(FieldOffset); // add one more offset
+	}
+	return len + sizeof(FieldAddress) + sizeof(SlotDir); // add address and SlotDir
+}
+// get the free space start point
+void * RecordBasedFileManager::getFreeSpaceStartPoint(void *page) {
+	char *p = (char *)page + pageSize - sizeof(FieldAddress);
+	FieldAddress addr = *(FieldAddress *)(p);
+	return (char *)page + addr;
+}
+void RecordBasedFileManager::setFreeSpaceStartPoint(void *page, void *startPoint) {
+	FieldAddress addr = (FieldAddress)(startPoint) - (FieldAddress)(page);
+	char *p = (char *)page + pageSize - sizeof(FieldAddress);
+	memcpy(p, &addr, sizeof(FieldAddress));
+}
+// calculate the size of free space
+// Note this free space does NOT include the SLOT DIRECTORY
+int RecordBasedFileManager::getFreeSpaceSize(void *page) {
+	char *beg = (char *)page + pageSize - sizeof(FieldAddress);
+	FieldAddress addr_beg = *((FieldAddress *)(beg));
+	int space = pageSize - addr_beg;
+	space = space - getNumSlots(page) * sizeof(SlotDir) - sizeof(SlotNum) - sizeof(FieldAddress);
+	return space;
+}
+unsigned RecordBasedFileManager::getEmptySpaceSize() {
+	return pageSize - sizeof(SlotNum) - sizeof(FieldAddress);
+}
+// get/set the number of slots
+SlotNum RecordBasedFileManager::getNumSlots(void *page) {
+	char *p = (char *)page + pageSize - sizeof(FieldAddress) - sizeof(SlotNum);
+	return *((SlotNum *)p);
+}
+// get next available num slots
+SlotNum RecordBasedFileManager::getNextAvailableSlot(void *page, SlotNum first) {
+	SlotNum totalNumSLots = getNumSlots(page);
+	SlotDir slotDir;
+	for (SlotNum slot = first; slot <= totalNumSLots; ++slot) {
+		getSlotDir(page, slotDir, slot);
+		if (slotDir.recordLength == RECORD_DEL) {
+			return slot;
+		}
+	}
+	return totalNumSLots+1;
+}
+RC RecordBasedFileManager::setNumSlots(void *page, SlotNum num) {
+	int freeSpace = getFreeSpaceSize(page);
+	unsigned infoLen = sizeof(SlotDir);
+	if (freeSpace < infoLen)
+		return RECORD_NOT_ENOUGH_SPACE_FOR_MORE_SLOTS;
+	char *p = (char *)page + pageSize - sizeof(FieldAddress) - sizeof(SlotNum);
+	memcpy(p, &num, sizeof(SlotNum));
+	return SUCC;
+}
+
+// get directory of nth slot
+RC RecordBasedFileManager::getSlotDir(void *page, SlotDir &slotDir, const SlotNum &nth) {
+	if (nth > getNumSlots(page))
+		return RECORD_OVERFLOW;
+	char *nthSlotDir =  (char *)(page) + pageSize -
+			sizeof(FieldAddress) - sizeof(SlotNum) - (nth)*sizeof(SlotDir);
+	memcpy(&slotDir, nthSlotDir, sizeof(SlotDir));
+	return SUCC;
+}
+// set directory of nth slot
+RC RecordBasedFileManager::setSlotDir(void *page, const SlotDir &slotDir, const SlotNum &nth) {
+	if (nth > getNumSlots(page)) {
+		return RECORD_OVERFLOW;
+	}
+	char *nthSlotDir =  (char *)(page) + pageSize -
+				sizeof(FieldAddress) - sizeof(SlotNum) - (nth)*sizeof(SlotDir);
+	memcpy(nthSlotDir, &slotDir, sizeof(SlotDir));
+	return SUCC;
+}
+// get the forwarded page number and slot id
+void RecordBasedFileManager::getForwardRID(RID &rid, const FieldAddress &offset) {
+	// Note the size of a page num is sizeof(unsigned)
+	char *data = (char *)&offset;
+	memcpy(&(rid.pageNum), data, sizeof(unsigned));
+	data += sizeof(unsigned);
+	memcpy(&(rid.slotNum), data, sizeof(unsigned));
+}
+// set the forwarded page number and slot id
+void RecordBasedFileManager::setForwardRID(const RID &rid, FieldAddress &offset) {
+	char *offset2Filled = (char *)(&offset);
+	memcpy(offset2Filled, &(rid.pageNum), sizeof(unsigned));
+	offset2Filled += sizeof(unsigned);
+	memcpy(offset2Filled, &(rid.slotNum), sizeof(unsigned));
+}
+
+// get the bytes taken by the records of a page from its start
+unsigned RecordBasedFileManager::getDataSize(const void *page) {
+	return (char *)getFreeSpaceStartPoint((void *)page) - (const char *)page;
+}
+// get the stored record of a slot, in place or built from the minipages of a PAX page
+// Note the record of a PAX page is built in paxRecord
+const char *RecordBasedFileManager::getRecord(const char *page, const SlotDir &slotDir) {
+	if (!paxPages)
+		return page + slotDir.recordOffset;
+	PaxPage paxPage;
+	paxPage.load(page, getDataSize(page));
+	FieldOffset numFields = paxPage.numFields;
+	unsigned headerSize = sizeof(FieldOffset) * (numFields + 1) + (numFields + 7) / 8;
+	memcpy(paxRecord, &numFields, sizeof(FieldOffset));
+	FieldOffset *ends = (FieldOffset *)(paxRecord + sizeof(FieldOffset));
+	memset(ends + numFields, 0, (numFields + 7) / 8);
+	FieldOffset end = headerSize;
+	for (int i = 0; i < int(numFields); ++i) {
+		const char *value;
+		unsigned length;
+		paxPage.getField(i, slotDir.recordOffset, value, length);
+		memcpy(paxRecord + end, value, length);
+		end += length;
+		ends[i] = end;
+	}
+	return paxRecord;
+}
+// get the space a stored record takes on a page with its slot directory
+// A PAX row takes its slot and its values, the start of a value that is not
+// 4 bytes; the header and the alignment of the minipages are left to the page
+unsigned RecordBasedFileManager::getRecordSpace(const char *record,
+		const unsigned &recordSize) {
+	if (!paxPages)
+		return recordSize + sizeof(SlotDir);
+	unsigned space = sizeof(SlotNum) + sizeof(SlotDir);
+	FieldOffset numFields = *(const FieldOffset *)record;
+	for (unsigned i = 0; i < numFields; ++i) {
+		const char *value;
+		unsigned length = 0;
+		getRecordField(record, i, value, length);
+		space += length == sizeof(int) ? length : sizeof(FieldOffset) + length;
+	}
+	return space;
+}
+// get the rows of a PAX page left with the record in the slot, the next free one
+// unless it replaces the row of slotNum; RECORD_PAGE_MISMATCH if the rows have another format
+// Note a NULL record leaves the rows of the page that are not deleted or forwarded
+RC RecordBasedFileManager::getPaxRows(const char *page, const char *record,
+		SlotNum &slotNum, const bool &replace, PaxPage &source, vector<PaxRow> &rows,
+		SlotNum &numSlots) {
+	source.load(page, getDataSize(page));
+	numSlots = getNumSlots((void *)page);
+	if (record != NULL && !replace) {
+		slotNum = getNextAvailableSlot((void *)page, slotNum);
+		numSlots = max(numSlots, slotNum);
+	}
+
+	rows.clear();
+	for (SlotNum row = 0; row < source.numRows; ++row) {
+		SlotDir slotDir;
+		getSlotDir((void *)page, slotDir, source.rowSlots[row]);
+		if (slotDir.recordLength == RECORD_DEL || slotDir.recordLength == RECORD_FORWARD ||
+				slotDir.recordOffset != row || (replace && source.rowSlots[row] == slotNum))
+			continue;
+		PaxRow paxRow;
+		paxRow.slot = source.rowSlots[row];
+		paxRow.record = NULL;
+		paxRow.row = row;
+		rows.push_back(paxRow);
+	}
+	if (record == NULL)
+		return SUCC;
+	// the rows of a page have one version and the same fields
+	if (!rows.empty() && (*(const FieldOffset *)record != source.numFields ||
+			getRecordVersion(record) != source.version))
+		return RECORD_PAGE_MISMATCH;
+
+	// the rows stay in the order of their slots
+	PaxRow paxRow;
+	paxRow.slot = slotNum;
+	paxRow.record = record;
+	paxRow.row = 0;
+	vector<PaxRow>::iterator itr = rows.begin();
+	while (itr != rows.end() && itr->slot < slotNum)
+		++itr;
+	rows.insert(itr, paxRow);
+	return SUCC;
+}
+// locate a value of a row to write to a PAX page
+void RecordBasedFileManager::getPaxValue(const PaxPage &source, const PaxRow &row,
+		const unsigned &field, const char *&value, unsigned &length) {
+	if (row.record == NULL) {
+		source.getField(field, row.row, value, length);
+		return;
+	}
+	// the API format has no nulls, a field a record lacks is 0
+	if (!getRecordField(row.record, field, value, length)) {
+		value = (const char *)&defaultValue;
+		length = sizeof(int);
+	}
+}
+// get the bytes the rows take on a PAX page, and the layout of each field
+// A field is kept in an array if all its values take 4 bytes
+unsigned RecordBasedFileManager::getPaxPageSize(const PaxPage &source,
+		const vector<PaxRow> &rows, vector<char> &layouts) {
+	if (rows.empty())
+		return 0;
+	FieldOffset numFields = rows[0].record == NULL ? source.numFields :
+			*(const FieldOffset *)rows[0].record;
+	layouts.assign(numFields, PAX_FIXED);
+	unsigned size = PaxPage::align(PAX_HEADER_SIZE + numFields);
+	size = PaxPage::align(size + rows.size() * sizeof(SlotNum));
+	for (unsigned i = 0; i < numFields; ++i) {
+		unsigned total = 0;
+		for (unsigned j = 0; j < rows.size(); ++j) {
+			const char *value;
+			unsigned length;
+			getPaxValue(source, rows[j], i, value, length);
+			if (length != sizeof(int))
+				layouts[i] = PAX_VARIABLE;
+			total += length;
+		}
+		if (layouts[i] == PAX_VARIABLE)
+			total += PaxPage::align(sizeof(FieldOffset) * (rows.size() + 1));
+		size = PaxPage::align(size + total);
+	}
+	return size;
+}
+// rewrite the data of a PAX page with the rows, false if they do not fit
+// The page is built in paxContent, so the rows may come from the page itself
+bool RecordBasedFileManager::writePaxPage(char *page, const PaxPage &source,
+		const vector<PaxRow> &rows, const SlotNum &numSlots) {
+	vector<char> layouts;
+	unsigned dataSize = getPaxPageSize(source, rows, layouts);
+	if (dataSize + numSlots * sizeof(SlotDir) > getEmptySpaceSize())
+		return false;
+
+	FieldOffset numFields = layouts.size();
+	SlotNum numRows = rows.size();
+	vector<unsigned> recordSizes(numRows,
+			sizeof(FieldOffset) * (numFields + 1) + (numFields + 7) / 8);
+	if (numRows > 0) {
+		// the header and the slot of each row
+		VersionNumber version = rows[0].record == NULL ? source.version :
+				getRecordVersion(rows[0].record);
+		memcpy(paxContent, &numRows, sizeof(SlotNum));
+		memcpy(paxContent + sizeof(SlotNum), &numFields, sizeof(FieldOffset));
+		memcpy(paxContent + sizeof(SlotNum) + sizeof(FieldOffset), &version,
+				sizeof(VersionNumber));
+		memcpy(paxContent + PAX_HEADER_SIZE, &layouts[0], numFields);
+		unsigned offset = PaxPage::align(PAX_HEADER_SIZE + numFields);
+		SlotNum *rowSlots = (SlotNum *)(paxContent + offset);
+		for (SlotNum j = 0; j < numRows; ++j)
+			rowSlots[j] = rows[j].slot;
+		offset = PaxPage::align(offset + numRows * sizeof(SlotNum));
+
+		// a minipage for each field
+		for (unsigned i = 0; i < numFields; ++i) {
+			char *column = paxContent + offset;
+			FieldOffset *starts = (FieldOffset *)column;
+			FieldOffset end = layouts[i] == PAX_FIXED ? 0 :
+					PaxPage::align(sizeof(FieldOffset) * (numRows + 1));
+			for (SlotNum j = 0; j < numRows; ++j) {
+				const char *value;
+				unsigned length;
+				getPaxValue(source, rows[j], i, value, length);
+				if (layouts[i] == PAX_VARIABLE)
+					starts[j] = end;
+				memcpy(column + end, value, length);
+				end += length;
+				recordSizes[j] += length;
+			}
+			if (layouts[i] == PAX_VARIABLE)
+				starts[numRows] = end;
+			offset = PaxPage::align(offset + end);
+		}
+	}
+	memcpy(page, paxContent, dataSize);
+	setFreeSpaceStartPoint(page, page + dataSize);
+	if (numSlots != getNumSlots(page))
+		setNumSlots(page, numSlots);
+	// the slots of the rows point to them, the others are left as they are
+	for (SlotNum j = 0; j < numRows; ++j) {
+		SlotDir slotDir;
+		slotDir.recordOffset = j;
+		slotDir.recordLength = recordSizes[j];
+		setSlotDir(page, slotDir, rows[j].slot);
+	}
+	return true;
+}
+// place a stored record on a PAX page, added or in place of the row of slotNum
+RC RecordBasedFileManager::placePaxRecord(char *page, const char *record,
+		SlotNum &slotNum, const bool &replace) {
+	PaxPage source;
+	vector<PaxRow> rows;
+	SlotNum numSlots;
+	RC rc = getPaxRows(page, record, slotNum, replace, source, rows, numSlots);
+	if (rc != SUCC)
+		return rc;
+	if (!writePaxPage(page, source, rows, numSlots))
+		return RECORD_PAGE_FULL;
+	return SUCC;
+}
+
+/*
+ *		PAX pages
+ */
+// read the header of a page whose rows take dataSize bytes
+void PaxPage::load(const char *page, const unsigned &dataSize) {
+	columns.clear();
+	if (dataSize == 0) {
+		numRows = 0;
+		numFields = 0;
+		return;
+	}
+	memcpy(&numRows, page, sizeof(SlotNum));
+	memcpy(&numFields, page + sizeof(SlotNum), sizeof(FieldOffset));
+	memcpy(&version, page + sizeof(SlotNum) + sizeof(FieldOffset), sizeof(VersionNumber));
+	layouts = page + PAX_HEADER_SIZE;
+	unsigned offset = align(PAX_HEADER_SIZE + numFields);
+	rowSlots = (const SlotNum *)(page + offset);
+	offset = align(offset + numRows * sizeof(SlotNum));
+	// the minipages follow one another
+	columns.resize(numFields);
+	for (int i = 0; i < int(numFields); ++i) {
+		columns[i] = page + offset;
+		if (layouts[i] == PAX_FIXED)
+			offset = align(offset + numRows * sizeof(int));
+		else
+			offset = align(offset + ((const FieldOffset *)columns[i])[numRows]);
+	}
+}
+
+/*
+ *		Predicate kernels
+ */
+template <CompOp op, typename T>
+static inline bool meetsCondition(const T &lhs, const T &rhs) {
+	switch (op) {
+	case EQ_OP:
+		return lhs == rhs;
+	case LT_OP:
+		return lhs < rhs;
+	case GT_OP:
+		return lhs > rhs;
+	case LE_OP:
+		return lhs <= rhs;
+	case GE_OP:
+		return lhs >= rhs;
+	case NE_OP:
+		return lhs != rhs;
+	default:
+		return true;
+	}
+}
+// select the values from begin on, a multiple of 8, one at a time
+template <CompOp op, typename T>
+static unsigned selectScalar(const T *values, const unsigned &begin, const unsigned &count,
+		const T &constant, unsigned char *selection) {
+	unsigned hits = 0;
+	for (unsigned i = begin; i < count; i += 8) {
+		unsigned mask = 0;
+		for (unsigned j = 0; j < 8 && i + j < count; ++j)
+			mask |= unsigned(meetsCondition<op>(values[i + j], constant)) << j;
+		selection[i / 8] = mask;
+		hits += __builtin_popcount(mask);
+	}
+	return hits;
+}
+#ifdef SELECT_SSE2
+// the lanes of 4 values that meet the condition, as a mask
+template <CompOp op>
+static inline unsigned maskLanes(const int *values, const __m128i &constant) {
+	__m128i lhs = _mm_loadu_si128((const __m128i *)values);
+	switch (op) {
+	case EQ_OP:
+		return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(lhs, constant)));
+	case LT_OP:
+		return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(lhs, constant)));
+	case GT_OP:
+		return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(lhs, constant)));
+	case LE_OP:
+		return ~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(lhs, constant))) & 0xf;
+	case GE_OP:
+		return ~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(lhs, constant))) & 0xf;
+	case NE_OP:
+		return ~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(lhs, constant))) & 0xf;
+	default:
+		return 0xf;
+	}
+}
+template <CompOp op>
+static inline unsigned maskLanes(const float *values, const __m128 &constant) {
+	__m128 lhs = _mm_loadu_ps(values);
+	switch (op) {
+	case EQ_OP:
+		return _mm_movemask_ps(_mm_cmpeq_ps(lhs, constant));
+	case LT_OP:
+		return _mm_movemask_ps(_mm_cmplt_ps(lhs, constant));
+	case GT_OP:
+		return _mm_movemask_ps(_mm_cmpgt_ps(lhs, constant));
+	case LE_OP:
+		return _mm_movemask_ps(_mm_cmple_ps(lhs, constant));
+	case GE_OP:
+		return _mm_movemask_ps(_mm_cmpge_ps(lhs, constant));
+	case NE_OP:
+		return _mm_movemask_ps(_mm_cmpneq_ps(lhs, constant));
+	default:
+		return 0xf;
+	}
 }
-// Create an empty page
-void RecordBasedFileManager::setPageEmpty(void *page) {
-	// set the page to be zeros
-	memset(page, 0, PAGE_SIZE);
-	// set the free space point to the start of the page
-	setFreeSpaceStartPoint(page, page);
-	// set number of slots as zero
-	setNumSlots(page, 0);
+static inline __m128i broadcast(const int &value) {
+	return _mm_set1_epi32(value);
 }
-// get the size of a record
-unsigned RecordBasedFileManager::getRecordDirectorySize(const vector<Attribute> &recordDescriptor,
-		unsigned &recordSize){
-	unsigned len(0);
-	recordSize = 0;
-	for (int i = 0; i < int(recordDescriptor.size()); ++i) {
-		recordSize += recordDescriptor[i].length;
-		len += recordDescriptor[i].length + sizeof(FieldOffset); // add one more offset
+static inline __m128 broadcast(const float &value) {
+	return _mm_set1_ps(value);
+}
+// select 16 values at a time
+template <CompOp op, typename T>
+static unsigned selectSse2(const T *values, const unsigned &count,
+		const T &constant, unsigned char *selection) {
+	auto rhs = broadcast(constant);
+	unsigned hits = 0, i = 0;
+	for (; i + 16 <= count; i += 16) {
+		unsigned mask = maskLanes<op>(values + i, rhs) |
+				maskLanes<op>(values + i + 4, rhs) << 4 |
+				maskLanes<op>(values + i + 8, rhs) << 8 |
+				maskLanes<op>(values + i + 12, rhs) << 12;
+		selection[i / 8] = mask;
+		selection[i / 8 + 1] = mask >> 8;
+		hits += __builtin_popcount(mask);
+	}
+	return hits + selectScalar<op>(values, i, count, constant, selection);
+}
+#endif
+#ifdef SELECT_AVX2
+// the lanes of 8 values that meet the condition, as a mask
+template <CompOp op>
+__attribute__((target("avx2")))
+static inline unsigned maskLanes8(const int *values, const __m256i &constant) {
+	__m256i lhs = _mm256_loadu_si256((const __m256i *)values);
+	switch (op) {
+	case EQ_OP:
+		return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(lhs, constant)));
+	case LT_OP:
+		return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(constant, lhs)));
+	case GT_OP:
+		return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(lhs, constant)));
+	case LE_OP:
+		return ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(lhs, constant))) & 0xff;
+	case GE_OP:
+		return ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(constant, lhs))) & 0xff;
+	case NE_OP:
+		return ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(lhs, constant))) & 0xff;
+	default:
+		return 0xff;
 	}
-	return len + sizeof(FieldAddress) + sizeof(SlotDir); // add address and SlotDir
 }
-// get the free space start point
-void * RecordBasedFileManager::getFreeSpaceStartPoint(void *page) {
-	char *p = (char *)page + PAGE_SIZE - sizeof(FieldAddress);
-	FieldAddress addr = *(FieldAddress *)(p);
-	return (char *)page + addr;
+template <CompOp op>
+__attribute__((target("avx2")))
+static inline unsigned maskLanes8(const float *values, const __m256 &constant) {
+	__m256 lhs = _mm256_loadu_ps(values);
+	switch (op) {
+	case EQ_OP:
+		return _mm256_movemask_ps(_mm256_cmp_ps(lhs, constant, _CMP_EQ_OQ));
+	case LT_OP:
+		return _mm256_movemask_ps(_mm256_cmp_ps(lhs, constant, _CMP_LT_OQ));
+	case GT_OP:
+		return _mm256_movemask_ps(_mm256_cmp_ps(lhs, constant, _CMP_GT_OQ));
+	case LE_OP:
+		return _mm256_movemask_ps(_mm256_cmp_ps(lhs, constant, _CMP_LE_OQ));
+	case GE_OP:
+		return _mm256_movemask_ps(_mm256_cmp_ps(lhs, constant, _CMP_GE_OQ));
+	case NE_OP:
+		return _mm256_movemask_ps(_mm256_cmp_ps(lhs, constant, _CMP_NEQ_UQ));
+	default:
+		return 0xff;
+	}
 }
-void RecordBasedFileManager::setFreeSpaceStartPoint(void *page, void *startPoint) {
-	FieldAddress addr = (FieldAddress)(startPoint) - (FieldAddress)(page);
-	char *p = (char *)page + PAGE_SIZE - sizeof(FieldAddress);
-	memcpy(p, &addr, sizeof(FieldAddress));
+__attribute__((target("avx2")))
+static inline __m256i broadcast8(const int &value) {
+	return _mm256_set1_epi32(value);
 }
-// calculate the size of free space
-// Note this free space does NOT include the SLOT DIRECTORY
-int RecordBasedFileManager::getFreeSpaceSize(void *page) {
-	char *beg = (char *)page + PAGE_SIZE - sizeof(FieldAddress);
-	FieldAddress addr_beg = *((FieldAddress *)(beg));
-	int space = PAGE_SIZE - addr_beg;
-	space = space - getNumSlots(page) * sizeof(SlotDir) - sizeof(SlotNum) - sizeof(FieldAddress);
-	return space;
+__attribute__((target("avx2")))
+static inline __m256 broadcast8(const float &value) {
+	return _mm256_set1_ps(value);
 }
-unsigned RecordBasedFileManager::getEmptySpaceSize() {
-	return PAGE_SIZE - sizeof(SlotNum) - sizeof(FieldAddress);
+// select 32 values at a time
+template <CompOp op, typename T>
+__attribute__((target("avx2")))
+static unsigned selectAvx2(const T *values, const unsigned &count,
+		const T &constant, unsigned char *selection) {
+	auto rhs = broadcast8(constant);
+	unsigned hits = 0, i = 0;
+	for (; i + 32 <= count; i += 32) {
+		unsigned mask = maskLanes8<op>(values + i, rhs) |
+				maskLanes8<op>(values + i + 8, rhs) << 8 |
+				maskLanes8<op>(values + i + 16, rhs) << 16 |
+				maskLanes8<op>(values + i + 24, rhs) << 24;
+		for (unsigned j = 0; j < 4; ++j)
+			selection[i / 8 + j] = mask >> (8 * j);
+		hits += __builtin_popcount(mask);
+	}
+	return hits + selectScalar<op>(values, i, count, constant, selection);
 }
-// get/set the number of slots
-SlotNum RecordBasedFileManager::getNumSlots(void *page) {
-	char *p = (char *)page + PAGE_SIZE - sizeof(FieldAddress) - sizeof(SlotNum);
-	return *((SlotNum *)p);
+#endif
+template <CompOp op, typename T>
+static unsigned selectRun(const T *values, const unsigned &count,
+		const T &constant, unsigned char *selection) {
+#ifdef SELECT_AVX2
+	static const bool avx2 = __builtin_cpu_supports("avx2");
+	if (avx2)
+		return selectAvx2<op>(values, count, constant, selection);
+#endif
+#ifdef SELECT_SSE2
+	return selectSse2<op>(values, count, constant, selection);
+#else
+	return selectScalar<op>(values, 0, count, constant, selection);
+#endif
 }
-// get next available num slots
-SlotNum RecordBasedFileManager::getNextAvailableSlot(void *page) {
-	SlotNum totalNumSLots = getNumSlots(page);
-	SlotDir slotDir;
-	for (SlotNum slot = 1; slot <= totalNumSLots; ++slot) {
-		getSlotDir(page, slotDir, slot);
-		if (slotDir.recordLength == RECORD_DEL) {
-			return slot;
+template <typename T>
+static unsigned selectRun(const T *values, const unsigned &count, const CompOp &compOp,
+		const T &constant, unsigned char *selection) {
+	switch (compOp) {
+	case EQ_OP:
+		return selectRun<EQ_OP>(values, count, constant, selection);
+	case LT_OP:
+		return selectRun<LT_OP>(values, count, constant, selection);
+	case GT_OP:
+		return selectRun<GT_OP>(values, count, constant, selection);
+	case LE_OP:
+		return selectRun<LE_OP>(values, count, constant, selection);
+	case GE_OP:
+		return selectRun<GE_OP>(values, count, constant, selection);
+	case NE_OP:
+		return selectRun<NE_OP>(values, count, constant, selection);
+	default:
+		return selectScalar<NO_OP>(values, 0, count, constant, selection);
+	}
+}
+unsigned selectValues(const int *values, const unsigned &count, const CompOp &compOp,
+		const int &constant, unsigned char *selection) {
+	return selectRun(values, count, compOp, constant, selection);
+}
+unsigned selectValues(const float *values, const unsigned &count, const CompOp &compOp,
+		const float &constant, unsigned char *selection) {
+	return selectRun(values, count, compOp, constant, selection);
+}
+
+/*
+ *		Zone maps
+ */
+ZoneMap::ZoneMap(const string &fileName) : fileName(fileName), refCount(0),
+		numAttrs(0), entrySize(0), entriesPerPage(0), changed(false) {
+}
+ZoneMap::~ZoneMap() {
+	RC rc = sync();
+	if (rc != SUCC)
+		cerr << "ZoneMap: cannot write the zone map " << rc << endl;
+	if (fileHandle.fd >= 0)
+		PagedFileManager::instance()->closeFile(fileHandle);
+}
+// where page 0 keeps whether it is marked changed, after the attributes
+#define ZONE_CHANGED_OFFSET (sizeof(unsigned) + ZONE_MAX_ATTRS * sizeof(ZoneAttr))
+// open the side file and load the summaries
+RC ZoneMap::open() {
+	string zoneFileName = fileName + ZONE_FILE_SUFFIX;
+	RC rc = PagedFileManager::instance()->openFile(zoneFileName.c_str(), fileHandle);
+	if (rc != SUCC)
+		return rc;
+	unsigned numPages = fileHandle.getNumberOfPages();
+	pages.assign((size_t)numPages * PAGE_SIZE, 0);
+	for (PageNum i = 0; i < numPages; ++i) {
+		rc = fileHandle.readPage(i, &pages[(size_t)i * PAGE_SIZE]);
+		if (rc != SUCC)
+			return rc;
+	}
+	// page 0 lists the attributes
+	if (numPages > 0) {
+		memcpy(&numAttrs, &pages[0], sizeof(unsigned));
+		if (numAttrs > ZONE_MAX_ATTRS)
+			return FILE_STREAM_FAILURE;
+		memcpy(attrs, &pages[sizeof(unsigned)], numAttrs * sizeof(ZoneAttr));
+		memcpy(&changed, &pages[ZONE_CHANGED_OFFSET], sizeof(bool));
+		entrySize = ZONE_KEY_SIZE * (1 + 2 * numAttrs);
+		entriesPerPage = PAGE_SIZE / entrySize;
+	}
+	// the last user did not sync, the data pages may hold records not summarized
+	for (PageNum i = 1; changed && numAttrs > 0 && i < numPages; ++i) {
+		for (unsigned j = 0; j < entriesPerPage; ++j)
+			pages[(size_t)i * PAGE_SIZE + j * entrySize] = ZONE_UNKNOWN;
+		dirtyPages.insert(i);
+	}
+	return SUCC;
+}
+// get the index of an attribute, -1 if it is not kept or kept with another type
+// The empty pages are still skipped by an attribute no longer summarized
+int ZoneMap::getIndex(const string &attributeName, const AttrType &type) {
+	lock_guard<mutex> guard(latch);
+	for (int i = 0; i < int(numAttrs); ++i) {
+		if (attributeName == attrs[i].name)
+			return attrs[i].type == type || attrs[i].type == ZONE_NOT_SUMMARIZED ? i : -1;
+	}
+	return -1;
+}
+// widen the summary of a data page with a record in the API format
+// Note the attributes the record does not have are summarized as 0, as scans read them
+RC ZoneMap::addRecord(const PageNum &pageNum, const vector<Attribute> &recordDescriptor,
+		const void *data) {
+	static const int defaultValue = 0;
+	lock_guard<mutex> guard(latch);
+	bool headerChanged = false;
+	bool firstRecord = numAttrs == 0;
+	if (firstRecord) {
+		// the attributes are taken from the first record
+		for (int i = 0; i < int(recordDescriptor.size()) && numAttrs < ZONE_MAX_ATTRS; ++i) {
+			if (recordDescriptor[i].name.length() >= MAX_ATTR_LEN)
+				continue;
+			strcpy(attrs[numAttrs].name, recordDescriptor[i].name.c_str());
+			attrs[numAttrs].type = recordDescriptor[i].type;
+			++numAttrs;
+		}
+		if (numAttrs == 0)
+			return SUCC;
+		entrySize = ZONE_KEY_SIZE * (1 + 2 * numAttrs);
+		entriesPerPage = PAGE_SIZE / entrySize;
+		headerChanged = true;
+	}
+
+	// locate the summarized attributes in the record, the first of a name is the one read
+	const char *fields[ZONE_MAX_ATTRS];
+	for (int j = 0; j < int(numAttrs); ++j)
+		fields[j] = NULL;
+	const char *field = (const char *)data;
+	for (int i = 0; i < int(recordDescriptor.size()); ++i) {
+		for (int j = 0; j < int(numAttrs); ++j) {
+			if (fields[j] != NULL || recordDescriptor[i].name != attrs[j].name)
+				continue;
+			fields[j] = field;
+			if (attrs[j].type != ZONE_NOT_SUMMARIZED && attrs[j].type != recordDescriptor[i].type) {
+				attrs[j].type = ZONE_NOT_SUMMARIZED;
+				headerChanged = true;
+			}
 		}
+		field += recordDescriptor[i].type == TypeVarChar ?
+				sizeof(int) + *((const int *)field) : sizeof(int);
 	}
-	return totalNumSLots+1;
+	if (headerChanged) {
+		putHeader();
+		dirtyPages.insert(0);
+	}
+	// the attributes are written with the mark
+	RC rc = beginChange();
+	if (rc != SUCC)
+		return rc;
+	if (firstRecord) {
+		// no record is summarized yet, so the data pages up to this one are empty
+		for (PageNum i = 0; i <= pageNum; ++i) {
+			getEntry(i, true)[0] = ZONE_EMPTY;
+			dirtyPages.insert(1 + i / entriesPerPage);
+		}
+	}
+
+	// widen the entry, the page is written only if it changed
+	char *entry = getEntry(pageNum, true);
+	if (entry[0] == ZONE_UNKNOWN)
+		return SUCC;
+	char before[ZONE_KEY_SIZE * (1 + 2 * ZONE_MAX_ATTRS)];
+	memcpy(before, entry, entrySize);
+	bool empty = entry[0] == ZONE_EMPTY;
+	entry[0] = ZONE_SUMMARIZED;
+	char key[ZONE_KEY_SIZE];
+	for (int j = 0; j < int(numAttrs); ++j) {
+		if (attrs[j].type == ZONE_NOT_SUMMARIZED)
+			continue;
+		makeKey(attrs[j].type, fields[j] != NULL ? fields[j] : (const char *)&defaultValue, key);
+		char *keys = entry + ZONE_KEY_SIZE * (1 + 2 * j);
+		if (empty) {
+			memcpy(keys, key, ZONE_KEY_SIZE);
+			memcpy(keys + ZONE_KEY_SIZE, key, ZONE_KEY_SIZE);
+		} else {
+			widen(attrs[j].type, keys, key);
+		}
+	}
+	if (memcmp(before, entry, entrySize) != 0)
+		dirtyPages.insert(1 + pageNum / entriesPerPage);
+	return SUCC;
 }
-RC RecordBasedFileManager::setNumSlots(void *page, SlotNum num) {
-	unsigned freeSpace = getFreeSpaceSize(page);
-	unsigned infoLen = sizeof(SlotDir);
-	if (freeSpace < infoLen)
-		return RECORD_NOT_ENOUGH_SPACE_FOR_MORE_SLOTS;
-	char *p = (char *)page + PAGE_SIZE - sizeof(FieldAddress) - sizeof(SlotNum);
-	memcpy(p, &num, sizeof(SlotNum));
+// stop summarizing an attribute, its old values no longer tell what scans read
+RC ZoneMap::dropAttribute(const string &attributeName) {
+	lock_guard<mutex> guard(latch);
+	for (int i = 0; i < int(numAttrs); ++i) {
+		if (attributeName != attrs[i].name || attrs[i].type == ZONE_NOT_SUMMARIZED)
+			continue;
+		attrs[i].type = ZONE_NOT_SUMMARIZED;
+		putHeader();
+		dirtyPages.insert(0);
+		return beginChange();
+	}
 	return SUCC;
 }
+// whether a data page may hold a record whose attribute meets the condition
+// Varchars are compared by their prefixes, so the bounds of a string
+// condition are taken as inclusive
+bool ZoneMap::mayMatch(const PageNum &pageNum, const int &index, const CompOp &compOp,
+		const void *value) {
+	lock_guard<mutex> guard(latch);
+	if (index < 0 || index >= int(numAttrs))
+		return true;
+	// only a page known to be empty is skipped without its summary
+	char *entry = getEntry(pageNum, false);
+	if (entry == NULL || entry[0] == ZONE_UNKNOWN)
+		return true;
+	if (entry[0] == ZONE_EMPTY)
+		return false;
+	if (attrs[index].type == ZONE_NOT_SUMMARIZED)
+		return true;
 
-// get directory of nth slot
-RC RecordBasedFileManager::getSlotDir(void *page, SlotDir &slotDir, const SlotNum &nth) {
-	if (nth > getNumSlots(page))
-		return RECORD_OVERFLOW;
-	char *nthSlotDir =  (char *)(page) + PAGE_SIZE -
-			sizeof(FieldAddress) - sizeof(SlotNum) - (nth)*sizeof(SlotDir);
-	memcpy(&slotDir, nthSlotDir, sizeof(SlotDir));
+	int type = attrs[index].type;
+	char key[ZONE_KEY_SIZE];
+	makeKey(type, (const char *)value, key);
+	const char *keys = entry + ZONE_KEY_SIZE * (1 + 2 * index);
+	int cmpMin = compareKey(type, key, keys);
+	int cmpMax = compareKey(type, key, keys + ZONE_KEY_SIZE);
+	bool prefix = type == TypeVarChar;
+	switch(compOp) {
+	case EQ_OP:
+		return cmpMin >= 0 && cmpMax <= 0;
+	case LT_OP:
+		return prefix ? cmpMin >= 0 : cmpMin > 0;
+	case LE_OP:
+		return cmpMin >= 0;
+	case GT_OP:
+		return prefix ? cmpMax <= 0 : cmpMax < 0;
+	case GE_OP:
+		return cmpMax <= 0;
+	case NE_OP:
+		return prefix || cmpMin != 0 || cmpMax != 0;
+	default:
+		return true;
+	}
+}
+// get/set the summary of a page, empty if the page holds no records
+// The summary of a page past the side file is unknown
+void ZoneMap::getSummary(const PageNum &pageNum, vector<char> &summary) {
+	lock_guard<mutex> guard(latch);
+	char *entry = getEntry(pageNum, false);
+	if (entry == NULL)
+		summary.assign(entrySize, ZONE_UNKNOWN);
+	else if (entry[0] == ZONE_EMPTY)
+		summary.clear();
+	else
+		summary.assign(entry, entry + entrySize);
+}
+RC ZoneMap::setSummary(const PageNum &pageNum, const vector<char> &summary) {
+	lock_guard<mutex> guard(latch);
+	if (numAttrs == 0)
+		return SUCC;
+	RC rc = beginChange();
+	if (rc != SUCC)
+		return rc;
+	char *entry = getEntry(pageNum, true);
+	if (summary.empty()) {
+		memset(entry, 0, entrySize);
+		entry[0] = ZONE_EMPTY;
+	} else {
+		memcpy(entry, &summary[0], entrySize);
+	}
+	dirtyPages.insert(1 + pageNum / entriesPerPage);
 	return SUCC;
 }
-// set directory of nth slot
-RC RecordBasedFileManager::setSlotDir(void *page, const SlotDir &slotDir, const SlotNum &nth) {
-	if (nth > getNumSlots(page)) {
-		return RECORD_OVERFLOW;
+// merge a summary into another, an unknown one makes it unknown
+void ZoneMap::mergeSummary(vector<char> &summary, const vector<char> &other) {
+	lock_guard<mutex> guard(latch);
+	if (other.empty())
+		return;
+	if (summary.empty()) {
+		summary = other;
+		return;
+	}
+	if (summary[0] == ZONE_UNKNOWN || other[0] == ZONE_UNKNOWN) {
+		summary[0] = ZONE_UNKNOWN;
+		return;
+	}
+	for (int j = 0; j < int(numAttrs); ++j) {
+		if (attrs[j].type == ZONE_NOT_SUMMARIZED)
+			continue;
+		char *keys = &summary[ZONE_KEY_SIZE * (1 + 2 * j)];
+		const char *otherKeys = &other[ZONE_KEY_SIZE * (1 + 2 * j)];
+		widen(attrs[j].type, keys, otherKeys);
+		widen(attrs[j].type, keys, otherKeys + ZONE_KEY_SIZE);
+	}
+}
+// forget the summaries, the numPages data pages are empty
+RC ZoneMap::clear(const PageNum &numPages) {
+	lock_guard<mutex> guard(latch);
+	if (numAttrs == 0)
+		return SUCC;
+	RC rc = beginChange();
+	if (rc != SUCC)
+		return rc;
+	PageNum numEntries = max(numPages, PageNum(pages.size() / PAGE_SIZE - 1) * entriesPerPage);
+	for (PageNum i = 0; i < numEntries; ++i) {
+		char *entry = getEntry(i, true);
+		memset(entry, 0, entrySize);
+		entry[0] = ZONE_EMPTY;
+		dirtyPages.insert(1 + i / entriesPerPage);
 	}
-	char *nthSlotDir =  (char *)(page) + PAGE_SIZE -
-				sizeof(FieldAddress) - sizeof(SlotNum) - (nth)*sizeof(SlotDir);
-	memcpy(nthSlotDir, &slotDir, sizeof(SlotDir));
 	return SUCC;
 }
-// get the forwarded page number and slot id
-void RecordBasedFileManager::getForwardRID(RID &rid, const FieldAddress &offset) {
-	// Note the size of a page num is sizeof(unsigned)
-	char *data = (char *)&offset;
-	memcpy(&(rid.pageNum), data, sizeof(unsigned));
-	data += sizeof(unsigned);
-	memcpy(&(rid.slotNum), data, sizeof(unsigned));
+// mark the side file changed before data pages are written
+RC ZoneMap::markChanged() {
+	lock_guard<mutex> guard(latch);
+	if (numAttrs == 0)
+		return SUCC;
+	return beginChange();
 }
-// set the forwarded page number and slot id
-void RecordBasedFileManager::setForwardRID(const RID &rid, FieldAddress &offset) {
-	char *offset2Filled = (char *)(&offset);
-	memcpy(offset2Filled, &(rid.pageNum), sizeof(unsigned));
-	offset2Filled += sizeof(unsigned);
-	memcpy(offset2Filled, &(rid.slotNum), sizeof(unsigned));
+// write the pages of the side file changed since the last sync, page 0 last
+// The summaries go to the disk before the mark is cleared
+RC ZoneMap::sync() {
+	lock_guard<mutex> guard(latch);
+	if (dirtyPages.empty() && !changed)
+		return SUCC;
+	RC rc;
+	for (set<PageNum>::iterator itr = dirtyPages.begin(); itr != dirtyPages.end(); ++itr) {
+		if (*itr == 0)
+			continue;
+		rc = writeZonePage(*itr);
+		if (rc != SUCC)
+			return rc;
+	}
+	rc = PagedFileManager::instance()->bufferManager.flushFile(fileHandle.fileName);
+	if (rc != SUCC)
+		return rc;
+	changed = false;
+	putHeader();
+	rc = writeZonePage(0);
+	if (rc != SUCC) {
+		changed = true;
+		return rc;
+	}
+	dirtyPages.clear();
+	return SUCC;
+}
+// write page 0 marked changed, once until the next sync
+// It reaches the disk before the data pages depending on it
+RC ZoneMap::beginChange() {
+	if (changed)
+		return SUCC;
+	changed = true;
+	putHeader();
+	RC rc = writeZonePage(0);
+	if (rc != SUCC) {
+		changed = false;
+		return rc;
+	}
+	return SUCC;
+}
+// copy the attributes and the mark into page 0
+void ZoneMap::putHeader() {
+	if (pages.size() < PAGE_SIZE)
+		pages.resize(PAGE_SIZE, 0);
+	memcpy(&pages[0], &numAttrs, sizeof(unsigned));
+	memcpy(&pages[sizeof(unsigned)], attrs, numAttrs * sizeof(ZoneAttr));
+	memcpy(&pages[ZONE_CHANGED_OFFSET], &changed, sizeof(bool));
+}
+// write a page of the side file to the disk, the pages up to it are appended
+RC ZoneMap::writeZonePage(const PageNum &zonePage) {
+	RC rc;
+	if (zonePage < fileHandle.getNumberOfPages()) {
+		rc = fileHandle.writePage(zonePage, &pages[(size_t)zonePage * PAGE_SIZE]);
+	} else {
+		rc = SUCC;
+		while (rc == SUCC && fileHandle.getNumberOfPages() <= zonePage)
+			rc = fileHandle.appendPage(&pages[(size_t)fileHandle.getNumberOfPages() * PAGE_SIZE]);
+	}
+	if (rc != SUCC)
+		return rc;
+	// a deferred write is not left to the buffer pool
+	rc = PagedFileManager::instance()->bufferManager.flushPage(fileHandle.fileName, zonePage);
+	return rc == BUFFER_FILE_NOT_HIT || rc == BUFFER_PAGENUM_NOT_HIT ? SUCC : rc;
 }
 
+// get the entry of a data page, NULL if it is past the side file and not extended
+char *ZoneMap::getEntry(const PageNum &pageNum, bool extend) {
+	if (numAttrs == 0)
+		return NULL;
+	size_t zonePage = 1 + pageNum / entriesPerPage;
+	if ((zonePage + 1) * PAGE_SIZE > pages.size()) {
+		if (!extend)
+			return NULL;
+		pages.resize((zonePage + 1) * PAGE_SIZE, 0);
+	}
+	return &pages[zonePage * PAGE_SIZE + (pageNum % entriesPerPage) * entrySize];
+}
+// make the key of a value, a varchar is cut to its prefix
+void ZoneMap::makeKey(const int &type, const char *value, char *key) {
+	memset(key, 0, ZONE_KEY_SIZE);
+	if (type == TypeVarChar)
+		memcpy(key, value + sizeof(int), min(*((const int *)value), ZONE_KEY_SIZE));
+	else
+		memcpy(key, value, sizeof(int));
+}
+int ZoneMap::compareKey(const int &type, const char *lhs, const char *rhs) {
+	switch(type) {
+	case TypeInt:
+		return *((const int *)lhs) < *((const int *)rhs) ? -1 :
+				*((const int *)lhs) > *((const int *)rhs) ? 1 : 0;
+	case TypeReal:
+		return *((const float *)lhs) < *((const float *)rhs) ? -1 :
+				*((const float *)lhs) > *((const float *)rhs) ? 1 : 0;
+	default:
+		return memcmp(lhs, rhs, ZONE_KEY_SIZE);
+	}
+}
+// widen the min and the max kept at entryKeys with a key
+void ZoneMap::widen(const int &type, char *entryKeys, const char *key) {
+	if (compareKey(type, key, entryKeys) < 0)
+		memcpy(entryKeys, key, ZONE_KEY_SIZE);
+	if (compareKey(type, key, entryKeys + ZONE_KEY_SIZE) > 0)
+		memcpy(entryKeys + ZONE_KEY_SIZE, key, ZONE_KEY_SIZE);
+}
 
 /*
  *		Middleware: Version Manager
  */
+// compile the descriptor of a version
+// Note the first attribute of a name is the one found, as readAttribute did
+VersionDescriptor::VersionDescriptor(const vector<Attribute> &attributes) :
+		attrs(attributes), fixedOffsets(attributes.size(), -1) {
+	int offset = 0;
+	for (int i = 0; i < int(attrs.size()); ++i) {
+		attrIndex.insert(make_pair(attrs[i].name, i));
+		fixedOffsets[i] = offset;
+		if (attrs[i].type == TypeVarChar)
+			varcharIndex.push_back(i);
+		if (offset >= 0)
+			offset = attrs[i].type == TypeVarChar ? -1 : offset + sizeof(int);
+	}
+}
+
 VersionManager::VersionManager() {
 	createAttrRecordDescriptor(recordAttributeDescriptor);
 }
@@ -1353,6 +2950,7 @@ VersionManager* VersionManager::instance() {
 // open up a Table
 RC VersionManager::initTableVersionInfo(const string &tableName,
 		FileHandle &fileHandle) {
+	lock_guard<recursive_mutex> guard(latch);
 	RC rc;
 	vector<Attribute> attrs;
 	VersionInfoFrame verInfoFrame;
@@ -1422,10 +3020,13 @@ RC VersionManager::initTableVersionInfo(const string &tableName,
 	}
 	// insert the history attributes to the attribute map
 	attrMap[tableName] = recordDescriptorArray;
+	descriptorMap.erase(tableName);
+	translationMap.erase(tableName);
 	return SUCC;
 }
 
 RC VersionManager::loadTable(const string &tableName) {
+	lock_guard<recursive_mutex> guard(latch);
 	FileHandle fileHandle;
 	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
 	RC rc;
@@ -1450,6 +3051,7 @@ RC VersionManager::loadTable(const string &tableName) {
 // get version number publicly
 RC VersionManager::getVersionNumber(const string &tableName,
 		VersionNumber &ver) {
+	lock_guard<recursive_mutex> guard(latch);
 	VersionMap::iterator itr = versionMap.find(tableName);
 	if(itr == versionMap.end()) {
 		if (loadTable(tableName) != SUCC)
@@ -1467,6 +3069,7 @@ RC VersionManager::getVersionNumber(const string &tableName,
 // Note that once load a table, the history attributes are cached
 RC VersionManager::getAttributes(const string &tableName, vector<Attribute> &attrs,
 		const VersionNumber ver) {
+	lock_guard<recursive_mutex> guard(latch);
 	AttrMap::iterator itr = attrMap.find(tableName);
 
 	if (itr == attrMap.end()) {
@@ -1482,9 +3085,52 @@ RC VersionManager::getAttributes(const string &tableName, vector<Attribute> &att
 
 	return SUCC;
 }
+// get the compiled descriptor of a version, shared instead of copied
+// Note the descriptors of a table are dropped when it changes, the ones
+// handed out stay valid with their holders
+RC VersionManager::getDescriptor(const string &tableName,
+		VersionDescriptorPtr &descriptor, const VersionNumber ver) {
+	lock_guard<recursive_mutex> guard(latch);
+	AttrMap::iterator itr = attrMap.find(tableName);
+
+	if (itr == attrMap.end()) {
+		if (loadTable(tableName) != SUCC)
+			return VERSION_TABLE_NOT_FOUND;
+		else {
+			itr = attrMap.find(tableName);
+		}
+	}
+
+	vector<RecordDescriptor> &recordDescriptorArray = itr->second;
+	if (ver >= recordDescriptorArray.size())
+		return VERSION_OVERFLOW;
+	vector<VersionDescriptorPtr> &descriptors = descriptorMap[tableName];
+	if (descriptors.size() < recordDescriptorArray.size())
+		descriptors.resize(recordDescriptorArray.size());
+	if (!descriptors[ver])
+		descriptors[ver] = make_shared<VersionDescriptor>(recordDescriptorArray[ver]);
+	descriptor = descriptors[ver];
+
+	return SUCC;
+}
+// stop summarizing an attribute of a file keeping zone maps
+// The records scanned by the name after the change are not the ones summarized
+static RC dropZoneAttribute(FileHandle &fileHandle, const string &attributeName) {
+	if (!(fileHandle.getFlags() & FILE_ZONE_MAPS))
+		return SUCC;
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+	ZoneMap *zoneMap;
+	RC rc = rbfm->acquireZoneMap(fileHandle.fileName, zoneMap);
+	if (rc != SUCC)
+		return rc;
+	rc = zoneMap->dropAttribute(attributeName);
+	rbfm->releaseZoneMap(fileHandle.fileName);
+	return rc;
+}
 // add an attribute
 RC VersionManager::addAttribute(const string &tableName,
 		const Attribute &attr, FileHandle &fileHandle) {
+	lock_guard<recursive_mutex> guard(latch);
 	AttrMap::iterator itr = attrMap.find(tableName);
 	VersionMap::iterator itr_1 = versionMap.find(tableName);
 	if (itr == attrMap.end() ||
@@ -1518,6 +3164,11 @@ RC VersionManager::addAttribute(const string &tableName,
 	verInfoFrame.name[attr.name.length()] = '\0';
 	verInfoFrame.verChangeAction = ADD_ATTRIBUTE;
 	verInfoFrame.AttrColumn = recordDescriptor.size();
+	rc = dropZoneAttribute(fileHandle, attr.name);
+	if (rc != SUCC) {
+		cerr << "add attribute: zone map error." << rc << endl;
+		return rc;
+	}
 	// save the frame to the page
 	set_ithVersionInfo(page, currentVersion, verInfoFrame);
 	// update the version number
@@ -1533,6 +3184,8 @@ RC VersionManager::addAttribute(const string &tableName,
 
 	// update record descriptor
 	recordDescriptorArray.push_back(recordDescriptor);
+	descriptorMap.erase(tableName);
+	translationMap.erase(tableName);
 	recordDescriptorArray[currentVersion].push_back(attr);
 
 	// save the attribute changes to the page
@@ -1547,6 +3200,7 @@ RC VersionManager::addAttribute(const string &tableName,
 // drop an attribute
 RC VersionManager::dropAttribute(const string &tableName,
 		const string &attributeName, FileHandle &fileHandle) {
+	lock_guard<recursive_mutex> guard(latch);
 	AttrMap::iterator itr = attrMap.find(tableName);
 	VersionMap::iterator itr_1 = versionMap.find(tableName);
 	if (itr == attrMap.end() ||
@@ -1591,6 +3245,11 @@ RC VersionManager::dropAttribute(const string &tableName,
 	verInfoFrame.name[recordDescriptor[deleteIndex].name.length()] = '\0';
 	verInfoFrame.verChangeAction = DROP_ATTRIBUTE;
 	verInfoFrame.AttrColumn = deleteIndex;
+	rc = dropZoneAttribute(fileHandle, attributeName);
+	if (rc != SUCC) {
+		cerr << "drop attribute: zone map error." << rc << endl;
+		return rc;
+	}
 	// save the frame to the page
 	set_ithVersionInfo(page, currentVersion, verInfoFrame);
 	// update the version number
@@ -1607,6 +3266,8 @@ RC VersionManager::dropAttribute(const string &tableName,
 	// update record descriptor
 	recordDescriptor.erase(deleteItr);
 	recordDescriptorArray.push_back(recordDescriptor);
+	descriptorMap.erase(tableName);
+	translationMap.erase(tableName);
 
 	// save the attribute changes to the page
 	rc = resetAttributePages(recordDescriptorArray[currentVersion], fileHandle);
@@ -1622,6 +3283,7 @@ RC VersionManager::dropAttribute(const string &tableName,
 RC VersionManager::translateData2LastedVersion(const string &tableName,
 		const VersionNumber &currentVersion,
 		const void *oldData, void *latestData) {
+	lock_guard<recursive_mutex> guard(latch);
 	AttrMap::iterator itrAttr = attrMap.find(tableName);
 	VersionMap::iterator itrVer = versionMap.find(tableName);
 	if (itrAttr == attrMap.end() ||
@@ -1639,8 +3301,8 @@ RC VersionManager::translateData2LastedVersion(const string &tableName,
 	}
 
 	// get the attribute of the old data
-	vector<Attribute> oldAttrs;
-	RC rc = getAttributes(tableName, oldAttrs, currentVersion);
+	VersionDescriptorPtr oldDescriptor;
+	RC rc = getDescriptor(tableName, oldDescriptor, currentVersion);
 	if (rc != SUCC) {
 		cerr << "translateData2LastedVersion: get attribute " << rc << endl;
 		return rc;
@@ -1650,112 +3312,40 @@ RC VersionManager::translateData2LastedVersion(const string &tableName,
 	// copy and return
 	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
 	if (currentVersion == itrVer->second) {
-		unsigned oldDataSize = rbfm->getRecordSize(oldData, oldAttrs);
+		unsigned oldDataSize = rbfm->getRecordSize(oldData, oldDescriptor->attrs);
 		memcpy(latestData, oldData, oldDataSize);
 		return SUCC;
 	}
 
-	// if not, need to load the first page to get the version history
-	FileHandle fileHandle;
-	rc = rbfm->openFile(tableName, fileHandle);
-	if (rc != SUCC) {
-		cerr << "translateData2LastedVersion: open file " << rc << endl;
-		return rc;
-	}
-	// load page 0
-	rc = fileHandle.readPage(0, page);
-	if (rc != SUCC) {
-		cerr << "translateData2LastedVersion: load page 0 " << rc << endl;
-		return rc;
-	}
-	VersionInfoFrame verInfoFrame;
-	vector<Attribute> latestAttrs;
-	rc = getAttributes(tableName, latestAttrs, itrVer->second);
-	if (rc != SUCC) {
-		cerr << "translateData2LastedVersion: get attribute 2 " << rc << endl;
-		return rc;
-	}
-	// initial change log,
-	// if it is 'n', stop;
-	// it it is 'a', add default;
-	// if it is 'r', original real; if it is 'i', original int; if it is 'v', original varchar;
-	// if it is 'R', delete real; if it is 'I', delete int; if it is 'V', delete varchar;
-	vector<int> historyChangeLog(oldAttrs.size() + latestAttrs.size(), 'n');
-	for (int i = 0; i < int(oldAttrs.size()); ++i) {
-		switch(oldAttrs[i].type) {
-		case TypeInt:
-			historyChangeLog[i] = 'i';
-			break;
-		case TypeVarChar:
-			historyChangeLog[i] = 'v';
-			break;
-		case TypeReal:
-			historyChangeLog[i] = 'r';
-			break;
-		}
-	}
-	for (VersionNumber ver = currentVersion; ver < itrVer->second; ++ver) {
-		// get the change log of the version
-		get_ithVersionInfo(page, ver, verInfoFrame);
-		if (verInfoFrame.verChangeAction == ADD_ATTRIBUTE) {
-			// if an attribute is added
-			// the attribute is added to the tail
-			historyChangeLog[verInfoFrame.AttrColumn] = 'a';
-		} else {
-			// if the attribute is dropped
-			switch(verInfoFrame.attrType) {
-			case TypeInt:
-				historyChangeLog[verInfoFrame.AttrColumn] = 'I';
-				break;
-			case TypeVarChar:
-				historyChangeLog[verInfoFrame.AttrColumn] = 'V';
-				break;
-			case TypeReal:
-				historyChangeLog[verInfoFrame.AttrColumn] = 'R';
-				break;
-			}
-		}
+	// the plan is compiled once per old version and shared
+	vector<TranslationPlanPtr> &plans = translationMap[tableName];
+	if (plans.size() <= currentVersion)
+		plans.resize(currentVersion + 1);
+	if (!plans[currentVersion]) {
+		TranslationPlan *plan = new TranslationPlan();
+		compileTranslation(itrAttr->second, currentVersion, itrVer->second, *plan);
+		plans[currentVersion].reset(plan);
 	}
+	const TranslationPlan &plan = *plans[currentVersion];
 
-	// restore data to latest version with help of history change log
+	// restore data to latest version by running the plan
 	char *dest = (char *)latestData;
-	char *src = (char *)oldData;
-	int defaultVal = 0;
+	const char *src = (const char *)oldData;
 	int len = 0;
-	for (int i = 0; i < int(historyChangeLog.size()); ++i) {
-		if (historyChangeLog[i] == 'n') // reach the end quit
-			break;
-		switch(historyChangeLog[i]) {
-		case 'i':
-			memcpy(dest, src, sizeof(int));
-			dest += sizeof(int);
-			src += sizeof(int);
-			break;
-		case 'r':
-			memcpy(dest, src, sizeof(float));
-			dest += sizeof(float);
-			src += sizeof(float);
-			break;
-		case 'v':
-			len = *((int *)src) + sizeof(int);
-			memcpy(dest, src,  len);
+	for (const TranslationStep &step : plan) {
+		len = step.length >= 0 ? step.length : *((const int *)src) + sizeof(int);
+		switch(step.op) {
+		case TRANSLATE_COPY:
+			memcpy(dest, src, len);
 			dest += len;
 			src += len;
 			break;
-		case 'a':
-			memcpy(dest, &defaultVal, sizeof(int));
-			dest += sizeof(int);
-			src += sizeof(int);
-			break;
-		case 'R':
-			src += sizeof(float);
-			break;
-		case 'V':
-			len = *((int *)src) + sizeof(int);
+		case TRANSLATE_SKIP:
 			src += len;
 			break;
-		case 'I':
-			src += sizeof(int);
+		case TRANSLATE_DEFAULT:
+			memset(dest, 0, len);
+			dest += len;
 			break;
 		}
 	}
@@ -1764,7 +3354,53 @@ RC VersionManager::translateData2LastedVersion(const string &tableName,
 
 }
 
+// compile the translation plan of a version to the latest version
+// Note an added attribute goes to the tail and a dropped one keeps the order of the rest,
+// so the plan copies or skips the old fields in order and then fills the added ones
+void VersionManager::compileTranslation(const vector<RecordDescriptor> &recordDescriptorArray,
+		const VersionNumber ver, const VersionNumber latestVer, TranslationPlan &plan) {
+	const RecordDescriptor &oldAttrs = recordDescriptorArray[ver];
+	// the old field each latest field comes from, -1 for an added one
+	vector<int> source(oldAttrs.size());
+	for (int i = 0; i < int(source.size()); ++i)
+		source[i] = i;
+	for (VersionNumber v = ver; v < latestVer; ++v) {
+		const RecordDescriptor &cur = recordDescriptorArray[v];
+		const RecordDescriptor &next = recordDescriptorArray[v + 1];
+		if (next.size() > cur.size()) {
+			source.push_back(-1);
+			continue;
+		}
+		// the dropped attribute is the first one that differs
+		int col = 0;
+		while (col < int(next.size()) && next[col].name == cur[col].name &&
+				next[col].type == cur[col].type)
+			++col;
+		source.erase(source.begin() + col);
+	}
+
+	// append a step, runs of fixed-size fields are merged
+	auto addStep = [&plan](char op, int length) {
+		if (length >= 0 && !plan.empty() && plan.back().op == op && plan.back().length >= 0)
+			plan.back().length += length;
+		else
+			plan.push_back(TranslationStep{op, length});
+	};
+	int next = 0;
+	for (int i = 0; i < int(oldAttrs.size()); ++i) {
+		int length = oldAttrs[i].type == TypeVarChar ? -1 : sizeof(int);
+		bool kept = next < int(source.size()) && source[next] == i;
+		addStep(kept ? TRANSLATE_COPY : TRANSLATE_SKIP, length);
+		if (kept)
+			++next;
+	}
+	// an added attribute starts as 0, or an empty varchar
+	for (; next < int(source.size()); ++next)
+		addStep(TRANSLATE_DEFAULT, sizeof(int));
+}
+
 void VersionManager::eraseTableVersionInfo(const string &tableName) {
+	lock_guard<recursive_mutex> guard(latch);
 	AttrMap::iterator itr = attrMap.find(tableName);
 	if (itr != attrMap.end()) {
 		attrMap.erase(itr);
@@ -1773,13 +3409,19 @@ void VersionManager::eraseTableVersionInfo(const string &tableName) {
 	if (itr_1 != versionMap.end()) {
 		versionMap.erase(itr_1);
 	}
+	descriptorMap.erase(tableName);
+	translationMap.erase(tableName);
 }
 void VersionManager::eraseAllInfo() {
+	lock_guard<recursive_mutex> guard(latch);
 	attrMap.clear();
-	attrMap.clear();
+	versionMap.clear();
+	descriptorMap.clear();
+	translationMap.clear();
 }
 
 void VersionManager::printAttributes(const string &tableName) {
+	lock_guard<recursive_mutex> guard(latch);
 	AttrMap::iterator itrMap = attrMap.find(tableName);
 	if (itrMap == attrMap.end()) {
 		cout << "Table cannot be found!" << endl;
@@ -1853,6 +3495,7 @@ void VersionManager::set_ithVersionInfo(void *page, VersionNumber ver,
 RC VersionManager::formatFirst2Page(const string &tableName,
 		const vector<Attribute> &attrs,
 		FileHandle &fileHandle) {
+	lock_guard<recursive_mutex> guard(latch);
 	/*
 	 * In first page:
 	 * - current version
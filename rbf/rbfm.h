@@ -6,6 +6,11 @@
 #include <sstream>
 #include <vector>
 #include <list>
+#include <memory>
+#include <set>
+#include <atomic>
+#include <functional>
+#include <climits>
 
 #include "../rbf/pfm.h"
 
@@ -14,11 +19,16 @@ using namespace std;
 // define a bunch of types
 typedef unsigned short FieldOffset;
 typedef unsigned short SlotNum;
+// define char as version
+typedef unsigned VersionNumber;
 
 // define return code for record manager
 #define RECORD_FILE_HANDLE_NOT_FOUND 1000
 #define RECORD_OVERFLOW 1001
 #define RECORD_NOT_ENOUGH_SPACE_FOR_MORE_SLOTS 1002
+#define RECORD_NOT_DATA_PAGE 1003
+#define RECORD_PAGE_FULL 1004
+#define RECORD_PAGE_MISMATCH 1005
 
 
 // Record ID
@@ -38,6 +48,17 @@ const unsigned RECORD_FORWARD = -2;
 #define RC_RECORD_DELETED 40
 #define RC_RECORD_FORWARDED 41
 
+// Record format, kept in the user flags of the file header
+// A record starts with its number of fields, the end offset of each field from
+// the start of the record and a null bitmap, then the values follow as in the
+// API format, so any field is located in constant time. The files without the
+// flag keep the values alone.
+#define FILE_FIELD_OFFSETS 0x10000
+// Zone maps, kept in the user flags of the file header, see ZoneMap
+#define FILE_ZONE_MAPS 0x20000
+// PAX data pages, kept in the user flags of the file header, see PaxPage
+#define FILE_PAX_PAGES 0x40000
+
 
 // Attribute
 typedef enum { TypeInt = 0, TypeReal, TypeVarChar } AttrType;
@@ -60,6 +81,90 @@ typedef enum { EQ_OP = 0,  // =
            NO_OP       // no condition
 } CompOp;
 
+/*
+ * Predicate kernels
+ * Compare a run of count int or real values with a constant, and set bit i % 8
+ * of byte i / 8 of the selection if the i'th value meets the condition; the
+ * selection takes SELECTION_BYTES(count) bytes. They go through the run with
+ * AVX2 if the processor has it, SSE2 otherwise, and with scalars on other
+ * machines. Return # of values that meet the condition.
+ */
+#define SELECTION_BYTES(count) (((count) + 7) / 8)
+unsigned selectValues(const int *values, const unsigned &count, const CompOp &compOp,
+		const int &constant, unsigned char *selection);
+unsigned selectValues(const float *values, const unsigned &count, const CompOp &compOp,
+		const float &constant, unsigned char *selection);
+
+
+
+/*
+ * Compiled descriptor of a version of a table
+ * It is built once, shared by the readers of the version and never changed
+ */
+struct VersionDescriptor {
+	vector<Attribute> attrs;
+	unordered_map<string, int> attrIndex;	// position of an attribute by its name
+	vector<int> fixedOffsets;	// offset of an attribute in the API format, -1 past the first varchar
+	vector<int> varcharIndex;	// positions of the varchar attributes
+	explicit VersionDescriptor(const vector<Attribute> &attributes);
+	// get the position of an attribute, -1 if the version does not have it
+	int getIndex(const string &attributeName) const {
+		unordered_map<string, int>::const_iterator itr = attrIndex.find(attributeName);
+		return itr == attrIndex.end() ? -1 : itr->second;
+	}
+};
+typedef shared_ptr<const VersionDescriptor> VersionDescriptorPtr;
+
+/*
+ * PAX pages
+ * A data page of a file made with FILE_PAX_PAGES keeps its records column by
+ * column. The page starts with a header and the slot of each row, then a
+ * minipage follows for each field: the array of the values if they all take 4
+ * bytes, otherwise the start of each value then the values in the API format.
+ * The slot directory at the end of the page is the one of a row page, except
+ * the offset of a record is its row. The rows of a page have the version and
+ * the fields of the first one, in the order of their slots. A page is rewritten
+ * whole when a row is added or changed, which drops the rows of the deleted or
+ * forwarded slots; an empty page has no header.
+ */
+#define PAX_ALIGN 4			// defines the alignment of a minipage
+#define PAX_HEADER_SIZE (sizeof(SlotNum) + sizeof(FieldOffset) + sizeof(VersionNumber))
+#define PAX_FIXED 0			// the minipage is an array of 4 bytes values
+#define PAX_VARIABLE 1		// the minipage starts with the start of each value
+class PaxPage {
+public:
+  PaxPage() : numRows(0), numFields(0), version(0), layouts(NULL), rowSlots(NULL) {}
+  // read the header of a page whose rows take dataSize bytes
+  void load(const char *page, const unsigned &dataSize);
+  // locate the value of a field of a row in place
+  void getField(const unsigned &field, const SlotNum &row,
+		  const char *&value, unsigned &length) const {
+	  if (layouts[field] == PAX_FIXED) {
+		  value = columns[field] + row * sizeof(int);
+		  length = sizeof(int);
+		  return;
+	  }
+	  const FieldOffset *starts = (const FieldOffset *)columns[field];
+	  value = columns[field] + starts[row];
+	  length = starts[row + 1] - starts[row];
+  }
+  static unsigned align(const unsigned &offset) {
+	  return (offset + PAX_ALIGN - 1) / PAX_ALIGN * PAX_ALIGN;
+  }
+
+  SlotNum numRows;
+  FieldOffset numFields;
+  VersionNumber version;
+  const char *layouts;			// PAX_FIXED or PAX_VARIABLE for each field
+  const SlotNum *rowSlots;		// the slot of each row, in increasing order
+  vector<const char *> columns;	// the minipage of each field
+};
+// a row to write to a PAX page, a stored record or a row already on the page
+struct PaxRow {
+	SlotNum slot;
+	const char *record;		// NULL for a row of the page
+	SlotNum row;
+};
 
 
 /****************************************************************************
@@ -78,6 +183,9 @@ The scan iterator is NOT required to be implemented for part 1 of the project
 //  rbfmScanIterator.close();
 
 #define SCANITER_COND_PROJ_NOT_FOUND 60
+#define SCANITER_BATCH_TOO_SMALL 61
+#define SCAN_SELECTION_ROWS 64		// defines # of rows of a PAX page selected together
+class ZoneMap;
 class RBFM_ScanIterator {
 public:
   RBFM_ScanIterator();
@@ -85,10 +193,14 @@ public:
 
   // "data" follows the same format as RecordBasedFileManager::insertRecord()
   RC getNextRecord(RID &rid, void *data);
+  // fill the buffer with as many records as fit, one after another in the same
+  // format, their RIDs in rids; RBFM_EOF if there are none left
+  RC getNextBatch(void *buffer, unsigned capacity, vector<RID> &rids, unsigned &count);
   RC close();
-  // compare the two attribute data
+  // scan the pages [first, end) only, from the first record of the first
+  void setPageRange(const PageNum &first, const PageNum &end);
+  // compare an attribute value with the value of the condition
   bool compareValue(const void *record, const AttrType &type);
-  bool compareString(const string &lhs, const string &rhs);
   template <typename T>
   bool compareValueTemplate(T const &lhs, T const &rhs) {
 	  switch(compOp) {
@@ -115,10 +227,34 @@ public:
 	  }
 	  return true;
   }
-  // prepare the data
-  RC prepareData(char *readPage, FileHandle &fileHandle,
-		  const vector<Attribute> &recordDescriptor,
-		  const RID &rid, void *data);
+  // positions of the condition and the projected attributes in a version,
+  // found once per scan from the descriptor of the version
+  struct VersionPlan {
+	  bool loaded;
+	  VersionDescriptorPtr descriptor;
+	  int conditionIndex;			// -1 if the version does not have it
+	  vector<int> projectedIndex;
+	  VersionPlan() : loaded(false), conditionIndex(-1) {}
+  };
+  RC getVersionPlan(const VersionNumber &ver, VersionPlan *&plan);
+  // copy the records that qualify until maxRecords or the capacity is reached
+  RC nextRecords(char *data, const unsigned &capacity, const unsigned &maxRecords,
+		  RID &rid, vector<RID> *rids, unsigned &count);
+  // locate an attribute of a record in place, or of a row in its minipage if record is NULL
+  bool getAttribute(const char *record, const SlotNum &row, const VersionPlan &plan,
+		  const int &index, const char *&field, unsigned &length);
+  // prepare the data of a record that qualifies, false if it does not fit
+  bool prepareData(const char *record, const SlotNum &row, const VersionPlan &plan,
+		  void *data, const unsigned &capacity, unsigned &size);
+  // get the minipage of the condition attribute if its values are compared
+  // a run at a time, NULL otherwise
+  const char *getConditionRun();
+  // select the rows [begin, end) of the PAX page, begin is a multiple of 8
+  void selectRows(const char *conditionRun, const SlotNum &begin, const SlotNum &end);
+  // release the page read by the iterator
+  void releaseCurrentPage();
+  // release the zone map used for the condition
+  void releaseZoneMap();
 
   CompOp compOp;
   char *value;
@@ -131,9 +267,68 @@ public:
   vector<string> projectedName;
   vector<AttrType> projectedType;
   FileHandle *fHandle;
-  char page[PAGE_SIZE];
-  char tuple[PAGE_SIZE];
-  char attrData[PAGE_SIZE];
+  const char *page;		// prevPageNum read in place from the buffer pool or the mapping
+  vector<VersionPlan> versionPlans;	// by version, filled as the versions are met
+  ZoneMap *zoneMap;		// summaries of the pages, NULL if they cannot help the condition
+  int zoneIndex;		// the condition attribute in the zone map
+  PaxPage paxPage;		// the header of the page if it is a PAX page
+  vector<unsigned char> selection;	// the rows of the PAX page that meet the condition
+};
+
+/*
+ * Parallel scan
+ * The data pages are split into morsels of PARALLEL_SCAN_MORSEL_PAGES that the
+ * worker threads take in turn. Each worker has its own file handle and scan
+ * iterator, so the pages are read, filtered and projected at once. The records
+ * come out through a bounded queue of batches, or are given to a sink run by
+ * the worker that found them; either way they are in no particular order.
+ */
+#define PARALLEL_SCAN_MORSEL_PAGES 32	// defines # of pages a worker takes at a time
+#define PARALLEL_SCAN_BATCH_RECORDS 256	// defines # of records queued together
+#define PARALLEL_SCAN_QUEUE_BATCHES 4	// defines # of batches queued per worker
+// a sink is called by the workers at once, each with its own number
+typedef function<RC (unsigned worker, const RID &rid, const void *data)> ScanSink;
+class RBFM_ParallelScanIterator {
+public:
+  RBFM_ParallelScanIterator();
+  ~RBFM_ParallelScanIterator();
+
+  // "data" follows the same format as RecordBasedFileManager::insertRecord()
+  RC getNextRecord(RID &rid, void *data);
+  // stop the workers and drop the records not read
+  RC close();
+private:
+  struct ScanBatch {
+	  vector<RID> rids;
+	  vector<unsigned> offsets;		// where the data of each record starts
+	  vector<char> data;
+  };
+  // the work of each thread, morsel after morsel
+  void work(unsigned worker);
+  // queue a batch, waits while the queue is full
+  void pushBatch(ScanBatch &batch);
+
+  string fileName;
+  vector<Attribute> recordDescriptor;
+  string conditionName;
+  CompOp compOp;
+  vector<char> value;				// empty if there is no condition
+  vector<string> projectedName;
+  vector<Attribute> projectedAttrs;
+  ScanSink sink;					// empty if the records are queued
+  PageNum totalPageNum;
+  atomic<PageNum> nextPage;			// first page of the next morsel
+  atomic<bool> stopping;
+  vector<thread> workers;
+  mutex latch;						// guards the queue and the state of the workers
+  condition_variable queueCond;
+  list<ScanBatch> queue;
+  unsigned maxQueued;
+  unsigned runningWorkers;
+  RC error;							// the first error of a worker
+  ScanBatch current;				// the batch being read
+  unsigned currentIndex;
+  friend class RecordBasedFileManager;
 };
 
 /*
@@ -161,10 +356,18 @@ const int NO_ACTION_ATTRIBUTE = 0;
 #define ATTR_OVERFLOW 52
 #define ATTR_NOT_FOUND 53
 
-// define char as version
-typedef unsigned VersionNumber;
 // define record descriptor
 typedef vector<Attribute> RecordDescriptor;
+// one step of the program translating an old version's data to the latest version
+#define TRANSLATE_COPY 'c'
+#define TRANSLATE_SKIP 's'
+#define TRANSLATE_DEFAULT 'd'
+struct TranslationStep {
+	char op;
+	int length;		// bytes of a run of fixed-size fields, -1 for a varchar
+};
+typedef vector<TranslationStep> TranslationPlan;
+typedef shared_ptr<const TranslationPlan> TranslationPlanPtr;
 // define member types
 typedef unordered_map<string, vector<RecordDescriptor> > AttrMap;
 typedef unordered_map<string, VersionNumber> VersionMap;
@@ -174,7 +377,13 @@ class VersionManager {
 private:
 	AttrMap attrMap;
 	VersionMap versionMap;
+	// compiled descriptors by version, built on first use
+	unordered_map<string, vector<VersionDescriptorPtr> > descriptorMap;
+	// translation plans to the latest version by old version, built on first use
+	unordered_map<string, vector<TranslationPlanPtr> > translationMap;
 	static VersionManager *_ver_manager;
+	// guards the maps and the page, tables are loaded lazily from inside the public calls
+	recursive_mutex latch;
 public:
 	VersionManager();
 	// load the catelog of a table
@@ -186,6 +395,9 @@ public:
 	// get the attributes of a version
 	RC getAttributes(const string &tableName, vector<Attribute> &attrs,
 			const VersionNumber ver);
+	// get the compiled descriptor of a version, shared instead of copied
+	RC getDescriptor(const string &tableName, VersionDescriptorPtr &descriptor,
+			const VersionNumber ver);
 	// add an attribute
 	RC addAttribute(const string &tableName, const Attribute &attr, FileHandle &fileHandle);
 	// drop an attribute
@@ -219,6 +431,9 @@ private:
 	// set i'th version Information
 	void set_ithVersionInfo(void *page, VersionNumber ver,
 			const VersionInfoFrame &versionInfoFrame);
+	// compile the translation plan of a version to the latest version
+	void compileTranslation(const vector<RecordDescriptor> &recordDescriptorArray,
+			const VersionNumber ver, const VersionNumber latestVer, TranslationPlan &plan);
 	// get/set number of attributes
 	unsigned getNumberAttributes(void *page);
 	void setNumberAttributes(void *page, const unsigned numAttrs);
@@ -228,11 +443,88 @@ private:
 	// create attribute descriptor for attribute
 	vector<Attribute> recordAttributeDescriptor;
 private:
-	char page[PAGE_SIZE];
+	// catalog pages keep their layout in the first PAGE_SIZE bytes of any page size
+	char page[MAX_PAGE_SIZE];
 	void createAttrRecordDescriptor(vector<Attribute> &recordDescriptor);
 	// void getCurrentTupleVersion(vector<Attribute>)
 };
 
+/*
+ * 		Zone maps
+ * A file made with FILE_ZONE_MAPS keeps the min and the max of its attributes
+ * for each data page in a side file, so a scan skips the pages that cannot
+ * meet its condition. Page 0 of the side file lists the attributes, taken from
+ * the first record inserted; the pages after it keep an entry per data page.
+ * Varchars keep a prefix of ZONE_KEY_SIZE bytes. A summary only widens, a
+ * deleted record leaves it as it is.
+ * A record is summarized before its data page is released, and page 0 is
+ * marked changed on the disk before the first summary changed since the last
+ * sync. The summaries of a side file opened marked changed may be behind the
+ * data pages, so they are all taken as unknown; an unknown page is always read.
+ */
+#define ZONE_FILE_SUFFIX ".zone"
+#define ZONE_MAX_ATTRS 8			// attributes summarized at most
+#define ZONE_KEY_SIZE 8				// an int, a real or the prefix of a varchar
+#define ZONE_NOT_SUMMARIZED -1		// type of an attribute met with another type, or dropped or added
+// state of the entry of a data page, in its first key
+#define ZONE_UNKNOWN 0				// the page may hold records not summarized
+#define ZONE_SUMMARIZED 1
+#define ZONE_EMPTY 2				// the page holds no records
+class ZoneMap {
+public:
+	ZoneMap(const string &fileName);
+	~ZoneMap();
+	// open the side file and load the summaries
+	RC open();
+	// get the index of a kept attribute, -1 if it is not or is kept with another type
+	int getIndex(const string &attributeName, const AttrType &type);
+	// widen the summary of a data page with a record in the API format
+	RC addRecord(const PageNum &pageNum, const vector<Attribute> &recordDescriptor,
+			const void *data);
+	// stop summarizing an attribute, its old values no longer tell what scans read
+	RC dropAttribute(const string &attributeName);
+	// whether a data page may hold a record whose attribute meets the condition
+	bool mayMatch(const PageNum &pageNum, const int &index, const CompOp &compOp,
+			const void *value);
+	// get/set the summary of a page, and merge one into another
+	void getSummary(const PageNum &pageNum, vector<char> &summary);
+	RC setSummary(const PageNum &pageNum, const vector<char> &summary);
+	void mergeSummary(vector<char> &summary, const vector<char> &other);
+	// forget the summaries, the numPages data pages are empty
+	RC clear(const PageNum &numPages);
+	// mark the side file changed before data pages are written
+	RC markChanged();
+	// write the pages of the side file changed since the last sync, page 0 last
+	RC sync();
+
+	const string fileName;		// the file summarized
+	int refCount;				// # of users, kept by the record-based file manager
+private:
+	struct ZoneAttr {
+		char name[MAX_ATTR_LEN];
+		int type;
+	};
+	// get the entry of a data page, NULL if it is past the side file
+	char *getEntry(const PageNum &pageNum, bool extend);
+	// write page 0 marked changed, once until the next sync
+	RC beginChange();
+	void putHeader();
+	RC writeZonePage(const PageNum &zonePage);
+	void makeKey(const int &type, const char *value, char *key);
+	int compareKey(const int &type, const char *lhs, const char *rhs);
+	void widen(const int &type, char *entryKeys, const char *key);
+
+	FileHandle fileHandle;
+	unsigned numAttrs;
+	ZoneAttr attrs[ZONE_MAX_ATTRS];
+	unsigned entrySize;			// a state key, then the min and the max of each attribute
+	unsigned entriesPerPage;
+	vector<char> pages;			// the side file, page 0 first
+	set<PageNum> dirtyPages;
+	bool changed;				// page 0 on the disk is marked changed
+	mutex latch;				// guards the summaries, the writers of a file are many threads
+};
+
 /*
  * 			Record based file manager
  */
@@ -242,7 +534,11 @@ class RecordBasedFileManager
 public:
   static RecordBasedFileManager* instance();
 
-  RC createFile(const string &fileName);
+  // flags takes FILE_COMPRESSED for files mostly scanned, whose pages are compressed on the disk,
+  // and FILE_ZONE_MAPS for files scanned by ranges of clustered values
+  // and FILE_PAX_PAGES for files scanned for a few of many attributes
+  // the records of a new file are stored with FILE_FIELD_OFFSETS
+  RC createFile(const string &fileName, unsigned pageSize = PAGE_SIZE, unsigned flags = 0);
   
   RC destroyFile(const string &fileName);
   
@@ -256,6 +552,9 @@ public:
   //     For varchar: use 4 bytes to store the length of characters, then store the actual characters.
   //  !!!The same format is used for updateRecord(), the returned data of readRecord(), and readAttribute()
   RC insertRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const void *data, RID &rid);
+  // insert records in a batch, each page is filled and written once
+  RC insertRecords(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+		  const vector<const void *> &data, vector<RID> &rids);
 
 
   RC readRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const RID &rid, void *data);
@@ -268,6 +567,40 @@ public:
   // in the page exclude the rid size
   unsigned getRecordSize(const void *formattedData, const vector<Attribute> &recordDescriptor);
 
+  // get the zone map of a file made with FILE_ZONE_MAPS, opened by the first user
+  RC acquireZoneMap(const string &fileName, ZoneMap *&zoneMap);
+  void releaseZoneMap(const string &fileName);
+  // use the page size and the record format of the file for the layout below
+  void setFileLayout(FileHandle &fileHandle) {
+	  pageSize = fileHandle.getPageSize();
+	  fieldOffsets = (fileHandle.getFlags() & FILE_FIELD_OFFSETS) != 0;
+	  paxPages = (fileHandle.getFlags() & FILE_PAX_PAGES) != 0;
+  }
+  // the data pages of the file are PAX pages
+  bool hasPaxPages() const {
+	  return paxPages;
+  }
+  // get the stored record of a slot, in place or built from the minipages of a PAX page
+  const char *getRecord(const char *page, const SlotDir &slotDir);
+  // get the bytes taken by the records of a page from its start
+  unsigned getDataSize(const void *page);
+  // get the record as stored in the page, the size is returned
+  unsigned getStoredRecord(const void *data, const vector<Attribute> &recordDescriptor,
+		  const char *&record);
+  // translate a stored record to the API format
+  void getRecordData(const char *record, unsigned recordSize, void *data);
+  // locate the index'th attribute of a stored record in place, given the
+  // descriptor of its version; false if the record does not have it
+  bool getRecordAttribute(const char *record, const vector<Attribute> &recordDescriptor,
+		  int index, const char *&field, unsigned &length);
+  bool getRecordAttribute(const char *record, const VersionDescriptor &descriptor,
+		  int index, const char *&field, unsigned &length);
+  // read an attribute of a stored record, given the descriptor of its version
+  // the size of the value written to data is returned
+  unsigned readRecordAttribute(const char *record, const vector<Attribute> &recordDescriptor,
+		  const string &attributeName, void *data);
+  // get the version of a stored record, kept in its first field
+  VersionNumber getRecordVersion(const char *record);
   // create an empty page
   void setPageEmpty(void *page);
   // get the size of a record & it's directory
@@ -281,8 +614,8 @@ public:
   unsigned getEmptySpaceSize();
   // get/set the number of slots
   SlotNum getNumSlots(void *page);
-  // get next available num slots
-  SlotNum getNextAvailableSlot(void *page);
+  // get next available num slots, the ones before first are known to be taken
+  SlotNum getNextAvailableSlot(void *page, SlotNum first = 1);
   RC setNumSlots(void *page, SlotNum num);
   // get directory of nth slot
   // Note that the id of slot starts from 0
@@ -321,6 +654,26 @@ public:
       const vector<string> &attributeNames, // a list of projected attributes
       RBFM_ScanIterator &rbfm_ScanIterator);
 
+  // scan with numThreads workers, the records come out of the iterator in no particular order
+  RC parallelScan(FileHandle &fileHandle,
+      const vector<Attribute> &recordDescriptor,
+      const string &conditionAttribute,
+      const CompOp compOp,
+      const void *value,
+      const vector<string> &attributeNames,
+      const unsigned numThreads,
+      RBFM_ParallelScanIterator &rbfm_ParallelScanIterator);
+  // scan with numThreads workers, each record is given to the sink by the worker
+  // that found it; returns when all the pages are scanned or the sink fails
+  RC parallelScan(FileHandle &fileHandle,
+      const vector<Attribute> &recordDescriptor,
+      const string &conditionAttribute,
+      const CompOp compOp,
+      const void *value,
+      const vector<string> &attributeNames,
+      const unsigned numThreads,
+      const ScanSink &sink);
+
 
 // Extra credit for part 2 of the project, please ignore for part 1 of the project
 public:
@@ -334,7 +687,49 @@ protected:
 
 private:
   static RecordBasedFileManager *_rbf_manager;
-  char pageContent[PAGE_SIZE];
+  // append an empty data page, and a free space map page before it if due
+  RC appendDataPage(FileHandle &fileHandle, PageNum &pageNum);
+  // pin a page with room for the record and its slot directory, a page is appended if none has
+  RC pinPageForRecord(FileHandle &fileHandle, const char *record,
+		  const unsigned &recordDirectorySize, PageNum &pageNum, char *&page);
+  // get the space a stored record takes on an empty page with its slot directory
+  unsigned getRecordSpace(const char *record, const unsigned &recordSize);
+  // place a stored record at the free space of a page
+  RC placeRecord(char *page, const char *record, const unsigned &recordSize, SlotNum &slotNum);
+  // get the rows of a PAX page left with the record in the slot, the next free one
+  // unless it replaces the row of slotNum; RECORD_PAGE_MISMATCH if the rows have another format
+  RC getPaxRows(const char *page, const char *record, SlotNum &slotNum, const bool &replace,
+		  PaxPage &source, vector<PaxRow> &rows, SlotNum &numSlots);
+  // get the bytes the rows take on a PAX page, and the layout of each field
+  unsigned getPaxPageSize(const PaxPage &source, const vector<PaxRow> &rows,
+		  vector<char> &layouts);
+  // locate a value of a row to write to a PAX page
+  void getPaxValue(const PaxPage &source, const PaxRow &row, const unsigned &field,
+		  const char *&value, unsigned &length);
+  // rewrite the data of a PAX page with the rows, false if they do not fit
+  bool writePaxPage(char *page, const PaxPage &source, const vector<PaxRow> &rows,
+		  const SlotNum &numSlots);
+  // place a stored record on a PAX page, added or in place of the row of slotNum
+  RC placePaxRecord(char *page, const char *record, SlotNum &slotNum, const bool &replace);
+  // update the free space of a page in the space manager of its file
+  RC updatePageSpace(FileHandle &fileHandle, const unsigned &freeSpaceSize,
+		  const PageNum &pageNum);
+  // widen the zone map of a page with records, nothing to do unless the file keeps one
+  RC summarizeRecords(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+		  const void * const *data, const unsigned &numRecords, const PageNum &pageNum);
+  // zone maps of the open files by name
+  unordered_map<string, ZoneMap *> zoneMaps;
+  mutex zoneLatch;
+  // scratch state of a call, kept per thread so that threads work on different files at once
+  static thread_local char pageContent[MAX_PAGE_SIZE];
+  static thread_local unsigned pageSize;		// page size of the file being worked on
+  static thread_local bool fieldOffsets;		// its records have FILE_FIELD_OFFSETS
+  static thread_local char recordContent[MAX_PAGE_SIZE];	// a record translated to be stored
+  static thread_local bool paxPages;			// its data pages are PAX pages
+  static thread_local char paxContent[MAX_PAGE_SIZE];	// a PAX page being written
+  static thread_local char paxRecord[MAX_PAGE_SIZE];	// a record built from a PAX page
+  // locate the i'th field of a record with FILE_FIELD_OFFSETS, false if it is null or missing
+  bool getRecordField(const char *record, unsigned index, const char *&field, unsigned &length);
 };
 
 #endif
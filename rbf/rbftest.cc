@@ -7,6 +7,7 @@
 #include <string.h>
 #include <stdexcept>
 #include <stdio.h> 
+#include <thread>
 
 #include "pfm.h"
 #include "rbfm.h"
@@ -105,6 +106,25 @@ void createRecordDescriptor(vector<Attribute> &recordDescriptor) {
 
 }
 
+// Ver followed by the attributes above, as the relation manager keeps them,
+// with the version pages of an open file formatted for it
+void createVersionedFile(const string &fileName, FileHandle &fileHandle,
+        vector<Attribute> &recordDescriptor) {
+    Attribute attr;
+    attr.name = "Ver";
+    attr.type = TypeInt;
+    attr.length = sizeof(int);
+    recordDescriptor.push_back(attr);
+    vector<Attribute> empDescriptor;
+    createRecordDescriptor(empDescriptor);
+    recordDescriptor.insert(recordDescriptor.end(), empDescriptor.begin(), empDescriptor.end());
+    VersionManager *vm = VersionManager::instance();
+    RC rc = vm->formatFirst2Page(fileName, recordDescriptor, fileHandle);
+    assert(rc == success);
+    rc = vm->initTableVersionInfo(fileName, fileHandle);
+    assert(rc == success);
+}
+
 void createLargeRecordDescriptor(vector<Attribute> &recordDescriptor)
 {
     int index = 0;
@@ -1187,81 +1207,2551 @@ int RBFTest_12(RecordBasedFileManager *rbfm) {
     return 0;
 }
 
-int main()
+int RBFTest_13(PagedFileManager *pfm)
 {
-    PagedFileManager *pfm = PagedFileManager::instance(); // To test the functionality of the paged file manager
-    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance(); // To test the functionality of the record-based file manager
+    // Functions Tested:
+    // 1. Pin/Unpin Page
+    // 2. Read Page through a buffer pool smaller than the file
+    // 3. Read Page while every frame is pinned
+    // 4. Get Number Of Pages of handles sharing a file
+    // 5. A file with a pinned page is neither closed by its last handle nor destroyed
+    cout << "****In RBF Test Case 13****" << endl;
 
-    remove("test");
-    remove("test_1");
-    remove("test_2");
-    remove("test_3");
-    remove("test_4");
-    remove("test_5");
-    vector<int> gradeFail(11,0);
-    int rc = RBFTest_1(pfm);
-    if (rc == 0) {
-        total += 5;
-        gradeFail[0] = 1;
+    RC rc;
+    string fileName = "test_buffer";
+    const unsigned numFrames = 4;
+    const unsigned numPages = 3 * numFrames;
+
+    remove(fileName.c_str());
+    rc = pfm->setBufferSize(numFrames);
+    assert(rc == success);
+    rc = pfm->createFile(fileName.c_str());
+    assert(rc == success);
+
+    FileHandle fileHandle;
+    rc = pfm->openFile(fileName.c_str(), fileHandle);
+    assert(rc == success);
+
+    char data[PAGE_SIZE];
+    for (unsigned i = 0; i < numPages; ++i) {
+        memset(data, 'a' + i, PAGE_SIZE);
+        rc = fileHandle.appendPage(data);
+        assert(rc == success);
     }
-    rc = RBFTest_2(pfm); 
-    if (rc == 0) {
-        total += 5;
-        gradeFail[1] = 1;
+
+    // modify a pinned frame and read it through another handle
+    char *frame;
+    rc = fileHandle.pinPage(3, frame);
+    assert(rc == success);
+    frame[0] = 'Z';
+    rc = fileHandle.unpinPage(3, true);
+    assert(rc == success);
+
+    FileHandle fileHandle2;
+    rc = pfm->openFile(fileName.c_str(), fileHandle2);
+    assert(rc == success);
+    rc = fileHandle2.readPage(3, data);
+    assert(rc == success);
+    if (data[0] != 'Z' || data[1] != 'a' + 3) {
+        cout << "Test Case 13 Failed!" << endl << endl;
+        return -1;
     }
-    rc = RBFTest_3(pfm);
-    if (rc == 0) {
-        total += 5;
-        gradeFail[2] = 1;
+
+    // every page is evicted and reloaded at least once
+    for (unsigned round = 0; round < 2; ++round) {
+        for (unsigned i = 0; i < numPages; ++i) {
+            rc = fileHandle.readPage(i, data);
+            assert(rc == success);
+            if (data[PAGE_SIZE-1] != char('a' + i)) {
+                cout << "Test Case 13 Failed!" << endl << endl;
+                return -1;
+            }
+        }
     }
-    rc = RBFTest_4(pfm);
-    if (rc == 0) {
-        total += 5;
-        gradeFail[3] = 1;
+
+    // a page can still be read when no frame is free
+    char *frames[numFrames];
+    for (unsigned i = 0; i < numFrames; ++i) {
+        rc = fileHandle.pinPage(i, frames[i]);
+        assert(rc == success);
     }
-    rc = RBFTest_5(pfm); 
-    if (rc == 0) {
-        total += 5;
-        gradeFail[4] = 1;
+    rc = fileHandle.readPage(numPages-1, data);
+    assert(rc == success);
+    assert(data[0] == char('a' + numPages - 1));
+    for (unsigned i = 0; i < numFrames; ++i) {
+        rc = fileHandle.unpinPage(i);
+        assert(rc == success);
     }
-    rc = RBFTest_6(pfm);
-    if (rc == 0) {
-        total += 5;
-        gradeFail[5] = 1;
+
+    // a page appended by one handle is seen by the other
+    rc = fileHandle2.appendPage(data);
+    assert(rc == success);
+    if (fileHandle.getNumberOfPages() != numPages + 1) {
+        cout << "Test Case 13 Failed!" << endl << endl;
+        return -1;
     }
-    rc = RBFTest_7(pfm);
-    if (rc == 0) {
-        total += 5;
-        gradeFail[6] = 1;
+
+    // the frame of a pinned page is not given away while its holder reads it
+    rc = fileHandle.pinPage(numPages, frame);
+    assert(rc == success);
+    rc = pfm->destroyFile(fileName.c_str());
+    if (rc != BUFFER_PAGE_PINNED || !FileExists(fileName)) {
+        cout << "Test Case 13 Failed!" << endl << endl;
+        return -1;
     }
-    rc = RBFTest_8(rbfm);
-    if (rc == 0) {
-        total += 5;
-        gradeFail[7] = 1;
+    rc = pfm->closeFile(fileHandle2);
+    assert(rc == success);
+    rc = pfm->closeFile(fileHandle);
+    if (rc != BUFFER_PAGE_PINNED || fileHandle.fd < 0) {
+        cout << "Test Case 13 Failed!" << endl << endl;
+        return -1;
     }
-    
-    vector<RID> rids;
-    vector<int> sizes;
-    rc = RBFTest_9(rbfm, rids, sizes);
-    if (rc == 0) {
-        total += 5;
-        gradeFail[8] = 1;
+    rc = fileHandle.unpinPage(numPages);
+    assert(rc == success);
+
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success);
+    rc = pfm->destroyFile(fileName.c_str());
+    assert(rc == success);
+    rc = pfm->setBufferSize(MAX_PAGE_IN_MEM);
+    assert(rc == success);
+
+    cout << "Test Case 13 Passed!" << endl << endl;
+
+    return 0;
+}
+
+int RBFTest_14(PagedFileManager *pfm)
+{
+    // Functions Tested:
+    // 1. Write Page under the deferred write policy
+    // 2. Flush
+    // 3. Close File writes the dirty pages back
+    cout << "****In RBF Test Case 14****" << endl;
+
+    RC rc;
+    string fileName = "test_deferred";
+    const unsigned numPages = 16;
+
+    remove(fileName.c_str());
+    rc = pfm->setWritePolicy(WRITE_DEFERRED);
+    assert(rc == success);
+    rc = pfm->createFile(fileName.c_str());
+    assert(rc == success);
+
+    FileHandle fileHandle;
+    rc = pfm->openFile(fileName.c_str(), fileHandle);
+    assert(rc == success);
+
+    char data[PAGE_SIZE];
+    char buffer[PAGE_SIZE];
+    memset(data, 0, PAGE_SIZE);
+    for (unsigned i = 0; i < numPages; ++i) {
+        rc = fileHandle.appendPage(data);
+        assert(rc == success);
     }
-    rc = RBFTest_10(rbfm, rids, sizes);
-    if (rc == 0) {
-        total += 5;
-        gradeFail[9] = 1;
+    for (unsigned i = 0; i < numPages; ++i) {
+        memset(data, 'a' + i, PAGE_SIZE);
+        rc = fileHandle.writePage(i, data);
+        assert(rc == success);
     }
-    
-    rc = RBFTest_11(rbfm);
-    if (rc == 0) {
-        total += 20;
-        gradeFail[10] = 1;
+
+    // the pages are read from the buffer pool before they are flushed
+    rc = fileHandle.readPage(5, buffer);
+    assert(rc == success);
+    if (buffer[0] != 'a' + 5) {
+        cout << "Test Case 14 Failed!" << endl << endl;
+        return -1;
     }
-    
-    rc = RBFTest_12(rbfm);
-    if (rc != 0) {
-        cout << "Didn't implement variable-length records efficiently" << endl;
+
+    // every page is on the disk after flush
+    rc = pfm->flush();
+    assert(rc == success);
+    // the pages follow the file header page
+    FILE *fp = fopen(fileName.c_str(), "r");
+    assert(fp != NULL);
+    rc = fseek(fp, PAGE_SIZE, SEEK_SET);
+    assert(rc == 0);
+    for (unsigned i = 0; i < numPages; ++i) {
+        if (fread(buffer, PAGE_SIZE, 1, fp) != 1 || buffer[PAGE_SIZE-1] != char('a' + i)) {
+            fclose(fp);
+            cout << "Test Case 14 Failed!" << endl << endl;
+            return -1;
+        }
+    }
+
+    // the dirty page is on the disk after close
+    memset(data, 'z', PAGE_SIZE);
+    rc = fileHandle.writePage(numPages-1, data);
+    assert(rc == success);
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success);
+    if (fseek(fp, numPages * PAGE_SIZE, SEEK_SET) != 0 ||
+            fread(buffer, PAGE_SIZE, 1, fp) != 1 || buffer[0] != 'z') {
+        fclose(fp);
+        cout << "Test Case 14 Failed!" << endl << endl;
+        return -1;
+    }
+    fclose(fp);
+
+    rc = pfm->destroyFile(fileName.c_str());
+    assert(rc == success);
+    rc = pfm->setWritePolicy(WRITE_IMMEDIATE);
+    assert(rc == success);
+
+    cout << "Test Case 14 Passed!" << endl << endl;
+
+    return 0;
+}
+
+int RBFTest_15(PagedFileManager *pfm)
+{
+    // Functions Tested:
+    // 1. Open File with O_DIRECT
+    // 2. Append/Write/Read Page from buffers not aligned to the page
+    cout << "****In RBF Test Case 15****" << endl;
+
+    RC rc;
+    string fileName = "test_direct";
+    const unsigned numPages = 8;
+
+    remove(fileName.c_str());
+    pfm->setDirectIO(true);
+    rc = pfm->createFile(fileName.c_str());
+    assert(rc == success);
+
+    FileHandle fileHandle;
+    rc = pfm->openFile(fileName.c_str(), fileHandle);
+    assert(rc == success);
+
+    // offset the buffers by one byte so that they are never aligned
+    char *data = (char *)malloc(PAGE_SIZE + 1) + 1;
+    char *buffer = (char *)malloc(PAGE_SIZE + 1) + 1;
+    for (unsigned i = 0; i < numPages; ++i) {
+        memset(data, 'a' + i, PAGE_SIZE);
+        rc = fileHandle.appendPage(data);
+        assert(rc == success);
+    }
+    memset(data, 'z', PAGE_SIZE);
+    rc = fileHandle.writePage(2, data);
+    assert(rc == success);
+
+    int failed = 0;
+    for (unsigned i = 0; i < numPages; ++i) {
+        rc = fileHandle.readPage(i, buffer);
+        assert(rc == success);
+        char expected = i == 2 ? 'z' : 'a' + i;
+        if (buffer[0] != expected || buffer[PAGE_SIZE-1] != expected)
+            failed = -1;
+    }
+    free(data - 1);
+    free(buffer - 1);
+
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success);
+    rc = pfm->destroyFile(fileName.c_str());
+    assert(rc == success);
+    pfm->setDirectIO(false);
+
+    if (failed != 0) {
+        cout << "Test Case 15 Failed!" << endl << endl;
+        return -1;
+    }
+    cout << "Test Case 15 Passed!" << endl << endl;
+
+    return 0;
+}
+
+int RBFTest_16(PagedFileManager *pfm)
+{
+    // Functions Tested:
+    // 1. Open File with a read mapping
+    // 2. Read Page in place
+    // 3. Write Page, then read it in place
+    cout << "****In RBF Test Case 16****" << endl;
+
+    RC rc;
+    string fileName = "test_mmap";
+    const unsigned numPages = 8;
+
+    remove(fileName.c_str());
+    pfm->setMmapRead(true);
+    rc = pfm->createFile(fileName.c_str());
+    assert(rc == success);
+
+    FileHandle fileHandle;
+    rc = pfm->openFile(fileName.c_str(), fileHandle);
+    assert(rc == success);
+
+    char data[PAGE_SIZE];
+    for (unsigned i = 0; i < numPages; ++i) {
+        memset(data, 'a' + i, PAGE_SIZE);
+        rc = fileHandle.appendPage(data);
+        assert(rc == success);
+    }
+
+    int failed = 0;
+    const char *page;
+    for (unsigned i = 0; i < numPages; ++i) {
+        rc = fileHandle.readPage(i, page);
+        assert(rc == success);
+        if (page[0] != char('a' + i) || page[PAGE_SIZE-1] != char('a' + i))
+            failed = -1;
+        fileHandle.releasePage(page);
+    }
+
+    memset(data, 'z', PAGE_SIZE);
+    rc = fileHandle.writePage(3, data);
+    assert(rc == success);
+    rc = fileHandle.readPage(3, page);
+    assert(rc == success);
+    if (page[0] != 'z')
+        failed = -1;
+    fileHandle.releasePage(page);
+
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success);
+    rc = pfm->destroyFile(fileName.c_str());
+    assert(rc == success);
+    pfm->setMmapRead(false);
+
+    if (failed != 0) {
+        cout << "Test Case 16 Failed!" << endl << endl;
+        return -1;
+    }
+    cout << "Test Case 16 Passed!" << endl << endl;
+
+    return 0;
+}
+
+int RBFTest_17(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Insert Record into a page recorded in the free space map
+    //    after the file is reopened
+    cout << "****In RBF Test Case 17****" << endl;
+
+    RC rc;
+    string fileName = "test_fsm";
+    const int numRecords = 450;	// the last page is left partly full
+
+    remove(fileName.c_str());
+    rc = rbfm->createFile(fileName.c_str());
+    assert(rc == success);
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName.c_str(), fileHandle);
+    assert(rc == success);
+
+    RID rid;
+    int recordSize = 0;
+    void *record = malloc(100);
+    void *returnedData = malloc(100);
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+    prepareRecord(6, "Peters", 24, 170.1, 5000, record, &recordSize);
+
+    for (int i = 0; i < numRecords; ++i) {
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success);
+    }
+    unsigned numPages = fileHandle.getNumberOfPages();
+    PageNum lastPage = rid.pageNum;
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success);
+
+    // the last page still has room, the record goes there instead of a new page
+    rc = rbfm->openFile(fileName.c_str(), fileHandle);
+    assert(rc == success);
+    rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+    assert(rc == success);
+    int failed = 0;
+    if (fileHandle.getNumberOfPages() != numPages || rid.pageNum != lastPage)
+        failed = -1;
+    rc = rbfm->readRecord(fileHandle, recordDescriptor, rid, returnedData);
+    assert(rc == success);
+    if (memcmp(record, returnedData, recordSize) != 0)
+        failed = -1;
+
+    free(record);
+    free(returnedData);
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success);
+    rc = rbfm->destroyFile(fileName.c_str());
+    assert(rc == success);
+
+    if (failed != 0) {
+        cout << "Test Case 17 Failed!" << endl << endl;
+        return -1;
+    }
+    cout << "Test Case 17 Passed!" << endl << endl;
+
+    return 0;
+}
+
+int RBFTest_18(PagedFileManager *pfm)
+{
+    // Functions Tested:
+    // 1. Free space lists: best fit, and pages of the same free space
+    //    are all kept
+    cout << "****In RBF Test Case 18****" << endl;
+
+    RC rc;
+    string fileName = "test_fsm_lists";
+
+    remove(fileName.c_str());
+    rc = pfm->createFile(fileName.c_str());
+    assert(rc == success);
+
+    FileHandle fileHandle;
+    rc = pfm->openFile(fileName.c_str(), fileHandle);
+    assert(rc == success);
+
+    // catalog pages, a free space map page and three data pages
+    void *data = malloc(PAGE_SIZE);
+    memset(data, 0, PAGE_SIZE);
+    for (int i = 0; i < 6; ++i) {
+        rc = fileHandle.appendPage(data);
+        assert(rc == success);
+    }
+
+    int failed = 0;
+    PageNum first, second;
+    FileSpaceManager spaceManager;
+    spaceManager.clearPageSpaceInfo();
+    spaceManager.pushPageSpaceInfo(fileHandle, 1000, 3);
+    spaceManager.pushPageSpaceInfo(fileHandle, 1000, 4);
+    spaceManager.pushPageSpaceInfo(fileHandle, 2000, 5);
+    if (spaceManager.getPageSpaceQueueSize() != 3)
+        failed = -1;
+
+    // the pages with 1000 bytes fit best, both of them are listed
+    rc = spaceManager.getPageSpaceInfo(500, first);
+    if (rc != success || (first != 3 && first != 4))
+        failed = -1;
+    spaceManager.pushPageSpaceInfo(fileHandle, 0, first);
+    rc = spaceManager.getPageSpaceInfo(500, second);
+    if (rc != success || second == first || (second != 3 && second != 4))
+        failed = -1;
+    rc = spaceManager.getPageSpaceInfo(1500, first);
+    if (rc != success || first != 5)
+        failed = -1;
+    if (spaceManager.getPageSpaceInfo(3000, first) != FILE_SPACE_NO_SPACE)
+        failed = -1;
+    if (spaceManager.getPageSpaceQueueSize() != 2)
+        failed = -1;
+
+    free(data);
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success);
+    rc = pfm->destroyFile(fileName.c_str());
+    assert(rc == success);
+
+    if (failed != 0) {
+        cout << "Test Case 18 Failed!" << endl << endl;
+        return -1;
+    }
+    cout << "Test Case 18 Passed!" << endl << endl;
+
+    return 0;
+}
+
+int RBFTest_19(PagedFileManager *pfm)
+{
+    // Functions Tested:
+    // 1. Append Page into a preallocated extent
+    // 2. Get Number Of Pages
+    cout << "****In RBF Test Case 19****" << endl;
+
+    RC rc;
+    string fileName = "test_extent";
+    const unsigned extentSize = 16;
+
+    remove(fileName.c_str());
+    rc = pfm->createFile(fileName.c_str());
+    assert(rc == success);
+
+    unsigned oldExtentSize = pfm->getExtentSize();
+    pfm->setExtentSize(extentSize);
+    FileHandle fileHandle;
+    rc = pfm->openFile(fileName.c_str(), fileHandle);
+    assert(rc == success);
+
+    void *data = malloc(PAGE_SIZE);
+    memset(data, 'e', PAGE_SIZE);
+    for (int i = 0; i < 3; ++i) {
+        rc = fileHandle.appendPage(data);
+        assert(rc == success);
+    }
+    rc = pfm->flush();
+    assert(rc == success);
+
+    // the file size counts the header and the written pages only
+    int failed = 0;
+    struct stat fileStat;
+    stat(fileName.c_str(), &fileStat);
+    if (fileHandle.getNumberOfPages() != 3 || fileStat.st_size != 4 * PAGE_SIZE)
+        failed = -1;
+
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success);
+    pfm->setExtentSize(oldExtentSize);
+
+    // the preallocated pages are given back at close
+    stat(fileName.c_str(), &fileStat);
+    if (fileStat.st_size != 4 * PAGE_SIZE || fileStat.st_blocks * 512 > 4 * PAGE_SIZE)
+        failed = -1;
+
+    free(data);
+    rc = pfm->destroyFile(fileName.c_str());
+    assert(rc == success);
+
+    if (failed != 0) {
+        cout << "Test Case 19 Failed!" << endl << endl;
+        return -1;
+    }
+    cout << "Test Case 19 Passed!" << endl << endl;
+
+    return 0;
+}
+
+int RBFTest_20(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Create File with a larger page size
+    // 2. Insert / Read a record that does not fit in a PAGE_SIZE page
+    cout << "****In RBF Test Case 20****" << endl;
+
+    RC rc;
+    string fileName = "test_page_size";
+    const unsigned pageSize = PAGE_SIZE * 4;
+    const int nameLength = PAGE_SIZE + 1000;
+
+    remove(fileName.c_str());
+    rc = rbfm->createFile(fileName.c_str(), pageSize + 1);
+    assert(rc != success);
+    rc = rbfm->createFile(fileName.c_str(), pageSize);
+    assert(rc == success);
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName.c_str(), fileHandle);
+    assert(rc == success);
+
+    vector<Attribute> recordDescriptor;
+    Attribute attr;
+    attr.name = "Text";
+    attr.type = TypeVarChar;
+    attr.length = (AttrLength)nameLength;
+    recordDescriptor.push_back(attr);
+
+    int recordSize = sizeof(int) + nameLength;
+    char *record = (char *)malloc(recordSize);
+    char *returnedData = (char *)malloc(recordSize);
+    memcpy(record, &nameLength, sizeof(int));
+    memset(record + sizeof(int), 't', nameLength);
+
+    vector<RID> rids;
+    RID rid;
+    for (int i = 0; i < 6; ++i) {
+        record[sizeof(int)] = 'a' + i;
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success);
+        rids.push_back(rid);
+    }
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success);
+
+    // the page size is read back from the file header
+    rc = rbfm->openFile(fileName.c_str(), fileHandle);
+    assert(rc == success);
+    int failed = 0;
+    if (fileHandle.getPageSize() != pageSize)
+        failed = -1;
+    // records larger than PAGE_SIZE still share a page
+    if (rids[2].pageNum != rids[3].pageNum)
+        failed = -1;
+    for (int i = 0; i < 6; ++i) {
+        record[sizeof(int)] = 'a' + i;
+        rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedData);
+        assert(rc == success);
+        if (memcmp(record, returnedData, recordSize) != 0)
+            failed = -1;
+    }
+
+    free(record);
+    free(returnedData);
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success);
+    rc = rbfm->destroyFile(fileName.c_str());
+    assert(rc == success);
+
+    if (failed != 0) {
+        cout << "Test Case 20 Failed!" << endl << endl;
+        return -1;
+    }
+    cout << "Test Case 20 Passed!" << endl << endl;
+
+    return 0;
+}
+
+int RBFTest_21(PagedFileManager *pfm, RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Insert Record under WRITE_LOGGED: only the log is written
+    // 2. Replay the log after the buffered pages are lost
+    cout << "****In RBF Test Case 21****" << endl;
+
+    RC rc;
+    string fileName = "test_log";
+    string logName = "test_log.wal";
+    const int numRecords = 500;
+
+    remove(fileName.c_str());
+    remove(logName.c_str());
+    pfm->setLogFile(logName.c_str());
+    rc = pfm->setWritePolicy(WRITE_LOGGED);
+    assert(rc == success);
+    rc = rbfm->createFile(fileName.c_str());
+    assert(rc == success);
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName.c_str(), fileHandle);
+    assert(rc == success);
+
+    RID rid;
+    vector<RID> rids;
+    int recordSize = 0;
+    void *record = malloc(100);
+    void *returnedData = malloc(100);
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+    for (int i = 0; i < numRecords; ++i) {
+        prepareRecord(6, "Peters", i, 170.1, 5000, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success);
+        rids.push_back(rid);
+    }
+
+    // the pages are committed to the log, the file only holds its header
+    int failed = 0;
+    struct stat fileStat;
+    stat(fileName.c_str(), &fileStat);
+    if (fileStat.st_size != PAGE_SIZE)
+        failed = -1;
+    stat(logName.c_str(), &fileStat);
+    if (fileStat.st_size == 0)
+        failed = -1;
+
+    // crash: lose the buffered pages and leave the log behind
+    pfm->bufferManager.discardFile(fileName);
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success);
+    pfm->logManager.close();
+
+    // opening the log replays it
+    rc = pfm->setWritePolicy(WRITE_LOGGED);
+    assert(rc == success);
+    rc = pfm->setWritePolicy(WRITE_IMMEDIATE);
+    assert(rc == success);
+    if (FileExists(logName))
+        failed = -1;
+
+    rc = rbfm->openFile(fileName.c_str(), fileHandle);
+    assert(rc == success);
+    for (int i = 0; i < numRecords; ++i) {
+        prepareRecord(6, "Peters", i, 170.1, 5000, record, &recordSize);
+        rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedData);
+        if (rc != success || memcmp(record, returnedData, recordSize) != 0) {
+            failed = -1;
+            break;
+        }
+    }
+
+    free(record);
+    free(returnedData);
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success);
+    rc = rbfm->destroyFile(fileName.c_str());
+    assert(rc == success);
+    pfm->setLogFile(LOG_FILE_NAME);
+
+    if (failed != 0) {
+        cout << "Test Case 21 Failed!" << endl << endl;
+        return -1;
+    }
+    cout << "Test Case 21 Passed!" << endl << endl;
+
+    return 0;
+}
+
+int RBFTest_22(PagedFileManager *pfm)
+{
+    // Functions Tested:
+    // 1. I/O statistics of a handle and of its file
+    // 2. Reset the statistics
+    cout << "****In RBF Test Case 22****" << endl;
+
+    RC rc;
+    string fileName = "test_stats";
+
+    remove(fileName.c_str());
+    rc = pfm->createFile(fileName.c_str());
+    assert(rc == success);
+
+    FileHandle fileHandle, fileHandle2;
+    rc = pfm->openFile(fileName.c_str(), fileHandle);
+    assert(rc == success);
+    rc = pfm->openFile(fileName.c_str(), fileHandle2);
+    assert(rc == success);
+
+    void *data = malloc(PAGE_SIZE);
+    memset(data, 's', PAGE_SIZE);
+    for (int i = 0; i < 3; ++i) {
+        rc = fileHandle.appendPage(data);
+        assert(rc == success);
+    }
+    rc = fileHandle.writePage(1, data);
+    assert(rc == success);
+    rc = fileHandle2.readPage(2, data);
+    assert(rc == success);
+
+    // the handles count their own calls, the file counts both
+    int failed = 0;
+    IOStats stats = fileHandle.getIOStats();
+    if (stats.pagesAppended != 3 || stats.pagesWritten != 1 || stats.pagesRead != 0 ||
+            stats.bytesWritten != 4 * PAGE_SIZE || stats.writeCalls != 4)
+        failed = -1;
+    stats = fileHandle2.getIOStats();
+    if (stats.pagesRead != 1 || stats.pagesAppended != 0)
+        failed = -1;
+    stats = pfm->getIOStats(fileName);
+    if (stats.pagesAppended != 3 || stats.pagesWritten != 1 || stats.pagesRead != 1 ||
+            stats.bytesWritten != 4 * PAGE_SIZE)
+        failed = -1;
+    if (pfm->getIOStats().pagesAppended < 3)
+        failed = -1;
+
+    // calls made at the same time through the two handles are each
+    // charged to their own handle, and none is lost by the file
+    const int numReads = 2000;
+    fileHandle.resetIOStats();
+    fileHandle2.resetIOStats();
+    IOStats fileBefore = pfm->getIOStats(fileName);
+    vector<thread> readers;
+    FileHandle *handles[2] = { &fileHandle, &fileHandle2 };
+    for (int i = 0; i < 2; ++i) {
+        FileHandle *handle = handles[i];
+        readers.push_back(thread([handle]() {
+            char page[PAGE_SIZE];
+            for (int j = 0; j < numReads; ++j)
+                handle->readPage(j % 3, page);
+        }));
+    }
+    for (size_t i = 0; i < readers.size(); ++i)
+        readers[i].join();
+    stats = pfm->getIOStats(fileName) - fileBefore;
+    if (fileHandle.getIOStats().pagesRead != numReads ||
+            fileHandle2.getIOStats().pagesRead != numReads ||
+            fileHandle.getIOStats().readCalls + fileHandle2.getIOStats().readCalls != stats.readCalls ||
+            stats.pagesRead != 2 * numReads)
+        failed = -1;
+
+    // the statistics stay with the file name after it is closed
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success);
+    rc = pfm->closeFile(fileHandle2);
+    assert(rc == success);
+    if (pfm->getIOStats(fileName).pagesAppended != 3)
+        failed = -1;
+    pfm->resetIOStats();
+    fileHandle.resetIOStats();
+    if (pfm->getIOStats(fileName).pagesAppended != 0 || fileHandle.getIOStats().pagesWritten != 0)
+        failed = -1;
+
+    free(data);
+    rc = pfm->destroyFile(fileName.c_str());
+    assert(rc == success);
+
+    if (failed != 0) {
+        cout << "Test Case 22 Failed!" << endl << endl;
+        return -1;
+    }
+    cout << "Test Case 22 Passed!" << endl << endl;
+
+    return 0;
+}
+
+int RBFTest_23(PagedFileManager *pfm)
+{
+    // Functions Tested:
+    // 1. Write Pages: append adjacent pages
+    // 2. Read Pages: adjacent pages with one system call
+    // 3. Read Pages: a list of pages in any order
+    cout << "****In RBF Test Case 23****" << endl;
+
+    RC rc;
+    string fileName = "test_batch";
+    const unsigned numPages = 10;
+
+    remove(fileName.c_str());
+    rc = pfm->createFile(fileName.c_str());
+    assert(rc == success);
+    FileHandle fileHandle;
+    rc = pfm->openFile(fileName.c_str(), fileHandle);
+    assert(rc == success);
+
+    char *data = (char *)malloc(numPages * PAGE_SIZE);
+    char *buffer = (char *)malloc(numPages * PAGE_SIZE);
+    for (unsigned i = 0; i < numPages; ++i)
+        memset(data + i * PAGE_SIZE, 'a' + i, PAGE_SIZE);
+    int failed = 0;
+    // a gap past the last page is refused
+    if (fileHandle.writePages(1, numPages, data) == success)
+        failed = -1;
+    rc = fileHandle.writePages(0, numPages, data);
+    assert(rc == success);
+    if (fileHandle.getNumberOfPages() != numPages)
+        failed = -1;
+
+    // the pages are not buffered, so they are read by one call
+    IOStats before = fileHandle.getIOStats();
+    rc = fileHandle.readPages(0, numPages, buffer);
+    assert(rc == success);
+    IOStats stats = fileHandle.getIOStats() - before;
+    if (memcmp(data, buffer, numPages * PAGE_SIZE) != 0 || stats.readCalls != 1 ||
+            stats.pagesRead != numPages)
+        failed = -1;
+
+    // read the pages backwards
+    vector<PageNum> pageNums;
+    for (unsigned i = 0; i < numPages; ++i)
+        pageNums.push_back(numPages - 1 - i);
+    rc = fileHandle.readPages(pageNums, buffer);
+    assert(rc == success);
+    for (unsigned i = 0; i < numPages; ++i) {
+        if (buffer[i * PAGE_SIZE] != char('a' + numPages - 1 - i))
+            failed = -1;
+    }
+
+    // write the pages backwards, and read one page back
+    rc = fileHandle.writePages(pageNums, data);
+    assert(rc == success);
+    rc = fileHandle.readPage(0, buffer);
+    assert(rc == success);
+    if (buffer[0] != char('a' + numPages - 1))
+        failed = -1;
+
+    free(data);
+    free(buffer);
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success);
+    rc = pfm->destroyFile(fileName.c_str());
+    assert(rc == success);
+
+    if (failed != 0) {
+        cout << "Test Case 23 Failed!" << endl << endl;
+        return -1;
+    }
+    cout << "Test Case 23 Passed!" << endl << endl;
+
+    return 0;
+}
+
+// Insert records into a file of its own and read them back
+// Run by each thread of RBFTest_24
+void threadWork(RecordBasedFileManager *rbfm, unsigned id, int *failed)
+{
+    const int numRecords = 1000;
+    string fileName = "test_thread_" + to_string(id);
+    // the page sizes differ, so the threads do not share the scratch state
+    unsigned pageSize = id % 2 == 0 ? PAGE_SIZE : 4 * PAGE_SIZE;
+    remove(fileName.c_str());
+    if (rbfm->createFile(fileName, pageSize) != success) {
+        *failed = -1;
+        return;
+    }
+    FileHandle fileHandle;
+    if (rbfm->openFile(fileName, fileHandle) != success) {
+        *failed = -1;
+        return;
+    }
+    RID rid;
+    vector<RID> rids;
+    int recordSize = 0;
+    char record[100];
+    char returnedData[100];
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+    for (int i = 0; i < numRecords; ++i) {
+        prepareRecord(6, "Thread", i, 170.1, id, record, &recordSize);
+        if (rbfm->insertRecord(fileHandle, recordDescriptor, record, rid) != success) {
+            *failed = -1;
+            break;
+        }
+        rids.push_back(rid);
+    }
+    for (unsigned i = 0; i < rids.size(); ++i) {
+        prepareRecord(6, "Thread", i, 170.1, id, record, &recordSize);
+        if (rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedData) != success ||
+                memcmp(record, returnedData, recordSize) != 0) {
+            *failed = -1;
+            break;
+        }
+    }
+    if (rids.size() != (unsigned)numRecords)
+        *failed = -1;
+    if (rbfm->closeFile(fileHandle) != success || rbfm->destroyFile(fileName) != success)
+        *failed = -1;
+}
+
+int RBFTest_24(PagedFileManager *pfm, RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Open, insert, read and close different files from several threads
+    // 2. Open and close one file from several threads
+    cout << "****In RBF Test Case 24****" << endl;
+
+    RC rc;
+    const unsigned numThreads = 4;
+    string fileName = "test_thread_shared";
+    remove(fileName.c_str());
+    rc = pfm->createFile(fileName.c_str());
+    assert(rc == success);
+
+    vector<int> results(numThreads, 0);
+    vector<thread> threads;
+    for (unsigned i = 0; i < numThreads; ++i)
+        threads.push_back(thread(threadWork, rbfm, i, &results[i]));
+    // the handles of the shared file come and go while the others work
+    vector<thread> openers;
+    for (unsigned i = 0; i < numThreads; ++i) {
+        openers.push_back(thread([pfm, &fileName]() {
+            for (int j = 0; j < 100; ++j) {
+                FileHandle fileHandle;
+                if (pfm->openFile(fileName.c_str(), fileHandle) == success)
+                    pfm->closeFile(fileHandle);
+            }
+        }));
+    }
+    for (unsigned i = 0; i < numThreads; ++i) {
+        threads[i].join();
+        openers[i].join();
+    }
+
+    int failed = 0;
+    for (unsigned i = 0; i < numThreads; ++i) {
+        if (results[i] != 0)
+            failed = -1;
+    }
+    // every handle was closed, so the file opens afresh
+    FileHandle fileHandle;
+    rc = pfm->openFile(fileName.c_str(), fileHandle);
+    assert(rc == success);
+    if (fileHandle.getNumberOfPages() != 0)
+        failed = -1;
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success);
+    rc = pfm->destroyFile(fileName.c_str());
+    assert(rc == success);
+
+    if (failed != 0) {
+        cout << "Test Case 24 Failed!" << endl << endl;
+        return -1;
+    }
+    cout << "Test Case 24 Passed!" << endl << endl;
+
+    return 0;
+}
+
+int RBFTest_25(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Page codec: a repetitive page shrinks, a random one does not
+    // 2. Create a compressed file, insert and read records
+    // 3. Read the records again after the file is reopened
+    cout << "****In RBF Test Case 25****" << endl;
+
+    RC rc;
+    string fileName = "test_compressed";
+    const int numRecords = 2000;
+    int failed = 0;
+
+    char page[PAGE_SIZE];
+    char compressed[PAGE_SIZE];
+    char decompressed[PAGE_SIZE];
+    for (unsigned i = 0; i < PAGE_SIZE; ++i)
+        page[i] = "Peters"[i % 6] + (i % 100 == 0);
+    unsigned length = PageCodec::compress(page, PAGE_SIZE, compressed, PAGE_SIZE - 1);
+    if (length == 0 || length > PAGE_SIZE / 4 ||
+            !PageCodec::decompress(compressed, length, decompressed, PAGE_SIZE) ||
+            memcmp(page, decompressed, PAGE_SIZE) != 0)
+        failed = -1;
+    srand(25);
+    for (unsigned i = 0; i < PAGE_SIZE; ++i)
+        page[i] = rand();
+    if (PageCodec::compress(page, PAGE_SIZE, compressed, PAGE_SIZE - 1) != 0)
+        failed = -1;
+
+    remove(fileName.c_str());
+    rc = rbfm->createFile(fileName.c_str(), PAGE_SIZE, FILE_COMPRESSED);
+    assert(rc == success);
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName.c_str(), fileHandle);
+    assert(rc == success);
+
+    RID rid;
+    vector<RID> rids;
+    int recordSize = 0;
+    void *record = malloc(100);
+    void *returnedData = malloc(100);
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+    for (int i = 0; i < numRecords; ++i) {
+        prepareRecord(6, "Peters", i, 170.1, 5000, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success);
+        rids.push_back(rid);
+    }
+    unsigned numPages = fileHandle.getNumberOfPages();
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success);
+
+    // the pages take a fraction of their size on the disk
+    struct stat fileStat;
+    stat(fileName.c_str(), &fileStat);
+    if (fileStat.st_size >= (off_t)numPages * PAGE_SIZE / 2)
+        failed = -1;
+
+    rc = rbfm->openFile(fileName.c_str(), fileHandle);
+    assert(rc == success);
+    if (fileHandle.getNumberOfPages() != numPages)
+        failed = -1;
+    for (int i = 0; i < numRecords; ++i) {
+        prepareRecord(6, "Peters", i, 170.1, 5000, record, &recordSize);
+        rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedData);
+        if (rc != success || memcmp(record, returnedData, recordSize) != 0) {
+            failed = -1;
+            break;
+        }
+    }
+
+    free(record);
+    free(returnedData);
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success);
+    rc = rbfm->destroyFile(fileName.c_str());
+    assert(rc == success);
+
+    if (failed != 0) {
+        cout << "Test Case 25 Failed!" << endl << endl;
+        return -1;
+    }
+    cout << "Test Case 25 Passed!" << endl << endl;
+
+    return 0;
+}
+
+int RBFTest_26(PagedFileManager *pfm, RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Records of a new file are stored with field offsets, the ones of a file without the flag are not
+    // 2. Insert, update and read records in both formats
+    // 3. Read an attribute of a stored record without going through the ones before it
+    cout << "****In RBF Test Case 26****" << endl;
+
+    RC rc;
+    string fileNames[2] = {"test_offsets", "test_no_offsets"};
+    const int numRecords = 500;
+    int failed = 0;
+
+    remove(fileNames[0].c_str());
+    remove(fileNames[1].c_str());
+    rc = rbfm->createFile(fileNames[0]);
+    assert(rc == success);
+    rc = pfm->createFile(fileNames[1].c_str());
+    assert(rc == success);
+
+    int recordSize = 0;
+    void *record = malloc(100);
+    void *returnedData = malloc(100);
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+    for (int f = 0; f < 2; ++f) {
+        FileHandle fileHandle;
+        rc = rbfm->openFile(fileNames[f], fileHandle);
+        assert(rc == success);
+        if (((fileHandle.getFlags() & FILE_FIELD_OFFSETS) != 0) != (f == 0))
+            failed = -1;
+
+        vector<RID> rids;
+        RID rid;
+        for (int i = 0; i < numRecords; ++i) {
+            prepareRecord(1 + i % 30, "Peters Peters Peters Peters Peters", i, 170.1, 5000 + i,
+                    record, &recordSize);
+            rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+            assert(rc == success);
+            rids.push_back(rid);
+        }
+        // grow every other record, so that some of them are forwarded
+        for (int i = 0; i < numRecords; i += 2) {
+            prepareRecord(60, "Peters Peters Peters Peters Peters Peters Peters Peters Peters Peters",
+                    i, 170.1, 5000 + i, record, &recordSize);
+            rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[i]);
+            assert(rc == success);
+        }
+        for (int i = 0; i < numRecords && failed == 0; ++i) {
+            if (i % 2 == 0)
+                prepareRecord(60, "Peters Peters Peters Peters Peters Peters Peters Peters Peters Peters",
+                        i, 170.1, 5000 + i, record, &recordSize);
+            else
+                prepareRecord(1 + i % 30, "Peters Peters Peters Peters Peters", i, 170.1, 5000 + i,
+                        record, &recordSize);
+            rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedData);
+            if (rc != success || memcmp(record, returnedData, recordSize) != 0)
+                failed = -1;
+        }
+
+        // the last attribute of a stored record
+        rbfm->setFileLayout(fileHandle);
+        const char *stored;
+        unsigned storedSize = rbfm->getStoredRecord(record, recordDescriptor, stored);
+        if ((f == 0) != (storedSize > (unsigned)recordSize))
+            failed = -1;
+        int salary = 0;
+        if (rbfm->readRecordAttribute(stored, recordDescriptor, "Salary", &salary) != sizeof(int) ||
+                salary != 5000 + numRecords - 1)
+            failed = -1;
+        // an attribute the record does not have reads as the default value
+        salary = -1;
+        if (rbfm->readRecordAttribute(stored, recordDescriptor, "Bonus", &salary) != sizeof(int) ||
+                salary != 0)
+            failed = -1;
+
+        rc = rbfm->closeFile(fileHandle);
+        assert(rc == success);
+        rc = rbfm->destroyFile(fileNames[f]);
+        assert(rc == success);
+    }
+
+    free(record);
+    free(returnedData);
+
+    if (failed != 0) {
+        cout << "Test Case 26 Failed!" << endl << endl;
+        return -1;
+    }
+    cout << "Test Case 26 Passed!" << endl << endl;
+
+    return 0;
+}
+
+int RBFTest_27(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Insert records in a batch, the pages are written about once
+    // 2. Read the records of the batch
+    // 3. A record too big for a page stops the batch
+    cout << "****In RBF Test Case 27****" << endl;
+
+    RC rc;
+    string fileName = "test_batch";
+    const int numRecords = 2000;
+    int failed = 0;
+
+    remove(fileName.c_str());
+    rc = rbfm->createFile(fileName);
+    assert(rc == success);
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success);
+
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+    vector<char> records(numRecords * 100);
+    vector<const void *> data;
+    vector<int> sizes(numRecords);
+    for (int i = 0; i < numRecords; ++i) {
+        prepareRecord(1 + i % 30, "Peters Peters Peters Peters Peters", i, 170.1, 5000 + i,
+                &records[i * 100], &sizes[i]);
+        data.push_back(&records[i * 100]);
+    }
+    vector<RID> rids;
+    rc = rbfm->insertRecords(fileHandle, recordDescriptor, data, rids);
+    assert(rc == success);
+    // a page left with a little room may take a small record of a later page
+    if (rids.size() != data.size() ||
+            fileHandle.getIOStats().pagesWritten > 2 * fileHandle.getNumberOfPages())
+        failed = -1;
+
+    char returnedData[100];
+    for (int i = 0; i < numRecords && failed == 0; ++i) {
+        rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedData);
+        if (rc != success || memcmp(&records[i * 100], returnedData, sizes[i]) != 0)
+            failed = -1;
+    }
+
+    // the records before the one too big are inserted
+    vector<char> big(PAGE_SIZE + 100);
+    prepareRecord(PAGE_SIZE, string(PAGE_SIZE, 'P'), 0, 170.1, 5000, &big[0], &sizes[0]);
+    data.resize(3);
+    data[1] = &big[0];
+    rc = rbfm->insertRecords(fileHandle, recordDescriptor, data, rids);
+    if (rc != RECORD_OVERFLOW || rids.size() != 1)
+        failed = -1;
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success);
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success);
+
+    if (failed != 0) {
+        cout << "Test Case 27 Failed!" << endl << endl;
+        return -1;
+    }
+    cout << "Test Case 27 Passed!" << endl << endl;
+
+    return 0;
+}
+
+int RBFTest_28(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Scan a versioned file with conditions on a string and an int
+    // 2. Scan records of two versions, the older ones read the added attribute as 0
+    cout << "****In RBF Test Case 28****" << endl;
+
+    RC rc;
+    string fileName = "test_scan";
+    const int numRecords = 1000;
+    int failed = 0;
+    VersionManager *vm = VersionManager::instance();
+
+    remove(fileName.c_str());
+    rc = rbfm->createFile(fileName);
+    assert(rc == success);
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success);
+
+    // the version is the first attribute of a record, as the relation manager keeps it
+    vector<Attribute> recordDescriptor;
+    createVersionedFile(fileName, fileHandle, recordDescriptor);
+
+    // names "Peters" and "Petersen" alternate, the later version adds a bonus
+    char record[100];
+    int recordSize = 0;
+    RID rid;
+    VersionNumber ver;
+    for (int i = 0; i < 2 * numRecords; ++i) {
+        if (i == numRecords) {
+            Attribute attr;
+            attr.name = "Bonus";
+            attr.type = TypeInt;
+            attr.length = sizeof(int);
+            rc = vm->addAttribute(fileName, attr, fileHandle);
+            assert(rc == success);
+            recordDescriptor.push_back(attr);
+        }
+        rc = vm->getVersionNumber(fileName, ver);
+        assert(rc == success);
+        memcpy(record, &ver, sizeof(int));
+        prepareRecord(i % 2 == 0 ? 6 : 8, "Petersen", i, 170.1, 5000 + i,
+                record + sizeof(int), &recordSize);
+        if (i >= numRecords)
+            memcpy(record + sizeof(int) + recordSize, &i, sizeof(int));
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success);
+    }
+
+    // a string condition, "Peters" < "Petersen"
+    RBFM_ScanIterator scanIterator;
+    vector<string> names;
+    names.push_back("Age");
+    names.push_back("EmpName");
+    char value[100];
+    int length = 8;
+    memcpy(value, &length, sizeof(int));
+    memcpy(value + sizeof(int), "Petersen", length);
+    rc = rbfm->scan(fileHandle, recordDescriptor, "EmpName", LT_OP, value, names, scanIterator);
+    assert(rc == success);
+    char data[100];
+    int count = 0;
+    while (scanIterator.getNextRecord(rid, data) != RBFM_EOF) {
+        if (*(int *)data % 2 != 0 || *(int *)(data + sizeof(int)) != 6 ||
+                memcmp(data + 2 * sizeof(int), "Peters", 6) != 0)
+            failed = -1;
+        ++count;
+    }
+    scanIterator.close();
+    if (count != numRecords)
+        failed = -1;
+
+    // an int condition, and the attribute added by the later version
+    names.clear();
+    names.push_back("Bonus");
+    names.push_back("Salary");
+    int salary = 5000 + numRecords - 10;
+    rc = rbfm->scan(fileHandle, recordDescriptor, "Salary", GE_OP, &salary, names, scanIterator);
+    assert(rc == success);
+    count = 0;
+    while (scanIterator.getNextRecord(rid, data) != RBFM_EOF) {
+        int bonus = *(int *)data;
+        salary = *(int *)(data + sizeof(int));
+        if (bonus != (salary - 5000 < numRecords ? 0 : salary - 5000))
+            failed = -1;
+        ++count;
+    }
+    scanIterator.close();
+    if (count != numRecords + 10)
+        failed = -1;
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success);
+    vm->eraseTableVersionInfo(fileName);
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success);
+
+    if (failed != 0) {
+        cout << "Test Case 28 Failed!" << endl << endl;
+        return -1;
+    }
+    cout << "Test Case 28 Passed!" << endl << endl;
+
+    return 0;
+}
+
+int RBFTest_29(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. The descriptor of a version is compiled once and shared
+    // 2. Positions and fixed offsets of the attributes
+    // 3. A new version gets a new descriptor, the old one stays valid
+    cout << "****In RBF Test Case 29****" << endl;
+
+    RC rc;
+    string fileName = "test_descriptor";
+    int failed = 0;
+    VersionManager *vm = VersionManager::instance();
+
+    remove(fileName.c_str());
+    rc = rbfm->createFile(fileName);
+    assert(rc == success);
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success);
+
+    // Ver, EmpName, Age, Height, Salary
+    vector<Attribute> recordDescriptor;
+    createVersionedFile(fileName, fileHandle, recordDescriptor);
+
+    VersionNumber ver;
+    rc = vm->getVersionNumber(fileName, ver);
+    assert(rc == success);
+    VersionDescriptorPtr first, second;
+    rc = vm->getDescriptor(fileName, first, ver);
+    assert(rc == success);
+    rc = vm->getDescriptor(fileName, second, ver);
+    assert(rc == success);
+    if (first != second || first->attrs.size() != recordDescriptor.size())
+        failed = -1;
+    if (first->getIndex("Salary") != 4 || first->getIndex("Bonus") != -1 ||
+            first->fixedOffsets[1] != (int)sizeof(int) || first->fixedOffsets[2] != -1 ||
+            first->varcharIndex.size() != 1 || first->varcharIndex[0] != 1)
+        failed = -1;
+    if (vm->getDescriptor(fileName, second, ver + 1) != VERSION_OVERFLOW)
+        failed = -1;
+
+    Attribute attr;
+    attr.name = "Bonus";
+    attr.type = TypeInt;
+    attr.length = sizeof(int);
+    rc = vm->addAttribute(fileName, attr, fileHandle);
+    assert(rc == success);
+    rc = vm->getDescriptor(fileName, second, ver + 1);
+    assert(rc == success);
+    if (second == first || second->getIndex("Bonus") != 5 || first->getIndex("Bonus") != -1)
+        failed = -1;
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success);
+    vm->eraseTableVersionInfo(fileName);
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success);
+
+    if (failed != 0) {
+        cout << "Test Case 29 Failed!" << endl << endl;
+        return -1;
+    }
+    cout << "Test Case 29 Passed!" << endl << endl;
+
+    return 0;
+}
+
+int RBFTest_30(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Translate data of an old version after adding and dropping attributes
+    // 2. The translation does not need the file once the table is loaded
+    cout << "****In RBF Test Case 30****" << endl;
+
+    RC rc;
+    string fileName = "test_translation";
+    int failed = 0;
+    VersionManager *vm = VersionManager::instance();
+
+    remove(fileName.c_str());
+    rc = rbfm->createFile(fileName);
+    assert(rc == success);
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success);
+
+    // Ver, EmpName, Age, Height, Salary
+    vector<Attribute> recordDescriptor;
+    createVersionedFile(fileName, fileHandle, recordDescriptor);
+
+    // version 1 adds Bonus, version 2 drops Age
+    Attribute attr;
+    attr.name = "Bonus";
+    attr.type = TypeInt;
+    attr.length = sizeof(int);
+    rc = vm->addAttribute(fileName, attr, fileHandle);
+    assert(rc == success);
+    rc = vm->dropAttribute(fileName, "Age", fileHandle);
+    assert(rc == success);
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success);
+
+    // Ver, EmpName, Age, Height, Salary of version 0
+    char oldData[100];
+    char latestData[100];
+    char expected[100];
+    int ver = 0, salary = 9000, bonus = 0;
+    int recordSize = 0;
+    memcpy(oldData, &ver, sizeof(int));
+    prepareRecord(6, "Peters", 24, 170.1, salary, oldData + sizeof(int), &recordSize);
+    // Ver, EmpName, Height, Salary, Bonus
+    memcpy(expected, oldData, sizeof(int) * 2 + 6);
+    memcpy(expected + sizeof(int) * 2 + 6, oldData + sizeof(int) * 3 + 6, sizeof(int) * 2);
+    memcpy(expected + sizeof(int) * 4 + 6, &bonus, sizeof(int));
+
+    // twice to go through the cached plan
+    for (int i = 0; i < 2; ++i) {
+        memset(latestData, 0xff, sizeof(latestData));
+        rc = vm->translateData2LastedVersion(fileName, 0, oldData, latestData);
+        if (rc != success || memcmp(latestData, expected, sizeof(int) * 5 + 6) != 0)
+            failed = -1;
+    }
+
+    // Ver, EmpName, Age, Height, Salary, Bonus of version 1
+    bonus = 50;
+    memcpy(oldData + sizeof(int) + recordSize, &bonus, sizeof(int));
+    memcpy(expected + sizeof(int) * 4 + 6, &bonus, sizeof(int));
+    rc = vm->translateData2LastedVersion(fileName, 1, oldData, latestData);
+    if (rc != success || memcmp(latestData, expected, sizeof(int) * 5 + 6) != 0)
+        failed = -1;
+
+    vm->eraseTableVersionInfo(fileName);
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success);
+
+    if (failed != 0) {
+        cout << "Test Case 30 Failed!" << endl << endl;
+        return -1;
+    }
+    cout << "Test Case 30 Passed!" << endl << endl;
+
+    return 0;
+}
+
+int RBFTest_31(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. A file with zone maps skips the pages a range condition cannot meet
+    // 2. The summaries are kept across an update, a reopen and deleting all records
+    // 3. The files copied while open, as after a crash, read every page
+    // 4. An attribute dropped and added again is no longer summarized
+    cout << "****In RBF Test Case 31****" << endl;
+
+    RC rc;
+    string fileName = "test_zone";
+    const int numRecords = 2000;
+    int failed = 0;
+    VersionManager *vm = VersionManager::instance();
+
+    remove(fileName.c_str());
+    rc = rbfm->createFile(fileName, PAGE_SIZE, FILE_ZONE_MAPS);
+    assert(rc == success);
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success);
+
+    // Ver, EmpName, Age, Height, Salary
+    vector<Attribute> recordDescriptor;
+    createVersionedFile(fileName, fileHandle, recordDescriptor);
+
+    // the salaries grow with the pages
+    char record[100];
+    int recordSize = 0;
+    RID rid, firstRid, middleRid;
+    int ver = 0;
+    for (int i = 0; i < numRecords; ++i) {
+        memcpy(record, &ver, sizeof(int));
+        prepareRecord(6, "Peters", 24, 170.1, i, record + sizeof(int), &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success);
+        if (i == 0)
+            firstRid = rid;
+        if (i == numRecords / 2)
+            middleRid = rid;
+    }
+    unsigned numPages = fileHandle.getNumberOfPages();
+
+    // the salary is the last attribute, right after the age
+    RBFM_ScanIterator scanIterator;
+    vector<string> names;
+    names.push_back("Salary");
+    char data[100];
+    int salary = numRecords - 10;
+    int count = 0;
+    for (int round = 0; round < 4; ++round) {
+        if (round == 1) {
+            // a record of the first page gets the greatest salary
+            prepareRecord(6, "Peters", 24, 170.1, numRecords, record + sizeof(int), &recordSize);
+            rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, firstRid);
+            assert(rc == success);
+        } else if (round == 2) {
+            rc = rbfm->closeFile(fileHandle);
+            assert(rc == success);
+            rc = rbfm->openFile(fileName, fileHandle);
+            assert(rc == success);
+            // a record of a middle page too, after the summaries were written
+            prepareRecord(6, "Peters", 24, 170.1, numRecords + 1, record + sizeof(int), &recordSize);
+            rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, middleRid);
+            assert(rc == success);
+            // the side file on the disk is marked changed until the close
+            string copyName = fileName + "_copy";
+            for (int i = 0; i < 2; ++i) {
+                string suffix = i == 0 ? "" : ZONE_FILE_SUFFIX;
+                ifstream in((fileName + suffix).c_str(), ifstream::in | ifstream::binary);
+                ofstream out((copyName + suffix).c_str(), ofstream::out | ofstream::binary);
+                out << in.rdbuf();
+            }
+            FileHandle copyHandle;
+            rc = rbfm->openFile(copyName, copyHandle);
+            assert(rc == success);
+            rc = rbfm->scan(copyHandle, recordDescriptor, "Salary", GE_OP, &salary, names, scanIterator);
+            assert(rc == success);
+            count = 0;
+            while (scanIterator.getNextRecord(rid, data) != RBFM_EOF)
+                ++count;
+            scanIterator.close();
+            if (count != 12 || copyHandle.getIOStats().pagesRead <= 4)
+                failed = -1;
+            rc = rbfm->closeFile(copyHandle);
+            assert(rc == success);
+            vm->eraseTableVersionInfo(copyName);
+            rc = rbfm->destroyFile(copyName);
+            assert(rc == success);
+        } else if (round == 3) {
+            // an attribute dropped and added again reads every page
+            rc = vm->dropAttribute(fileName, "Salary", fileHandle);
+            assert(rc == success);
+            rc = vm->addAttribute(fileName, recordDescriptor.back(), fileHandle);
+            assert(rc == success);
+            fileHandle.resetIOStats();
+            rc = rbfm->scan(fileHandle, recordDescriptor, "Salary", GE_OP, &salary, names, scanIterator);
+            assert(rc == success);
+            count = 0;
+            while (scanIterator.getNextRecord(rid, data) != RBFM_EOF)
+                ++count;
+            scanIterator.close();
+            if (count != 12 || fileHandle.getIOStats().pagesRead <= 4)
+                failed = -1;
+
+            rc = rbfm->deleteRecords(fileHandle);
+            assert(rc == success);
+        }
+        fileHandle.resetIOStats();
+        rc = rbfm->scan(fileHandle, recordDescriptor, "Salary", GE_OP, &salary, names, scanIterator);
+        assert(rc == success);
+        count = 0;
+        while (scanIterator.getNextRecord(rid, data) != RBFM_EOF) {
+            if (*(int *)data < salary)
+                failed = -1;
+            ++count;
+        }
+        scanIterator.close();
+        if (count != (round == 0 ? 10 : round == 1 ? 11 : round == 2 ? 12 : 0))
+            failed = -1;
+        // the last page and the ones updated
+        if (fileHandle.getIOStats().pagesRead > (round == 0 ? 2 : round == 1 ? 3 : round == 2 ? 4 : 0))
+            failed = -1;
+    }
+    if (numPages < 10)
+        failed = -1;
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success);
+    vm->eraseTableVersionInfo(fileName);
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success);
+    if (PagedFileManager::instance()->fileExist((fileName + ZONE_FILE_SUFFIX).c_str()))
+        failed = -1;
+
+    if (failed != 0) {
+        cout << "Test Case 31 Failed!" << endl << endl;
+        return -1;
+    }
+    cout << "Test Case 31 Passed!" << endl << endl;
+
+    return 0;
+}
+
+int RBFTest_32(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Parallel scan through the iterator, every record that qualifies comes out once
+    // 2. Parallel scan into per-worker sinks, and a sink that fails stops the scan
+    cout << "****In RBF Test Case 32****" << endl;
+
+    RC rc;
+    string fileName = "test_parallel";
+    const int numRecords = 10000;
+    const unsigned numThreads = 4;
+    int failed = 0;
+    VersionManager *vm = VersionManager::instance();
+
+    remove(fileName.c_str());
+    rc = rbfm->createFile(fileName);
+    assert(rc == success);
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success);
+
+    // Ver, EmpName, Age, Height, Salary
+    vector<Attribute> recordDescriptor;
+    createVersionedFile(fileName, fileHandle, recordDescriptor);
+
+    char record[100];
+    int recordSize = 0;
+    RID rid;
+    int ver = 0;
+    for (int i = 0; i < numRecords; ++i) {
+        memcpy(record, &ver, sizeof(int));
+        prepareRecord(6, "Peters", i % 100, 170.1, i, record + sizeof(int), &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success);
+    }
+    if (fileHandle.getNumberOfPages() < 2 * PARALLEL_SCAN_MORSEL_PAGES)
+        failed = -1;
+
+    // the salaries of the records with an age under 10
+    vector<string> names;
+    names.push_back("EmpName");
+    names.push_back("Salary");
+    int age = 10;
+    RBFM_ParallelScanIterator parallelIterator;
+    rc = rbfm->parallelScan(fileHandle, recordDescriptor, "Age", LT_OP, &age, names,
+            numThreads, parallelIterator);
+    assert(rc == success);
+    vector<bool> seen(numRecords, false);
+    char data[100];
+    int count = 0;
+    while (parallelIterator.getNextRecord(rid, data) != RBFM_EOF) {
+        int salary = *(int *)(data + sizeof(int) + 6);
+        if (*(int *)data != 6 || memcmp(data + sizeof(int), "Peters", 6) != 0 ||
+                salary < 0 || salary >= numRecords || salary % 100 >= age || seen[salary])
+            failed = -1;
+        else
+            seen[salary] = true;
+        ++count;
+    }
+    parallelIterator.close();
+    if (count != numRecords / 100 * age)
+        failed = -1;
+
+    // a sum per worker
+    vector<long long> sums(numThreads, 0);
+    ScanSink sink = [&sums](unsigned worker, const RID &rid, const void *data) {
+        sums[worker] += *(const int *)((const char *)data + sizeof(int) + 6);
+        return (RC)success;
+    };
+    rc = rbfm->parallelScan(fileHandle, recordDescriptor, "", NO_OP, NULL, names,
+            numThreads, sink);
+    long long sum = 0;
+    for (unsigned i = 0; i < numThreads; ++i)
+        sum += sums[i];
+    if (rc != success || sum != (long long)numRecords * (numRecords - 1) / 2)
+        failed = -1;
+
+    // the error of a sink is returned
+    ScanSink failingSink = [](unsigned worker, const RID &rid, const void *data) {
+        return (RC)RECORD_OVERFLOW;
+    };
+    rc = rbfm->parallelScan(fileHandle, recordDescriptor, "", NO_OP, NULL, names,
+            numThreads, failingSink);
+    if (rc != RECORD_OVERFLOW)
+        failed = -1;
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success);
+    vm->eraseTableVersionInfo(fileName);
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success);
+
+    if (failed != 0) {
+        cout << "Test Case 32 Failed!" << endl << endl;
+        return -1;
+    }
+    cout << "Test Case 32 Passed!" << endl << endl;
+
+    return 0;
+}
+
+int RBFTest_33(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Batch scan returns the same records in the same order as getNextRecord
+    // 2. A record that does not fit is left for the next batch
+    cout << "****In RBF Test Case 33****" << endl;
+
+    RC rc;
+    string fileName = "test_batch";
+    const int numRecords = 2000;
+    int failed = 0;
+    VersionManager *vm = VersionManager::instance();
+
+    remove(fileName.c_str());
+    rc = rbfm->createFile(fileName);
+    assert(rc == success);
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success);
+
+    // Ver, EmpName, Age, Height, Salary
+    vector<Attribute> recordDescriptor;
+    createVersionedFile(fileName, fileHandle, recordDescriptor);
+
+    // names of different lengths
+    char record[100];
+    int recordSize = 0;
+    RID rid;
+    int ver = 0;
+    string name = "PetersPetersPeters";
+    for (int i = 0; i < numRecords; ++i) {
+        memcpy(record, &ver, sizeof(int));
+        prepareRecord(i % 18 + 1, name.substr(0, i % 18 + 1), i % 100, 170.1, i,
+                record + sizeof(int), &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success);
+    }
+
+    vector<string> names;
+    names.push_back("EmpName");
+    names.push_back("Salary");
+    int age = 50;
+
+    // the records one at a time
+    vector<RID> expectedRids;
+    vector<string> expected;
+    RBFM_ScanIterator scanIterator;
+    rc = rbfm->scan(fileHandle, recordDescriptor, "Age", LT_OP, &age, names, scanIterator);
+    assert(rc == success);
+    char data[100];
+    while (scanIterator.getNextRecord(rid, data) != RBFM_EOF) {
+        expectedRids.push_back(rid);
+        expected.push_back(string(data, sizeof(int) + *(int *)data + sizeof(int)));
+    }
+    scanIterator.close();
+    if (int(expected.size()) != numRecords / 100 * age)
+        failed = -1;
+
+    // the records in batches of a few hundred bytes
+    rc = rbfm->scan(fileHandle, recordDescriptor, "Age", LT_OP, &age, names, scanIterator);
+    assert(rc == success);
+    char buffer[300];
+    vector<RID> rids;
+    unsigned count;
+    // a buffer smaller than the first record gets nothing and does not move the scan
+    if (scanIterator.getNextBatch(buffer, sizeof(int), rids, count) != SCANITER_BATCH_TOO_SMALL ||
+            count != 0)
+        failed = -1;
+    unsigned numRead = 0, numBatches = 0;
+    while ((rc = scanIterator.getNextBatch(buffer, sizeof(buffer), rids, count)) == success) {
+        ++numBatches;
+        if (count == 0 || rids.size() != count)
+            failed = -1;
+        unsigned offset = 0;
+        for (unsigned i = 0; i < count && numRead < expected.size(); ++i, ++numRead) {
+            unsigned size = sizeof(int) + *(int *)(buffer + offset) + sizeof(int);
+            if (rids[i].pageNum != expectedRids[numRead].pageNum ||
+                    rids[i].slotNum != expectedRids[numRead].slotNum ||
+                    string(buffer + offset, size) != expected[numRead])
+                failed = -1;
+            offset += size;
+        }
+        if (offset > sizeof(buffer))
+            failed = -1;
+    }
+    if (rc != RBFM_EOF || count != 0 || numRead != expected.size() ||
+            numBatches >= expected.size())
+        failed = -1;
+    scanIterator.close();
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success);
+    vm->eraseTableVersionInfo(fileName);
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success);
+
+    if (failed != 0) {
+        cout << "Test Case 33 Failed!" << endl << endl;
+        return -1;
+    }
+    cout << "Test Case 33 Passed!" << endl << endl;
+
+    return 0;
+}
+
+int RBFTest_34(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Insert, read, update, delete and scan the records of PAX pages
+    // 2. The values of a field are kept together in the page
+    // 3. The records of a new version go to pages of their own
+    cout << "****In RBF Test Case 34****" << endl;
+
+    RC rc;
+    string fileName = "test_pax";
+    const int numRecords = 1000;
+    int failed = 0;
+    VersionManager *vm = VersionManager::instance();
+
+    remove(fileName.c_str());
+    rc = rbfm->createFile(fileName, PAGE_SIZE, FILE_PAX_PAGES);
+    assert(rc == success);
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success);
+
+    // Ver, EmpName, Age, Height, Salary
+    vector<Attribute> recordDescriptor;
+    createVersionedFile(fileName, fileHandle, recordDescriptor);
+
+    // names of different lengths, half of the records inserted in a batch
+    vector<string> records(numRecords);
+    vector<RID> rids(numRecords);
+    char record[100];
+    int recordSize = 0;
+    int ver = 0;
+    string name = "PetersPetersPeters";
+    for (int i = 0; i < numRecords; ++i) {
+        memcpy(record, &ver, sizeof(int));
+        prepareRecord(i % 18, name.substr(0, i % 18), i % 100, 170.1, i,
+                record + sizeof(int), &recordSize);
+        records[i].assign(record, sizeof(int) + recordSize);
+    }
+    for (int i = 0; i < numRecords / 2; ++i) {
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, records[i].data(), rids[i]);
+        assert(rc == success);
+    }
+    vector<const void *> batch;
+    vector<RID> batchRids;
+    for (int i = numRecords / 2; i < numRecords; ++i)
+        batch.push_back(records[i].data());
+    rc = rbfm->insertRecords(fileHandle, recordDescriptor, batch, batchRids);
+    assert(rc == success);
+    copy(batchRids.begin(), batchRids.end(), rids.begin() + numRecords / 2);
+
+    // the salaries of the first page are an array
+    PageNum firstPage = fileHandle.getSpaceManager()->getDataPage(TABLE_PAGES_NUM);
+    char page[PAGE_SIZE];
+    rc = fileHandle.readPage(firstPage, page);
+    assert(rc == success);
+    PaxPage paxPage;
+    paxPage.load(page, rbfm->getDataSize(page));
+    if (paxPage.numRows == 0 || paxPage.numFields != 5 || paxPage.layouts[4] != PAX_FIXED ||
+            paxPage.layouts[1] != PAX_VARIABLE)
+        failed = -1;
+    for (int i = 0; i < numRecords && failed == 0; ++i) {
+        if (rids[i].pageNum != firstPage)
+            continue;
+        int salary = *(int *)(paxPage.columns[4] + sizeof(int) * (rids[i].slotNum - 1));
+        if (salary != i)
+            failed = -1;
+    }
+
+    // shorter and longer names, some of which move to another page
+    for (int i = 0; i < numRecords; i += 7) {
+        int length = i % 2 == 0 ? 0 : 18;
+        memcpy(record, &ver, sizeof(int));
+        prepareRecord(length, name.substr(0, length), i % 100, 170.1, i,
+                record + sizeof(int), &recordSize);
+        records[i].assign(record, sizeof(int) + recordSize);
+        rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success);
+    }
+    for (int i = 0; i < numRecords; i += 5) {
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+        assert(rc == success);
+    }
+    rc = rbfm->reorganizePage(fileHandle, recordDescriptor, firstPage);
+    assert(rc == success);
+
+    // read the records and their salaries
+    char data[100];
+    for (int i = 0; i < numRecords; ++i) {
+        rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], data);
+        if (i % 5 == 0) {
+            if (rc == success)
+                failed = -1;
+            continue;
+        }
+        if (rc != success || string(data, records[i].size()) != records[i])
+            failed = -1;
+        int salary = -1;
+        rc = rbfm->readAttribute(fileHandle, recordDescriptor, rids[i], "Salary", &salary);
+        if (rc != success || salary != i)
+            failed = -1;
+    }
+
+    // the names of the records with an age under 30
+    vector<string> names;
+    names.push_back("Salary");
+    names.push_back("EmpName");
+    int age = 30;
+    RBFM_ScanIterator scanIterator;
+    rc = rbfm->scan(fileHandle, recordDescriptor, "Age", LT_OP, &age, names, scanIterator);
+    assert(rc == success);
+    vector<bool> seen(numRecords, false);
+    int count = 0;
+    RID rid;
+    while (scanIterator.getNextRecord(rid, data) != RBFM_EOF) {
+        int salary = *(int *)data;
+        int length = *(int *)(data + sizeof(int));
+        if (salary < 0 || salary >= numRecords || salary % 5 == 0 || salary % 100 >= age ||
+                seen[salary] || records[salary].compare(sizeof(int), sizeof(int) + length,
+                data + sizeof(int), sizeof(int) + length) != 0)
+            failed = -1;
+        else
+            seen[salary] = true;
+        ++count;
+    }
+    scanIterator.close();
+    if (count != numRecords / 100 * age * 4 / 5)
+        failed = -1;
+
+    // version 1 adds Bonus, its records do not share the pages of version 0
+    Attribute attr;
+    attr.name = "Bonus";
+    attr.type = TypeInt;
+    attr.length = sizeof(int);
+    rc = vm->addAttribute(fileName, attr, fileHandle);
+    assert(rc == success);
+    recordDescriptor.push_back(attr);
+    ver = 1;
+    int bonus = 77;
+    memcpy(record, &ver, sizeof(int));
+    prepareRecord(6, "Peters", 20, 170.1, numRecords, record + sizeof(int), &recordSize);
+    memcpy(record + sizeof(int) + recordSize, &bonus, sizeof(int));
+    RID newRid;
+    rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, newRid);
+    assert(rc == success);
+    for (int i = 0; i < numRecords; ++i) {
+        if (i % 5 != 0 && rids[i].pageNum == newRid.pageNum)
+            failed = -1;
+    }
+    rc = rbfm->readRecord(fileHandle, recordDescriptor, newRid, data);
+    if (rc != success || memcmp(data, record, sizeof(int) * 2 + recordSize) != 0)
+        failed = -1;
+    names.clear();
+    names.push_back("Bonus");
+    rc = rbfm->scan(fileHandle, recordDescriptor, "Salary", GE_OP, &numRecords, names, scanIterator);
+    assert(rc == success);
+    count = 0;
+    while (scanIterator.getNextRecord(rid, data) != RBFM_EOF) {
+        if (*(int *)data != bonus || rid.pageNum != newRid.pageNum || rid.slotNum != newRid.slotNum)
+            failed = -1;
+        ++count;
+    }
+    scanIterator.close();
+    if (count != 1)
+        failed = -1;
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success);
+    vm->eraseTableVersionInfo(fileName);
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success);
+
+    if (failed != 0) {
+        cout << "Test Case 34 Failed!" << endl << endl;
+        return -1;
+    }
+    cout << "Test Case 34 Passed!" << endl << endl;
+
+    return 0;
+}
+
+int RBFTest_35(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. The predicate kernels select the int and real values one at a time would
+    // 2. Runs of any length and alignment, and the bits past the run are clear
+    cout << "****In RBF Test Case 35****" << endl;
+
+    const int numValues = 1000;
+    int failed = 0;
+    vector<int> ints(numValues + 1);
+    vector<float> reals(numValues + 1);
+    for (int i = 0; i <= numValues; ++i) {
+        ints[i] = (i * 7919) % 61 - 30;
+        reals[i] = ints[i] / 4.0f;
+    }
+    ints[10] = INT_MIN;
+    ints[11] = INT_MAX;
+    reals[12] = 0.0f / 0.0f;
+    reals[13] = -0.0f;
+
+    vector<unsigned char> selection(SELECTION_BYTES(numValues) + 1);
+    for (int op = EQ_OP; op <= NO_OP; ++op) {
+        CompOp compOp = (CompOp)op;
+        for (int count = 0; count <= numValues; count = count < 80 ? count + 1 : count * 3) {
+            if (count > numValues)
+                count = numValues;
+            for (int start = 0; start <= 1; ++start) {
+                int run = min(count, numValues - start);
+                for (int type = 0; type <= 1; ++type) {
+                    memset(&selection[0], 0xff, selection.size());
+                    unsigned hits = type == 0 ?
+                            selectValues(&ints[start], run, compOp, 3, &selection[0]) :
+                            selectValues(&reals[start], run, compOp, 0.0f, &selection[0]);
+                    unsigned expected = 0;
+                    for (int i = 0; i < run; ++i) {
+                        bool meets;
+                        if (type == 0) {
+                            int lhs = ints[start + i], rhs = 3;
+                            meets = compOp == EQ_OP ? lhs == rhs : compOp == LT_OP ? lhs < rhs :
+                                    compOp == GT_OP ? lhs > rhs : compOp == LE_OP ? lhs <= rhs :
+                                    compOp == GE_OP ? lhs >= rhs : compOp == NE_OP ? lhs != rhs : true;
+                        } else {
+                            float lhs = reals[start + i], rhs = 0.0f;
+                            meets = compOp == EQ_OP ? lhs == rhs : compOp == LT_OP ? lhs < rhs :
+                                    compOp == GT_OP ? lhs > rhs : compOp == LE_OP ? lhs <= rhs :
+                                    compOp == GE_OP ? lhs >= rhs : compOp == NE_OP ? lhs != rhs : true;
+                        }
+                        expected += meets;
+                        if (bool(selection[i / 8] & (1 << (i % 8))) != meets)
+                            failed = -1;
+                    }
+                    for (int i = run; i < SELECTION_BYTES(run) * 8; ++i) {
+                        if (selection[i / 8] & (1 << (i % 8)))
+                            failed = -1;
+                    }
+                    if (hits != expected)
+                        failed = -1;
+                }
+            }
+            if (count == numValues)
+                break;
+        }
+    }
+
+    if (failed != 0) {
+        cout << "Test Case 35 Failed!" << endl << endl;
+        return -1;
+    }
+    cout << "Test Case 35 Passed!" << endl << endl;
+
+    return 0;
+}
+
+int RBFTest_36(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Open a file made without a free space map
+    // 2. Its records start at the first data page and every later page is a data page
+    // 3. The free space of its pages is found when it is opened again
+    cout << "****In RBF Test Case 36****" << endl;
+
+    RC rc;
+    string fileName = "test_nomap";
+    const int numRecords = 2000;
+    int failed = 0;
+
+    remove(fileName.c_str());
+    rc = PagedFileManager::instance()->createFile(fileName.c_str());
+    assert(rc == success);
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success);
+    if (fileHandle.getSpaceManager()->hasSpaceMap())
+        failed = -1;
+
+    vector<Attribute> recordDescriptor;
+    createVersionedFile(fileName, fileHandle, recordDescriptor);
+
+    vector<string> records(numRecords);
+    vector<RID> rids(numRecords);
+    char record[100];
+    int recordSize = 0;
+    int ver = 0;
+    string name = "PetersPetersPeters";
+    for (int i = 0; i < numRecords; ++i) {
+        memcpy(record, &ver, sizeof(int));
+        prepareRecord(i % 18, name.substr(0, i % 18), i % 100, 170.1, i,
+                record + sizeof(int), &recordSize);
+        records[i].assign(record, sizeof(int) + recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, records[i].data(), rids[i]);
+        assert(rc == success);
+    }
+    // no page is kept for the map
+    if (rids[0].pageNum != TABLE_PAGES_NUM)
+        failed = -1;
+    for (int i = 1; i < numRecords; ++i) {
+        if (rids[i].pageNum > rids[i - 1].pageNum + 1)
+            failed = -1;
+    }
+    // free the space of every other record
+    for (int i = 0; i < numRecords; i += 2) {
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+        assert(rc == success);
+    }
+    unsigned numPages = fileHandle.getNumberOfPages();
+    for (PageNum pageNum = TABLE_PAGES_NUM; pageNum < numPages; ++pageNum) {
+        rc = rbfm->reorganizePage(fileHandle, recordDescriptor, pageNum);
+        assert(rc == success);
+    }
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success);
+
+    // the freed space is found by reading the pages
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success);
+    for (int i = 0; i < numRecords; i += 2) {
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, records[i].data(), rids[i]);
+        assert(rc == success);
+    }
+    if (fileHandle.getNumberOfPages() != numPages)
+        failed = -1;
+    char data[100];
+    for (int i = 0; i < numRecords && failed == 0; ++i) {
+        rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], data);
+        if (rc != success || memcmp(data, records[i].data(), records[i].size()) != 0)
+            failed = -1;
+    }
+    RBFM_ScanIterator scanIterator;
+    vector<string> names;
+    names.push_back("Salary");
+    int salary = 0;
+    rc = rbfm->scan(fileHandle, recordDescriptor, "Salary", GE_OP, &salary, names, scanIterator);
+    assert(rc == success);
+    RID rid;
+    int count = 0;
+    while (scanIterator.getNextRecord(rid, data) != RBFM_EOF)
+        ++count;
+    scanIterator.close();
+    if (count != numRecords)
+        failed = -1;
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success);
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success);
+
+    if (failed != 0) {
+        cout << "Test Case 36 Failed!" << endl << endl;
+        return -1;
+    }
+    cout << "Test Case 36 Passed!" << endl << endl;
+
+    return 0;
+}
+
+int RBFTest_37(PagedFileManager *pfm)
+{
+    // Functions Tested:
+    // 1. Read Ahead: pages are prefetched after sequential reads
+    // 2. Read Ahead: the window is refilled when half of it is read
+    // 3. Read Ahead: a seek or a random read starts over
+    cout << "****In RBF Test Case 37****" << endl;
+
+    RC rc;
+    string fileName = "test_readahead";
+    const unsigned numPages = 100;
+    const unsigned window = 8;
+
+    remove(fileName.c_str());
+    rc = pfm->createFile(fileName.c_str());
+    assert(rc == success);
+    FileHandle fileHandle;
+    rc = pfm->openFile(fileName.c_str(), fileHandle);
+    assert(rc == success);
+    char *data = (char *)malloc(PAGE_SIZE);
+    memset(data, 'r', PAGE_SIZE);
+    for (unsigned i = 0; i < numPages; ++i) {
+        rc = fileHandle.appendPage(data);
+        assert(rc == success);
+    }
+    pfm->setReadAhead(window);
+
+    int failed = 0;
+    IOStats before = fileHandle.getIOStats();
+    // two sequential reads after a seek do not prefetch, the third does
+    for (PageNum pageNum = 10; pageNum < 12; ++pageNum) {
+        rc = fileHandle.readPage(pageNum, data);
+        assert(rc == success);
+    }
+    if ((fileHandle.getIOStats() - before).pagesPrefetched != 0)
+        failed = -1;
+    rc = fileHandle.readPage(12, data);
+    assert(rc == success);
+    if ((fileHandle.getIOStats() - before).pagesPrefetched != window)
+        failed = -1;
+    // the window is not refilled before half of it is read, nor by a page read again
+    for (PageNum pageNum = 13; pageNum < 17; ++pageNum) {
+        rc = fileHandle.readPage(pageNum, data);
+        assert(rc == success);
+    }
+    rc = fileHandle.readPage(16, data);
+    assert(rc == success);
+    if ((fileHandle.getIOStats() - before).pagesPrefetched != window)
+        failed = -1;
+    // then only the pages past the window are prefetched, 21 to 25
+    rc = fileHandle.readPage(17, data);
+    assert(rc == success);
+    if ((fileHandle.getIOStats() - before).pagesPrefetched != window + 5)
+        failed = -1;
+
+    // random reads prefetch nothing
+    before = fileHandle.getIOStats();
+    PageNum randomPages[] = {5, 60, 7, 30, 31, 90, 2};
+    for (unsigned i = 0; i < sizeof(randomPages) / sizeof(PageNum); ++i) {
+        rc = fileHandle.readPage(randomPages[i], data);
+        assert(rc == success);
+    }
+    if ((fileHandle.getIOStats() - before).pagesPrefetched != 0)
+        failed = -1;
+
+    // a seek starts over, and the window stops at the last page
+    before = fileHandle.getIOStats();
+    for (PageNum pageNum = 50; pageNum < 53; ++pageNum) {
+        rc = fileHandle.readPage(pageNum, data);
+        assert(rc == success);
+    }
+    if ((fileHandle.getIOStats() - before).pagesPrefetched != window)
+        failed = -1;
+    before = fileHandle.getIOStats();
+    for (PageNum pageNum = numPages - 4; pageNum < numPages; ++pageNum) {
+        rc = fileHandle.readPage(pageNum, data);
+        assert(rc == success);
+    }
+    if ((fileHandle.getIOStats() - before).pagesPrefetched != 1)
+        failed = -1;
+
+    // no window, no read ahead
+    pfm->setReadAhead(0);
+    before = fileHandle.getIOStats();
+    for (PageNum pageNum = 20; pageNum < 40; ++pageNum) {
+        rc = fileHandle.readPage(pageNum, data);
+        assert(rc == success);
+    }
+    if ((fileHandle.getIOStats() - before).pagesPrefetched != 0)
+        failed = -1;
+    pfm->setReadAhead(READ_AHEAD_PAGES);
+
+    free(data);
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success);
+    rc = pfm->destroyFile(fileName.c_str());
+    assert(rc == success);
+
+    if (failed != 0) {
+        cout << "Test Case 37 Failed!" << endl << endl;
+        return -1;
+    }
+    cout << "Test Case 37 Passed!" << endl << endl;
+
+    return 0;
+}
+
+int RBFTest_38(PagedFileManager *pfm)
+{
+    // Functions Tested:
+    // 1. Flushing a file or the pool leaves a dirty pinned page to its holder
+    // 2. The page is written once it is unpinned
+    // 3. Write through: the last holder of a page writes it
+    cout << "****In RBF Test Case 38****" << endl;
+
+    RC rc;
+    string fileName = "test_flush_pinned";
+    const unsigned numPages = 4;
+
+    remove(fileName.c_str());
+    rc = pfm->setWritePolicy(WRITE_DEFERRED);
+    assert(rc == success);
+    rc = pfm->createFile(fileName.c_str());
+    assert(rc == success);
+    FileHandle fileHandle;
+    rc = pfm->openFile(fileName.c_str(), fileHandle);
+    assert(rc == success);
+    char *data = (char *)malloc(PAGE_SIZE);
+    memset(data, 'a', PAGE_SIZE);
+    for (unsigned i = 0; i < numPages; ++i) {
+        rc = fileHandle.appendPage(data);
+        assert(rc == success);
+    }
+    rc = pfm->bufferManager.flushFile(fileName);
+    assert(rc == success);
+
+    int failed = 0;
+    // the page is dirty, and pinned again while it is modified
+    char *page;
+    rc = fileHandle.pinPage(1, page);
+    assert(rc == success);
+    memset(page, 'b', PAGE_SIZE);
+    rc = fileHandle.unpinPage(1, true);
+    assert(rc == success);
+    rc = fileHandle.pinPage(1, page);
+    assert(rc == success);
+    IOStats before = pfm->getIOStats(fileName);
+    if (pfm->bufferManager.flushFile(fileName) != BUFFER_PAGE_PINNED ||
+            pfm->flush() != BUFFER_PAGE_PINNED)
+        failed = -1;
+    if ((pfm->getIOStats(fileName) - before).writeCalls != 0)
+        failed = -1;
+    rc = fileHandle.unpinPage(1, false);
+    assert(rc == success);
+    rc = pfm->bufferManager.flushFile(fileName);
+    assert(rc == success);
+    if ((pfm->getIOStats(fileName) - before).writeCalls != 1)
+        failed = -1;
+
+    // written through by the second holder, though it did not modify the page
+    rc = pfm->setWritePolicy(WRITE_IMMEDIATE);
+    assert(rc == success);
+    char *other;
+    rc = fileHandle.pinPage(2, page);
+    assert(rc == success);
+    rc = fileHandle.pinPage(2, other);
+    assert(rc == success);
+    memset(page, 'c', PAGE_SIZE);
+    before = pfm->getIOStats(fileName);
+    rc = fileHandle.unpinPage(2, true);
+    assert(rc == success);
+    if ((pfm->getIOStats(fileName) - before).writeCalls != 0)
+        failed = -1;
+    rc = fileHandle.unpinPage(2, false);
+    assert(rc == success);
+    if ((pfm->getIOStats(fileName) - before).writeCalls != 1)
+        failed = -1;
+
+    free(data);
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success);
+    rc = pfm->destroyFile(fileName.c_str());
+    assert(rc == success);
+
+    if (failed != 0) {
+        cout << "Test Case 38 Failed!" << endl << endl;
+        return -1;
+    }
+    cout << "Test Case 38 Passed!" << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    PagedFileManager *pfm = PagedFileManager::instance(); // To test the functionality of the paged file manager
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance(); // To test the functionality of the record-based file manager
+
+    remove("test");
+    remove("test_1");
+    remove("test_2");
+    remove("test_3");
+    remove("test_4");
+    remove("test_5");
+    vector<int> gradeFail(11,0);
+    int rc = RBFTest_1(pfm);
+    if (rc == 0) {
+        total += 5;
+        gradeFail[0] = 1;
+    }
+    rc = RBFTest_2(pfm); 
+    if (rc == 0) {
+        total += 5;
+        gradeFail[1] = 1;
+    }
+    rc = RBFTest_3(pfm);
+    if (rc == 0) {
+        total += 5;
+        gradeFail[2] = 1;
+    }
+    rc = RBFTest_4(pfm);
+    if (rc == 0) {
+        total += 5;
+        gradeFail[3] = 1;
+    }
+    rc = RBFTest_5(pfm); 
+    if (rc == 0) {
+        total += 5;
+        gradeFail[4] = 1;
+    }
+    rc = RBFTest_6(pfm);
+    if (rc == 0) {
+        total += 5;
+        gradeFail[5] = 1;
+    }
+    rc = RBFTest_7(pfm);
+    if (rc == 0) {
+        total += 5;
+        gradeFail[6] = 1;
+    }
+    rc = RBFTest_8(rbfm);
+    if (rc == 0) {
+        total += 5;
+        gradeFail[7] = 1;
+    }
+    
+    vector<RID> rids;
+    vector<int> sizes;
+    rc = RBFTest_9(rbfm, rids, sizes);
+    if (rc == 0) {
+        total += 5;
+        gradeFail[8] = 1;
+    }
+    rc = RBFTest_10(rbfm, rids, sizes);
+    if (rc == 0) {
+        total += 5;
+        gradeFail[9] = 1;
+    }
+    
+    rc = RBFTest_11(rbfm);
+    if (rc == 0) {
+        total += 20;
+        gradeFail[10] = 1;
+    }
+    
+    rc = RBFTest_12(rbfm);
+    if (rc != 0) {
+        cout << "Didn't implement variable-length records efficiently" << endl;
+    }
+
+    rc = RBFTest_13(pfm);
+    if (rc != 0) {
+        cout << "Buffer pool test failed" << endl;
+    }
+
+    rc = RBFTest_14(pfm);
+    if (rc != 0) {
+        cout << "Deferred write test failed" << endl;
+    }
+
+    rc = RBFTest_15(pfm);
+    if (rc != 0) {
+        cout << "Direct I/O test failed" << endl;
+    }
+
+    rc = RBFTest_16(pfm);
+    if (rc != 0) {
+        cout << "Memory mapped read test failed" << endl;
+    }
+
+    rc = RBFTest_17(rbfm);
+    if (rc != 0) {
+        cout << "Free space map test failed" << endl;
+    }
+
+    rc = RBFTest_18(pfm);
+    if (rc != 0) {
+        cout << "Free space lists test failed" << endl;
+    }
+
+    rc = RBFTest_19(pfm);
+    if (rc != 0) {
+        cout << "Extent preallocation test failed" << endl;
+    }
+
+    rc = RBFTest_20(rbfm);
+    if (rc != 0) {
+        cout << "Page size test failed" << endl;
+    }
+
+    rc = RBFTest_21(pfm, rbfm);
+    if (rc != 0) {
+        cout << "Write-ahead log test failed" << endl;
+    }
+
+    rc = RBFTest_22(pfm);
+    if (rc != 0) {
+        cout << "I/O statistics test failed" << endl;
+    }
+
+    rc = RBFTest_23(pfm);
+    if (rc != 0) {
+        cout << "Batch page I/O test failed" << endl;
+    }
+    rc = RBFTest_24(pfm, rbfm);
+    if (rc != 0) {
+        cout << "Multi-threaded file test failed" << endl;
+    }
+    rc = RBFTest_25(rbfm);
+    if (rc != 0) {
+        cout << "Compressed file test failed" << endl;
+    }
+    rc = RBFTest_26(pfm, rbfm);
+    if (rc != 0) {
+        cout << "Record field offsets test failed" << endl;
+    }
+    rc = RBFTest_27(rbfm);
+    if (rc != 0) {
+        cout << "Batch insert test failed" << endl;
+    }
+    rc = RBFTest_28(rbfm);
+    if (rc != 0) {
+        cout << "Scan condition test failed" << endl;
+    }
+    rc = RBFTest_29(rbfm);
+    if (rc != 0) {
+        cout << "Version descriptor test failed" << endl;
+    }
+    rc = RBFTest_30(rbfm);
+    if (rc != 0) {
+        cout << "Version translation test failed" << endl;
+    }
+    rc = RBFTest_31(rbfm);
+    if (rc != 0) {
+        cout << "Zone map test failed" << endl;
+    }
+    rc = RBFTest_32(rbfm);
+    if (rc != 0) {
+        cout << "Parallel scan test failed" << endl;
+    }
+    rc = RBFTest_33(rbfm);
+    if (rc != 0) {
+        cout << "Batch scan test failed" << endl;
+    }
+    rc = RBFTest_34(rbfm);
+    if (rc != 0) {
+        cout << "PAX page test failed" << endl;
+    }
+    rc = RBFTest_35(rbfm);
+    if (rc != 0) {
+        cout << "Predicate kernel test failed" << endl;
+    }
+    rc = RBFTest_36(rbfm);
+    if (rc != 0) {
+        cout << "Free space map test failed" << endl;
+    }
+    rc = RBFTest_37(pfm);
+    if (rc != 0) {
+        cout << "Read ahead test failed" << endl;
+    }
+    rc = RBFTest_38(pfm);
+    if (rc != 0) {
+        cout << "Pinned flush test failed" << endl;
     }
      
     cout << "Grade is: " << total << endl;
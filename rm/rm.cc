@@ -159,10 +159,23 @@ RC RM_ScanIterator::getNextTuple(RID &rid, void *data) {
 	else
 		return SUCC;
 }
+RC RM_ScanIterator::getNextBatch(void *buffer, unsigned capacity, vector<RID> &rids,
+		unsigned &count) {
+	RC rc = rbfm_si.getNextBatch(buffer, capacity, rids, count);
+	return rc == RBFM_EOF ? RM_EOF : rc;
+}
 RC RM_ScanIterator::close() {
 	return rbfm_si.close();
 }
 
+RC RM_ParallelScanIterator::getNextTuple(RID &rid, void *data) {
+	RC rc = rbfm_psi.getNextRecord(rid, data);
+	return rc == RBFM_EOF ? RM_EOF : rc;
+}
+RC RM_ParallelScanIterator::close() {
+	return rbfm_psi.close();
+}
+
 RelationManager* RelationManager::instance()
 {
     if(!_rm)
@@ -184,13 +197,14 @@ RelationManager::~RelationManager()
 
 
 
-RC RelationManager::createTable(const string &tableName, const vector<Attribute> &attrs)
+RC RelationManager::createTable(const string &tableName, const vector<Attribute> &attrs,
+		const unsigned flags)
 {
 	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
 	VersionManager *vm = VersionManager::instance();
 	RC rc;
 	// create the file
-	rc = rbfm->createFile(tableName);
+	rc = rbfm->createFile(tableName, PAGE_SIZE, flags);
 	if (rc != SUCC) {
 		cerr << "RelationManager::createTable: error create file " << rc << endl;
 		return rc;
@@ -316,6 +330,28 @@ RC RelationManager::getAllAttributes(const string &tableName, vector<Attribute>
 	return SUCC;
 }
 
+// get the compiled descriptor of the current version, the version attribute included
+RC RelationManager::getDescriptor(const string &tableName, VersionDescriptorPtr &descriptor)
+{
+	VersionManager *vm = VersionManager::instance();
+	VersionNumber curVer(0);
+	RC rc;
+
+	rc = vm->getVersionNumber(tableName, curVer);
+	if (rc != SUCC) {
+		cerr << "getDescriptor: get version number error " << rc << endl;
+		return rc;
+	}
+
+	rc = vm->getDescriptor(tableName, descriptor, curVer);
+	if (rc != SUCC) {
+		cerr << "getDescriptor: get descriptor error " << rc << endl;
+		return rc;
+	}
+
+	return SUCC;
+}
+
 RC RelationManager::openTable(const string &tableName, FileHandle *&fileHandle) {
 	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
 	RC rc;
@@ -442,11 +478,11 @@ bool RelationManager::isIndexExist(const string &tableName, const string &attrib
 
 RC RelationManager::insertIndex(const string &tableName, const RID &rid) {
 	RC rc;
-	vector<Attribute> attrs;
+	VersionDescriptorPtr descriptor;
 	IndexManager *ix = IndexManager::instance();
 
 	// get attribute
-	rc = getAllAttributes(tableName, attrs);
+	rc = getDescriptor(tableName, descriptor);
 	if (rc != SUCC) {
 		cerr << "insertIndex: getAttributes error " << rc << endl;
 		return rc;
@@ -455,7 +491,7 @@ RC RelationManager::insertIndex(const string &tableName, const RID &rid) {
 	char key[PAGE_SIZE];
 
 	// iterate to see it there exists an index file
-	for (Attribute attr : attrs) {
+	for (const Attribute &attr : descriptor->attrs) {
 		if (isIndexExist(tableName, attr.name)) {
 			// open the index file
 			FileHandle *fileHandle;
@@ -482,11 +518,11 @@ RC RelationManager::insertIndex(const string &tableName, const RID &rid) {
 }
 RC RelationManager::deleteIndex(const string &tableName, const RID &rid) {
 	RC rc;
-	vector<Attribute> attrs;
+	VersionDescriptorPtr descriptor;
 	IndexManager *ix = IndexManager::instance();
 
 	// get attribute
-	rc = getAllAttributes(tableName, attrs);
+	rc = getDescriptor(tableName, descriptor);
 	if (rc != SUCC) {
 		cerr << "deleteIndex: getAttributes error " << rc << endl;
 		return rc;
@@ -495,7 +531,7 @@ RC RelationManager::deleteIndex(const string &tableName, const RID &rid) {
 	char key[PAGE_SIZE];
 
 	// iterate to see it there exists an index file
-	for (Attribute attr : attrs) {
+	for (const Attribute &attr : descriptor->attrs) {
 		if (isIndexExist(tableName, attr.name)) {
 			// open the index file
 			FileHandle *fileHandle;
@@ -580,12 +616,13 @@ RC RelationManager::insertTuple(const string &tableName, const void *data, RID &
 		return rc;
 	}
 	// get the current version attribute
-	vector<Attribute> attrs;
-	rc = vm->getAttributes(tableName, attrs, curVer);
+	VersionDescriptorPtr descriptor;
+	rc = vm->getDescriptor(tableName, descriptor, curVer);
 	if (rc != SUCC) {
 		cerr << "insertTuple: get attribute error " << rc << endl;
 		return rc;
 	}
+	const vector<Attribute> &attrs = descriptor->attrs;
 
 	// get the size of the record
 	unsigned recordSize = getRecordSize(data, attrs);
@@ -610,6 +647,70 @@ RC RelationManager::insertTuple(const string &tableName, const void *data, RID &
     return SUCC;
 }
 
+RC RelationManager::insertTuples(const string &tableName, const vector<const void *> &data,
+		vector<RID> &rids)
+{
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+	VersionManager *vm = VersionManager::instance();
+	RC rc;
+
+	// open the file
+	FileHandle *fileHandle;
+	rc = openTable(tableName, fileHandle);
+	if (rc != SUCC) {
+		cerr << "insertTuples: open table " << tableName << " error " << rc << endl;
+		return rc;
+	}
+
+	// get the current version
+	VersionNumber curVer;
+	rc = vm->getVersionNumber(tableName, curVer);
+	if (rc != SUCC) {
+		cerr << "insertTuples: get version error " << rc << endl;
+		return rc;
+	}
+	// get the current version attribute
+	VersionDescriptorPtr descriptor;
+	rc = vm->getDescriptor(tableName, descriptor, curVer);
+	if (rc != SUCC) {
+		cerr << "insertTuples: get attribute error " << rc << endl;
+		return rc;
+	}
+	const vector<Attribute> &attrs = descriptor->attrs;
+
+	// add version to the tuples, kept one after another in a buffer
+	vector<unsigned> recordSizes(data.size());
+	size_t bufferSize = 0;
+	for (unsigned i = 0; i < data.size(); ++i) {
+		recordSizes[i] = getRecordSize(data[i], attrs);
+		bufferSize += sizeof(int) + recordSizes[i];
+	}
+	vector<char> buffer(bufferSize + 1);
+	vector<const void *> tuples(data.size());
+	size_t offset = 0;
+	for (unsigned i = 0; i < data.size(); ++i) {
+		addVersion2Data(&buffer[offset], data[i], curVer, recordSizes[i]);
+		tuples[i] = &buffer[offset];
+		offset += sizeof(int) + recordSizes[i];
+	}
+
+	// insert the tuples, each page is written once
+	rc = rbfm->insertRecords(*fileHandle, attrs, tuples, rids);
+	if (rc != SUCC)
+		cerr << "insertTuples: insert records " << rc << endl;
+
+	// insert the inserted ones to the index
+	for (unsigned i = 0; i < rids.size(); ++i) {
+		RC indexRC = insertIndex(tableName, rids[i]);
+		if (indexRC != SUCC) {
+			cerr << "insertTuples: insert index error " << indexRC << endl;
+			return indexRC;
+		}
+	}
+
+	return rc;
+}
+
 RC RelationManager::deleteTuples(const string &tableName)
 {
 	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
@@ -656,12 +757,13 @@ RC RelationManager::deleteTuple(const string &tableName, const RID &rid)
 	}
 
 	// get the current version attribute
-	vector<Attribute> attrs;
-	rc = getAllAttributes(tableName, attrs);
+	VersionDescriptorPtr descriptor;
+	rc = getDescriptor(tableName, descriptor);
 	if (rc != SUCC) {
 		cerr << "deleteTuple: get attribute error " << rc << endl;
 		return rc;
 	}
+	const vector<Attribute> &attrs = descriptor->attrs;
 
 	rc = rbfm->deleteRecord(*fileHandle, attrs, rid);
 	if (rc != SUCC) {
@@ -695,12 +797,13 @@ RC RelationManager::updateTuple(const string &tableName, const void *data,
 		return rc;
 	}
 	// get the current version attribute
-	vector<Attribute> attrs;
-	rc = vm->getAttributes(tableName, attrs, curVer);
+	VersionDescriptorPtr descriptor;
+	rc = vm->getDescriptor(tableName, descriptor, curVer);
 	if (rc != SUCC) {
 		cerr << "updateTuple: get attribute error " << rc << endl;
 		return rc;
 	}
+	const vector<Attribute> &attrs = descriptor->attrs;
 
 	// get the size of the record
 	unsigned recordSize = getRecordSize(data, attrs);
@@ -735,12 +838,13 @@ RC RelationManager::readTuple(const string &tableName, const RID &rid, void *dat
 	}
 
 	// get the current version attribute
-	vector<Attribute> attrs;
-	rc = getAllAttributes(tableName, attrs);
+	VersionDescriptorPtr descriptor;
+	rc = getDescriptor(tableName, descriptor);
 	if (rc != SUCC) {
 		cerr << "readTuple: read the attribute " << rc << endl;
 		return rc;
 	}
+	const vector<Attribute> &attrs = descriptor->attrs;
 
 	rc = rbfm->readRecord(*fileHandle, attrs, rid, tuple);
 	if (rc != SUCC) {
@@ -783,12 +887,13 @@ RC RelationManager::readAttribute(const string &tableName,
 	}
 
 	// get the current version attribute
-	vector<Attribute> attrs;
-	rc = getAllAttributes(tableName, attrs);
+	VersionDescriptorPtr descriptor;
+	rc = getDescriptor(tableName, descriptor);
 	if (rc != SUCC) {
 		cerr << "RelationManager::readAttribute: get attribute error " << rc << endl;
 		return rc;
 	}
+	const vector<Attribute> &attrs = descriptor->attrs;
 
 	// read the attribute
 	rc = rbfm->readAttribute(*fileHandle, attrs, rid, attributeName, data);
@@ -873,6 +978,67 @@ RC RelationManager::scan(const string &tableName,
 	return SUCC;
 }
 
+RC RelationManager::parallelScan(const string &tableName,
+      const string &conditionAttribute,
+      const CompOp compOp,
+      const void *value,
+      const vector<string> &attributeNames,
+      const unsigned numThreads,
+      RM_ParallelScanIterator &rm_ParallelScanIterator)
+{
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+	RC rc;
+
+	// the workers open their own handles, this one gives the file
+	FileHandle *fileHandle;
+	rc = openTable(tableName, fileHandle);
+	if (rc != SUCC) {
+		cerr << "RelationManager::parallelScan: open table " << tableName << " error " << rc << endl;
+		return rc;
+	}
+	VersionDescriptorPtr descriptor;
+	rc = getDescriptor(tableName, descriptor);
+	if (rc != SUCC)
+		return rc;
+
+	rc = rbfm->parallelScan(*fileHandle, descriptor->attrs,
+			conditionAttribute, compOp, value,
+			attributeNames, numThreads, rm_ParallelScanIterator.rbfm_psi);
+	if (rc != SUCC) {
+		cerr << "RelationManager::parallelScan: scan initialization error " << rc << endl;
+		return rc;
+	}
+
+	return SUCC;
+}
+
+RC RelationManager::parallelScan(const string &tableName,
+      const string &conditionAttribute,
+      const CompOp compOp,
+      const void *value,
+      const vector<string> &attributeNames,
+      const unsigned numThreads,
+      const ScanSink &sink)
+{
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+	RC rc;
+
+	FileHandle *fileHandle;
+	rc = openTable(tableName, fileHandle);
+	if (rc != SUCC) {
+		cerr << "RelationManager::parallelScan: open table " << tableName << " error " << rc << endl;
+		return rc;
+	}
+	VersionDescriptorPtr descriptor;
+	rc = getDescriptor(tableName, descriptor);
+	if (rc != SUCC)
+		return rc;
+
+	return rbfm->parallelScan(*fileHandle, descriptor->attrs,
+			conditionAttribute, compOp, value,
+			attributeNames, numThreads, sink);
+}
+
 // Extra credit
 RC RelationManager::dropAttribute(const string &tableName, const string &attributeName)
 {
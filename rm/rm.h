@@ -34,10 +34,25 @@ public:
 
   // "data" follows the same format as RelationManager::insertTuple()
   RC getNextTuple(RID &rid, void *data);
+  // fill the buffer with as many tuples as fit, one after another
+  RC getNextBatch(void *buffer, unsigned capacity, vector<RID> &rids, unsigned &count);
   RC close();
   RBFM_ScanIterator rbfm_si;
 };
 
+// RM_ParallelScanIterator hands out the tuples found by the workers of a
+// parallel scan, in no particular order
+class RM_ParallelScanIterator {
+public:
+  RM_ParallelScanIterator() {};
+  ~RM_ParallelScanIterator() {};
+
+  // "data" follows the same format as RelationManager::insertTuple()
+  RC getNextTuple(RID &rid, void *data);
+  RC close();
+  RBFM_ParallelScanIterator rbfm_psi;
+};
+
 class RM_IndexScanIterator {
  public:
   RM_IndexScanIterator() {};  	// Constructor
@@ -55,15 +70,22 @@ class RelationManager
 public:
   static RelationManager* instance();
 
-  RC createTable(const string &tableName, const vector<Attribute> &attrs);
+  // flags are the ones of RecordBasedFileManager::createFile, such as FILE_PAX_PAGES
+  RC createTable(const string &tableName, const vector<Attribute> &attrs,
+      const unsigned flags = 0);
 
   RC deleteTable(const string &tableName);
 
   RC getAttributes(const string &tableName, vector<Attribute> &attrs);
   RC getAllAttributes(const string &tableName, vector<Attribute> &attrs);
+  // get the compiled descriptor of the current version, the version attribute included
+  RC getDescriptor(const string &tableName, VersionDescriptorPtr &descriptor);
 
   RC insertTuple(const string &tableName, const void *data, RID &rid);
 
+  // insert tuples in a batch, rids gets the ones inserted
+  RC insertTuples(const string &tableName, const vector<const void *> &data, vector<RID> &rids);
+
   RC deleteTuples(const string &tableName);
 
   RC deleteTuple(const string &tableName, const RID &rid);
@@ -85,6 +107,24 @@ public:
       const vector<string> &attributeNames, // a list of projected attributes
       RM_ScanIterator &rm_ScanIterator);
 
+  // scan with numThreads worker threads, the tuples come in no particular order
+  RC parallelScan(const string &tableName,
+      const string &conditionAttribute,
+      const CompOp compOp,
+      const void *value,
+      const vector<string> &attributeNames,
+      const unsigned numThreads,
+      RM_ParallelScanIterator &rm_ParallelScanIterator);
+  // scan with numThreads worker threads, each tuple is given to the sink by
+  // the worker that found it, e.g. to aggregate per worker
+  RC parallelScan(const string &tableName,
+      const string &conditionAttribute,
+      const CompOp compOp,
+      const void *value,
+      const vector<string> &attributeNames,
+      const unsigned numThreads,
+      const ScanSink &sink);
+
   RC createIndex(const string &tableName, const string &attributeName);
 
   RC destroyIndex(const string &tableName, const string &attributeName);